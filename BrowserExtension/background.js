@@ -189,6 +189,50 @@ async function sendToLDM(url, showNotification = true, referer = null) {
     }
 }
 
+// Submit a whole list in one POST /downloads; returns the number added
+async function sendBatchToLDM(urls, referer = null) {
+    const body = JSON.stringify(urls.map(url => referer ? { url: url, referer: referer } : { url: url }));
+    const post = () => fetch(LDM_URL + "/downloads", {
+        method: "POST",
+        mode: "cors",
+        headers: {
+            "Content-Type": "application/json",
+            "X-Auth-Token": authToken || ""
+        },
+        body: body
+    });
+
+    try {
+        if (!authToken) {
+            await fetchAuthToken();
+        }
+
+        let response = await post();
+        if (response.status === 401) {
+            // Token stale, refresh and retry
+            authToken = null;
+            if (!(await fetchAuthToken())) {
+                return 0;
+            }
+            response = await post();
+        }
+        if (!response.ok) {
+            return 0;
+        }
+
+        const data = await response.json();
+        const ids = data.ids || [];
+        urls.forEach((url, i) => addToRecent(url, ids[i] >= 0));
+        if (data.added > 0) {
+            updateStats(true);
+        }
+        return data.added || 0;
+    } catch (e) {
+        console.error("LDM Connection Error:", e.message);
+        return 0;
+    }
+}
+
 // ============================================
 // NOTIFICATIONS
 // ============================================
@@ -388,11 +432,7 @@ chrome.contextMenus.onClicked.addListener(function(info, tab) {
             mediaOnly: mediaOnly
         }, async function(response) {
             if (response && response.links && response.links.length > 0) {
-                let count = 0;
-                for (const url of response.links) {
-                    const result = await sendToLDM(url, false, referer);
-                    if (result.success) count++;
-                }
+                const count = await sendBatchToLDM(response.links, referer);
 
                 if (settings.notificationsEnabled) {
                     showDownloadNotification(
@@ -428,11 +468,7 @@ chrome.commands.onCommand.addListener(function(command) {
                     mediaOnly: true
                 }, async function(response) {
                     if (response && response.links && response.links.length > 0) {
-                        let count = 0;
-                        for (const url of response.links) {
-                            const result = await sendToLDM(url, false, pageReferer);
-                            if (result.success) count++;
-                        }
+                        const count = await sendBatchToLDM(response.links, pageReferer);
 
                         if (settings.notificationsEnabled) {
                             showDownloadNotification(
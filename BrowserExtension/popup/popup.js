@@ -2,6 +2,8 @@ const LDM_URL = "http://127.0.0.1:45678";
 let authToken = null;
 let isConnected = false;
 let statusInterval = null;
+let eventSource = null;
+let activeDownloads = new Map();
 
 // ============================================
 // INITIALIZATION
@@ -38,6 +40,9 @@ window.addEventListener('unload', function() {
     if (statusInterval) {
         clearInterval(statusInterval);
     }
+    if (eventSource) {
+        eventSource.close();
+    }
 });
 
 // ============================================
@@ -205,6 +210,12 @@ function updateStats(url, success) {
 // ============================================
 
 function startStatusPolling() {
+    // Prefer the pushed event stream; poll only if it is unavailable
+    if (typeof EventSource !== 'undefined' && isConnected) {
+        startEventStream();
+        return;
+    }
+
     // Fetch immediately
     fetchDownloadStatus();
 
@@ -216,6 +227,65 @@ function startStatusPolling() {
     }, 1000);
 }
 
+function startEventStream() {
+    eventSource = new EventSource(LDM_URL + "/events");
+
+    eventSource.addEventListener('snapshot', function(e) {
+        const data = JSON.parse(e.data);
+        activeDownloads = new Map();
+        (data.downloads || []).forEach(dl => activeDownloads.set(dl.id, dl));
+        renderEventState();
+    });
+
+    // Deltas only carry what changed; merge them into the last known state.
+    // Progress for a download not known here is dropped: it is no longer
+    // active, and one that becomes active arrives with a full status event.
+    ['added', 'progress', 'status', 'completed'].forEach(type => {
+        eventSource.addEventListener(type, function(e) {
+            const delta = JSON.parse(e.data);
+            const known = activeDownloads.get(delta.id);
+            if (!known && !delta.status) {
+                return;
+            }
+            const dl = Object.assign(known || {}, delta);
+            if (dl.status && dl.status !== 'Downloading') {
+                activeDownloads.delete(delta.id);
+            } else {
+                activeDownloads.set(delta.id, dl);
+            }
+            renderEventState();
+        });
+    });
+
+    eventSource.addEventListener('removed', function(e) {
+        const data = JSON.parse(e.data);
+        (data.ids || []).forEach(id => activeDownloads.delete(id));
+        renderEventState();
+    });
+
+    eventSource.onerror = function() {
+        // Server gone or too old for /events: fall back to polling
+        if (eventSource.readyState === EventSource.CLOSED) {
+            eventSource = null;
+            fetchDownloadStatus();
+            statusInterval = setInterval(function() {
+                if (isConnected) {
+                    fetchDownloadStatus();
+                }
+            }, 1000);
+        }
+    };
+}
+
+function renderEventState() {
+    const downloads = Array.from(activeDownloads.values());
+    renderActiveDownloads({
+        activeDownloads: downloads.length,
+        totalSpeed: downloads.reduce((sum, dl) => sum + (dl.speed || 0), 0),
+        downloads: downloads
+    });
+}
+
 async function fetchDownloadStatus() {
     if (!isConnected) {
         renderActiveDownloads({ activeDownloads: 0, totalSpeed: 0, downloads: [] });
@@ -552,30 +622,29 @@ async function downloadBulk() {
     }
 
     let successCount = 0;
-    let failCount = 0;
+    let failCount = urls.length;
 
-    for (const url of urls) {
-        try {
-            const response = await fetch(LDM_URL + "/download", {
-                method: "POST",
-                mode: "cors",
-                headers: {
-                    "Content-Type": "application/json",
-                    "X-Auth-Token": authToken || ""
-                },
-                body: JSON.stringify({ url: url })
-            });
+    // The whole list goes in one request
+    try {
+        const response = await fetch(LDM_URL + "/downloads", {
+            method: "POST",
+            mode: "cors",
+            headers: {
+                "Content-Type": "application/json",
+                "X-Auth-Token": authToken || ""
+            },
+            body: JSON.stringify(urls.map(url => ({ url: url })))
+        });
 
-            if (response.ok) {
-                successCount++;
-                addToRecent(url, true);
-            } else {
-                failCount++;
-                addToRecent(url, false);
-            }
-        } catch (e) {
-            failCount++;
+        if (response.ok) {
+            const data = await response.json();
+            const ids = data.ids || [];
+            urls.forEach((url, i) => addToRecent(url, ids[i] >= 0));
+            successCount = data.added || 0;
+            failCount = urls.length - successCount;
         }
+    } catch (e) {
+        // Counted as failed
     }
 
     updateStats(null, true);
@@ -24,7 +24,11 @@ std::string Download::GetSavePath() const {
 }
 
 std::string Download::GetStatusString() const {
-  switch (m_status.load()) {
+  return StatusToString(m_status.load());
+}
+
+std::string Download::StatusToString(DownloadStatus status) {
+  switch (status) {
   case DownloadStatus::Queued:
     return "Queued";
   case DownloadStatus::Downloading:
@@ -105,25 +109,80 @@ std::string Download::GetCalculatedChecksum() const {
 void Download::SetFilename(const std::string &filename) {
   std::lock_guard<std::mutex> lock(m_metadataMutex);
   m_filename = filename;
+  Touch();
 }
 
 void Download::SetReferer(const std::string &referer) {
   std::lock_guard<std::mutex> lock(m_metadataMutex);
   m_referer = referer;
+  Touch();
+}
+
+std::string Download::GetResolvedUrl() const {
+  std::lock_guard<std::mutex> lock(m_metadataMutex);
+  if (m_resolvedUrl.empty() ||
+      std::chrono::steady_clock::now() >= m_resolvedUrlExpiry) {
+    return "";
+  }
+  return m_resolvedUrl;
+}
+
+void Download::SetResolvedUrl(const std::string &url,
+                              std::chrono::steady_clock::time_point expiry) {
+  std::lock_guard<std::mutex> lock(m_metadataMutex);
+  m_resolvedUrl = url;
+  m_resolvedUrlExpiry = expiry;
+}
+
+void Download::ClearResolvedUrl() {
+  std::lock_guard<std::mutex> lock(m_metadataMutex);
+  m_resolvedUrl.clear();
 }
 
 void Download::SetProgress(double progress) {
   m_manualProgress.store(progress);
+  Touch();
+}
+
+void Download::Touch() {
+  constexpr uint32_t ALL_CONSUMERS =
+      (1u << static_cast<uint32_t>(ChangeConsumer::Count)) - 1;
+
+  m_generation.fetch_add(1);
+  uint32_t previous = m_dirtyMask.fetch_or(ALL_CONSUMERS);
+  if (previous != ALL_CONSUMERS && m_changeListener) {
+    m_changeListener(*this, ALL_CONSUMERS & ~previous);
+  }
+}
+
+void Download::SetStatus(DownloadStatus status) {
+  if (m_status.exchange(status) == status) {
+    return;
+  }
+  Touch();
+  if (m_indexListener) {
+    m_indexListener(*this);
+  }
 }
 
 void Download::SetCategory(const std::string &category) {
-  std::lock_guard<std::mutex> lock(m_metadataMutex);
-  m_category = category;
+  {
+    std::lock_guard<std::mutex> lock(m_metadataMutex);
+    if (m_category == category) {
+      return;
+    }
+    m_category = category;
+  }
+  Touch();
+  if (m_indexListener) {
+    m_indexListener(*this);
+  }
 }
 
 void Download::SetDescription(const std::string &desc) {
   std::lock_guard<std::mutex> lock(m_metadataMutex);
   m_description = desc;
+  Touch();
 }
 
 void Download::SetSpeed(double speed) {
@@ -152,6 +211,7 @@ void Download::SetSpeed(double speed) {
     m_smoothedSpeed.store(newSmoothed, std::memory_order_relaxed);
     m_speed.store(newSmoothed, std::memory_order_release);  // Release for readers
   }
+  Touch();
 }
 
 void Download::ResetSpeed() {
@@ -159,16 +219,19 @@ void Download::ResetSpeed() {
   m_speed.store(0.0, std::memory_order_relaxed);
   m_smoothedSpeed.store(0.0, std::memory_order_relaxed);
   m_speedSampleCount.store(0, std::memory_order_relaxed);
+  Touch();
 }
 
 void Download::SetErrorMessage(const std::string &msg) {
   std::lock_guard<std::mutex> lock(m_metadataMutex);
   m_errorMessage = msg;
+  Touch();
 }
 
 void Download::SetSavePath(const std::string &path) {
   std::lock_guard<std::mutex> lock(m_metadataMutex);
   m_savePath = path;
+  Touch();
 }
 
 void Download::UpdateLastTryTime() {
@@ -188,17 +251,43 @@ void Download::UpdateLastTryTime() {
     std::lock_guard<std::mutex> lock(m_metadataMutex);
     m_lastTryTime = ss.str();
   }
+  Touch();
 }
 
 void Download::SetExpectedChecksum(const std::string &hash, int type) {
   std::lock_guard<std::mutex> lock(m_metadataMutex);
   m_expectedChecksum = hash;
   m_checksumType = type;
+  Touch();
 }
 
 void Download::SetCalculatedChecksum(const std::string &hash) {
   std::lock_guard<std::mutex> lock(m_metadataMutex);
   m_calculatedChecksum = hash;
+  Touch();
+}
+
+std::string Download::GetETag() const {
+  std::lock_guard<std::mutex> lock(m_metadataMutex);
+  return m_etag;
+}
+
+std::string Download::GetLastModified() const {
+  std::lock_guard<std::mutex> lock(m_metadataMutex);
+  return m_lastModified;
+}
+
+bool Download::HasValidators() const {
+  std::lock_guard<std::mutex> lock(m_metadataMutex);
+  return !m_etag.empty() || !m_lastModified.empty();
+}
+
+void Download::SetValidators(const std::string &etag,
+                             const std::string &lastModified) {
+  std::lock_guard<std::mutex> lock(m_metadataMutex);
+  m_etag = etag;
+  m_lastModified = lastModified;
+  Touch();
 }
 
 void Download::InitializeChunks(int numConnections) {
@@ -273,6 +362,7 @@ void Download::RecalculateProgress() {
   }
 
   m_downloadedSize = totalDownloaded;
+  Touch();
 }
 
 std::string Download::ExtractFilenameFromUrl(const std::string &url) const {
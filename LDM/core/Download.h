@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -19,6 +20,24 @@ enum class DownloadStatus {
   Cancelled
 };
 
+// Explicit scheduling priority, used by the Priority and FairShare queue
+// policies (stored as its integer value)
+enum class DownloadPriority {
+  Low,
+  Normal,
+  High
+};
+
+// Parts of the app that each track which downloads changed since they last
+// looked; every consumer owns one bit of a download's dirty mask
+enum class ChangeConsumer {
+  Database,
+  Table,
+  Status,
+  Events,
+  Count
+};
+
 struct DownloadChunk {
   int64_t startByte;
   int64_t endByte;
@@ -55,12 +74,15 @@ public:
     std::lock_guard<std::mutex> lock(m_metadataMutex);
     return m_referer;
   }
+  // Final URL after redirects; empty when unresolved or expired
+  std::string GetResolvedUrl() const;
   std::string GetFilename() const;
   std::string GetSavePath() const;
   int64_t GetTotalSize() const { return m_totalSize.load(); }
   int64_t GetDownloadedSize() const { return m_downloadedSize.load(); }
   DownloadStatus GetStatus() const { return m_status.load(); }
   std::string GetStatusString() const;
+  static std::string StatusToString(DownloadStatus status);
   std::string GetCategory() const;
   std::string GetDescription() const;
   double GetProgress() const;
@@ -91,12 +113,26 @@ public:
     return m_checksumVerified; 
   }
 
+  // HTTP validators from the server (used for If-Range on resume)
+  std::string GetETag() const;
+  std::string GetLastModified() const;
+  bool HasValidators() const;
+
   // Setters
   void SetFilename(const std::string &filename);
   void SetReferer(const std::string &referer);
-  void SetTotalSize(int64_t size) { m_totalSize.store(size); }
-  void SetDownloadedSize(int64_t size) { m_downloadedSize.store(size); }
-  void SetStatus(DownloadStatus status) { m_status.store(status); }
+  void SetResolvedUrl(const std::string &url,
+                      std::chrono::steady_clock::time_point expiry);
+  void ClearResolvedUrl();
+  void SetTotalSize(int64_t size) {
+    m_totalSize.store(size);
+    Touch();
+  }
+  void SetDownloadedSize(int64_t size) {
+    m_downloadedSize.store(size);
+    Touch();
+  }
+  void SetStatus(DownloadStatus status);
   void SetCategory(const std::string &category);
   void SetDescription(const std::string &desc);
   void SetSpeed(double speed);
@@ -106,9 +142,53 @@ public:
   void UpdateLastTryTime();
   void SetProgress(double progress);  // For yt-dlp downloads
 
+  // Whether the server advertised byte ranges on the last probe
+  bool IsResumable() const { return m_resumable.load(); }
+  void SetResumable(bool resumable) { m_resumable.store(resumable); }
+
+  // Bumped by every setter, so views can skip rows that have not changed
+  // since they were drawn
+  uint64_t GetGeneration() const { return m_generation.load(); }
+
+  // Called when a setter marks the download dirty for consumers that had
+  // already seen its previous state (newlyDirty holds their bits), so a
+  // burst of changes notifies once per consumer until it drains. Set once,
+  // before the download is shared.
+  using ChangeListener =
+      std::function<void(const Download &download, uint32_t newlyDirty)>;
+  void SetChangeListener(ChangeListener listener) {
+    m_changeListener = std::move(listener);
+  }
+  // Clear a consumer's dirty bit before reading the state it will act on;
+  // a change made meanwhile sets the bit again and notifies again
+  void ClearDirty(ChangeConsumer consumer) {
+    m_dirtyMask.fetch_and(~ConsumerBit(consumer));
+  }
+  void ResetDirty() { m_dirtyMask.store(0); }  // Owner's state is current
+  static uint32_t ConsumerBit(ChangeConsumer consumer) {
+    return 1u << static_cast<uint32_t>(consumer);
+  }
+
+  // Called after the status or category actually changes, so the owner can
+  // keep its indexes current. Set once, before the download is shared.
+  using IndexListener = std::function<void(const Download &download)>;
+  void SetIndexListener(IndexListener listener) {
+    m_indexListener = std::move(listener);
+  }
+
+  // Queue priority
+  DownloadPriority GetPriority() const { return m_priority.load(); }
+  void SetPriority(DownloadPriority priority) {
+    m_priority.store(priority);
+    Touch();
+  }
+
   // yt-dlp download flag
   bool IsYtDlpDownload() const { return m_isYtDlpDownload.load(); }
-  void SetYtDlpDownload(bool isYtDlp) { m_isYtDlpDownload.store(isYtDlp); }
+  void SetYtDlpDownload(bool isYtDlp) {
+    m_isYtDlpDownload.store(isYtDlp);
+    Touch();
+  }
 
   // Retry support
   void SetMaxRetries(int maxRetries) { m_maxRetries.store(maxRetries); }
@@ -121,8 +201,12 @@ public:
   void SetChecksumVerified(bool verified) { 
     std::lock_guard<std::mutex> lock(m_metadataMutex);
     m_checksumVerified = verified; 
+    Touch();
   }
 
+  // HTTP validators
+  void SetValidators(const std::string &etag, const std::string &lastModified);
+
   // Chunk management
   void InitializeChunks(int numConnections);
   std::vector<DownloadChunk> GetChunksCopy() const;
@@ -133,9 +217,13 @@ public:
   void RecalculateProgress();
 
 private:
+  void Touch();  // Bump the generation and mark dirty for all consumers
+
   int m_id;
   std::string m_url;
   std::string m_referer;  // Page URL for protected downloads
+  std::string m_resolvedUrl;  // Redirect target cache (runtime only)
+  std::chrono::steady_clock::time_point m_resolvedUrlExpiry;
   std::string m_filename;
   std::string m_savePath;
   std::atomic<int64_t> m_totalSize;
@@ -147,6 +235,12 @@ private:
   std::atomic<double> m_smoothedSpeed{0.0};  // EMA smoothed speed
   std::atomic<int> m_speedSampleCount{0};    // Sample count for initial ramp-up
   std::atomic<bool> m_isYtDlpDownload{false}; // True if handled by yt-dlp
+  std::atomic<bool> m_resumable{false};        // Server accepts byte ranges
+  std::atomic<DownloadPriority> m_priority{DownloadPriority::Normal};
+  IndexListener m_indexListener;
+  std::atomic<uint64_t> m_generation{0};
+  std::atomic<uint32_t> m_dirtyMask{0};  // One bit per ChangeConsumer
+  ChangeListener m_changeListener;
   std::atomic<double> m_manualProgress{-1.0}; // Manual progress for yt-dlp (-1 = use calculated)
   std::string m_lastTryTime;
   std::string m_errorMessage;
@@ -162,6 +256,10 @@ private:
   int m_checksumType = 0;           // 0=None, 1=MD5, 2=SHA256
   bool m_checksumVerified = false;  // Was checksum verified successfully?
 
+  // Validators of the remote entity the partial data belongs to
+  std::string m_etag;
+  std::string m_lastModified;
+
   std::vector<DownloadChunk> m_chunks;
   mutable std::mutex m_chunksMutex;
   mutable std::mutex m_metadataMutex;
@@ -1,11 +1,20 @@
 #include "DownloadEngine.h"
+#include "../utils/Manifest.h"
+#include "../utils/SegmentState.h"
+#include "../utils/SpeedLimiter.h"
 #include <algorithm>
+#include <bcrypt.h>
 #include <cctype>
 #include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <ctime>
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <map>
+
+#pragma comment(lib, "bcrypt.lib")
 
 
 namespace Config {
@@ -20,6 +29,15 @@ constexpr int BASE_CHUNK_RETRY_MS = 500;
 constexpr int BASE_DOWNLOAD_RETRY_MS = 2000;  // Longer delay between download retries
 constexpr int64_t LARGE_BUFFER_THRESHOLD = 8 * 1024 * 1024;
 constexpr int SPEED_UPDATE_INTERVAL_MS = 1000;  // Update speed every 1 second
+constexpr int RESOLVED_URL_TTL_SEC = 600;  // Re-resolve redirects after 10 minutes
+constexpr int RESOLVED_URL_EXPIRY_MARGIN_SEC = 30;  // Slack before signed links expire
+constexpr int MAX_SMALL_FILE_WORKERS = 4;  // Hosts served concurrently by a batch
+constexpr DWORD SMALL_FILE_READ_SIZE = 64 * 1024;
+constexpr size_t MAX_PROBES_PER_HOST = 4;  // Concurrent link checks per host
+constexpr size_t MAX_PROBE_WORKERS = 16;   // Concurrent link checks overall
+constexpr int MAX_PROBE_REDIRECTS = 5;     // Redirects WinINet left to us
+constexpr size_t SEGMENTS_AHEAD_PER_WORKER = 2;  // Fetched but unwritten segments
+constexpr int SEGMENT_WAIT_MS = 200;  // Writer's abort-check interval
 } // namespace Config
 
 // Helper to create directories recursively (handles nested paths)
@@ -70,6 +88,39 @@ static std::string ExtractOriginFromUrl(const std::string &url) {
   return url.substr(0, hostEnd) + "/";
 }
 
+// Helper to split a URL into the parts InternetConnect/HttpOpenRequest need
+static bool CrackUrl(const std::string &url, std::string &host,
+                     INTERNET_PORT &port, std::string &objectPath,
+                     bool &secure) {
+  char hostBuffer[256] = {0};
+  char pathBuffer[2048] = {0};
+  char extraBuffer[2048] = {0};
+  URL_COMPONENTSA components = {};
+  components.dwStructSize = sizeof(components);
+  components.lpszHostName = hostBuffer;
+  components.dwHostNameLength = sizeof(hostBuffer);
+  components.lpszUrlPath = pathBuffer;
+  components.dwUrlPathLength = sizeof(pathBuffer);
+  components.lpszExtraInfo = extraBuffer;
+  components.dwExtraInfoLength = sizeof(extraBuffer);
+  if (!InternetCrackUrlA(url.c_str(), 0, 0, &components)) {
+    return false;
+  }
+  if (components.nScheme != INTERNET_SCHEME_HTTP &&
+      components.nScheme != INTERNET_SCHEME_HTTPS) {
+    return false;
+  }
+
+  host = hostBuffer;
+  port = components.nPort;
+  secure = components.nScheme == INTERNET_SCHEME_HTTPS;
+  objectPath = std::string(pathBuffer) + extraBuffer;
+  if (objectPath.empty()) {
+    objectPath = "/";
+  }
+  return !host.empty();
+}
+
 // Helper to get WinINet error description with user-friendly messages
 static std::string GetWinINetError(DWORD errorCode) {
   char buffer[512] = {0};
@@ -180,6 +231,110 @@ static std::string GetHttpStatusError(DWORD statusCode) {
   }
 }
 
+// Helper to read a string response header (empty if the server didn't send it)
+static std::string QueryHeaderString(HINTERNET hRequest, DWORD infoLevel) {
+  char buffer[512] = {0};
+  DWORD size = sizeof(buffer);
+  if (!HttpQueryInfoA(hRequest, infoLevel, buffer, &size, NULL)) {
+    return "";
+  }
+  return std::string(buffer, size);
+}
+
+// Pick the validator to send in If-Range. Weak ETags never match there,
+// so fall back to Last-Modified for those.
+static std::string GetIfRangeValidator(const std::string &etag,
+                                       const std::string &lastModified) {
+  if (!etag.empty() && etag.compare(0, 2, "W/") != 0) {
+    return etag;
+  }
+  return lastModified;
+}
+
+// Compare stored validators against the ones the server just reported.
+// Only validators known on both sides are compared.
+static bool ValidatorsDiffer(const std::string &storedEtag,
+                             const std::string &storedLastModified,
+                             const std::string &etag,
+                             const std::string &lastModified) {
+  if (!storedEtag.empty() && !etag.empty()) {
+    return storedEtag != etag;
+  }
+  if (!storedLastModified.empty() && !lastModified.empty()) {
+    return storedLastModified != lastModified;
+  }
+  return false;
+}
+
+// Helper to get the URL a request ended up at after WinINet followed redirects
+static std::string QueryFinalUrl(HINTERNET hRequest) {
+  DWORD size = 0;
+  InternetQueryOptionA(hRequest, INTERNET_OPTION_URL, NULL, &size);
+  if (size == 0) {
+    return "";
+  }
+  std::string url(size, '\0');
+  if (!InternetQueryOptionA(hRequest, INTERNET_OPTION_URL, &url[0], &size)) {
+    return "";
+  }
+  url.resize(strlen(url.c_str()));
+  return url;
+}
+
+// Decrypt an HLS AES-128 segment (CBC, PKCS#7 padding) in place
+static bool DecryptAes128Cbc(const std::string &key, const uint8_t iv[16],
+                             std::vector<char> &data) {
+  if (key.size() != 16 || data.empty() || data.size() % 16 != 0) {
+    return false;
+  }
+
+  BCRYPT_ALG_HANDLE hAlg = NULL;
+  BCRYPT_KEY_HANDLE hKey = NULL;
+  bool decrypted = false;
+  if (BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_AES_ALGORITHM,
+                                                 NULL, 0)) &&
+      BCRYPT_SUCCESS(BCryptSetProperty(
+          hAlg, BCRYPT_CHAINING_MODE, (PUCHAR)BCRYPT_CHAIN_MODE_CBC,
+          sizeof(BCRYPT_CHAIN_MODE_CBC), 0)) &&
+      BCRYPT_SUCCESS(BCryptGenerateSymmetricKey(
+          hAlg, &hKey, NULL, 0, (PUCHAR)key.data(), 16, 0))) {
+    UCHAR chainIv[16];  // BCryptDecrypt advances the IV it is given
+    memcpy(chainIv, iv, sizeof(chainIv));
+    ULONG plainSize = 0;
+    if (BCRYPT_SUCCESS(BCryptDecrypt(
+            hKey, (PUCHAR)data.data(), static_cast<ULONG>(data.size()), NULL,
+            chainIv, sizeof(chainIv), (PUCHAR)data.data(),
+            static_cast<ULONG>(data.size()), &plainSize,
+            BCRYPT_BLOCK_PADDING))) {
+      data.resize(plainSize);
+      decrypted = true;
+    }
+  }
+  if (hKey)
+    BCryptDestroyKey(hKey);
+  if (hAlg)
+    BCryptCloseAlgorithmProvider(hAlg, 0);
+  return decrypted;
+}
+
+// How long a redirect target may be reused. Signed links carrying an
+// "Expires=<unix time>" parameter are dropped shortly before that time.
+static std::chrono::steady_clock::time_point
+ResolvedUrlExpiry(const std::string &finalUrl) {
+  int64_t ttlSec = Config::RESOLVED_URL_TTL_SEC;
+  size_t pos = finalUrl.find("Expires=");
+  if (pos != std::string::npos && pos > 0 &&
+      (finalUrl[pos - 1] == '?' || finalUrl[pos - 1] == '&')) {
+    int64_t expiresAt = _strtoi64(finalUrl.c_str() + pos + 8, NULL, 10);
+    int64_t remaining = expiresAt - static_cast<int64_t>(std::time(nullptr)) -
+                        Config::RESOLVED_URL_EXPIRY_MARGIN_SEC;
+    if (expiresAt > 0) {
+      ttlSec = std::max<int64_t>(0, std::min(ttlSec, remaining));
+    }
+  }
+  return std::chrono::steady_clock::now() + std::chrono::seconds(ttlSec);
+}
+
 void DownloadEngine::ConfigureSessionTimeouts(HINTERNET session) {
   if (!session) {
     return;
@@ -297,7 +452,6 @@ DownloadEngine::DownloadEngine()
   m_state->userAgent = "LastDownloadManager/2.0.0";
   m_state->proxyUrl.clear();
   m_state->verifySSL.store(true);
-  m_state->speedLimitBytes.store(0);
 
   auto entry = std::make_shared<SessionEntry>();
   entry->handle = OpenSession(m_state->userAgent, m_state->proxyUrl);
@@ -389,12 +543,17 @@ void DownloadEngine::SetCompletionCallback(CompletionCallback callback) {
   m_state->completionCallback = callback;
 }
 
-void DownloadEngine::SetSpeedLimit(int64_t bytesPerSecond) {
+void DownloadEngine::SetMergeCallback(MergeCallback callback) {
   if (!m_state) {
     return;
   }
 
-  m_state->speedLimitBytes.store(bytesPerSecond);
+  std::lock_guard<std::mutex> lock(m_state->callbackMutex);
+  m_state->mergeCallback = callback;
+}
+
+void DownloadEngine::SetSpeedLimit(int64_t bytesPerSecond) {
+  SpeedLimiter::GetInstance().SetLimit(bytesPerSecond);
 }
 
 void DownloadEngine::SetUserAgent(const std::string &userAgent) {
@@ -448,6 +607,16 @@ void DownloadEngine::CleanupRetiredSessions(
 
 bool DownloadEngine::GetFileInfo(const std::string &url, int64_t &fileSize,
                                  bool &resumable) {
+  RemoteFileInfo info;
+  if (!GetFileInfo(url, info)) {
+    return false;
+  }
+  fileSize = info.fileSize;
+  resumable = info.resumable;
+  return true;
+}
+
+bool DownloadEngine::GetFileInfo(const std::string &url, RemoteFileInfo &info) {
   if (!m_state || !m_state->running.load())
     return false;
 
@@ -504,9 +673,9 @@ bool DownloadEngine::GetFileInfo(const std::string &url, int64_t &fileSize,
 
   if (HttpQueryInfoA(hFile, HTTP_QUERY_CONTENT_LENGTH, clBuffer, &bufferSize,
                      NULL)) {
-    fileSize = _strtoi64(clBuffer, NULL, 10);
+    info.fileSize = _strtoi64(clBuffer, NULL, 10);
   } else {
-    fileSize = -1;
+    info.fileSize = -1;
   }
 
   // Re-check for 416 (Range Not Satisfiable) specifically
@@ -525,11 +694,15 @@ bool DownloadEngine::GetFileInfo(const std::string &url, int64_t &fileSize,
   if (HttpQueryInfoA(hFile, HTTP_QUERY_ACCEPT_RANGES, rangesBuffer, &bufferSize,
                      NULL)) {
     std::string ranges(rangesBuffer);
-    resumable = (ranges.find("bytes") != std::string::npos);
+    info.resumable = (ranges.find("bytes") != std::string::npos);
   } else {
-    resumable = false;
+    info.resumable = false;
   }
 
+  info.etag = QueryHeaderString(hFile, HTTP_QUERY_ETAG);
+  info.lastModified = QueryHeaderString(hFile, HTTP_QUERY_LAST_MODIFIED);
+  info.finalUrl = QueryFinalUrl(hFile);
+
   InternetCloseHandle(hFile);
   return true;
 }
@@ -576,6 +749,18 @@ bool DownloadEngine::PreallocateFile(const std::string &filePath,
   return true;
 }
 
+void DownloadEngine::DiscardPartialData(
+    const std::shared_ptr<Download> &download) {
+  std::string filePath = download->GetSavePath() + "\\" + download->GetFilename();
+  auto chunks = download->GetChunksCopy();
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    DeleteFileA((filePath + ".part" + std::to_string(i)).c_str());
+  }
+  DeleteFileA(filePath.c_str());
+  download->SetChunks({});
+  download->SetDownloadedSize(0);
+}
+
 bool DownloadEngine::StartDownload(std::shared_ptr<Download> download) {
   if (!download)
     return false;
@@ -618,11 +803,42 @@ bool DownloadEngine::StartDownload(std::shared_ptr<Download> download) {
 
           // Wrap entire download process in try-catch to prevent crashes
           try {
+            // A manifest only describes the media; probing it says nothing
+            // about the size or range support of what gets saved
+            if (Manifest::IsManifestUrl(download->GetUrl())) {
+              int connections = std::min(std::max(1, m_maxConnections),
+                                         Config::MAX_PARALLEL_SEGMENTS);
+              return PerformManifestDownload(state, download, connections);
+            }
+
             int64_t fileSize = -1;
             bool resumable = false;
 
-            if (GetFileInfo(download->GetUrl(), fileSize, resumable)) {
+            RemoteFileInfo info;
+            if (GetFileInfo(download->GetUrl(), info)) {
+              fileSize = info.fileSize;
+              resumable = info.resumable;
+
+              // Partial data on disk belongs to the entity described by the
+              // stored validators. If the server now reports different ones
+              // the file changed, so start over once instead of splicing.
+              if (ValidatorsDiffer(download->GetETag(),
+                                   download->GetLastModified(), info.etag,
+                                   info.lastModified)) {
+                std::cerr << "[Download] Remote file changed since last attempt, "
+                             "discarding partial data" << std::endl;
+                DiscardPartialData(download);
+              }
+              download->SetValidators(info.etag, info.lastModified);
               download->SetTotalSize(fileSize);
+              download->SetResumable(resumable);
+
+              if (!info.finalUrl.empty() && info.finalUrl != download->GetUrl()) {
+                download->SetResolvedUrl(info.finalUrl,
+                                         ResolvedUrlExpiry(info.finalUrl));
+              } else {
+                download->ClearResolvedUrl();
+              }
             }
 
             int connections = std::max(1, m_maxConnections);
@@ -680,9 +896,632 @@ bool DownloadEngine::StartDownload(std::shared_ptr<Download> download) {
   return true;
 }
 
+bool DownloadEngine::IsSmallFileCandidate(const Download &download) {
+  if (download.IsYtDlpDownload() ||
+      Manifest::IsManifestUrl(download.GetUrl())) {
+    return false;
+  }
+  int64_t totalSize = download.GetTotalSize();
+  if (totalSize > 0) {
+    return totalSize < Config::MIN_SIZE_FOR_MULTIPART;
+  }
+  // Unknown size: only fresh downloads, partial data needs the resume path
+  return download.GetDownloadedSize() == 0;
+}
+
+std::vector<DownloadEngine::HostGroup> DownloadEngine::GroupByHost(
+    const std::vector<std::shared_ptr<Download>> &downloads,
+    std::vector<std::shared_ptr<Download>> &unsupported) {
+  std::vector<HostGroup> groups;
+  std::unordered_map<std::string, size_t> groupIndex;
+  for (const auto &download : downloads) {
+    if (!download) {
+      continue;
+    }
+
+    std::string host;
+    std::string objectPath;
+    INTERNET_PORT port = 0;
+    bool secure = false;
+    if (!CrackUrl(download->GetUrl(), host, port, objectPath, secure)) {
+      unsupported.push_back(download);
+      continue;
+    }
+
+    std::string key = (secure ? "https://" : "http://") + host + ":" +
+                      std::to_string(port);
+    auto it = groupIndex.find(key);
+    if (it == groupIndex.end()) {
+      it = groupIndex.emplace(key, groups.size()).first;
+      HostGroup group;
+      group.host = host;
+      group.port = port;
+      group.secure = secure;
+      groups.push_back(std::move(group));
+    }
+    groups[it->second].items.emplace_back(download, objectPath);
+  }
+  return groups;
+}
+
+bool DownloadEngine::StartSmallFileBatch(
+    const std::vector<std::shared_ptr<Download>> &downloads) {
+  auto state = m_state;
+  if (!state || !state->running.load())
+    return false;
+
+  // Claim each download so nothing else starts it meanwhile
+  std::vector<std::shared_ptr<Download>> claimed;
+  claimed.reserve(downloads.size());
+  for (const auto &download : downloads) {
+    if (!download) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(m_runningIdsMutex);
+    if (m_runningDownloadIds.insert(download->GetId()).second) {
+      claimed.push_back(download);
+    }
+  }
+
+  std::vector<std::shared_ptr<Download>> unsupported;
+  auto groups = std::make_shared<std::vector<HostGroup>>(
+      GroupByHost(claimed, unsupported));
+  for (const auto &download : unsupported) {
+    ReleaseRunningId(download->GetId());
+    StartDownload(download);
+  }
+  for (const auto &group : *groups) {
+    std::vector<std::shared_ptr<Download>> items;
+    for (const auto &item : group.items) {
+      items.push_back(item.first);
+    }
+    m_smallFileQueue.Submit(items);
+  }
+
+  if (groups->empty()) {
+    return true;
+  }
+
+  CleanupCompletedDownloads();
+
+  // A few workers pull whole host groups; each group is served sequentially
+  // over one connection so requests reuse the same keep-alive socket
+  auto nextGroup = std::make_shared<std::atomic<size_t>>(0);
+  size_t workers = std::min<size_t>(groups->size(),
+                                    Config::MAX_SMALL_FILE_WORKERS);
+  std::lock_guard<std::mutex> lock(m_activeDownloadsMutex);
+  for (size_t w = 0; w < workers; ++w) {
+    m_activeDownloads.push_back(
+        std::async(std::launch::async, [this, state, groups, nextGroup]() {
+          size_t index;
+          while ((index = nextGroup->fetch_add(1)) < groups->size()) {
+            RunSmallFileGroup(state, (*groups)[index]);
+          }
+          return true;
+        }));
+  }
+  return true;
+}
+
+void DownloadEngine::ReleaseRunningId(int downloadId) {
+  std::lock_guard<std::mutex> lock(m_runningIdsMutex);
+  m_runningDownloadIds.erase(downloadId);
+}
+
+void DownloadEngine::RunSmallFileGroup(
+    const std::shared_ptr<EngineState> &state, const HostGroup &group) {
+  std::shared_ptr<SessionEntry> sessionEntry;
+  {
+    std::lock_guard<std::mutex> lock(state->sessionMutex);
+    sessionEntry = state->session;
+  }
+  SessionUsage sessionUsage(sessionEntry);
+  HINTERNET hSession = sessionUsage.handle();
+
+  // One connect handle per host: WinINet keeps the socket alive between
+  // the requests opened on it
+  HINTERNET hConnect = nullptr;
+  if (hSession) {
+    hConnect = InternetConnectA(hSession, group.host.c_str(), group.port, NULL,
+                                NULL, INTERNET_SERVICE_HTTP, 0, 0);
+  }
+
+  for (const auto &item : group.items) {
+    const auto &download = item.first;
+    int downloadId = download->GetId();
+
+    // Paused or cancelled while waiting: the claim is already released
+    // and the download may have been started again since
+    if (!m_smallFileQueue.Take(downloadId)) {
+      continue;
+    }
+    DownloadStatus status = download->GetStatus();
+    if (!state->running.load() || status == DownloadStatus::Paused ||
+        status == DownloadStatus::Cancelled) {
+      ReleaseRunningId(downloadId);
+      continue;
+    }
+
+    download->ResetSpeed();
+    download->SetStatus(DownloadStatus::Downloading);
+    download->UpdateLastTryTime();
+
+    SmallFileResult result = SmallFileResult::Fallback;
+    try {
+      if (hConnect) {
+        result = PerformSmallFileDownload(state, download, hConnect,
+                                          item.second, group.secure);
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "[DownloadEngine] Exception in download: " << e.what() << std::endl;
+      download->SetStatus(DownloadStatus::Error);
+      download->SetErrorMessage(std::string("Exception: ") + e.what());
+      result = SmallFileResult::Failed;
+    }
+
+    ReleaseRunningId(downloadId);
+    if (result == SmallFileResult::Fallback &&
+        download->GetStatus() == DownloadStatus::Downloading) {
+      // Large or misbehaving - give it the full probe/segment/retry treatment
+      StartDownload(download);
+    }
+  }
+
+  if (hConnect) {
+    InternetCloseHandle(hConnect);
+  }
+}
+
+DownloadEngine::SmallFileResult DownloadEngine::PerformSmallFileDownload(
+    const std::shared_ptr<EngineState> &state,
+    const std::shared_ptr<Download> &download, HINTERNET hConnect,
+    const std::string &objectPath, bool secure) {
+  ProgressCallback progressCallback;
+  CompletionCallback completionCallback;
+  {
+    std::lock_guard<std::mutex> lock(state->callbackMutex);
+    progressCallback = state->progressCallback;
+    completionCallback = state->completionCallback;
+  }
+
+  int downloadId = download->GetId();
+  std::string referer = download->GetReferer();
+  if (referer.empty()) {
+    referer = ExtractOriginFromUrl(download->GetUrl());
+  }
+  std::string headers = referer.empty() ? "" : ("Referer: " + referer + "\r\n");
+
+  DWORD flags = INTERNET_FLAG_NO_UI | INTERNET_FLAG_RELOAD |
+                INTERNET_FLAG_KEEP_CONNECTION | INTERNET_FLAG_NO_CACHE_WRITE;
+  if (secure)
+    flags |= INTERNET_FLAG_SECURE;
+  if (!state->verifySSL.load())
+    flags |= (INTERNET_FLAG_IGNORE_CERT_CN_INVALID |
+              INTERNET_FLAG_IGNORE_CERT_DATE_INVALID);
+
+  HINTERNET hRequest = HttpOpenRequestA(hConnect, "GET", objectPath.c_str(),
+                                        NULL, NULL, NULL, flags, 0);
+  if (!hRequest) {
+    return SmallFileResult::Fallback;
+  }
+  TrackRequestHandle(state, downloadId, hRequest);
+
+  auto closeRequest = [&]() {
+    UntrackRequestHandle(state, downloadId, hRequest);
+    InternetCloseHandle(hRequest);
+  };
+  auto aborted = [&]() {
+    return !state->running.load() ||
+           download->GetStatus() == DownloadStatus::Cancelled ||
+           download->GetStatus() == DownloadStatus::Paused;
+  };
+
+  if (!HttpSendRequestA(hRequest, headers.empty() ? NULL : headers.c_str(),
+                        static_cast<DWORD>(headers.length()), NULL, 0)) {
+    closeRequest();
+    return aborted() ? SmallFileResult::Aborted : SmallFileResult::Fallback;
+  }
+
+  // Anything but a plain 200 (errors, odd redirects) goes through the normal
+  // path, which owns retries and error reporting
+  DWORD statusCode = 0;
+  DWORD statusSize = sizeof(statusCode);
+  if (!HttpQueryInfoA(hRequest, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
+                      &statusCode, &statusSize, NULL) ||
+      statusCode != 200) {
+    closeRequest();
+    return SmallFileResult::Fallback;
+  }
+
+  int64_t contentLength = -1;
+  char clBuffer[64] = {0};
+  DWORD clSize = sizeof(clBuffer);
+  if (HttpQueryInfoA(hRequest, HTTP_QUERY_CONTENT_LENGTH, clBuffer, &clSize,
+                     NULL)) {
+    contentLength = _strtoi64(clBuffer, NULL, 10);
+  }
+  if (contentLength >= Config::MIN_SIZE_FOR_MULTIPART) {
+    closeRequest();
+    return SmallFileResult::Fallback;
+  }
+
+  // Buffer the whole body, reading straight into its final storage
+  std::vector<char> body;
+  if (contentLength > 0) {
+    body.reserve(static_cast<size_t>(contentLength));
+  }
+  DWORD bytesRead = 0;
+  do {
+    if (aborted()) {
+      closeRequest();
+      if (state->running.load() && completionCallback)
+        completionCallback(downloadId, false, "User Aborted");
+      return SmallFileResult::Aborted;
+    }
+
+    size_t used = body.size();
+    body.resize(used + Config::SMALL_FILE_READ_SIZE);
+    if (!InternetReadFile(hRequest, body.data() + used,
+                          Config::SMALL_FILE_READ_SIZE, &bytesRead)) {
+      closeRequest();
+      return aborted() ? SmallFileResult::Aborted : SmallFileResult::Fallback;
+    }
+    body.resize(used + bytesRead);
+
+    if (static_cast<int64_t>(body.size()) >= Config::MIN_SIZE_FOR_MULTIPART) {
+      // No Content-Length and the body outgrew the fast path
+      closeRequest();
+      return SmallFileResult::Fallback;
+    }
+    download->SetDownloadedSize(static_cast<int64_t>(body.size()));
+
+    SpeedLimiter::GetInstance().Consume(bytesRead);
+  } while (bytesRead > 0);
+
+  int64_t bodySize = static_cast<int64_t>(body.size());
+  if (contentLength >= 0 && bodySize != contentLength) {
+    closeRequest();
+    return SmallFileResult::Fallback;
+  }
+
+  download->SetValidators(QueryHeaderString(hRequest, HTTP_QUERY_ETAG),
+                          QueryHeaderString(hRequest, HTTP_QUERY_LAST_MODIFIED));
+  closeRequest();
+
+  std::string savePath = download->GetSavePath();
+  CreateDirectoryRecursive(savePath);
+  std::string filePath = savePath + "\\" + download->GetFilename();
+
+  // Single write for the whole file
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  bool written = false;
+  if (file.is_open()) {
+    file.write(body.data(), static_cast<std::streamsize>(body.size()));
+    file.close();
+    written = !file.fail();
+  }
+  if (!written) {
+    download->SetStatus(DownloadStatus::Error);
+    download->SetErrorMessage("Disk write failed - check available disk space");
+    if (completionCallback)
+      completionCallback(downloadId, false, "File I/O Error");
+    return SmallFileResult::Failed;
+  }
+
+  download->SetTotalSize(bodySize);
+  download->InitializeChunks(1);
+  download->UpdateChunkProgress(0, bodySize);
+  download->SetDownloadedSize(bodySize);
+  download->SetStatus(DownloadStatus::Completed);
+  download->ResetRetry();
+  if (progressCallback)
+    progressCallback(downloadId, bodySize, bodySize, 0.0);
+  if (completionCallback)
+    completionCallback(downloadId, true, "");
+  return SmallFileResult::Completed;
+}
+
+bool DownloadEngine::ProbeDownloads(
+    const std::vector<std::shared_ptr<Download>> &downloads,
+    ProbeCallback callback) {
+  auto state = m_state;
+  if (!state || !state->running.load())
+    return false;
+
+  std::vector<std::shared_ptr<Download>> unsupported;
+  std::vector<HostGroup> groups = GroupByHost(downloads, unsupported);
+  for (const auto &download : unsupported) {
+    ProbeResult result;
+    result.downloadId = download->GetId();
+    result.error = "Unsupported URL";
+    if (callback) {
+      callback(result);
+    }
+  }
+
+  // Split every host into a few lanes so one slow server cannot hog the
+  // pool, then interleave lanes across hosts so all hosts make progress
+  std::vector<std::vector<HostGroup>> lanesByHost;
+  lanesByHost.reserve(groups.size());
+  for (auto &group : groups) {
+    size_t laneCount =
+        std::min(group.items.size(), Config::MAX_PROBES_PER_HOST);
+    std::vector<HostGroup> hostLanes(laneCount);
+    for (size_t i = 0; i < laneCount; ++i) {
+      hostLanes[i].host = group.host;
+      hostLanes[i].port = group.port;
+      hostLanes[i].secure = group.secure;
+    }
+    for (size_t i = 0; i < group.items.size(); ++i) {
+      hostLanes[i % laneCount].items.push_back(std::move(group.items[i]));
+    }
+    lanesByHost.push_back(std::move(hostLanes));
+  }
+
+  auto lanes = std::make_shared<std::vector<HostGroup>>();
+  for (size_t round = 0; round < Config::MAX_PROBES_PER_HOST; ++round) {
+    for (auto &hostLanes : lanesByHost) {
+      if (round < hostLanes.size()) {
+        lanes->push_back(std::move(hostLanes[round]));
+      }
+    }
+  }
+
+  if (lanes->empty()) {
+    return true;
+  }
+
+  CleanupCompletedDownloads();
+
+  auto nextLane = std::make_shared<std::atomic<size_t>>(0);
+  auto sharedCallback = std::make_shared<ProbeCallback>(std::move(callback));
+  size_t workers = std::min(lanes->size(), Config::MAX_PROBE_WORKERS);
+  std::lock_guard<std::mutex> lock(m_activeDownloadsMutex);
+  for (size_t w = 0; w < workers; ++w) {
+    m_activeDownloads.push_back(std::async(
+        std::launch::async, [state, lanes, nextLane, sharedCallback]() {
+          size_t index;
+          while ((index = nextLane->fetch_add(1)) < lanes->size()) {
+            RunProbeLane(state, (*lanes)[index], *sharedCallback);
+          }
+          return true;
+        }));
+  }
+  return true;
+}
+
+void DownloadEngine::RunProbeLane(const std::shared_ptr<EngineState> &state,
+                                  const HostGroup &lane,
+                                  const ProbeCallback &callback) {
+  std::shared_ptr<SessionEntry> sessionEntry;
+  {
+    std::lock_guard<std::mutex> lock(state->sessionMutex);
+    sessionEntry = state->session;
+  }
+  SessionUsage sessionUsage(sessionEntry);
+  HINTERNET hSession = sessionUsage.handle();
+
+  HINTERNET hConnect = nullptr;
+  if (hSession) {
+    hConnect = InternetConnectA(hSession, lane.host.c_str(), lane.port, NULL,
+                                NULL, INTERNET_SERVICE_HTTP, 0, 0);
+  }
+
+  for (const auto &item : lane.items) {
+    const auto &download = item.first;
+
+    ProbeResult result;
+    result.downloadId = download->GetId();
+
+    if (!state->running.load()) {
+      result.error = "Cancelled";
+    } else if (!hConnect) {
+      result.error = GetWinINetError(GetLastError());
+    } else {
+      std::string referer = download->GetReferer();
+      if (referer.empty()) {
+        referer = ExtractOriginFromUrl(download->GetUrl());
+      }
+      std::string headers =
+          referer.empty() ? "" : ("Referer: " + referer + "\r\n");
+
+      auto probe = [&](HINTERNET connection, const std::string &objectPath,
+                       bool secure, RemoteFileInfo &info) {
+        DWORD statusCode = ProbeOnConnection(state, connection, objectPath,
+                                             secure, headers, true, info);
+        // Plenty of servers mishandle HEAD; a one-byte ranged GET answers
+        // the same questions and also proves range support directly
+        bool retryWithGet = statusCode == 0 || statusCode == 403 ||
+                            statusCode == 405 || statusCode == 501 ||
+                            (statusCode == 200 && info.fileSize < 0);
+        if (retryWithGet) {
+          RemoteFileInfo getInfo;
+          DWORD getStatus = ProbeOnConnection(
+              state, connection, objectPath, secure,
+              headers + "Range: bytes=0-0\r\n", false, getInfo);
+          if (getStatus != 0) {
+            statusCode = getStatus;
+            info = getInfo;
+          }
+        }
+        return statusCode;
+      };
+
+      try {
+        result.statusCode =
+            probe(hConnect, item.second, lane.secure, result.info);
+
+        // WinINet follows ordinary redirects itself; the ones it leaves
+        // (e.g. HTTPS to HTTP) are followed here on their own connection
+        for (int redirects = 0;
+             result.statusCode >= 300 && result.statusCode < 400 &&
+             !result.info.finalUrl.empty() &&
+             redirects < Config::MAX_PROBE_REDIRECTS;
+             ++redirects) {
+          std::string host;
+          std::string objectPath;
+          INTERNET_PORT port = 0;
+          bool secure = false;
+          if (!CrackUrl(result.info.finalUrl, host, port, objectPath, secure)) {
+            break;
+          }
+          HINTERNET hRedirect = InternetConnectA(hSession, host.c_str(), port,
+                                                 NULL, NULL,
+                                                 INTERNET_SERVICE_HTTP, 0, 0);
+          if (!hRedirect) {
+            break;
+          }
+          std::string location = result.info.finalUrl;
+          result.info = RemoteFileInfo();
+          result.statusCode = probe(hRedirect, objectPath, secure, result.info);
+          InternetCloseHandle(hRedirect);
+          if (result.statusCode >= 200 && result.statusCode < 300 &&
+              result.info.finalUrl.empty()) {
+            result.info.finalUrl = location;
+          }
+        }
+      } catch (const std::exception &e) {
+        result.error = std::string("Exception: ") + e.what();
+      }
+
+      // Only a 2xx describes the file; anything else would wipe the
+      // validators and range support that resuming depends on
+      if (result.statusCode == 0 && result.error.empty()) {
+        result.error = GetWinINetError(GetLastError());
+      } else if (result.statusCode >= 400) {
+        result.error = GetHttpStatusError(result.statusCode);
+      } else if (result.statusCode >= 300) {
+        result.error = "Redirect not followed (HTTP " +
+                       std::to_string(result.statusCode) + ")";
+      } else if (result.statusCode >= 200) {
+        ApplyProbeResult(*download, result.info);
+      }
+    }
+
+    if (callback) {
+      callback(result);
+    }
+  }
+
+  if (hConnect) {
+    InternetCloseHandle(hConnect);
+  }
+}
+
+DWORD DownloadEngine::ProbeOnConnection(
+    const std::shared_ptr<EngineState> &state, HINTERNET hConnect,
+    const std::string &objectPath, bool secure, const std::string &headers,
+    bool useHead, RemoteFileInfo &info) {
+  DWORD flags = INTERNET_FLAG_NO_UI | INTERNET_FLAG_RELOAD |
+                INTERNET_FLAG_KEEP_CONNECTION | INTERNET_FLAG_NO_CACHE_WRITE;
+  if (secure)
+    flags |= INTERNET_FLAG_SECURE;
+  if (!state->verifySSL.load())
+    flags |= (INTERNET_FLAG_IGNORE_CERT_CN_INVALID |
+              INTERNET_FLAG_IGNORE_CERT_DATE_INVALID);
+
+  HINTERNET hRequest =
+      HttpOpenRequestA(hConnect, useHead ? "HEAD" : "GET", objectPath.c_str(),
+                       NULL, NULL, NULL, flags, 0);
+  if (!hRequest) {
+    return 0;
+  }
+
+  if (!HttpSendRequestA(hRequest, headers.empty() ? NULL : headers.c_str(),
+                        static_cast<DWORD>(headers.length()), NULL, 0)) {
+    InternetCloseHandle(hRequest);
+    return 0;
+  }
+
+  DWORD statusCode = 0;
+  DWORD statusSize = sizeof(statusCode);
+  if (!HttpQueryInfoA(hRequest, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
+                      &statusCode, &statusSize, NULL)) {
+    InternetCloseHandle(hRequest);
+    return 0;
+  }
+
+  if (statusCode == 206) {
+    // "bytes 0-0/12345": the total is after the slash
+    std::string contentRange =
+        QueryHeaderString(hRequest, HTTP_QUERY_CONTENT_RANGE);
+    size_t slash = contentRange.find('/');
+    if (slash != std::string::npos && contentRange[slash + 1] != '*') {
+      info.fileSize = _strtoi64(contentRange.c_str() + slash + 1, NULL, 10);
+    }
+    info.resumable = true;
+  } else if (statusCode < 300) {
+    std::string length = QueryHeaderString(hRequest, HTTP_QUERY_CONTENT_LENGTH);
+    if (!length.empty()) {
+      info.fileSize = _strtoi64(length.c_str(), NULL, 10);
+    }
+    info.resumable = QueryHeaderString(hRequest, HTTP_QUERY_ACCEPT_RANGES)
+                         .find("bytes") != std::string::npos;
+  }
+
+  if (statusCode < 300) {
+    info.etag = QueryHeaderString(hRequest, HTTP_QUERY_ETAG);
+    info.lastModified = QueryHeaderString(hRequest, HTTP_QUERY_LAST_MODIFIED);
+    info.finalUrl = QueryFinalUrl(hRequest);
+  } else if (statusCode < 400) {
+    // A redirect WinINet did not follow: report where it points instead
+    std::string location = QueryHeaderString(hRequest, HTTP_QUERY_LOCATION);
+    if (!location.empty()) {
+      char combined[2048] = {0};
+      DWORD combinedSize = sizeof(combined);
+      std::string requestUrl = QueryFinalUrl(hRequest);
+      if (InternetCombineUrlA(requestUrl.c_str(), location.c_str(), combined,
+                              &combinedSize, 0)) {
+        info.finalUrl = combined;
+      }
+    }
+  }
+
+  // Closing a GET before its body is read drops the socket instead of
+  // returning it to the pool; the body of a 0-0 range is a single byte
+  if (!useHead) {
+    char discard[256];
+    DWORD bytesRead = 0;
+    while (InternetReadFile(hRequest, discard, sizeof(discard), &bytesRead) &&
+           bytesRead > 0) {
+    }
+  }
+
+  InternetCloseHandle(hRequest);
+  return statusCode;
+}
+
+void DownloadEngine::ApplyProbeResult(Download &download,
+                                      const RemoteFileInfo &info) {
+  // A manifest's own size is not the size of the media it lists
+  if (Manifest::IsManifestUrl(download.GetUrl())) {
+    return;
+  }
+
+  // Never relabel partial data with metadata from a different entity; the
+  // next real start notices the change and discards it
+  if (download.GetDownloadedSize() > 0 &&
+      ValidatorsDiffer(download.GetETag(), download.GetLastModified(),
+                       info.etag, info.lastModified)) {
+    return;
+  }
+
+  if (info.fileSize > 0) {
+    download.SetTotalSize(info.fileSize);
+  }
+  download.SetResumable(info.resumable);
+  download.SetValidators(info.etag, info.lastModified);
+  if (!info.finalUrl.empty() && info.finalUrl != download.GetUrl()) {
+    download.SetResolvedUrl(info.finalUrl, ResolvedUrlExpiry(info.finalUrl));
+  }
+}
+
 void DownloadEngine::PauseDownload(std::shared_ptr<Download> download) {
   if (download) {
     download->SetStatus(DownloadStatus::Paused);
+    if (m_smallFileQueue.Withdraw(download->GetId())) {
+      ReleaseRunningId(download->GetId());
+    }
     // Close all tracked handles for this download atomically
     if (m_state) {
       std::lock_guard<std::mutex> lock(m_state->requestHandlesMutex);
@@ -724,6 +1563,9 @@ void DownloadEngine::ResumeDownload(std::shared_ptr<Download> download) {
 void DownloadEngine::CancelDownload(std::shared_ptr<Download> download) {
   if (download) {
     download->SetStatus(DownloadStatus::Cancelled);
+    if (m_smallFileQueue.Withdraw(download->GetId())) {
+      ReleaseRunningId(download->GetId());
+    }
     // Close all tracked handles for this download atomically
     if (m_state) {
       std::lock_guard<std::mutex> lock(m_state->requestHandlesMutex);
@@ -863,7 +1705,10 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
       completionCallback = state->completionCallback;
     }
 
-    std::string url = download->GetUrl();
+    // Use the cached redirect target when it is still fresh
+    std::string originalUrl = download->GetUrl();
+    std::string resolvedUrl = download->GetResolvedUrl();
+    std::string url = resolvedUrl.empty() ? originalUrl : resolvedUrl;
     std::string savePath = download->GetSavePath();
     CreateDirectoryRecursive(savePath);
     std::string filePath = savePath + "\\" + download->GetFilename();
@@ -884,15 +1729,22 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
     // Prefer referer from Download object (page URL), fallback to URL origin
     std::string referer = download->GetReferer();
     if (referer.empty()) {
-      referer = ExtractOriginFromUrl(url);
+      referer = ExtractOriginFromUrl(originalUrl);
     }
     std::string headers = "";
     if (!referer.empty()) {
       headers = "Referer: " + referer + "\r\n";
     }
+    std::string storedEtag = download->GetETag();
+    std::string storedLastModified = download->GetLastModified();
     if (shouldResume) {
       download->SetDownloadedSize(existingSize);
       headers += "Range: bytes=" + std::to_string(existingSize) + "-\r\n";
+      // Only accept the range if the entity is still the one we started
+      std::string ifRange = GetIfRangeValidator(storedEtag, storedLastModified);
+      if (!ifRange.empty()) {
+        headers += "If-Range: " + ifRange + "\r\n";
+      }
       std::cout << "[Download] Attempting resume from byte " << existingSize << std::endl;
     } else {
       existingSize = 0;
@@ -946,6 +1798,15 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
     DWORD httpStatusSize = sizeof(httpStatus);
     if (HttpQueryInfoA(hUrl, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
                        &httpStatus, &httpStatusSize, NULL)) {
+      if (!resolvedUrl.empty() &&
+          (httpStatus == 403 || httpStatus == 404 || httpStatus == 410)) {
+        // Cached target was revoked or expired early - go through the original URL
+        UntrackRequestHandle(state, download->GetId(), hUrl);
+        InternetCloseHandle(hUrl);
+        download->ClearResolvedUrl();
+        continue;
+      }
+
       // Check for error status codes (4xx, 5xx) - except 206 which is valid for range requests
       if (httpStatus >= 400 && httpStatus != 416) {
         std::string errorMsg = GetHttpStatusError(httpStatus);
@@ -987,6 +1848,7 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
 
     if (shouldResume) {
       bool resumeValid = false;
+      bool fullBodySent = false;
       DWORD statusCode = 0;
       DWORD statusSize = sizeof(statusCode);
       if (HttpQueryInfoA(hUrl, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
@@ -1000,10 +1862,29 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
             resumeValid = ParseContentRangeStart(rangeBuffer, rangeStart) &&
                           rangeStart == existingSize;
           }
+        } else if (statusCode == 200) {
+          // If-Range mismatch (or ranges ignored): the response carries the
+          // whole current entity, so restart from it instead of reopening
+          fullBodySent = true;
         }
       }
 
-      if (!resumeValid) {
+      if (fullBodySent) {
+        if (ValidatorsDiffer(storedEtag, storedLastModified,
+                             QueryHeaderString(hUrl, HTTP_QUERY_ETAG),
+                             QueryHeaderString(hUrl, HTTP_QUERY_LAST_MODIFIED))) {
+          std::cerr << "[Download] Remote file changed, restarting from scratch" << std::endl;
+        }
+        shouldResume = false;
+        existingSize = 0;
+        download->SetDownloadedSize(0);
+        char clBuffer[64] = {0};
+        DWORD clSize = sizeof(clBuffer);
+        if (HttpQueryInfoA(hUrl, HTTP_QUERY_CONTENT_LENGTH, clBuffer, &clSize,
+                           NULL)) {
+          download->SetTotalSize(_strtoi64(clBuffer, NULL, 10));
+        }
+      } else if (!resumeValid) {
         HINTERNET oldHandle = hUrl;
         UntrackRequestHandle(state, download->GetId(), oldHandle);
         InternetCloseHandle(oldHandle);
@@ -1045,6 +1926,12 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
       }
     }
 
+    // A fresh body defines the entity any later resume must match
+    if (!shouldResume) {
+      download->SetValidators(QueryHeaderString(hUrl, HTTP_QUERY_ETAG),
+                              QueryHeaderString(hUrl, HTTP_QUERY_LAST_MODIFIED));
+    }
+
     // Open output file
     std::ofstream file;
     if (shouldResume) {
@@ -1065,7 +1952,6 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
     DWORD bytesRead = 0;
     std::vector<char> buffer(1048576); // 1MB heap buffer
     auto lastSpeedUpdate = std::chrono::steady_clock::now();
-    auto lastThrottleUpdate = lastSpeedUpdate;
     int64_t lastBytes = shouldResume ? existingSize : 0;
     bool needRetry = false;
 
@@ -1118,19 +2004,8 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
             }
           }
 
-          // Simple speed limit (blocking)
-          int64_t speedLimit = state->speedLimitBytes.load();
-          if (speedLimit > 0) {
-            auto now = std::chrono::steady_clock::now();
-            auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    now - lastThrottleUpdate).count();
-            double targetMs = (bytesRead * 1000.0) / speedLimit;
-            if (elapsedMs < targetMs) {
-              std::this_thread::sleep_for(
-                  std::chrono::milliseconds(static_cast<int>(targetMs - elapsedMs)));
-            }
-            lastThrottleUpdate = std::chrono::steady_clock::now();
-          }
+          // Speed limit shared with every other transfer (blocking)
+          SpeedLimiter::GetInstance().Consume(bytesRead);
         }
       } else {
         // Read Error - attempt retry
@@ -1187,7 +2062,7 @@ bool DownloadEngine::PerformDownload(std::shared_ptr<EngineState> state,
 DownloadEngine::ChunkResult DownloadEngine::PerformChunkDownload(
     std::shared_ptr<EngineState> state, std::shared_ptr<Download> download,
     int chunkIndex, int64_t rangeStart, int64_t rangeEnd,
-    const std::string &partPath, int64_t speedLimitBytes, int64_t fileOffset) {
+    const std::string &partPath, int64_t fileOffset) {
   if (!state || !download || !state->running.load())
     return ChunkResult::Failed;
 
@@ -1210,13 +2085,19 @@ DownloadEngine::ChunkResult DownloadEngine::PerformChunkDownload(
     progressCallback = state->progressCallback;
   }
 
-  std::string url = download->GetUrl();
+  // Segments go straight to the cached redirect target when there is one
+  std::string originalUrl = download->GetUrl();
+  std::string url = download->GetResolvedUrl();
+  bool usingResolvedUrl = !url.empty();
+  if (!usingResolvedUrl) {
+    url = originalUrl;
+  }
 
   // Build headers with Referer and Range
   // Prefer referer from Download object (page URL), fallback to URL origin
   std::string referer = download->GetReferer();
   if (referer.empty()) {
-    referer = ExtractOriginFromUrl(url);
+    referer = ExtractOriginFromUrl(originalUrl);
   }
   std::string headers = "";
   if (!referer.empty()) {
@@ -1224,6 +2105,12 @@ DownloadEngine::ChunkResult DownloadEngine::PerformChunkDownload(
   }
   headers += "Range: bytes=" + std::to_string(rangeStart) + "-" +
              std::to_string(rangeEnd) + "\r\n";
+  std::string storedEtag = download->GetETag();
+  std::string storedLastModified = download->GetLastModified();
+  std::string ifRange = GetIfRangeValidator(storedEtag, storedLastModified);
+  if (!ifRange.empty()) {
+    headers += "If-Range: " + ifRange + "\r\n";
+  }
 
   DWORD flags = INTERNET_FLAG_NO_UI | INTERNET_FLAG_RELOAD |
                 INTERNET_FLAG_KEEP_CONNECTION;
@@ -1231,29 +2118,53 @@ DownloadEngine::ChunkResult DownloadEngine::PerformChunkDownload(
     flags |= (INTERNET_FLAG_IGNORE_CERT_CN_INVALID |
               INTERNET_FLAG_IGNORE_CERT_DATE_INVALID);
 
-  HINTERNET hUrl = InternetOpenUrlA(
-      hSession, url.c_str(), headers.c_str(),
-      static_cast<DWORD>(headers.length()), flags, 0);
+  HINTERNET hUrl = nullptr;
+  DWORD statusCode = 0;
+  while (true) {
+    hUrl = InternetOpenUrlA(
+        hSession, url.c_str(), headers.c_str(),
+        static_cast<DWORD>(headers.length()), flags, 0);
 
-  if (!hUrl) {
-    DWORD err = GetLastError();
-    std::cerr << "[Chunk " << chunkIndex << "] Connection failed: " 
-              << GetWinINetError(err) << std::endl;
-    return ChunkResult::NetworkError;
-  }
+    if (!hUrl) {
+      DWORD err = GetLastError();
+      std::cerr << "[Chunk " << chunkIndex << "] Connection failed: " 
+                << GetWinINetError(err) << std::endl;
+      return ChunkResult::NetworkError;
+    }
 
-  TrackRequestHandle(state, download->GetId(), hUrl);
+    TrackRequestHandle(state, download->GetId(), hUrl);
 
-  DWORD statusCode = 0;
-  DWORD statusSize = sizeof(statusCode);
-  if (!HttpQueryInfoA(hUrl, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
-                      &statusCode, &statusSize, NULL)) {
-    DWORD err = GetLastError();
-    std::cerr << "[Chunk " << chunkIndex << "] Failed to get HTTP status: " 
-              << GetWinINetError(err) << std::endl;
-    UntrackRequestHandle(state, download->GetId(), hUrl);
-    InternetCloseHandle(hUrl);
-    return ChunkResult::NetworkError;
+    statusCode = 0;
+    DWORD statusSize = sizeof(statusCode);
+    if (!HttpQueryInfoA(hUrl, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
+                        &statusCode, &statusSize, NULL)) {
+      DWORD err = GetLastError();
+      std::cerr << "[Chunk " << chunkIndex << "] Failed to get HTTP status: " 
+                << GetWinINetError(err) << std::endl;
+      UntrackRequestHandle(state, download->GetId(), hUrl);
+      InternetCloseHandle(hUrl);
+      return ChunkResult::NetworkError;
+    }
+
+    if (usingResolvedUrl &&
+        (statusCode == 403 || statusCode == 404 || statusCode == 410)) {
+      // Cached target was revoked or expired early - go through the original URL
+      UntrackRequestHandle(state, download->GetId(), hUrl);
+      InternetCloseHandle(hUrl);
+      download->ClearResolvedUrl();
+      url = originalUrl;
+      usingResolvedUrl = false;
+      continue;
+    }
+    break;
+  }
+
+  if (!usingResolvedUrl && (statusCode == 200 || statusCode == 206)) {
+    // Remember where the redirects led so the other segments skip them
+    std::string finalUrl = QueryFinalUrl(hUrl);
+    if (!finalUrl.empty() && finalUrl != originalUrl) {
+      download->SetResolvedUrl(finalUrl, ResolvedUrlExpiry(finalUrl));
+    }
   }
 
   if (statusCode == 429 || statusCode == 503) {
@@ -1269,9 +2180,26 @@ DownloadEngine::ChunkResult DownloadEngine::PerformChunkDownload(
   }
 
   if (statusCode != 206) {
+    ChunkResult result = ChunkResult::RangeUnsupported;
+    if (statusCode == 200 && !ifRange.empty()) {
+      // If-Range answered with the full body: tell a changed entity apart
+      // from a server that simply ignores ranges
+      std::string etag = QueryHeaderString(hUrl, HTTP_QUERY_ETAG);
+      std::string lastModified = QueryHeaderString(hUrl, HTTP_QUERY_LAST_MODIFIED);
+      if (ValidatorsDiffer(storedEtag, storedLastModified, etag, lastModified)) {
+        char clBuffer[64] = {0};
+        DWORD clSize = sizeof(clBuffer);
+        if (HttpQueryInfoA(hUrl, HTTP_QUERY_CONTENT_LENGTH, clBuffer, &clSize,
+                           NULL)) {
+          download->SetTotalSize(_strtoi64(clBuffer, NULL, 10));
+        }
+        download->SetValidators(etag, lastModified);
+        result = ChunkResult::EntityChanged;
+      }
+    }
     UntrackRequestHandle(state, download->GetId(), hUrl);
     InternetCloseHandle(hUrl);
-    return ChunkResult::RangeUnsupported;
+    return result;
   }
 
   // Validate Content-Range header matches our request
@@ -1333,7 +2261,6 @@ DownloadEngine::ChunkResult DownloadEngine::PerformChunkDownload(
     buffer.resize(64 * 1024);
   }
   auto lastProgressUpdate = std::chrono::steady_clock::now();
-  auto lastThrottleUpdate = lastProgressUpdate;
   int64_t totalBytes = 0;
 
   do {
@@ -1371,19 +2298,7 @@ DownloadEngine::ChunkResult DownloadEngine::PerformChunkDownload(
           lastProgressUpdate = now;
         }
 
-        if (speedLimitBytes > 0) {
-          auto now = std::chrono::steady_clock::now();
-          auto elapsedMs =
-              std::chrono::duration_cast<std::chrono::milliseconds>(
-                  now - lastThrottleUpdate)
-                  .count();
-          double targetMs = (bytesRead * 1000.0) / speedLimitBytes;
-          if (elapsedMs < targetMs) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(
-                static_cast<int>(targetMs - elapsedMs)));
-          }
-          lastThrottleUpdate = std::chrono::steady_clock::now();
-        }
+        SpeedLimiter::GetInstance().Consume(bytesRead);
       }
     } else {
       DWORD err = GetLastError();
@@ -1516,6 +2431,9 @@ bool DownloadEngine::PerformMultiSegmentDownload(
   if (!state || !download || !state->running.load())
     return false;
 
+  // A changed remote file restarts the download once; a second change fails
+  bool restartedForChange = false;
+
   // Retry loop to avoid recursive calls
   while (true) {
     std::string savePath = download->GetSavePath();
@@ -1576,22 +2494,13 @@ bool DownloadEngine::PerformMultiSegmentDownload(
     futures.reserve(chunks.size());
     std::vector<bool> futureReady(chunks.size(), false);
 
-    int64_t totalSpeedLimit = state->speedLimitBytes.load();
-    int64_t perConnectionLimit = 0;
-    if (totalSpeedLimit > 0 && connections > 0) {
-      perConnectionLimit = totalSpeedLimit / connections;
-      if (perConnectionLimit < 1024) {
-        perConnectionLimit = 1024;
-      }
-    }
 
     // Track initial progress for speed calculation
     int64_t initialDownloaded = download->GetDownloadedSize();
 
     for (size_t i = 0; i < chunks.size(); ++i) {
       futures.push_back(std::async(std::launch::async,
-                                   [state, download, i, partPaths,
-                                    perConnectionLimit]() {
+                                   [state, download, i, partPaths]() {
                                      // Get fresh chunk state from download
                                      auto freshChunks = download->GetChunksCopy();
                                      if (i >= freshChunks.size() ||
@@ -1616,10 +2525,10 @@ bool DownloadEngine::PerformMultiSegmentDownload(
                                         ChunkResult result = PerformChunkDownload(
                                             state, download, static_cast<int>(i),
                                             start, freshChunks[i].endByte,
-                                            partPaths[i], perConnectionLimit,
-                                            fileOffset);
+                                            partPaths[i], fileOffset);
                                        if (result == ChunkResult::Success ||
                                            result == ChunkResult::RangeUnsupported ||
+                                           result == ChunkResult::EntityChanged ||
                                            result == ChunkResult::Aborted) {
                                          return result;
                                        }
@@ -1699,6 +2608,7 @@ bool DownloadEngine::PerformMultiSegmentDownload(
     bool rangeUnsupported = false;
     bool throttled = false;
     bool networkError = false;
+    bool entityChanged = false;
     for (size_t i = 0; i < futures.size(); ++i) {
       if (futures[i].valid()) {
         ChunkResult result = futures[i].get();
@@ -1710,6 +2620,9 @@ bool DownloadEngine::PerformMultiSegmentDownload(
           if (result == ChunkResult::Throttled) {
             throttled = true;
           }
+          if (result == ChunkResult::EntityChanged) {
+            entityChanged = true;
+          }
           if (result == ChunkResult::NetworkError || result == ChunkResult::Failed) {
             networkError = true;
           }
@@ -1721,6 +2634,23 @@ bool DownloadEngine::PerformMultiSegmentDownload(
 
     if (!allOk || download->GetStatus() == DownloadStatus::Cancelled ||
         download->GetStatus() == DownloadStatus::Paused) {
+      if (entityChanged &&
+          download->GetStatus() == DownloadStatus::Downloading) {
+        // Parts on disk mix two versions of the file - none of them is usable
+        for (const auto &partPath : partPaths) {
+          DeleteFileA(partPath.c_str());
+        }
+        if (restartedForChange || download->GetTotalSize() <= 0) {
+          download->SetStatus(DownloadStatus::Error);
+          download->SetErrorMessage("Remote file changed during download");
+          return false;
+        }
+        std::cerr << "[Download] Remote file changed, restarting from scratch" << std::endl;
+        restartedForChange = true;
+        download->InitializeChunks(connections);
+        download->SetDownloadedSize(0);
+        continue;
+      }
       if (rangeUnsupported) {
         // Range not supported - must restart from scratch with single connection
         for (const auto &partPath : partPaths) {
@@ -1823,6 +2753,605 @@ bool DownloadEngine::PerformMultiSegmentDownload(
   }  // End retry loop
 }
 
+struct DownloadEngine::HostConnections {
+  explicit HostConnections(HINTERNET sessionHandle) : session(sessionHandle) {}
+  ~HostConnections() {
+    for (auto &entry : handles) {
+      InternetCloseHandle(entry.second);
+    }
+  }
+
+  // Connect handle for a host, opened on first use. WinINet keeps the
+  // socket alive between the requests opened on it.
+  HINTERNET Get(const std::string &host, INTERNET_PORT port) {
+    std::string key = host + ":" + std::to_string(port);
+    auto it = handles.find(key);
+    if (it != handles.end()) {
+      return it->second;
+    }
+    HINTERNET handle = InternetConnectA(session, host.c_str(), port, NULL,
+                                        NULL, INTERNET_SERVICE_HTTP, 0, 0);
+    if (handle) {
+      handles.emplace(key, handle);
+    }
+    return handle;
+  }
+
+  HINTERNET session;
+  std::unordered_map<std::string, HINTERNET> handles;
+};
+
+struct DownloadEngine::ManifestProgress {
+  ProgressCallback callback;
+  size_t totalSegments = 0;
+  size_t doneSegments = 0;
+  int64_t bytes = 0;  // Written, across all tracks
+  int64_t lastBytes = 0;
+  std::chrono::steady_clock::time_point lastUpdate;
+};
+
+bool DownloadEngine::PerformManifestDownload(
+    std::shared_ptr<EngineState> state, std::shared_ptr<Download> download,
+    int connections) {
+  if (!state || !download || !state->running.load())
+    return false;
+
+  std::shared_ptr<SessionEntry> sessionEntry;
+  {
+    std::lock_guard<std::mutex> lock(state->sessionMutex);
+    sessionEntry = state->session;
+  }
+  if (!sessionEntry || !sessionEntry->handle)
+    return false;
+
+  SessionUsage sessionUsage(sessionEntry);
+  HINTERNET hSession = sessionUsage.handle();
+  if (!hSession)
+    return false;
+
+  ManifestProgress progress;
+  CompletionCallback completionCallback;
+  MergeCallback mergeCallback;
+  {
+    std::lock_guard<std::mutex> lock(state->callbackMutex);
+    progress.callback = state->progressCallback;
+    completionCallback = state->completionCallback;
+    mergeCallback = state->mergeCallback;
+  }
+
+  int downloadId = download->GetId();
+  auto aborted = [&]() {
+    return !state->running.load() ||
+           download->GetStatus() == DownloadStatus::Cancelled ||
+           download->GetStatus() == DownloadStatus::Paused;
+  };
+  auto fail = [&](const std::string &error) {
+    if (aborted()) {
+      if (state->running.load() && completionCallback)
+        completionCallback(downloadId, false, "User Aborted");
+      return false;
+    }
+    std::cerr << "[Download] " << error << std::endl;
+    download->SetStatus(DownloadStatus::Error);
+    download->SetErrorMessage(error);
+    if (completionCallback)
+      completionCallback(downloadId, false, error);
+    return false;
+  };
+
+  // Playlists are small; fetch them on the download's own thread
+  HostConnections hosts(hSession);
+  std::string error;
+  auto fetchText = [&](const std::string &url, std::string &text,
+                       std::string &finalUrl) {
+    std::vector<char> body;
+    if (FetchResource(state, download, hosts, url, -1, -1, body, error,
+                      &finalUrl) != ChunkResult::Success) {
+      return false;
+    }
+    text.assign(body.begin(), body.end());
+    if (finalUrl.empty()) {
+      finalUrl = url;
+    }
+    return true;
+  };
+
+  std::string text;
+  std::string manifestUrl;
+  if (!fetchText(download->GetUrl(), text, manifestUrl)) {
+    return fail("Failed to fetch manifest: " + error);
+  }
+
+  std::vector<MediaTrack> tracks;
+  if (Manifest::IsHls(text)) {
+    std::string variantUrl;
+    std::string audioUrl;
+    std::string mediaUrl = manifestUrl;
+    if (Manifest::ParseHlsMaster(text, manifestUrl, variantUrl, audioUrl) &&
+        !fetchText(variantUrl, text, mediaUrl)) {
+      return fail("Failed to fetch playlist: " + error);
+    }
+    MediaTrack track;
+    if (!Manifest::ParseHlsMedia(text, mediaUrl, track, error)) {
+      return fail(error);
+    }
+    tracks.push_back(std::move(track));
+
+    if (!audioUrl.empty()) {
+      if (!fetchText(audioUrl, text, mediaUrl)) {
+        return fail("Failed to fetch audio playlist: " + error);
+      }
+      MediaTrack audio;
+      if (!Manifest::ParseHlsMedia(text, mediaUrl, audio, error)) {
+        return fail(error);
+      }
+      tracks.push_back(std::move(audio));
+    }
+  } else if (Manifest::IsDash(text)) {
+    if (!Manifest::ParseDash(text, manifestUrl, tracks, error)) {
+      return fail(error);
+    }
+  } else {
+    return fail("Not an HLS or DASH manifest");
+  }
+  if (tracks.size() > 1 && !mergeCallback) {
+    return fail("Separate audio and video need ffmpeg to be merged");
+  }
+
+  std::vector<std::vector<std::string>> keys(tracks.size());
+  for (size_t t = 0; t < tracks.size(); ++t) {
+    for (const auto &keyUrl : tracks[t].keyUrls) {
+      std::vector<char> key;
+      if (FetchResource(state, download, hosts, keyUrl, -1, -1, key,
+                        error) != ChunkResult::Success) {
+        return fail("Failed to fetch decryption key: " + error);
+      }
+      if (key.size() != 16) {
+        return fail("Invalid AES-128 key");
+      }
+      keys[t].emplace_back(key.begin(), key.end());
+    }
+  }
+
+  // The saved file takes the container of its contents. With separate
+  // audio each track is assembled on its own and muxed at the end.
+  std::string filename = download->GetFilename();
+  size_t dot = filename.find_last_of('.');
+  std::string stem = (dot == std::string::npos || dot == 0)
+                         ? filename
+                         : filename.substr(0, dot);
+  std::string extension = tracks[0].extension;
+  if (tracks.size() > 1) {
+    bool allWebm = std::all_of(tracks.begin(), tracks.end(),
+                               [](const MediaTrack &track) {
+                                 return track.extension == "webm";
+                               });
+    extension = allWebm ? "webm" : "mp4";
+  }
+  if (filename != stem + "." + extension) {
+    download->SetFilename(stem + "." + extension);
+  }
+
+  std::string savePath = download->GetSavePath();
+  CreateDirectoryRecursive(savePath);
+  std::string filePath = savePath + "\\" + download->GetFilename();
+  std::vector<std::string> trackPaths;
+  for (size_t t = 0; t < tracks.size(); ++t) {
+    trackPaths.push_back(tracks.size() == 1
+                             ? filePath
+                             : savePath + "\\" + stem + ".f" +
+                                   std::to_string(t) + "." +
+                                   tracks[t].extension);
+  }
+
+  // Pick up where each track left off; a record that disagrees with the
+  // file on disk or with the playlist's segments restarts that track
+  std::vector<std::pair<size_t, int64_t>> resume(tracks.size());
+  for (size_t t = 0; t < tracks.size(); ++t) {
+    bool listChanged = false;
+    SegmentState record = SegmentState::ResumePoint(
+        trackPaths[t] + ".segments", tracks[t],
+        GetExistingFileSize(trackPaths[t]), listChanged);
+    if (listChanged) {
+      std::cerr << "[DownloadEngine] Segment list of " << trackPaths[t]
+                << " changed, restarting the track" << std::endl;
+    }
+    size_t segments = record.segments;
+    int64_t bytes = record.bytes;
+    resume[t] = {segments, bytes};
+    progress.totalSegments += tracks[t].segments.size();
+    progress.doneSegments += segments;
+    progress.bytes += bytes;
+  }
+  progress.lastBytes = progress.bytes;
+  progress.lastUpdate = std::chrono::steady_clock::now();
+  download->SetDownloadedSize(progress.bytes);
+
+  for (size_t t = 0; t < tracks.size(); ++t) {
+    if (resume[t].first == tracks[t].segments.size()) {
+      continue;
+    }
+    if (!FetchManifestTrack(state, download, hSession, tracks[t], keys[t],
+                            trackPaths[t], resume[t].first, resume[t].second,
+                            connections, progress, error)) {
+      return fail(error);
+    }
+  }
+
+  if (tracks.size() > 1) {
+    // Track files stay (complete) if muxing fails, so a retry only muxes
+    if (!mergeCallback(trackPaths, filePath)) {
+      return fail("Failed to merge audio and video");
+    }
+    for (const auto &trackPath : trackPaths) {
+      DeleteFileA(trackPath.c_str());
+      DeleteFileA((trackPath + ".segments").c_str());
+    }
+  } else {
+    DeleteFileA((filePath + ".segments").c_str());
+  }
+
+  int64_t fileSize = GetExistingFileSize(filePath);
+  download->SetTotalSize(fileSize);
+  download->SetDownloadedSize(fileSize);
+  download->SetStatus(DownloadStatus::Completed);
+  download->ResetRetry();
+
+  if (progress.callback)
+    progress.callback(downloadId, fileSize, fileSize, 0.0);
+  if (completionCallback)
+    completionCallback(downloadId, true, "");
+  return true;
+}
+
+bool DownloadEngine::FetchManifestTrack(
+    const std::shared_ptr<EngineState> &state,
+    const std::shared_ptr<Download> &download, HINTERNET hSession,
+    const MediaTrack &track, const std::vector<std::string> &keys,
+    const std::string &trackPath, size_t doneSegments, int64_t doneBytes,
+    int workers, ManifestProgress &progress, std::string &error) {
+  HANDLE file = CreateFileA(trackPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+                            NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    error = "Failed to create " + trackPath;
+    return false;
+  }
+  // Drop anything written past the last recorded segment
+  LARGE_INTEGER offset;
+  offset.QuadPart = doneBytes;
+  if (!SetFilePointerEx(file, offset, NULL, FILE_BEGIN) ||
+      !SetEndOfFile(file)) {
+    CloseHandle(file);
+    error = "Failed to prepare " + trackPath;
+    return false;
+  }
+
+  const size_t count = track.segments.size();
+  SegmentState record;
+  record.listHash = SegmentState::Hash(track);
+  workers = static_cast<int>(
+      std::min<size_t>(std::max(1, workers), count - doneSegments));
+  const size_t window = workers * Config::SEGMENTS_AHEAD_PER_WORKER;
+
+  // Workers claim segments in order, at most 'window' ahead of the writer,
+  // and hand bodies over in 'ready'; this thread writes them in sequence
+  struct Pipeline {
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t nextIndex = 0;
+    size_t writeIndex = 0;
+    std::map<size_t, std::vector<char>> ready;
+    bool stopped = false;
+    std::string error;
+  } pipeline;
+  pipeline.nextIndex = doneSegments;
+  pipeline.writeIndex = doneSegments;
+
+  auto worker = [&]() {
+    HostConnections hosts(hSession);
+    while (true) {
+      size_t index;
+      {
+        std::unique_lock<std::mutex> lock(pipeline.mutex);
+        pipeline.changed.wait(lock, [&]() {
+          return pipeline.stopped || pipeline.nextIndex >= count ||
+                 pipeline.nextIndex < pipeline.writeIndex + window;
+        });
+        if (pipeline.stopped || pipeline.nextIndex >= count) {
+          return;
+        }
+        index = pipeline.nextIndex++;
+      }
+
+      const MediaSegment &segment = track.segments[index];
+      std::vector<char> body;
+      std::string segmentError;
+      bool fetched = FetchResource(state, download, hosts, segment.url,
+                                   segment.rangeStart, segment.rangeLength,
+                                   body, segmentError) ==
+                     ChunkResult::Success;
+      if (fetched && segment.keyIndex >= 0 &&
+          !DecryptAes128Cbc(keys[segment.keyIndex], segment.iv, body)) {
+        fetched = false;
+        segmentError = "Failed to decrypt segment " + std::to_string(index);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        if (fetched) {
+          pipeline.ready.emplace(index, std::move(body));
+        } else if (!pipeline.stopped) {
+          pipeline.stopped = true;
+          pipeline.error = "Segment " + std::to_string(index) + ": " +
+                           segmentError;
+        }
+      }
+      pipeline.changed.notify_all();
+      if (!fetched) {
+        return;
+      }
+    }
+  };
+
+  std::vector<std::future<void>> futures;
+  for (int w = 0; w < workers; ++w) {
+    futures.push_back(std::async(std::launch::async, worker));
+  }
+
+  int downloadId = download->GetId();
+  while (true) {
+    std::vector<char> body;
+    {
+      std::unique_lock<std::mutex> lock(pipeline.mutex);
+      if (pipeline.writeIndex >= count) {
+        break;
+      }
+      pipeline.changed.wait_for(
+          lock, std::chrono::milliseconds(Config::SEGMENT_WAIT_MS), [&]() {
+            return pipeline.stopped ||
+                   pipeline.ready.count(pipeline.writeIndex) > 0;
+          });
+      if (!pipeline.stopped &&
+          (!state->running.load() ||
+           download->GetStatus() == DownloadStatus::Cancelled ||
+           download->GetStatus() == DownloadStatus::Paused)) {
+        pipeline.stopped = true;
+        pipeline.error = "User Aborted";
+      }
+      if (pipeline.stopped) {
+        break;
+      }
+      auto it = pipeline.ready.find(pipeline.writeIndex);
+      if (it == pipeline.ready.end()) {
+        continue;
+      }
+      body = std::move(it->second);
+      pipeline.ready.erase(it);
+    }
+
+    DWORD written = 0;
+    if (!body.empty() &&
+        (!WriteFile(file, body.data(), static_cast<DWORD>(body.size()),
+                    &written, NULL) ||
+         written != body.size())) {
+      std::lock_guard<std::mutex> lock(pipeline.mutex);
+      pipeline.stopped = true;
+      pipeline.error = "Disk write failed - check available disk space";
+      break;
+    }
+
+    size_t writeIndex;
+    {
+      std::lock_guard<std::mutex> lock(pipeline.mutex);
+      writeIndex = ++pipeline.writeIndex;
+    }
+    pipeline.changed.notify_all();
+    doneBytes += static_cast<int64_t>(body.size());
+    record.segments = writeIndex;
+    record.bytes = doneBytes;
+    record.Write(trackPath + ".segments");
+
+    progress.doneSegments++;
+    progress.bytes += static_cast<int64_t>(body.size());
+    download->SetDownloadedSize(progress.bytes);
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       now - progress.lastUpdate).count();
+    if (elapsed >= Config::SPEED_UPDATE_INTERVAL_MS) {
+      double speed = static_cast<double>(progress.bytes - progress.lastBytes) *
+                     1000.0 / elapsed;
+      download->SetSpeed(speed);
+      progress.lastUpdate = now;
+      progress.lastBytes = progress.bytes;
+
+      // Segment sizes are only known once fetched; extrapolate the average
+      int64_t estimatedTotal = static_cast<int64_t>(
+          static_cast<double>(progress.bytes) * progress.totalSegments /
+          progress.doneSegments);
+      download->SetTotalSize(estimatedTotal);
+      if (progress.callback) {
+        progress.callback(downloadId, progress.bytes, estimatedTotal, speed);
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pipeline.mutex);
+    pipeline.stopped = true;
+  }
+  pipeline.changed.notify_all();
+  for (auto &future : futures) {
+    future.wait();
+  }
+  CloseHandle(file);
+
+  if (pipeline.writeIndex < count) {
+    error = pipeline.error;
+    return false;
+  }
+  return true;
+}
+
+DownloadEngine::ChunkResult DownloadEngine::FetchResource(
+    const std::shared_ptr<EngineState> &state,
+    const std::shared_ptr<Download> &download, HostConnections &hosts,
+    const std::string &url, int64_t rangeStart, int64_t rangeLength,
+    std::vector<char> &body, std::string &error, std::string *finalUrl) {
+  std::string host;
+  std::string objectPath;
+  INTERNET_PORT port = 0;
+  bool secure = false;
+  if (!CrackUrl(url, host, port, objectPath, secure)) {
+    error = "Unsupported URL: " + url;
+    return ChunkResult::Failed;
+  }
+
+  int downloadId = download->GetId();
+  std::string referer = download->GetReferer();
+  if (referer.empty()) {
+    referer = ExtractOriginFromUrl(download->GetUrl());
+  }
+  std::string headers = referer.empty() ? "" : ("Referer: " + referer + "\r\n");
+  const bool ranged = rangeStart >= 0 && rangeLength > 0;
+  if (ranged) {
+    headers += "Range: bytes=" + std::to_string(rangeStart) + "-" +
+               std::to_string(rangeStart + rangeLength - 1) + "\r\n";
+  }
+
+  DWORD flags = INTERNET_FLAG_NO_UI | INTERNET_FLAG_RELOAD |
+                INTERNET_FLAG_KEEP_CONNECTION | INTERNET_FLAG_NO_CACHE_WRITE;
+  if (secure)
+    flags |= INTERNET_FLAG_SECURE;
+  if (!state->verifySSL.load())
+    flags |= (INTERNET_FLAG_IGNORE_CERT_CN_INVALID |
+              INTERNET_FLAG_IGNORE_CERT_DATE_INVALID);
+
+  auto aborted = [&]() {
+    return !state->running.load() ||
+           download->GetStatus() == DownloadStatus::Cancelled ||
+           download->GetStatus() == DownloadStatus::Paused;
+  };
+
+  auto attempt = [&]() {
+    HINTERNET hConnect = hosts.Get(host, port);
+    if (!hConnect) {
+      error = "Connection failed: " + GetWinINetError(GetLastError());
+      return ChunkResult::NetworkError;
+    }
+    HINTERNET hRequest = HttpOpenRequestA(hConnect, "GET", objectPath.c_str(),
+                                          NULL, NULL, NULL, flags, 0);
+    if (!hRequest) {
+      error = "Connection failed: " + GetWinINetError(GetLastError());
+      return ChunkResult::NetworkError;
+    }
+    TrackRequestHandle(state, downloadId, hRequest);
+    auto closeRequest = [&]() {
+      UntrackRequestHandle(state, downloadId, hRequest);
+      InternetCloseHandle(hRequest);
+    };
+
+    if (!HttpSendRequestA(hRequest, headers.empty() ? NULL : headers.c_str(),
+                          static_cast<DWORD>(headers.length()), NULL, 0)) {
+      DWORD err = GetLastError();
+      closeRequest();
+      if (aborted())
+        return ChunkResult::Aborted;
+      error = "Connection failed: " + GetWinINetError(err);
+      return ChunkResult::NetworkError;
+    }
+
+    DWORD statusCode = 0;
+    DWORD statusSize = sizeof(statusCode);
+    HttpQueryInfoA(hRequest, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
+                   &statusCode, &statusSize, NULL);
+    if (statusCode != 200 && statusCode != 206) {
+      closeRequest();
+      error = GetHttpStatusError(statusCode);
+      if (statusCode == 429 || statusCode == 503)
+        return ChunkResult::Throttled;
+      if (statusCode >= 500 || statusCode == 408)
+        return ChunkResult::NetworkError;
+      return ChunkResult::Failed;
+    }
+    // A ranged request must get exactly its range back; a server that
+    // ignores Range sends the whole resource with a 200
+    if (ranged) {
+      int64_t servedStart = -1;
+      if (statusCode != 206 ||
+          !ParseContentRangeStart(QueryHeaderString(hRequest, HTTP_QUERY_CONTENT_RANGE),
+                                  servedStart) ||
+          servedStart != rangeStart) {
+        closeRequest();
+        error = (statusCode == 206) ? "Server returned the wrong byte range"
+                                    : "Server does not support byte ranges";
+        return ChunkResult::Failed;
+      }
+    }
+    if (finalUrl) {
+      *finalUrl = QueryFinalUrl(hRequest);
+    }
+
+    int64_t contentLength = -1;
+    char clBuffer[64] = {0};
+    DWORD clSize = sizeof(clBuffer);
+    if (HttpQueryInfoA(hRequest, HTTP_QUERY_CONTENT_LENGTH, clBuffer, &clSize,
+                       NULL)) {
+      contentLength = _strtoi64(clBuffer, NULL, 10);
+    }
+
+    body.clear();
+    if (contentLength > 0) {
+      body.reserve(static_cast<size_t>(contentLength));
+    }
+    DWORD bytesRead = 0;
+    do {
+      if (aborted()) {
+        closeRequest();
+        return ChunkResult::Aborted;
+      }
+      size_t used = body.size();
+      body.resize(used + Config::SMALL_FILE_READ_SIZE);
+      if (!InternetReadFile(hRequest, body.data() + used,
+                            Config::SMALL_FILE_READ_SIZE, &bytesRead)) {
+        closeRequest();
+        if (aborted())
+          return ChunkResult::Aborted;
+        error = "Read Error";
+        return ChunkResult::NetworkError;
+      }
+      body.resize(used + bytesRead);
+
+      SpeedLimiter::GetInstance().Consume(bytesRead);
+    } while (bytesRead > 0);
+    closeRequest();
+
+    int64_t size = static_cast<int64_t>(body.size());
+    if (contentLength >= 0 && size != contentLength) {
+      error = "Connection closed early";
+      return ChunkResult::NetworkError;
+    }
+    if (ranged && size != rangeLength) {
+      error = "Unexpected range length";
+      return ChunkResult::NetworkError;
+    }
+    return ChunkResult::Success;
+  };
+
+  for (int retry = 0;; ++retry) {
+    ChunkResult result = attempt();
+    if (result == ChunkResult::Success || result == ChunkResult::Failed ||
+        result == ChunkResult::Aborted || retry >= Config::MAX_CHUNK_RETRIES) {
+      return result;
+    }
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(Config::BASE_CHUNK_RETRY_MS * (1 << retry)));
+    if (aborted()) {
+      return ChunkResult::Aborted;
+    }
+  }
+}
+
 void DownloadEngine::CleanupCompletedDownloads() {
   std::lock_guard<std::mutex> lock(m_activeDownloadsMutex);
   for (auto it = m_activeDownloads.begin(); it != m_activeDownloads.end();) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Download.h"
+#include "SmallFileQueue.h"
 #include <atomic>
 #include <functional>
 #include <future>
@@ -18,6 +19,8 @@
 
 #pragma comment(lib, "wininet.lib")
 
+struct MediaTrack;
+
 class DownloadEngine {
 public:
   DownloadEngine();
@@ -27,9 +30,21 @@ public:
   DownloadEngine(const DownloadEngine &) = delete;
   DownloadEngine &operator=(const DownloadEngine &) = delete;
 
-  // Start downloading a file
+  // Start downloading a file. An HLS (.m3u8) or DASH (.mpd) URL is
+  // downloaded as its media: segments are fetched in parallel and written
+  // out in order, and separate audio is joined by the merge callback.
   bool StartDownload(std::shared_ptr<Download> download);
 
+  // Download many small files back-to-back without probing them first.
+  // Files are grouped by host and each group reuses one keep-alive
+  // connection; anything that turns out to be large is handed to
+  // StartDownload.
+  bool StartSmallFileBatch(
+      const std::vector<std::shared_ptr<Download>> &downloads);
+
+  // True if a download looks small enough for StartSmallFileBatch
+  static bool IsSmallFileCandidate(const Download &download);
+
   // Pause/resume/cancel
   void PauseDownload(std::shared_ptr<Download> download);
   void ResumeDownload(std::shared_ptr<Download> download);
@@ -39,8 +54,34 @@ public:
   // Returns true if download is no longer running, false on timeout
   bool WaitForDownloadFinish(int downloadId, int timeoutMs = 5000);
 
+  // Remote file metadata reported by the server
+  struct RemoteFileInfo {
+    int64_t fileSize = -1;
+    bool resumable = false;
+    std::string etag;
+    std::string lastModified;
+    std::string finalUrl;  // URL after redirects (a 3xx: where it points)
+  };
+
   // Get file info (size, resumable) without downloading
   bool GetFileInfo(const std::string &url, int64_t &fileSize, bool &resumable);
+  bool GetFileInfo(const std::string &url, RemoteFileInfo &info);
+
+  // Outcome of probing one download's URL
+  struct ProbeResult {
+    int downloadId = 0;
+    DWORD statusCode = 0;  // 0 when no response was received
+    RemoteFileInfo info;
+    std::string error;
+  };
+  using ProbeCallback = std::function<void(const ProbeResult &result)>;
+
+  // Check many links at once without downloading them: HEAD (falling back
+  // to a one-byte ranged GET) with a bounded number of requests per host,
+  // each lane reusing one connection. Sizes, range support and validators
+  // are written into the downloads as results arrive. Returns immediately.
+  bool ProbeDownloads(const std::vector<std::shared_ptr<Download>> &downloads,
+                      ProbeCallback callback);
 
   // Callbacks for progress updates
   using ProgressCallback = std::function<void(
@@ -51,8 +92,14 @@ public:
   void SetProgressCallback(ProgressCallback callback);
   void SetCompletionCallback(CompletionCallback callback);
 
+  // Muxes separately fetched streams into one file (blocking)
+  using MergeCallback = std::function<bool(
+      const std::vector<std::string> &inputs, const std::string &outputPath)>;
+  void SetMergeCallback(MergeCallback callback);
+
   // Settings
   void SetMaxConnections(int connections) { m_maxConnections = connections; }
+  // Sets the process-wide SpeedLimiter, shared with every other engine
   void SetSpeedLimit(int64_t bytesPerSecond);
   void SetUserAgent(const std::string &userAgent);
   void SetProxy(const std::string &proxyHost, int proxyPort);
@@ -72,8 +119,21 @@ private:
     Throttled,
     NetworkError,    // Connection/read failure - should retry
     Failed,          // Non-recoverable failure
+    EntityChanged,   // If-Range mismatch - remote file changed
     Aborted
   };
+  enum class SmallFileResult {
+    Completed,
+    Failed,
+    Aborted,
+    Fallback         // Too large or unexpected response - use the normal path
+  };
+  struct HostGroup {
+    std::string host;
+    INTERNET_PORT port = 0;
+    bool secure = false;
+    std::vector<std::pair<std::shared_ptr<Download>, std::string>> items;  // download, object path
+  };
   struct SessionEntry {
     HINTERNET handle = nullptr;
     std::atomic<int> activeCount{0};
@@ -90,7 +150,6 @@ private:
     std::unordered_map<int, std::vector<HINTERNET>> requestHandles;
 
     std::atomic<bool> running{false};
-    std::atomic<int64_t> speedLimitBytes{0};
     std::string userAgent;
     std::string proxyUrl;
     std::atomic<bool> verifySSL{true};
@@ -98,6 +157,7 @@ private:
     std::mutex callbackMutex;
     ProgressCallback progressCallback;
     CompletionCallback completionCallback;
+    MergeCallback mergeCallback;
   };
 
   struct SessionUsage {
@@ -124,6 +184,25 @@ private:
   std::set<int> m_runningDownloadIds;
   std::mutex m_runningIdsMutex;
 
+  // Claimed small files waiting for a batch worker
+  SmallFileQueue m_smallFileQueue;
+
+  static std::vector<HostGroup>
+  GroupByHost(const std::vector<std::shared_ptr<Download>> &downloads,
+              std::vector<std::shared_ptr<Download>> &unsupported);
+  static void RunProbeLane(const std::shared_ptr<EngineState> &state,
+                           const HostGroup &lane,
+                           const ProbeCallback &callback);
+  static DWORD ProbeOnConnection(const std::shared_ptr<EngineState> &state,
+                                 HINTERNET hConnect,
+                                 const std::string &objectPath, bool secure,
+                                 const std::string &headers, bool useHead,
+                                 RemoteFileInfo &info);
+  static void ApplyProbeResult(Download &download, const RemoteFileInfo &info);
+  void ReleaseRunningId(int downloadId);
+  void RunSmallFileGroup(const std::shared_ptr<EngineState> &state,
+                         const HostGroup &group);
+
   // Worker thread
   std::thread m_workerThread;
   // Cleanup completed futures
@@ -138,6 +217,7 @@ private:
                                      int64_t &startOut);
   static int64_t GetExistingFileSize(const std::string &filePath);
   static bool PreallocateFile(const std::string &filePath, int64_t size);
+  static void DiscardPartialData(const std::shared_ptr<Download> &download);
 
   static void CleanupRetiredSessions(
       const std::shared_ptr<EngineState> &state);
@@ -155,8 +235,35 @@ private:
                                           int chunkIndex, int64_t rangeStart,
                                           int64_t rangeEnd,
                                           const std::string &partPath,
-                                          int64_t speedLimitBytes,
                                           int64_t fileOffset);
+  static SmallFileResult PerformSmallFileDownload(
+      const std::shared_ptr<EngineState> &state,
+      const std::shared_ptr<Download> &download, HINTERNET hConnect,
+      const std::string &objectPath, bool secure);
+  // Streaming manifests: one connect handle per host for each worker, and
+  // byte/segment counts shared by the tracks of one download
+  struct HostConnections;
+  struct ManifestProgress;
+  static bool PerformManifestDownload(std::shared_ptr<EngineState> state,
+                                      std::shared_ptr<Download> download,
+                                      int connections);
+  static bool FetchManifestTrack(const std::shared_ptr<EngineState> &state,
+                                 const std::shared_ptr<Download> &download,
+                                 HINTERNET hSession, const MediaTrack &track,
+                                 const std::vector<std::string> &keys,
+                                 const std::string &trackPath,
+                                 size_t doneSegments, int64_t doneBytes,
+                                 int workers, ManifestProgress &progress,
+                                 std::string &error);
+  // GET a resource or a byte range of it into memory, retrying network
+  // errors. finalUrl, if given, receives the URL after redirects.
+  static ChunkResult FetchResource(const std::shared_ptr<EngineState> &state,
+                                   const std::shared_ptr<Download> &download,
+                                   HostConnections &hosts,
+                                   const std::string &url, int64_t rangeStart,
+                                   int64_t rangeLength,
+                                   std::vector<char> &body, std::string &error,
+                                   std::string *finalUrl = nullptr);
   static bool MergeChunkFiles(const std::vector<std::string> &partPaths,
                               const std::string &outputPath);
   static void TrackRequestHandle(const std::shared_ptr<EngineState> &state,
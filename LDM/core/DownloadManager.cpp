@@ -1,16 +1,29 @@
 #include "DownloadManager.h"
 #include "YtDlpManager.h"
 #include "../database/DatabaseManager.h"
+#include "../utils/Manifest.h"
 #include "../utils/Settings.h"
 #include <KnownFolders.h>
 #include <Shlobj.h>
 #include <algorithm>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <thread>
 #include <unordered_set>
 #include <wx/app.h>
 #include <wx/msgdlg.h>
 
+// Bulk add: below this many URLs per thread, preparing inline is cheaper
+static constexpr size_t BULK_ADD_MIN_PER_WORKER = 512;
+// URLs read from an import file per AddDownloads call
+static constexpr size_t IMPORT_BATCH_SIZE = 10000;
+// Completed records one /downloads query may look at before it returns a
+// short page with a cursor, so a filter few match does not scan it all
+static constexpr size_t HISTORY_SCAN_BUDGET = 20000;
+
 // URL validation helper
 static bool IsValidUrl(const std::string &url) {
   if (url.empty() || url.length() < 10)
@@ -28,12 +41,6 @@ static bool IsValidUrl(const std::string &url) {
     return false;
   }
 
-  // Reject streaming manifest URLs
-  if (url.find(".m3u8") != std::string::npos ||
-      url.find(".mpd") != std::string::npos) {
-    return false;
-  }
-
   // Check URL length (WinINet has limits)
   if (url.length() > 2048) {
     return false;
@@ -73,6 +80,18 @@ static bool IsValidUrl(const std::string &url) {
   return true;
 }
 
+// Host part of a URL, used to group downloads by server
+static std::string ExtractHost(const std::string &url) {
+  size_t start = url.find("://");
+  start = (start == std::string::npos) ? 0 : start + 3;
+  size_t end = url.find_first_of(":/?#", start);
+  std::string host = url.substr(start, end == std::string::npos
+                                           ? std::string::npos
+                                           : end - start);
+  std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+  return host;
+}
+
 static std::unordered_set<std::string> ParseExtensions(const std::string &csv) {
   std::unordered_set<std::string> result;
   std::istringstream stream(csv);
@@ -92,7 +111,28 @@ static std::unordered_set<std::string> ParseExtensions(const std::string &csv) {
   return result;
 }
 
-static std::string DetermineCategoryFromSettings(const std::string &filename) {
+// What a query row shows of a loaded download; chunks are left out
+static DownloadManager::DownloadRow RowFromDownload(const Download &download) {
+  DownloadManager::DownloadRow row;
+  DownloadRecord &record = row.record;
+  record.id = download.GetId();
+  record.url = download.GetUrl();
+  record.filename = download.GetFilename();
+  record.savePath = download.GetSavePath();
+  record.category = download.GetCategory();
+  record.errorMessage = download.GetErrorMessage();
+  record.totalSize = download.GetTotalSize();
+  record.downloadedSize = download.GetDownloadedSize();
+  record.status = download.GetStatus();
+  record.isYtDlp = download.IsYtDlpDownload();
+  row.generation = download.GetGeneration();
+  row.progress = download.GetProgress();
+  row.speed = download.GetSpeed();
+  return row;
+}
+
+std::string
+DownloadManager::DetermineCategoryFromSettings(const std::string &filename) {
   size_t dotPos = filename.rfind('.');
   if (dotPos == std::string::npos) {
     return "All Downloads";
@@ -102,38 +142,40 @@ static std::string DetermineCategoryFromSettings(const std::string &filename) {
   std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
 
   DatabaseManager &db = DatabaseManager::GetInstance();
-
-  auto compressed = ParseExtensions(db.GetSetting("file_types_compressed", "zip,rar,7z,tar,gz"));
-  if (compressed.find(ext) != compressed.end()) {
-    return "Compressed";
-  }
-
-  auto documents = ParseExtensions(db.GetSetting("file_types_documents", "pdf,doc,docx,txt,xls,xlsx,ppt,pptx"));
-  if (documents.find(ext) != documents.end()) {
-    return "Documents";
-  }
-
-  auto images = ParseExtensions(db.GetSetting("file_types_images", "jpg,jpeg,png,gif,bmp,webp,svg,ico,tiff,tif"));
-  if (images.find(ext) != images.end()) {
-    return "Images";
-  }
-
-  auto music = ParseExtensions(db.GetSetting("file_types_music", "mp3,wav,flac,aac,ogg,wma"));
-  if (music.find(ext) != music.end()) {
-    return "Music";
-  }
-
-  auto video = ParseExtensions(db.GetSetting("file_types_video", "mp4,avi,mkv,mov,wmv,flv,webm"));
-  if (video.find(ext) != video.end()) {
-    return "Video";
-  }
-
-  auto programs = ParseExtensions(db.GetSetting("file_types_programs", "exe,msi,dmg,deb,rpm,apk"));
-  if (programs.find(ext) != programs.end()) {
-    return "Programs";
+  uint64_t version = db.GetSettingsVersion();
+
+  std::lock_guard<std::mutex> lock(m_categoryRulesMutex);
+  if (version != m_categoryRulesVersion) {
+    // Compile the file type lists into one table. Categories are added in
+    // priority order and emplace keeps the first, so an extension listed
+    // twice goes to the earlier category.
+    struct Rule {
+      const char *category;
+      const char *key;
+      const char *defaults;
+    };
+    static const Rule rules[] = {
+        {"Compressed", "file_types_compressed", "zip,rar,7z,tar,gz"},
+        {"Documents", "file_types_documents",
+         "pdf,doc,docx,txt,xls,xlsx,ppt,pptx"},
+        {"Images", "file_types_images",
+         "jpg,jpeg,png,gif,bmp,webp,svg,ico,tiff,tif"},
+        {"Music", "file_types_music", "mp3,wav,flac,aac,ogg,wma"},
+        {"Video", "file_types_video", "mp4,avi,mkv,mov,wmv,flv,webm"},
+        {"Programs", "file_types_programs", "exe,msi,dmg,deb,rpm,apk"},
+    };
+    m_categoryRules.clear();
+    for (const auto &rule : rules) {
+      for (const auto &extension :
+           ParseExtensions(db.GetSetting(rule.key, rule.defaults))) {
+        m_categoryRules.emplace(extension, rule.category);
+      }
+    }
+    m_categoryRulesVersion = version;
   }
 
-  return "All Downloads";
+  auto it = m_categoryRules.find(ext);
+  return it != m_categoryRules.end() ? it->second : "All Downloads";
 }
 
 DownloadManager &DownloadManager::GetInstance() {
@@ -155,6 +197,10 @@ DownloadManager::DownloadManager()
       [this](int downloadId, bool success, const std::string &error) {
         OnDownloadComplete(downloadId, success, error);
       });
+  m_engine->SetMergeCallback([](const std::vector<std::string> &inputs,
+                                const std::string &outputPath) {
+    return YtDlpManager::GetInstance().MergeMediaFiles(inputs, outputPath);
+  });
 
   // Set default save path to Downloads folder
   PWSTR path = NULL;
@@ -198,8 +244,8 @@ DownloadManager::~DownloadManager() {
     delete m_schedulerTimer;
   }
 
-  // Save all downloads to database before exiting
-  SaveAllDownloadsToDatabase();
+  // Persist whatever changed since the last periodic save
+  SaveChangedDownloadsToDatabase();
 
   // Cancel all active downloads
   CancelAllDownloads();
@@ -227,6 +273,7 @@ void DownloadManager::ApplySettings(const Settings &settings) {
   }
 
   m_maxSimultaneousDownloads = settings.GetMaxSimultaneousDownloads();
+  m_queuePolicy.store(static_cast<QueuePolicy>(settings.GetQueuePolicy()));
   EnsureCategoryFoldersExist();
 
   if (m_engine) {
@@ -243,59 +290,276 @@ void DownloadManager::ApplySettings(const Settings &settings) {
       m_engine->SetProxy("", 0);
     }
   }
+  YtDlpManager::GetInstance().ApplySettings(settings);
 }
 
 void DownloadManager::LoadDownloadsFromDatabase() {
   DatabaseManager &db = DatabaseManager::GetInstance();
   db.Initialize();
 
-  auto loadedDownloads = db.LoadAllDownloads();
+  // Only unfinished downloads are built; completed history stays in the
+  // database as records (see GetHistoryRecord)
+  auto loadedDownloads = db.LoadUnfinishedDownloads();
+  std::vector<int> historyIds = db.GetCompletedDownloadIds();
+  int maxId = db.GetMaxDownloadId();
 
   std::lock_guard<std::mutex> lock(m_downloadsMutex);
 
-  for (auto &download : loadedDownloads) {
-    // Track highest ID for new downloads
-    if (download->GetId() >= m_nextId) {
-      m_nextId = download->GetId() + 1;
-    }
+  // Track highest ID for new downloads, history included
+  if (maxId >= m_nextId) {
+    m_nextId = maxId + 1;
+  }
+  m_unloadedHistory = std::move(historyIds);
 
+  std::vector<std::shared_ptr<Download>> downloads = GetSnapshot()->downloads;
+  downloads.reserve(downloads.size() + loadedDownloads.size());
+  for (auto &download : loadedDownloads) {
     // Convert unique_ptr to shared_ptr and add to list
     auto sharedDownload = std::shared_ptr<Download>(download.release());
-    m_downloads.push_back(sharedDownload);
+    downloads.push_back(sharedDownload);
     m_downloadIndex[sharedDownload->GetId()] = sharedDownload;
+    IndexDownload(sharedDownload);
+  }
+  PublishSnapshot(std::move(downloads));
+}
+
+size_t DownloadManager::GetHistoryCount() const {
+  std::lock_guard<std::mutex> lock(m_downloadsMutex);
+  return m_unloadedHistory.size();
+}
+
+std::vector<int>
+DownloadManager::GetHistoryIds(const std::string &category) const {
+  if (category.empty()) {
+    std::lock_guard<std::mutex> lock(m_downloadsMutex);
+    return m_unloadedHistory;
+  }
+
+  // Matched on the stored records, then trimmed to what is still history
+  std::vector<int> ids =
+      DatabaseManager::GetInstance().GetCompletedDownloadIds(category);
+  std::lock_guard<std::mutex> lock(m_downloadsMutex);
+  ids.erase(std::remove_if(ids.begin(), ids.end(),
+                           [this](int id) {
+                             return !std::binary_search(
+                                 m_unloadedHistory.begin(),
+                                 m_unloadedHistory.end(), id);
+                           }),
+            ids.end());
+  return ids;
+}
+
+bool DownloadManager::GetHistoryRecord(int downloadId,
+                                       DownloadRecord &record) const {
+  return DatabaseManager::GetInstance().LoadRecord(downloadId, record) &&
+         record.status == DownloadStatus::Completed;
+}
+
+std::shared_ptr<Download> DownloadManager::GetOrRestoreDownload(int downloadId) {
+  std::shared_ptr<Download> download;
+  {
+    std::lock_guard<std::mutex> lock(m_downloadsMutex);
+    auto it = m_downloadIndex.find(downloadId);
+    if (it != m_downloadIndex.end()) {
+      return it->second;
+    }
+    auto historyIt = std::lower_bound(m_unloadedHistory.begin(),
+                                      m_unloadedHistory.end(), downloadId);
+    if (historyIt == m_unloadedHistory.end() || *historyIt != downloadId) {
+      return nullptr;
+    }
+    download = DatabaseManager::GetInstance().LoadDownload(downloadId);
+    if (!download) {
+      return nullptr;
+    }
+    m_unloadedHistory.erase(historyIt);
+
+    std::vector<std::shared_ptr<Download>> downloads = GetSnapshot()->downloads;
+    downloads.push_back(download);
+    m_downloadIndex[downloadId] = download;
+    IndexDownload(download);
+    PublishSnapshot(std::move(downloads));
+  }
+
+  // The table swaps its history row for the loaded download
+  MarkChanged(downloadId, Download::ConsumerBit(ChangeConsumer::Table));
+  return download;
+}
+
+DownloadManager::DownloadPage
+DownloadManager::QueryDownloads(const DownloadQuery &query) {
+  const size_t limit = std::max<size_t>(query.limit, 1);
+  auto lower = [](std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    return value;
+  };
+  const std::string host = lower(query.host);
+  const std::string text = lower(query.text);
+  auto wantsStatus = [&query](DownloadStatus status) {
+    return query.statuses.empty() ||
+           std::find(query.statuses.begin(), query.statuses.end(), status) !=
+               query.statuses.end();
+  };
+  auto matches = [&](const DownloadRecord &record) {
+    if (!wantsStatus(record.status)) {
+      return false;
+    }
+    if (!query.category.empty() && record.category != query.category) {
+      return false;
+    }
+    if (!host.empty() && ExtractHost(record.url) != host) {
+      return false;
+    }
+    return text.empty() ||
+           lower(record.filename).find(text) != std::string::npos ||
+           lower(record.url).find(text) != std::string::npos;
+  };
+
+  // Loaded downloads, newest first, walked straight out of the indexes:
+  // the category's bucket, else one bucket per wanted status
+  std::vector<DownloadRow> loaded;
+  int loadedFloor = 0;  // A full page from the indexes reaches down to here
+  {
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    using Head = std::pair<DownloadBucket::const_reverse_iterator,
+                           DownloadBucket::const_reverse_iterator>;
+    std::vector<Head> heads;
+    auto addBucket = [&](const DownloadBucket &bucket) {
+      heads.emplace_back(
+          DownloadBucket::const_reverse_iterator(bucket.lower_bound(query.beforeId)),
+          bucket.crend());
+    };
+    if (!query.category.empty()) {
+      auto it = m_categoryIndex.find(query.category);
+      if (it != m_categoryIndex.end()) {
+        addBucket(it->second);
+      }
+    } else {
+      for (size_t i = 0; i < STATUS_COUNT; ++i) {
+        if (wantsStatus(static_cast<DownloadStatus>(i))) {
+          addBucket(m_statusIndex[i]);
+        }
+      }
+    }
+
+    while (loaded.size() < limit) {
+      Head *next = nullptr;
+      for (auto &head : heads) {
+        if (head.first != head.second &&
+            (!next || head.first->first > next->first->first)) {
+          next = &head;
+        }
+      }
+      if (!next) {
+        break;
+      }
+      DownloadRow row = RowFromDownload(*next->first->second);
+      ++next->first;
+      if (matches(row.record)) {
+        loaded.push_back(std::move(row));
+      }
+    }
+    if (loaded.size() == limit) {
+      loadedFloor = loaded.back().record.id;
+    }
+  }
+
+  // Completed history still in the database, filtered on its compact
+  // records and never below what the indexes already filled. A sparse
+  // filter stops after a bounded scan and the page ends where it stopped.
+  std::vector<DownloadRow> history;
+  int historyResume = -1;
+  if (wantsStatus(DownloadStatus::Completed)) {
+    HistoryStore::Filter filter{query.category, host, text};
+    std::vector<DownloadRecord> records =
+        DatabaseManager::GetInstance().FindCompleted(
+            filter, query.beforeId, loadedFloor, limit, HISTORY_SCAN_BUDGET,
+            historyResume);
+    // Entries started again are listed from the indexes instead
+    std::lock_guard<std::mutex> lock(m_downloadsMutex);
+    for (auto &record : records) {
+      if (std::binary_search(m_unloadedHistory.begin(),
+                             m_unloadedHistory.end(), record.id)) {
+        DownloadRow row;
+        row.record = std::move(record);
+        history.push_back(std::move(row));
+      }
+    }
   }
+
+  // Merge newest first; an id can show up twice if it was started again
+  // while the page was read
+  DownloadPage page;
+  page.downloads = std::move(loaded);
+  page.downloads.insert(page.downloads.end(), history.begin(), history.end());
+  std::sort(page.downloads.begin(), page.downloads.end(),
+            [](const auto &a, const auto &b) { return a.record.id > b.record.id; });
+  page.downloads.erase(
+      std::unique(page.downloads.begin(), page.downloads.end(),
+                  [](const auto &a, const auto &b) { return a.record.id == b.record.id; }),
+      page.downloads.end());
+  if (historyResume >= 0) {
+    // History below the resume point is unread, so nothing under it can
+    // be placed yet; the next page starts there
+    page.downloads.erase(
+        std::find_if(page.downloads.begin(), page.downloads.end(),
+                     [historyResume](const auto &row) {
+                       return row.record.id < historyResume;
+                     }),
+        page.downloads.end());
+    page.nextCursor = historyResume;
+  }
+  if (page.downloads.size() >= limit) {
+    page.downloads.resize(limit);
+    page.nextCursor = page.downloads.back().record.id;
+  }
+  return page;
+}
+
+void DownloadManager::PublishSnapshot(
+    std::vector<std::shared_ptr<Download>> downloads) {
+  auto snapshot = std::make_shared<DownloadSnapshot>();
+  snapshot->version = GetSnapshot()->version + 1;
+  snapshot->downloads = std::move(downloads);
+  std::atomic_store(&m_snapshot, SnapshotPtr(std::move(snapshot)));
 }
 
 void DownloadManager::SaveAllDownloadsToDatabase() {
   DatabaseManager &db = DatabaseManager::GetInstance();
 
-  std::lock_guard<std::mutex> lock(m_downloadsMutex);
-  if (!db.SyncAllDownloads(m_downloads)) {
+  SnapshotPtr snapshot = GetSnapshot();
+  if (!db.SyncAllDownloads(snapshot->downloads)) {
     std::cerr << "Database error: Failed to save downloads" << std::endl;
   }
 }
 
+void DownloadManager::SaveChangedDownloadsToDatabase() {
+  DatabaseManager &db = DatabaseManager::GetInstance();
+  for (const auto &download : DrainChanged(ChangeConsumer::Database)) {
+    db.UpdateDownload(*download);
+  }
+}
+
 void DownloadManager::UpdateDownloadsCategory(const std::string &fromCategory,
                                               const std::string &toCategory) {
   std::vector<std::shared_ptr<Download>> toUpdate;
   {
-    std::lock_guard<std::mutex> lock(m_downloadsMutex);
-    for (const auto &download : m_downloads) {
-      if (download && download->GetCategory() == fromCategory) {
-        download->SetCategory(toCategory);
-        toUpdate.push_back(download);
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    auto it = m_categoryIndex.find(fromCategory);
+    if (it != m_categoryIndex.end()) {
+      for (const auto &entry : it->second) {
+        toUpdate.push_back(entry.second);
       }
     }
   }
 
-  if (toUpdate.empty()) {
-    return;
-  }
-
-  DatabaseManager &db = DatabaseManager::GetInstance();
+  // Re-filing happens through the index listener, outside m_indexMutex
   for (const auto &download : toUpdate) {
-    db.UpdateDownload(*download);
+    download->SetCategory(toCategory);
   }
+
+  // Stored records too, including history that has not been loaded yet
+  DatabaseManager::GetInstance().UpdateCategory(fromCategory, toCategory);
 }
 
 void DownloadManager::SaveDownloadToDatabase(int downloadId) {
@@ -307,21 +571,29 @@ void DownloadManager::SaveDownloadToDatabase(int downloadId) {
 
 int DownloadManager::AddDownload(const std::string &url,
                                  const std::string &savePath) {
-  // Validate URL first
-  if (!IsValidUrl(url)) {
-    return -1; // Invalid URL
-  }
-
-  std::lock_guard<std::mutex> lock(m_downloadsMutex);
+  return AddDownloads({url}, savePath).front();
+}
 
+std::shared_ptr<Download>
+DownloadManager::CreateDownload(int downloadId, const std::string &url,
+                                const std::string &savePath,
+                                const std::string &defaultSavePath) {
   // Create download with default path first to get auto-detected category
-  auto download =
-      std::make_shared<Download>(m_nextId++, url, m_defaultSavePath);
+  auto download = std::make_shared<Download>(downloadId, url, defaultSavePath);
 
   // Check if this is a video site URL
   YtDlpManager &ytdlp = YtDlpManager::GetInstance();
   bool isVideoSite = ytdlp.IsVideoSiteUrl(url);
 
+  // A manifest is saved as the media it lists; the engine settles the
+  // exact container once it has read the manifest
+  if (!isVideoSite && Manifest::IsManifestUrl(url)) {
+    std::string filename = download->GetFilename();
+    size_t dot = filename.find_last_of('.');
+    bool isHls = filename.size() > dot && filename.compare(dot, 5, ".m3u8") == 0;
+    download->SetFilename(filename.substr(0, dot) + (isHls ? ".ts" : ".mp4"));
+  }
+
   // Determine the correct folder based on category
   std::string category = DetermineCategoryFromSettings(download->GetFilename());
   download->SetCategory(category);
@@ -330,94 +602,255 @@ int DownloadManager::AddDownload(const std::string &url,
     download->SetSavePath(savePath); // User specified a custom path
   } else if (isVideoSite) {
     // Video site URLs always go to Video folder
-    download->SetSavePath(m_defaultSavePath + "\\Video");
+    download->SetSavePath(defaultSavePath + "\\Video");
     download->SetCategory("Video");
     download->SetYtDlpDownload(true);
   } else if (category != "All Downloads") {
     // Use category subfolder
-    download->SetSavePath(m_defaultSavePath + "\\" + category);
+    download->SetSavePath(defaultSavePath + "\\" + category);
   }
   // else: keep default save path
 
-  m_downloads.push_back(download);
-  m_downloadIndex[download->GetId()] = download;
-
-  // Save to database immediately
-  if (!DatabaseManager::GetInstance().SaveDownload(*download)) {
-    std::cerr << "Database error: Failed to save new download ID "
-              << download->GetId() << std::endl;
-  }
-
-  return download->GetId();
+  return download;
 }
 
-void DownloadManager::RemoveDownload(int downloadId, bool deleteFile) {
-  std::shared_ptr<Download> downloadToRemove;
+std::vector<int> DownloadManager::AddDownloads(
+    const std::vector<std::string> &urls, const std::string &savePath) {
+  std::vector<int> ids(urls.size(), -1);
+  if (urls.empty()) {
+    return ids;
+  }
 
+  // Reserve a block of ids up front; an invalid URL just leaves a gap
+  int firstId;
+  std::string defaultSavePath;
   {
     std::lock_guard<std::mutex> lock(m_downloadsMutex);
+    firstId = m_nextId;
+    m_nextId += static_cast<int>(urls.size());
+    defaultSavePath = m_defaultSavePath;
+  }
 
-    auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
-                           [downloadId](const std::shared_ptr<Download> &d) {
-                             return d->GetId() == downloadId;
-                           });
+  std::vector<std::shared_ptr<Download>> prepared(urls.size());
+  auto prepareRange = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (IsValidUrl(urls[i])) {
+        prepared[i] = CreateDownload(firstId + static_cast<int>(i), urls[i],
+                                     savePath, defaultSavePath);
+      }
+    }
+  };
 
-    if (it == m_downloads.end()) {
-      return;
+  size_t workers = std::min<size_t>(
+      std::max(1u, std::thread::hardware_concurrency()),
+      urls.size() / BULK_ADD_MIN_PER_WORKER);
+  if (workers <= 1) {
+    prepareRange(0, urls.size());
+  } else {
+    size_t perWorker = (urls.size() + workers - 1) / workers;
+    std::vector<std::future<void>> futures;
+    for (size_t begin = 0; begin < urls.size(); begin += perWorker) {
+      futures.push_back(std::async(std::launch::async, prepareRange, begin,
+                                   std::min(begin + perWorker, urls.size())));
     }
+    for (auto &future : futures) {
+      future.get();
+    }
+  }
 
-    downloadToRemove = *it;
+  std::vector<std::shared_ptr<Download>> added;
+  added.reserve(prepared.size());
+  for (size_t i = 0; i < prepared.size(); ++i) {
+    if (prepared[i]) {
+      ids[i] = prepared[i]->GetId();
+      added.push_back(std::move(prepared[i]));
+    }
+  }
+  if (added.empty()) {
+    return ids;
+  }
 
-    // Cancel if still downloading
-    if (downloadToRemove->GetStatus() == DownloadStatus::Downloading) {
-      if (downloadToRemove->IsYtDlpDownload()) {
-        YtDlpManager::GetInstance().CancelDownload(downloadId);
-      } else {
-        m_engine->CancelDownload(downloadToRemove);
-      }
+  // One snapshot copy and one publish for the whole batch
+  {
+    std::lock_guard<std::mutex> lock(m_downloadsMutex);
+    std::vector<std::shared_ptr<Download>> downloads = GetSnapshot()->downloads;
+    downloads.reserve(downloads.size() + added.size());
+    for (const auto &download : added) {
+      downloads.push_back(download);
+      m_downloadIndex[download->GetId()] = download;
+      IndexDownload(download);
     }
+    PublishSnapshot(std::move(downloads));
+  }
 
-    // Remove from index and list first
-    m_downloadIndex.erase(downloadId);
-    m_downloads.erase(it);
+  // Already current in the table and the database, but event subscribers
+  // still have to hear about them
+  for (const auto &download : added) {
+    MarkChanged(download->GetId(),
+                Download::ConsumerBit(ChangeConsumer::Events));
   }
 
-  // Wait for download thread to finish (outside the lock to avoid deadlock)
-  // This ensures file handles are released before we try to delete
-  if (downloadToRemove->IsYtDlpDownload()) {
-    YtDlpManager::GetInstance().WaitForDownloadFinish(downloadId, 5000);
-  } else {
-    m_engine->WaitForDownloadFinish(downloadId, 5000);
+  // Save to database immediately
+  if (!DatabaseManager::GetInstance().SaveDownloads(added)) {
+    std::cerr << "Database error: Failed to save " << added.size()
+              << " new download(s)" << std::endl;
   }
 
-  // Delete file if requested
-  if (deleteFile) {
-    std::string filePath = downloadToRemove->GetSavePath() + "\\" + downloadToRemove->GetFilename();
-    DeleteFileA(filePath.c_str());
+  return ids;
+}
+
+int DownloadManager::ImportUrlList(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "[DownloadManager] Cannot open URL list " << path
+              << std::endl;
+    return -1;
+  }
 
-    // Also delete any .partN files that may exist
-    auto chunks = downloadToRemove->GetChunksCopy();
-    for (size_t i = 0; i < chunks.size(); ++i) {
-      std::string partPath = filePath + ".part" + std::to_string(i);
-      DeleteFileA(partPath.c_str());
+  int added = 0;
+  auto flush = [&](std::vector<std::string> &batch) {
+    for (int id : AddDownloads(batch)) {
+      if (id >= 0) {
+        added++;
+      }
+    }
+    batch.clear();
+  };
+
+  std::vector<std::string> batch;
+  batch.reserve(IMPORT_BATCH_SIZE);
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t start = line.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos || line[start] == '#') {
+      continue;
+    }
+    size_t end = line.find_last_not_of(" \t\r\n");
+    batch.push_back(line.substr(start, end - start + 1));
+    if (batch.size() >= IMPORT_BATCH_SIZE) {
+      flush(batch);
     }
   }
+  if (!batch.empty()) {
+    flush(batch);
+  }
+  return added;
+}
 
-  // Remove from database
-  DatabaseManager::GetInstance().DeleteDownload(downloadId);
+void DownloadManager::RemoveDownload(int downloadId, bool deleteFile) {
+  RemoveDownloads({downloadId}, deleteFile);
 }
 
-void DownloadManager::StartDownload(int downloadId) {
-  std::shared_ptr<Download> download;
+size_t DownloadManager::RemoveDownloads(const std::vector<int> &downloadIds,
+                                        bool deleteFile) {
+  std::vector<std::shared_ptr<Download>> toRemove;
+  std::vector<int> historyRemoved;  // Only ever stored as records
 
   {
     std::lock_guard<std::mutex> lock(m_downloadsMutex);
-    auto it = m_downloadIndex.find(downloadId);
-    if (it != m_downloadIndex.end()) {
-      download = it->second;
+
+    std::unordered_set<Download *> removing;
+    for (int downloadId : downloadIds) {
+      auto it = m_downloadIndex.find(downloadId);
+      if (it == m_downloadIndex.end()) {
+        if (std::binary_search(m_unloadedHistory.begin(),
+                               m_unloadedHistory.end(), downloadId)) {
+          historyRemoved.push_back(downloadId);
+        }
+        continue;
+      }
+      std::shared_ptr<Download> download = it->second;
+
+      // Cancel if still downloading; a paused yt-dlp download may still
+      // hold engine streams
+      if (download->IsYtDlpDownload()) {
+        YtDlpManager::GetInstance().CancelDownload(downloadId);
+      } else if (download->GetStatus() == DownloadStatus::Downloading) {
+        m_engine->CancelDownload(download);
+      }
+
+      // Remove from indexes first
+      m_downloadIndex.erase(it);
+      UnindexDownload(downloadId);
+      removing.insert(download.get());
+      toRemove.push_back(std::move(download));
+    }
+    // One pass over the history ids however many go
+    std::sort(historyRemoved.begin(), historyRemoved.end());
+    m_unloadedHistory.erase(
+        std::remove_if(m_unloadedHistory.begin(), m_unloadedHistory.end(),
+                       [&historyRemoved](int id) {
+                         return std::binary_search(historyRemoved.begin(),
+                                                   historyRemoved.end(), id);
+                       }),
+        m_unloadedHistory.end());
+
+    // One copy of the list however many were removed
+    if (!toRemove.empty()) {
+      SnapshotPtr current = GetSnapshot();
+      std::vector<std::shared_ptr<Download>> downloads;
+      downloads.reserve(current->downloads.size());
+      for (const auto &download : current->downloads) {
+        if (removing.count(download.get()) == 0) {
+          downloads.push_back(download);
+        }
+      }
+      PublishSnapshot(std::move(downloads));
     }
   }
 
+  const uint32_t forget = Download::ConsumerBit(ChangeConsumer::Events) |
+                          Download::ConsumerBit(ChangeConsumer::Status) |
+                          Download::ConsumerBit(ChangeConsumer::Table);
+
+  DatabaseManager &db = DatabaseManager::GetInstance();
+  for (const auto &download : toRemove) {
+    int downloadId = download->GetId();
+    // So event subscribers, the status poll and the table can forget it
+    MarkChanged(downloadId, forget);
+
+    // Wait for download thread to finish (outside the lock to avoid deadlock)
+    // This ensures file handles are released before we try to delete
+    if (download->IsYtDlpDownload()) {
+      YtDlpManager::GetInstance().WaitForDownloadFinish(downloadId, 5000);
+    } else {
+      m_engine->WaitForDownloadFinish(downloadId, 5000);
+    }
+
+    // Delete file if requested
+    if (deleteFile) {
+      std::string filePath = download->GetSavePath() + "\\" + download->GetFilename();
+      DeleteFileA(filePath.c_str());
+
+      // Also delete any .partN files that may exist
+      auto chunks = download->GetChunksCopy();
+      for (size_t i = 0; i < chunks.size(); ++i) {
+        std::string partPath = filePath + ".part" + std::to_string(i);
+        DeleteFileA(partPath.c_str());
+      }
+    }
+
+    // Remove from database
+    db.DeleteDownload(downloadId);
+  }
+
+  // Finished, so nothing to cancel or wait for
+  for (int downloadId : historyRemoved) {
+    MarkChanged(downloadId, forget);
+    DownloadRecord record;
+    if (deleteFile && db.LoadRecord(downloadId, record)) {
+      std::string filePath = record.savePath + "\\" + record.filename;
+      DeleteFileA(filePath.c_str());
+    }
+    db.DeleteDownload(downloadId);
+  }
+  return toRemove.size() + historyRemoved.size();
+}
+
+void DownloadManager::StartDownload(int downloadId) {
+  // A history entry started again is built into a Download here
+  std::shared_ptr<Download> download = GetOrRestoreDownload(downloadId);
+
   if (download) {
     // Check if this is a video site URL that should use yt-dlp
     YtDlpManager &ytdlp = YtDlpManager::GetInstance();
@@ -445,15 +878,8 @@ void DownloadManager::StartDownload(int downloadId) {
 }
 
 void DownloadManager::StartDownloadWithFormat(int downloadId, const std::string &formatId) {
-  std::shared_ptr<Download> download;
-
-  {
-    std::lock_guard<std::mutex> lock(m_downloadsMutex);
-    auto it = m_downloadIndex.find(downloadId);
-    if (it != m_downloadIndex.end()) {
-      download = it->second;
-    }
-  }
+  // A history entry started again is built into a Download here
+  std::shared_ptr<Download> download = GetOrRestoreDownload(downloadId);
 
   if (download) {
     // Check if this is a video site URL that should use yt-dlp
@@ -503,15 +929,7 @@ void DownloadManager::PauseDownload(int downloadId) {
 }
 
 void DownloadManager::ResumeDownload(int downloadId) {
-  std::shared_ptr<Download> download;
-
-  {
-    std::lock_guard<std::mutex> lock(m_downloadsMutex);
-    auto it = m_downloadIndex.find(downloadId);
-    if (it != m_downloadIndex.end()) {
-      download = it->second;
-    }
-  }
+  std::shared_ptr<Download> download = GetOrRestoreDownload(downloadId);
 
   if (download) {
     if (download->IsYtDlpDownload()) {
@@ -545,38 +963,80 @@ void DownloadManager::CancelDownload(int downloadId) {
 }
 
 void DownloadManager::StartAllDownloads() {
-  std::vector<std::shared_ptr<Download>> toStart;
-
-  {
-    std::lock_guard<std::mutex> lock(m_downloadsMutex);
-    for (const auto &download : m_downloads) {
-      if (download->GetStatus() == DownloadStatus::Queued ||
-          download->GetStatus() == DownloadStatus::Paused) {
-        toStart.push_back(download);
-      }
-    }
-  }
+  std::vector<std::shared_ptr<Download>> toStart =
+      CollectByStatus({DownloadStatus::Queued, DownloadStatus::Paused});
 
+  // Small files skip the probe and share keep-alive connections per host
+  std::vector<std::shared_ptr<Download>> smallFiles;
   for (const auto &download : toStart) {
     if (download->IsYtDlpDownload()) {
       YtDlpManager::GetInstance().StartDownload(download);
+    } else if (DownloadEngine::IsSmallFileCandidate(*download)) {
+      smallFiles.push_back(download);
     } else {
       m_engine->StartDownload(download);
     }
   }
+
+  if (smallFiles.size() > 1) {
+    m_engine->StartSmallFileBatch(smallFiles);
+  } else if (!smallFiles.empty()) {
+    m_engine->StartDownload(smallFiles.front());
+  }
 }
 
-void DownloadManager::PauseAllDownloads() {
-  std::vector<std::shared_ptr<Download>> toPause;
-  {
-    std::lock_guard<std::mutex> lock(m_downloadsMutex);
-    for (const auto &download : m_downloads) {
-      if (download->GetStatus() == DownloadStatus::Downloading) {
-        toPause.push_back(download);
-      }
+int DownloadManager::CheckLinks() {
+  std::vector<std::shared_ptr<Download>> toCheck;
+  for (const auto &download :
+       CollectByStatus({DownloadStatus::Queued, DownloadStatus::Paused,
+                        DownloadStatus::Error})) {
+    if (!download->IsYtDlpDownload()) {
+      toCheck.push_back(download);
     }
   }
 
+  if (toCheck.empty() ||
+      !m_engine->ProbeDownloads(
+          toCheck, [this](const DownloadEngine::ProbeResult &result) {
+            auto download = GetDownload(result.downloadId);
+            if (!download) {
+              return;
+            }
+
+            // Only definite client errors mean the link is dead; timeouts,
+            // rate limiting and server errors may well be transient
+            DownloadStatus status = download->GetStatus();
+            bool idle = status == DownloadStatus::Queued ||
+                        status == DownloadStatus::Paused ||
+                        status == DownloadStatus::Error;
+            if (idle && result.statusCode >= 400 && result.statusCode < 500 &&
+                result.statusCode != 408 && result.statusCode != 429) {
+              download->SetStatus(DownloadStatus::Error);
+              download->SetErrorMessage(result.error);
+            } else if (status == DownloadStatus::Error &&
+                       result.statusCode >= 200 && result.statusCode < 300) {
+              download->SetErrorMessage("");
+            }
+            SaveDownloadToDatabase(result.downloadId);
+
+            DownloadUpdateCallback callback;
+            {
+              std::lock_guard<std::mutex> lock(m_callbackMutex);
+              callback = m_updateCallback;
+            }
+            if (callback) {
+              callback(result.downloadId);
+            }
+          })) {
+    return 0;
+  }
+  return static_cast<int>(toCheck.size());
+}
+
+void DownloadManager::PauseAllDownloads() {
+  std::vector<std::shared_ptr<Download>> toPause =
+      CollectByStatus({DownloadStatus::Downloading});
+
   for (const auto &download : toPause) {
     if (download->IsYtDlpDownload()) {
       YtDlpManager::GetInstance().PauseDownload(download->GetId());
@@ -588,16 +1048,8 @@ void DownloadManager::PauseAllDownloads() {
 }
 
 void DownloadManager::CancelAllDownloads() {
-  std::vector<std::shared_ptr<Download>> toCancel;
-  {
-    std::lock_guard<std::mutex> lock(m_downloadsMutex);
-    for (const auto &download : m_downloads) {
-      if (download->GetStatus() == DownloadStatus::Downloading ||
-          download->GetStatus() == DownloadStatus::Paused) {
-        toCancel.push_back(download);
-      }
-    }
-  }
+  std::vector<std::shared_ptr<Download>> toCancel =
+      CollectByStatus({DownloadStatus::Downloading, DownloadStatus::Paused});
 
   for (const auto &download : toCancel) {
     if (download->IsYtDlpDownload()) {
@@ -618,69 +1070,175 @@ std::shared_ptr<Download> DownloadManager::GetDownload(int downloadId) const {
 
 std::vector<std::shared_ptr<Download>>
 DownloadManager::GetAllDownloads() const {
-  std::lock_guard<std::mutex> lock(m_downloadsMutex);
-  return m_downloads;
+  return GetSnapshot()->downloads;
 }
 
 std::vector<std::shared_ptr<Download>>
 DownloadManager::GetDownloadsByCategory(const std::string &category) const {
-  std::lock_guard<std::mutex> lock(m_downloadsMutex);
+  if (category == "All Downloads") {
+    return GetAllDownloads();
+  }
 
+  std::lock_guard<std::mutex> lock(m_indexMutex);
   std::vector<std::shared_ptr<Download>> result;
-  result.reserve(m_downloads.size());  // Avoid reallocations
-  for (const auto &download : m_downloads) {
-    if (category == "All Downloads" || download->GetCategory() == category) {
-      result.push_back(download);
+  auto it = m_categoryIndex.find(category);
+  if (it != m_categoryIndex.end()) {
+    result.reserve(it->second.size());
+    for (const auto &entry : it->second) {
+      result.push_back(entry.second);
     }
   }
-
   return result;
 }
 
 std::vector<std::shared_ptr<Download>>
 DownloadManager::GetDownloadsByStatus(DownloadStatus status) const {
-  std::lock_guard<std::mutex> lock(m_downloadsMutex);
+  return CollectByStatus({status});
+}
 
-  std::vector<std::shared_ptr<Download>> result;
-  result.reserve(m_downloads.size());  // Avoid reallocations
-  for (const auto &download : m_downloads) {
-    if (download->GetStatus() == status) {
-      result.push_back(download);
-    }
+int DownloadManager::GetTotalDownloads() const {
+  return static_cast<int>(GetSnapshot()->downloads.size() +
+                          GetHistoryCount());
+}
+
+int DownloadManager::GetActiveDownloads() const {
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  return static_cast<int>(
+      m_statusIndex[static_cast<size_t>(DownloadStatus::Downloading)].size());
+}
+
+double DownloadManager::GetTotalSpeed() const {
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+
+  double totalSpeed = 0.0;
+  for (const auto &entry :
+       m_statusIndex[static_cast<size_t>(DownloadStatus::Downloading)]) {
+    totalSpeed += entry.second->GetSpeed();
   }
 
-  return result;
+  return totalSpeed;
 }
 
-int DownloadManager::GetTotalDownloads() const {
-  std::lock_guard<std::mutex> lock(m_downloadsMutex);
-  return static_cast<int>(m_downloads.size());
+void DownloadManager::IndexDownload(const std::shared_ptr<Download> &download) {
+  download->SetIndexListener(
+      [this](const Download &changed) { ReindexDownload(changed); });
+  download->SetChangeListener(
+      [this](const Download &changed, uint32_t newlyDirty) {
+        MarkChanged(changed.GetId(), newlyDirty);
+      });
+  // Freshly loaded or just saved: nothing is pending for any consumer
+  download->ResetDirty();
+
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  DownloadStatus status = download->GetStatus();
+  std::string category = download->GetCategory();
+  m_statusIndex[static_cast<size_t>(status)][download->GetId()] = download;
+  m_categoryIndex[category][download->GetId()] = download;
+  m_indexedKeys[download->GetId()] = {status, std::move(category)};
 }
 
-int DownloadManager::GetActiveDownloads() const {
-  std::lock_guard<std::mutex> lock(m_downloadsMutex);
+void DownloadManager::UnindexDownload(int downloadId) {
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  auto it = m_indexedKeys.find(downloadId);
+  if (it == m_indexedKeys.end()) {
+    return;
+  }
+  m_statusIndex[static_cast<size_t>(it->second.first)].erase(downloadId);
+  auto categoryIt = m_categoryIndex.find(it->second.second);
+  if (categoryIt != m_categoryIndex.end()) {
+    categoryIt->second.erase(downloadId);
+    if (categoryIt->second.empty()) {
+      m_categoryIndex.erase(categoryIt);
+    }
+  }
+  m_indexedKeys.erase(it);
+}
 
-  int count = 0;
-  for (const auto &download : m_downloads) {
-    if (download->GetStatus() == DownloadStatus::Downloading) {
-      count++;
+void DownloadManager::ReindexDownload(const Download &download) {
+  // Re-read the current values instead of trusting the notification order:
+  // whichever listener call runs last files the download correctly
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  auto it = m_indexedKeys.find(download.GetId());
+  if (it == m_indexedKeys.end()) {
+    return;  // Removed, or not owned by this manager
+  }
+
+  DownloadStatus status = download.GetStatus();
+  if (status != it->second.first) {
+    auto &from = m_statusIndex[static_cast<size_t>(it->second.first)];
+    auto node = from.extract(download.GetId());
+    if (!node.empty()) {
+      m_statusIndex[static_cast<size_t>(status)].insert(std::move(node));
     }
+    it->second.first = status;
   }
 
-  return count;
+  std::string category = download.GetCategory();
+  if (category != it->second.second) {
+    auto fromIt = m_categoryIndex.find(it->second.second);
+    if (fromIt != m_categoryIndex.end()) {
+      auto node = fromIt->second.extract(download.GetId());
+      if (fromIt->second.empty()) {
+        m_categoryIndex.erase(fromIt);
+      }
+      if (!node.empty()) {
+        m_categoryIndex[category].insert(std::move(node));
+      }
+    }
+    it->second.second = std::move(category);
+  }
 }
 
-double DownloadManager::GetTotalSpeed() const {
-  std::lock_guard<std::mutex> lock(m_downloadsMutex);
+void DownloadManager::MarkChanged(int downloadId, uint32_t newlyDirty) {
+  std::lock_guard<std::mutex> lock(m_dirtyMutex);
+  for (size_t i = 0; i < m_dirtySets.size(); ++i) {
+    if (newlyDirty & Download::ConsumerBit(static_cast<ChangeConsumer>(i))) {
+      m_dirtySets[i].insert(downloadId);
+    }
+  }
+}
 
-  double totalSpeed = 0.0;
-  for (const auto &download : m_downloads) {
-    if (download->GetStatus() == DownloadStatus::Downloading) {
-      totalSpeed += download->GetSpeed();
+std::vector<std::shared_ptr<Download>>
+DownloadManager::DrainChanged(ChangeConsumer consumer,
+                              std::vector<int> *removed) {
+  std::unordered_set<int> ids;
+  {
+    std::lock_guard<std::mutex> lock(m_dirtyMutex);
+    ids.swap(m_dirtySets[static_cast<size_t>(consumer)]);
+  }
+
+  std::vector<std::shared_ptr<Download>> changed;
+  changed.reserve(ids.size());
+  for (int id : ids) {
+    auto download = GetDownload(id);
+    if (download) {
+      // Clear before the caller reads, so later changes are not lost
+      download->ClearDirty(consumer);
+      changed.push_back(std::move(download));
+    } else if (removed) {
+      removed->push_back(id);
     }
   }
+  return changed;
+}
 
-  return totalSpeed;
+std::vector<std::shared_ptr<Download>> DownloadManager::CollectByStatus(
+    std::initializer_list<DownloadStatus> statuses) const {
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+
+  size_t total = 0;
+  for (DownloadStatus status : statuses) {
+    total += m_statusIndex[static_cast<size_t>(status)].size();
+  }
+
+  std::vector<std::shared_ptr<Download>> result;
+  result.reserve(total);
+  for (DownloadStatus status : statuses) {
+    for (const auto &entry : m_statusIndex[static_cast<size_t>(status)]) {
+      result.push_back(entry.second);
+    }
+  }
+  return result;
 }
 
 void DownloadManager::OnDownloadProgress(int downloadId, int64_t downloaded,
@@ -722,6 +1280,23 @@ void DownloadManager::OnDownloadComplete(int downloadId, bool success,
 // Queue management
 void DownloadManager::StartQueue() {
   m_isQueueRunning.store(true);
+
+  // Size-aware policies order by remaining bytes; look up unknown sizes in
+  // the background so the slots that free up later are filled in order
+  QueuePolicy policy = m_queuePolicy.load();
+  if (policy == QueuePolicy::ShortestRemainingFirst ||
+      policy == QueuePolicy::FairShare) {
+    std::vector<std::shared_ptr<Download>> unknownSize;
+    for (const auto &download : CollectByStatus({DownloadStatus::Queued})) {
+      if (!download->IsYtDlpDownload() && download->GetTotalSize() <= 0) {
+        unknownSize.push_back(download);
+      }
+    }
+    if (!unknownSize.empty()) {
+      m_engine->ProbeDownloads(unknownSize, nullptr);
+    }
+  }
+
   ProcessQueue();
 }
 
@@ -738,38 +1313,138 @@ void DownloadManager::ProcessQueue() {
   // Lock once to avoid TOCTOU race between GetActiveDownloads and starting downloads
   std::lock_guard<std::mutex> lock(m_downloadsMutex);
 
-  // Count active downloads while holding the lock
+  // Count active downloads (overall and per server) while holding the lock.
+  // Only the active and queued buckets are visited, never the history.
   int activeCount = 0;
-  for (const auto &download : m_downloads) {
-    if (download->GetStatus() == DownloadStatus::Downloading) {
-      activeCount++;
+  std::unordered_map<std::string, int> activePerHost;
+  std::vector<std::shared_ptr<Download>> queued;
+  {
+    std::lock_guard<std::mutex> indexLock(m_indexMutex);
+    const auto &active =
+        m_statusIndex[static_cast<size_t>(DownloadStatus::Downloading)];
+    activeCount = static_cast<int>(active.size());
+    for (const auto &entry : active) {
+      activePerHost[ExtractHost(entry.second->GetUrl())]++;
+    }
+
+    const auto &waiting =
+        m_statusIndex[static_cast<size_t>(DownloadStatus::Queued)];
+    if (activeCount < m_maxSimultaneousDownloads) {
+      queued.reserve(waiting.size());
+      for (const auto &entry : waiting) {
+        queued.push_back(entry.second);
+      }
     }
   }
 
-  if (activeCount >= m_maxSimultaneousDownloads)
+  if (activeCount >= m_maxSimultaneousDownloads || queued.empty())
     return;
 
-  // Find queued downloads to start
-  for (auto &download : m_downloads) {
-    if (activeCount >= m_maxSimultaneousDownloads)
+  auto toStart = SelectQueuedDownloads(std::move(queued),
+                                       std::move(activePerHost),
+                                       m_maxSimultaneousDownloads - activeCount);
+  for (auto &download : toStart) {
+    // Use appropriate download method based on download type
+    if (download->IsYtDlpDownload()) {
+      YtDlpManager &ytdlp = YtDlpManager::GetInstance();
+      if (ytdlp.IsYtDlpAvailable()) {
+        ytdlp.StartDownload(download);
+      } else {
+        download->SetStatus(DownloadStatus::Error);
+        download->SetErrorMessage("yt-dlp not installed. Click to install.");
+      }
+    } else {
+      m_engine->StartDownload(download);
+    }
+  }
+}
+
+std::vector<std::shared_ptr<Download>> DownloadManager::SelectQueuedDownloads(
+    std::vector<std::shared_ptr<Download>> queued,
+    std::unordered_map<std::string, int> activePerHost, int slots) const {
+  // Unknown sizes sort last: a probe fills them in before long
+  auto remaining = [](const std::shared_ptr<Download> &download) {
+    int64_t total = download->GetTotalSize();
+    if (total <= 0) {
+      return std::numeric_limits<int64_t>::max();
+    }
+    return std::max<int64_t>(0, total - download->GetDownloadedSize());
+  };
+  auto byRemaining = [&](const std::shared_ptr<Download> &a,
+                         const std::shared_ptr<Download> &b) {
+    return remaining(a) < remaining(b);
+  };
+
+  size_t count = std::min(queued.size(), static_cast<size_t>(slots));
+  switch (m_queuePolicy.load()) {
+    case QueuePolicy::Fifo:
       break;
 
-    if (download->GetStatus() == DownloadStatus::Queued) {
-      // Use appropriate download method based on download type
-      if (download->IsYtDlpDownload()) {
-        YtDlpManager &ytdlp = YtDlpManager::GetInstance();
-        if (ytdlp.IsYtDlpAvailable()) {
-          ytdlp.StartDownload(download);
-        } else {
-          download->SetStatus(DownloadStatus::Error);
-          download->SetErrorMessage("yt-dlp not installed. Click to install.");
+    case QueuePolicy::ShortestRemainingFirst:
+      std::stable_sort(queued.begin(), queued.end(), byRemaining);
+      break;
+
+    case QueuePolicy::Priority:
+      std::stable_sort(queued.begin(), queued.end(),
+                       [](const std::shared_ptr<Download> &a,
+                          const std::shared_ptr<Download> &b) {
+                         return a->GetPriority() > b->GetPriority();
+                       });
+      break;
+
+    case QueuePolicy::FairShare: {
+      // Each slot goes to the server with the lowest load relative to the
+      // weight of its best candidate, so one server's huge batch cannot
+      // take every slot. Within a server, smallest remaining goes first.
+      std::stable_sort(queued.begin(), queued.end(), byRemaining);
+      auto weight = [](DownloadPriority priority) {
+        return priority == DownloadPriority::High  ? 4
+               : priority == DownloadPriority::Low ? 1
+                                                   : 2;
+      };
+
+      std::vector<std::string> hosts;
+      hosts.reserve(queued.size());
+      for (const auto &download : queued) {
+        hosts.push_back(ExtractHost(download->GetUrl()));
+      }
+
+      std::vector<std::shared_ptr<Download>> picked;
+      std::vector<bool> taken(queued.size(), false);
+      while (picked.size() < count) {
+        size_t best = queued.size();
+        double bestLoad = 0.0;
+        for (size_t i = 0; i < queued.size(); ++i) {
+          if (taken[i]) {
+            continue;
+          }
+          double load = (activePerHost[hosts[i]] + 1.0) /
+                        weight(queued[i]->GetPriority());
+          if (best == queued.size() || load < bestLoad) {
+            best = i;
+            bestLoad = load;
+          }
         }
-      } else {
-        m_engine->StartDownload(download);
+        taken[best] = true;
+        activePerHost[hosts[best]]++;
+        picked.push_back(queued[best]);
       }
-      activeCount++;
+      return picked;
     }
   }
+
+  queued.resize(count);
+  return queued;
+}
+
+void DownloadManager::SetDownloadPriority(int downloadId,
+                                          DownloadPriority priority) {
+  auto download = GetDownload(downloadId);
+  if (!download) {
+    return;
+  }
+  download->SetPriority(priority);
+  SaveDownloadToDatabase(downloadId);
 }
 
 // Scheduling
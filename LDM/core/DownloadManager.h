@@ -2,16 +2,30 @@
 
 #include "Download.h"
 #include "DownloadEngine.h"
+#include "../database/DownloadRecord.h"
+#include <array>
+#include <initializer_list>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <wx/datetime.h>
 #include <wx/timer.h>
 
 
+// Order in which ProcessQueue starts queued downloads
+enum class QueuePolicy {
+  Fifo,                    // Order added
+  ShortestRemainingFirst,  // Fewest remaining bytes first, unknown sizes last
+  FairShare,               // Spread slots across servers, weighted by priority
+  Priority                 // Explicit priority, then order added
+};
+
 class DownloadManager : public wxEvtHandler {
 public:
   static DownloadManager &GetInstance();
@@ -22,7 +36,18 @@ public:
 
   // Download management
   int AddDownload(const std::string &url, const std::string &savePath = "");
+  // Validate and categorise a batch in parallel, then insert it under one
+  // lock and persist it in one batch. Returns one id per URL (-1 = invalid).
+  std::vector<int> AddDownloads(const std::vector<std::string> &urls,
+                                const std::string &savePath = "");
+  // Stream a URL list file (one URL per line, '#' starts a comment) into
+  // AddDownloads a batch at a time. Returns the number added, -1 if the
+  // file could not be opened.
+  int ImportUrlList(const std::string &path);
   void RemoveDownload(int downloadId, bool deleteFile = false);
+  // Remove several downloads with one list update. Returns how many existed.
+  size_t RemoveDownloads(const std::vector<int> &downloadIds,
+                         bool deleteFile = false);
   void StartDownload(int downloadId);
   void StartDownloadWithFormat(int downloadId, const std::string &formatId);
   void PauseDownload(int downloadId);
@@ -34,11 +59,18 @@ public:
   void PauseAllDownloads();
   void CancelAllDownloads();
 
+  // Probe every unfinished download's link in the background, refreshing
+  // sizes and flagging dead links. Returns the number of links checked.
+  int CheckLinks();
+
   // Queue management
   void StartQueue();
   void StopQueue();
   bool IsQueueRunning() const { return m_isQueueRunning.load(); }
   void ProcessQueue();
+  void SetQueuePolicy(QueuePolicy policy) { m_queuePolicy.store(policy); }
+  QueuePolicy GetQueuePolicy() const { return m_queuePolicy.load(); }
+  void SetDownloadPriority(int downloadId, DownloadPriority priority);
 
   // Scheduling
   void SetSchedule(bool enableStart, const wxDateTime &startTime,
@@ -46,6 +78,16 @@ public:
                    int maxConcurrent, bool hangUp, bool exitApp, bool shutdown);
   void CheckSchedule();
 
+  // Immutable, versioned view of the download list. Readers pick one up
+  // with a single atomic load and never contend with writers; adding or
+  // removing downloads publishes a new one.
+  struct DownloadSnapshot {
+    uint64_t version = 0;
+    std::vector<std::shared_ptr<Download>> downloads;
+  };
+  using SnapshotPtr = std::shared_ptr<const DownloadSnapshot>;
+  SnapshotPtr GetSnapshot() const { return std::atomic_load(&m_snapshot); }
+
   // Query downloads
   std::shared_ptr<Download> GetDownload(int downloadId) const;
   std::vector<std::shared_ptr<Download>> GetAllDownloads() const;
@@ -54,6 +96,41 @@ public:
   std::vector<std::shared_ptr<Download>>
   GetDownloadsByStatus(DownloadStatus status) const;
 
+  // Completed history stays in the database as records. The list and
+  // queries read it as plain rows; a Download is only built for an entry
+  // that is started again.
+  size_t GetHistoryCount() const;
+  // Ascending ids, all of the history or the part in one category
+  std::vector<int> GetHistoryIds(const std::string &category = "") const;
+  bool GetHistoryRecord(int downloadId, DownloadRecord &record) const;
+
+  // Filtered, newest-first listing over loaded downloads and unloaded
+  // history alike. Walks the status or category index from the cursor, so
+  // a page costs about its own size rather than the size of the list.
+  struct DownloadQuery {
+    std::vector<DownloadStatus> statuses;  // Any status when empty
+    std::string category;                  // Any category when empty
+    std::string host;                      // Server, case-insensitive
+    std::string text;                      // In filename or URL, case-insensitive
+    int beforeId = std::numeric_limits<int>::max();  // Cursor
+    size_t limit = 100;
+  };
+  // Plain views, so a page keeps no Download alive: a loaded download as
+  // it stood, history as stored
+  struct DownloadRow {
+    DownloadRecord record;
+    uint64_t generation = 0;  // Change counter; history does not change
+    double progress = 100.0;
+    double speed = 0.0;
+  };
+  struct DownloadPage {
+    std::vector<DownloadRow> downloads;  // Newest first
+    // beforeId for the next page; -1 when done. A sparse filter can end a
+    // page short of the limit and still have more below the cursor.
+    int nextCursor = -1;
+  };
+  DownloadPage QueryDownloads(const DownloadQuery &query);
+
   // Statistics
   int GetTotalDownloads() const;
   int GetActiveDownloads() const;
@@ -83,8 +160,15 @@ public:
     m_updateCallback = callback;
   }
 
+  // Downloads changed since this consumer last drained, so periodic work
+  // is proportional to what changed rather than to the whole list. Ids
+  // that were removed since go to removed, when given.
+  std::vector<std::shared_ptr<Download>> DrainChanged(
+      ChangeConsumer consumer, std::vector<int> *removed = nullptr);
+
   // Database persistence (public for periodic saves)
   void SaveAllDownloadsToDatabase();
+  void SaveChangedDownloadsToDatabase();
 
   // Update category for matching downloads (used by UI category rename/delete)
   void UpdateDownloadsCategory(const std::string &fromCategory,
@@ -94,13 +178,31 @@ private:
   DownloadManager();
   ~DownloadManager();
 
-  std::vector<std::shared_ptr<Download>> m_downloads;
+  // Current list; replaced (never modified) under m_downloadsMutex
+  SnapshotPtr m_snapshot = std::make_shared<const DownloadSnapshot>();
   std::unordered_map<int, std::shared_ptr<Download>> m_downloadIndex;  // O(1) lookup by ID
   mutable std::mutex m_downloadsMutex;
+  std::vector<int> m_unloadedHistory;  // Ascending ids; under m_downloadsMutex
+  // A loaded download, or one built from its history record and loaded now
+  std::shared_ptr<Download> GetOrRestoreDownload(int downloadId);
   mutable std::mutex m_callbackMutex;
 
+  // Secondary indexes kept current by each download's index listener, so
+  // status and category queries cost O(matches) rather than O(history).
+  // Buckets are ordered by id (= order added). Lock order: m_downloadsMutex
+  // before m_indexMutex; never call into a Download setter holding the latter.
+  using DownloadBucket = std::map<int, std::shared_ptr<Download>>;
+  static constexpr size_t STATUS_COUNT =
+      static_cast<size_t>(DownloadStatus::Cancelled) + 1;
+  mutable std::mutex m_indexMutex;
+  std::array<DownloadBucket, STATUS_COUNT> m_statusIndex;
+  std::unordered_map<std::string, DownloadBucket> m_categoryIndex;
+  std::unordered_map<int, std::pair<DownloadStatus, std::string>>
+      m_indexedKeys;  // Bucket each download is filed under
+
   // Queue & Schedule state
   std::atomic<bool> m_isQueueRunning;
+  std::atomic<QueuePolicy> m_queuePolicy{QueuePolicy::Fifo};
   wxTimer *m_schedulerTimer;
 
   // Schedule settings
@@ -125,13 +227,50 @@ private:
 
   DownloadUpdateCallback m_updateCallback;
 
+  // Swap in a new list; caller holds m_downloadsMutex
+  void PublishSnapshot(std::vector<std::shared_ptr<Download>> downloads);
+
   // Database persistence helpers
   void LoadDownloadsFromDatabase();
   void SaveDownloadToDatabase(int downloadId);
 
+  // Per-consumer sets of changed download ids, fed by change listeners
+  std::mutex m_dirtyMutex;
+  std::array<std::unordered_set<int>,
+             static_cast<size_t>(ChangeConsumer::Count)>
+      m_dirtySets;
+  void MarkChanged(int downloadId, uint32_t newlyDirty);
+
+  // Index maintenance
+  void IndexDownload(const std::shared_ptr<Download> &download);
+  void UnindexDownload(int downloadId);
+  void ReindexDownload(const Download &download);
+  std::vector<std::shared_ptr<Download>>
+  CollectByStatus(std::initializer_list<DownloadStatus> statuses) const;
+
+  // Pick up to 'slots' queued downloads to start next under the queue policy
+  std::vector<std::shared_ptr<Download>>
+  SelectQueuedDownloads(std::vector<std::shared_ptr<Download>> queued,
+                        std::unordered_map<std::string, int> activePerHost,
+                        int slots) const;
+
   // Folder management
   void EnsureCategoryFoldersExist();
 
+  // Build a new download with its category and save folder resolved.
+  // Touches no manager state, so batches can run it on several threads.
+  std::shared_ptr<Download> CreateDownload(int downloadId,
+                                           const std::string &url,
+                                           const std::string &savePath,
+                                           const std::string &defaultSavePath);
+
+  // Extension -> category table compiled from the file type settings,
+  // rebuilt only when the settings version changes
+  std::mutex m_categoryRulesMutex;
+  std::unordered_map<std::string, std::string> m_categoryRules;
+  uint64_t m_categoryRulesVersion = 0;
+  std::string DetermineCategoryFromSettings(const std::string &filename);
+
   void OnDownloadProgress(int downloadId, int64_t downloaded, int64_t total,
                           double speed);
   void OnDownloadComplete(int downloadId, bool success,
@@ -0,0 +1,22 @@
+#include "SmallFileQueue.h"
+
+void SmallFileQueue::Submit(
+    const std::vector<std::shared_ptr<Download>> &downloads) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto &download : downloads) {
+    download->ResetRetry();
+    download->SetErrorMessage("");
+    download->SetStatus(DownloadStatus::Queued);
+    m_waiting.insert(download->GetId());
+  }
+}
+
+bool SmallFileQueue::Withdraw(int downloadId) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_waiting.erase(downloadId) > 0;
+}
+
+bool SmallFileQueue::Take(int downloadId) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_waiting.erase(downloadId) > 0;
+}
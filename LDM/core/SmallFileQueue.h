@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Download.h"
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+// Downloads handed to the small-file workers and not yet started. A worker
+// may reach a download long after it was submitted, so whether to run it
+// is decided here rather than by its status: submitting marks a download
+// Queued (a paused one included), and only a pause or cancel that comes
+// after the submission withdraws it.
+class SmallFileQueue {
+public:
+  // Hold each download for a worker and mark it Queued
+  void Submit(const std::vector<std::shared_ptr<Download>> &downloads);
+  // Pass a held download by; true if it was still waiting, in which case
+  // the caller releases its claim since no worker will
+  bool Withdraw(int downloadId);
+  // A worker's turn to start the download; false if it was withdrawn
+  bool Take(int downloadId);
+
+private:
+  std::unordered_set<int> m_waiting;
+  std::mutex m_mutex;
+};
@@ -0,0 +1,113 @@
+#include "StreamJobTable.h"
+
+void StreamJobTable::Add(const std::shared_ptr<StreamJob> &job) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  int downloadId = job->download->GetId();
+  for (const MediaStream &stream : job->streams) {
+    m_owners[stream.download->GetId()] = downloadId;
+  }
+  m_jobs[downloadId] = job;
+}
+
+std::shared_ptr<StreamJob> StreamJobTable::Find(int downloadId) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_jobs.find(downloadId);
+  return (it == m_jobs.end()) ? nullptr : it->second;
+}
+
+std::shared_ptr<StreamJob> StreamJobTable::Detach(int downloadId) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_jobs.find(downloadId);
+  if (it == m_jobs.end()) {
+    return nullptr;
+  }
+  std::shared_ptr<StreamJob> job = it->second;
+  m_jobs.erase(it);
+  for (const MediaStream &stream : job->streams) {
+    m_owners.erase(stream.download->GetId());
+  }
+  return job;
+}
+
+std::vector<std::shared_ptr<StreamJob>> StreamJobTable::DetachAll() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<std::shared_ptr<StreamJob>> jobs;
+  jobs.reserve(m_jobs.size());
+  for (auto &entry : m_jobs) {
+    jobs.push_back(std::move(entry.second));
+  }
+  m_jobs.clear();
+  m_owners.clear();
+  return jobs;
+}
+
+void StreamJobTable::Park(const std::shared_ptr<StreamJob> &job) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_parked[job->download->GetId()] = job;
+}
+
+std::shared_ptr<StreamJob> StreamJobTable::TakeParked(int downloadId) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_parked.find(downloadId);
+  if (it == m_parked.end()) {
+    return nullptr;
+  }
+  std::shared_ptr<StreamJob> job = std::move(it->second);
+  m_parked.erase(it);
+  return job;
+}
+
+std::shared_ptr<Download> StreamJobTable::RecordProgress(int streamId,
+                                                         int64_t downloaded,
+                                                         int64_t total,
+                                                         double speed,
+                                                         StreamTotals &totals) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto owner = m_owners.find(streamId);
+  if (owner == m_owners.end()) {
+    return nullptr;
+  }
+  auto job = m_jobs.find(owner->second);
+  if (job == m_jobs.end()) {
+    return nullptr;
+  }
+
+  totals = StreamTotals();
+  for (MediaStream &stream : job->second->streams) {
+    if (stream.download->GetId() == streamId) {
+      stream.downloaded = downloaded;
+      stream.total = total;
+      stream.speed = speed;
+    }
+    totals.downloaded += stream.downloaded;
+    totals.speed += stream.completed ? 0.0 : stream.speed;
+    if (stream.total > 0) {
+      totals.total += stream.total;
+    } else {
+      totals.totalKnown = false;
+    }
+  }
+  return job->second->download;
+}
+
+int StreamJobTable::RecordCompletion(int streamId, bool success,
+                                     bool &allCompleted) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto owner = m_owners.find(streamId);
+  if (owner == m_owners.end()) {
+    return -1;
+  }
+  auto job = m_jobs.find(owner->second);
+  if (job == m_jobs.end()) {
+    return -1;
+  }
+
+  allCompleted = true;
+  for (MediaStream &stream : job->second->streams) {
+    if (stream.download->GetId() == streamId) {
+      stream.completed = success;
+    }
+    allCompleted = allCompleted && stream.completed;
+  }
+  return owner->second;
+}
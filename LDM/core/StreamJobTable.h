@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Download.h"
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One media stream of a yt-dlp download, fetched by the stream engine
+struct MediaStream {
+  std::shared_ptr<Download> download;  // Engine-side, never listed
+  int64_t downloaded = 0;
+  int64_t total = -1;
+  double speed = 0.0;
+  bool completed = false;
+};
+
+// The streams of one yt-dlp download and the file they become
+struct StreamJob {
+  std::shared_ptr<Download> download;
+  std::string selectedFormat;  // For the yt-dlp fallback
+  std::shared_ptr<std::promise<void>> done;
+  std::string outputPath;      // Final file, named by yt-dlp
+  std::vector<MediaStream> streams;
+};
+
+// A job's streams reported as one download
+struct StreamTotals {
+  int64_t downloaded = 0;
+  int64_t total = 0;  // Only meaningful when totalKnown
+  bool totalKnown = true;
+  double speed = 0.0;
+};
+
+// Stream jobs by download id, running or paused. Streams report by their
+// own ids, which map to a running job only; a paused job keeps its stream
+// Downloads, and with them the chunks a resume continues from.
+class StreamJobTable {
+public:
+  // Track a running job, replacing any with the same download id
+  void Add(const std::shared_ptr<StreamJob> &job);
+  std::shared_ptr<StreamJob> Find(int downloadId) const;
+  // Stop tracking a running job (null if not running); its streams'
+  // reports are ignored from then on, and the caller owns 'done'
+  std::shared_ptr<StreamJob> Detach(int downloadId);
+  // All running jobs, for shutdown
+  std::vector<std::shared_ptr<StreamJob>> DetachAll();
+
+  // Keep a detached job until it is resumed or cancelled
+  void Park(const std::shared_ptr<StreamJob> &job);
+  // The paused job for a download (null if none), no longer kept
+  std::shared_ptr<StreamJob> TakeParked(int downloadId);
+
+  // Record a stream's progress and sum up its job; returns the job's
+  // download, or null if the stream is not running
+  std::shared_ptr<Download> RecordProgress(int streamId, int64_t downloaded,
+                                           int64_t total, double speed,
+                                           StreamTotals &totals);
+  // Record a stream finishing; returns the job's download id, or -1 if the
+  // stream is not running, and whether all of the job's streams are done
+  int RecordCompletion(int streamId, bool success, bool &allCompleted);
+
+private:
+  std::unordered_map<int, std::shared_ptr<StreamJob>> m_jobs;    // Running
+  std::unordered_map<int, std::shared_ptr<StreamJob>> m_parked;  // Paused
+  std::unordered_map<int, int> m_owners;  // Stream id -> download id
+  mutable std::mutex m_mutex;
+};
@@ -1,14 +1,18 @@
 #include "YtDlpManager.h"
+#include "DownloadEngine.h"
+#include "../utils/Json.h"
 #include "../utils/Settings.h"
+#include "../utils/YtDlpProgress.h"
 #include <Windows.h>
 #include <ShlObj.h>
 #include <WinInet.h>
 #include <algorithm>
+#include <cctype>
 #include <chrono>
 #include <cstdio>
+#include <ctime>
 #include <fstream>
 #include <iostream>
-#include <regex>
 #include <sstream>
 #include <thread>
 
@@ -139,12 +143,72 @@ const std::unordered_set<std::string> YtDlpManager::VIDEO_SITE_PATTERNS = {
 static const char* YTDLP_DOWNLOAD_URL =
     "https://github.com/yt-dlp/yt-dlp/releases/latest/download/yt-dlp.exe";
 
+// yt-dlp is killed after this long without printing anything
+static const int READ_TIMEOUT_MS = 120000;
+// -J prints nothing until it is done, so this bounds the whole lookup
+static const int VIDEO_INFO_TIMEOUT_MS = 30000;
+
+static void ApplyProgress(Download &download, const ProgressFields &fields) {
+  if (fields.percent >= 0) {
+    download.SetProgress(fields.percent);
+  }
+  // Separate video and audio streams each report their own total
+  if (fields.totalBytes > 0 && download.GetTotalSize() <= 0) {
+    download.SetTotalSize(static_cast<int64_t>(fields.totalBytes));
+  }
+  if (fields.downloadedBytes >= 0) {
+    download.SetDownloadedSize(static_cast<int64_t>(fields.downloadedBytes));
+  }
+  if (fields.speed >= 0) {
+    download.SetSpeed(fields.speed);
+  }
+}
+
+// The document -J prints is its last line; anything before it is stray
+// diagnostics
+static std::string_view LastJsonLine(std::string_view output) {
+  size_t end = output.find_last_not_of(" \r\n\t");
+  if (end == std::string_view::npos) {
+    return std::string_view();
+  }
+  output = output.substr(0, end + 1);
+  size_t start = output.rfind("\n{");
+  start = (start == std::string_view::npos) ? 0 : start + 1;
+  return output.substr(start);
+}
+
+// Delete what the engine wrote of an unfinished stream. yt-dlp cannot use
+// segment parts, but with -c it continues a single-connection file, which
+// is contiguous from the start.
+static void DiscardStreamData(const Download &stream, bool keepContiguous) {
+  std::string filePath = stream.GetSavePath() + "\\" + stream.GetFilename();
+  std::vector<DownloadChunk> chunks = stream.GetChunksCopy();
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    DeleteFileA((filePath + ".part" + std::to_string(i)).c_str());
+  }
+  if (!keepContiguous || chunks.size() > 1) {
+    DeleteFileA(filePath.c_str());
+  }
+}
+
 YtDlpManager &YtDlpManager::GetInstance() {
   static YtDlpManager instance;
   return instance;
 }
 
-YtDlpManager::YtDlpManager() {
+YtDlpManager::YtDlpManager()
+    : m_runner(std::make_unique<ProcessRunner>()),
+      m_streamEngine(std::make_unique<DownloadEngine>()) {
+  // Streams report by their own ids; the handlers map them to downloads
+  m_streamEngine->SetProgressCallback([this](int streamId, int64_t downloaded,
+                                             int64_t total, double speed) {
+    OnStreamProgress(streamId, downloaded, total, speed);
+  });
+  m_streamEngine->SetCompletionCallback(
+      [this](int streamId, bool success, const std::string &error) {
+        OnStreamComplete(streamId, success, error);
+      });
+
   // Set default path: AppData/LDM/tools/yt-dlp.exe
   char appDataPath[MAX_PATH];
   if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appDataPath))) {
@@ -153,6 +217,7 @@ YtDlpManager::YtDlpManager() {
     m_ffmpegPath = appDataStr + "\\LDM\\tools\\ffmpeg.exe";
     m_denoPath = appDataStr + "\\LDM\\tools\\deno.exe";
     m_outputDir = appDataStr + "\\LDM\\downloads";
+    m_infoCachePath = appDataStr + "\\LDM\\video_info_cache.json";
 
     // Create tools directory if needed
     std::string ldmDir = appDataStr + "\\LDM";
@@ -164,38 +229,34 @@ YtDlpManager::YtDlpManager() {
     m_ffmpegPath = "ffmpeg.exe";
     m_denoPath = "deno.exe";
     m_outputDir = ".";
+    m_infoCachePath = "video_info_cache.json";
   }
+
+  LoadVideoInfoCache();
 }
 
 YtDlpManager::~YtDlpManager() {
   // Set shutdown flag to stop any loops
   m_shuttingDown.store(true);
 
-  // Kill all running processes first
+  // Pause engine-fetched streams so they resume next time; the engine is
+  // destroyed, waiting for their threads, once everything else has stopped
+  for (const auto &job : m_streamJobs.DetachAll()) {
+    for (const auto &stream : job->streams) {
+      m_streamEngine->PauseDownload(stream.download);
+    }
+  }
+
+  // Kill all running processes first; the runner waits for their exit
+  // callbacks, which see the shutdown flag and leave the status alone.
+  // Prefetches still running then fail fast instead of starting yt-dlp.
+  m_runner->Shutdown();
   {
     std::lock_guard<std::mutex> lock(m_processMutex);
-    for (auto &pair : m_runningProcesses) {
-      if (pair.second) {
-        TerminateProcess(pair.second, 1);
-        CloseHandle(pair.second);
-      }
-    }
     m_runningProcesses.clear();
   }
-
-  // Wait for all download tasks to complete (with timeout)
   {
     std::lock_guard<std::mutex> lock(m_tasksMutex);
-    for (auto &pair : m_downloadTasks) {
-      if (pair.second.valid()) {
-        // Wait with timeout to avoid hanging
-        auto status = pair.second.wait_for(std::chrono::seconds(2));
-        if (status == std::future_status::timeout) {
-          // Task didn't complete in time, it will be abandoned
-          std::cerr << "[YtDlpManager] Warning: Task " << pair.first << " did not complete in time" << std::endl;
-        }
-      }
-    }
     m_downloadTasks.clear();
   }
 
@@ -212,6 +273,9 @@ YtDlpManager::~YtDlpManager() {
     }
     m_utilityTasks.clear();
   }
+
+  // Waits for the stream threads, whose callbacks see the shutdown flag
+  m_streamEngine.reset();
 }
 
 bool YtDlpManager::IsYtDlpAvailable() const {
@@ -243,109 +307,12 @@ bool YtDlpManager::IsVideoSiteUrl(const std::string &url) const {
   return false;
 }
 
-std::vector<VideoFormat> YtDlpManager::GetAvailableFormats(const std::string &url) const {
-  std::vector<VideoFormat> formats;
-
-  std::string ytdlpPath;
-  std::string denoPath;
-  bool hasDeno = false;
-  {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    // Check if yt-dlp exists directly (don't call IsYtDlpAvailable to avoid deadlock)
-    DWORD attrs = GetFileAttributesA(m_ytdlpPath.c_str());
-    if (attrs == INVALID_FILE_ATTRIBUTES || (attrs & FILE_ATTRIBUTE_DIRECTORY)) {
-      return formats;
-    }
-    ytdlpPath = m_ytdlpPath;
-    denoPath = m_denoPath;
-    attrs = GetFileAttributesA(denoPath.c_str());
-    hasDeno = (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY));
-  }
-
-  // Build command with Deno option only for YouTube
-  bool isYouTube = (url.find("youtube.com") != std::string::npos ||
-                    url.find("youtu.be") != std::string::npos ||
-                    url.find("youtube-nocookie.com") != std::string::npos);
-  std::string denoOption = (hasDeno && isYouTube) ? "--js-runtimes deno:\"" + denoPath + "\" " : "";
-
-  // Run yt-dlp -F to list formats (silently, with timeout)
-  std::string cmd = "\"" + ytdlpPath + "\" " + denoOption + "-F --no-playlist --socket-timeout 15 \"" + url + "\"";
-  std::string output = RunCommandSilent(cmd, 20000); // 20 second timeout
-
-  if (output.empty()) {
-    return formats;
-  }
-
-  // Parse output lines
-  // Format: ID  EXT   RESOLUTION FPS CH │   FILESIZE   TBR PROTO │ VCODEC          VBR ACODEC      ABR ASR MORE INFO
-  std::istringstream stream(output);
-  std::string line;
-  bool headerPassed = false;
-
-  while (std::getline(stream, line)) {
-    // Skip header lines (before the separator line with dashes)
-    if (line.find("---") != std::string::npos) {
-      headerPassed = true;
-      continue;
-    }
-    if (!headerPassed || line.empty()) continue;
-
-    // Parse format line
-    std::istringstream lineStream(line);
-    std::string formatId, ext, resolution;
-    lineStream >> formatId >> ext >> resolution;
-
-    if (formatId.empty() || formatId[0] == '[') continue;
-
-    VideoFormat fmt;
-    fmt.formatId = formatId;
-    fmt.ext = ext;
-    fmt.resolution = resolution;
-    fmt.filesize = -1;
-    fmt.hasVideo = true;
-    fmt.hasAudio = true;
-
-    // Determine height from resolution
-    if (resolution.find("x") != std::string::npos) {
-      size_t xPos = resolution.find("x");
-      try {
-        fmt.height = std::stoi(resolution.substr(xPos + 1));
-      } catch (...) {
-        fmt.height = 0;
-      }
-    } else if (resolution.find("audio") != std::string::npos) {
-      fmt.height = 0;
-      fmt.hasVideo = false;
-    } else {
-      // Try to parse as height directly (e.g., "1080p")
-      try {
-        fmt.height = std::stoi(resolution);
-      } catch (...) {
-        fmt.height = 0;
-      }
-    }
-
-    // Create readable note
-    if (fmt.height > 0) {
-      fmt.note = std::to_string(fmt.height) + "p " + ext;
-    } else if (!fmt.hasVideo) {
-      fmt.note = "Audio only (" + ext + ")";
-    } else {
-      fmt.note = ext;
-    }
-
-    // Check if it's video-only or audio-only from the line
-    if (line.find("video only") != std::string::npos) {
-      fmt.hasAudio = false;
-      fmt.note += " (video only)";
-    }
-    if (line.find("audio only") != std::string::npos) {
-      fmt.hasVideo = false;
-      fmt.hasAudio = true;
-    }
-
-    formats.push_back(fmt);
+std::vector<VideoFormat> YtDlpManager::GetAvailableFormats(const std::string &url) {
+  VideoInfo info;
+  if (!GetVideoInfo(url, info)) {
+    return {};
   }
+  std::vector<VideoFormat> formats = std::move(info.formats);
 
   // Check if ffmpeg is available for format presets
   bool hasFfmpeg = false;
@@ -441,38 +408,311 @@ std::vector<VideoFormat> YtDlpManager::GetAvailableFormats(const std::string &ur
   return formats;
 }
 
-std::string YtDlpManager::GetVideoTitle(const std::string &url) const {
+std::string YtDlpManager::GetVideoTitle(const std::string &url) {
+  VideoInfo info;
+  return GetVideoInfo(url, info) ? info.title : "";
+}
+
+bool YtDlpManager::GetVideoInfo(const std::string &url, VideoInfo &info) {
+  std::shared_future<bool> pending;
+  std::promise<bool> fetch;
+  {
+    std::lock_guard<std::mutex> lock(m_infoMutex);
+    if (LookupVideoInfo(url, &info)) {
+      return true;
+    }
+    auto it = m_infoInFlight.find(url);
+    if (it != m_infoInFlight.end()) {
+      pending = it->second;
+    } else {
+      m_infoInFlight[url] = fetch.get_future().share();
+    }
+  }
+
+  // Someone (usually a prefetch) is already asking yt-dlp; wait for it
+  if (pending.valid()) {
+    if (!pending.get()) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(m_infoMutex);
+    return LookupVideoInfo(url, &info);
+  }
+
+  bool ok = false;
+  try {
+    ok = FetchVideoInfo(url, info);
+    std::lock_guard<std::mutex> lock(m_infoMutex);
+    if (ok) {
+      auto existing = m_infoIndex.find(url);
+      if (existing != m_infoIndex.end()) {
+        m_infoCache.erase(existing->second);
+        m_infoIndex.erase(existing);
+      }
+      m_infoCache.push_front({url, info, static_cast<int64_t>(std::time(nullptr))});
+      m_infoIndex[url] = m_infoCache.begin();
+      while (m_infoCache.size() > VIDEO_INFO_CACHE_SIZE) {
+        m_infoIndex.erase(m_infoCache.back().url);
+        m_infoCache.pop_back();
+      }
+    }
+    m_infoInFlight.erase(url);
+  } catch (...) {
+    // Waiters get the same failure, and the next caller starts afresh
+    {
+      std::lock_guard<std::mutex> lock(m_infoMutex);
+      m_infoInFlight.erase(url);
+    }
+    fetch.set_exception(std::current_exception());
+    throw;
+  }
+  fetch.set_value(ok);
+
+  if (ok) {
+    SaveVideoInfoCache();
+  }
+  return ok;
+}
+
+bool YtDlpManager::LookupVideoInfo(const std::string &url, VideoInfo *info) {
+  auto it = m_infoIndex.find(url);
+  if (it == m_infoIndex.end()) {
+    return false;
+  }
+  if (std::time(nullptr) - it->second->fetchedAt > VIDEO_INFO_TTL_SECONDS) {
+    m_infoCache.erase(it->second);
+    m_infoIndex.erase(it);
+    return false;
+  }
+  m_infoCache.splice(m_infoCache.begin(), m_infoCache, it->second);
+  if (info) {
+    *info = it->second->info;
+  }
+  return true;
+}
+
+bool YtDlpManager::FetchVideoInfo(const std::string &url, VideoInfo &info) {
   std::string ytdlpPath;
-  std::string denoPath;
-  bool hasDeno = false;
   {
     std::lock_guard<std::mutex> lock(m_mutex);
     // Check if yt-dlp exists directly (don't call IsYtDlpAvailable to avoid deadlock)
     DWORD attrs = GetFileAttributesA(m_ytdlpPath.c_str());
     if (attrs == INVALID_FILE_ATTRIBUTES || (attrs & FILE_ATTRIBUTE_DIRECTORY)) {
-      return "";
+      return false;
     }
     ytdlpPath = m_ytdlpPath;
-    denoPath = m_denoPath;
-    attrs = GetFileAttributesA(denoPath.c_str());
-    hasDeno = (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY));
+  }
+  std::string denoOption = DenoOption(url);
+
+  // One -J call gives the title and every format as JSON. The document is
+  // one long line, so it is collected unsplit; the runner drains the pipe
+  // while yt-dlp writes, however large the document gets.
+  std::string cmd = "\"" + ytdlpPath + "\" " + denoOption +
+                    "-J --no-playlist --no-warnings --socket-timeout 15 \"" + url + "\"";
+  struct Capture {
+    std::string output;
+    std::promise<int> exitCode;
+  };
+  auto capture = std::make_shared<Capture>();
+  std::future<int> exited = capture->exitCode.get_future();
+  int processId = m_runner->Start(
+      cmd, [capture](std::string_view chunk) { capture->output.append(chunk); },
+      [capture](int exitCode) { capture->exitCode.set_value(exitCode); },
+      VIDEO_INFO_TIMEOUT_MS, false);
+  if (processId < 0 || exited.get() != 0) {
+    return false;
   }
 
-  // Build command with Deno option only for YouTube
-  bool isYouTube = (url.find("youtube.com") != std::string::npos ||
-                    url.find("youtu.be") != std::string::npos ||
-                    url.find("youtube-nocookie.com") != std::string::npos);
-  std::string denoOption = (hasDeno && isYouTube) ? "--js-runtimes deno:\"" + denoPath + "\" " : "";
+  JsonValue root = JsonValue::Parse(LastJsonLine(capture->output));
+  if (!root.IsObject()) {
+    std::cerr << "[YtDlpManager] Unreadable -J output for " << url << std::endl;
+    return false;
+  }
 
-  std::string cmd = "\"" + ytdlpPath + "\" " + denoOption + "--get-title --no-playlist --socket-timeout 15 \"" + url + "\"";
-  std::string result = RunCommandSilent(cmd, 20000); // 20 second timeout
+  info.title = root["title"].AsString();
+  info.formats.clear();
+  root["formats"].ForEachElement([&info](const JsonValue &entry) {
+    std::string vcodec = entry["vcodec"].AsString();
+    std::string acodec = entry["acodec"].AsString();
+    // Storyboards and thumbnails carry neither stream
+    if (vcodec == "none" && acodec == "none") {
+      return true;
+    }
 
-  // Trim whitespace
-  size_t end = result.find_last_not_of(" \n\r\t");
-  if (end != std::string::npos) {
-    result = result.substr(0, end + 1);
+    VideoFormat fmt;
+    fmt.formatId = entry["format_id"].AsString();
+    fmt.ext = entry["ext"].AsString();
+    fmt.resolution = entry["resolution"].AsString();
+    fmt.height = static_cast<int>(entry["height"].AsInt(0));
+    fmt.filesize = entry["filesize"].AsInt(entry["filesize_approx"].AsInt(-1));
+    fmt.hasVideo = (vcodec != "none");
+    fmt.hasAudio = (acodec != "none");
+    if (fmt.formatId.empty()) {
+      return true;
+    }
+
+    // Create readable note
+    if (fmt.height > 0 && fmt.hasVideo) {
+      fmt.note = std::to_string(fmt.height) + "p " + fmt.ext;
+    } else if (!fmt.hasVideo) {
+      fmt.height = 0;
+      fmt.note = "Audio only (" + fmt.ext + ")";
+    } else {
+      fmt.note = fmt.ext;
+    }
+    if (fmt.hasVideo && !fmt.hasAudio) {
+      fmt.note += " (video only)";
+    }
+
+    info.formats.push_back(std::move(fmt));
+    return true;
+  });
+  return true;
+}
+
+void YtDlpManager::PrefetchVideoInfo(const std::string &url) {
+  if (m_shuttingDown.load() || !IsYtDlpAvailable()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_infoMutex);
+    if (LookupVideoInfo(url, nullptr) || m_infoInFlight.count(url) ||
+        std::find(m_prefetchQueue.begin(), m_prefetchQueue.end(), url) !=
+            m_prefetchQueue.end()) {
+      return;
+    }
+    m_prefetchQueue.push_back(url);
+    if (m_prefetchWorkers >= MAX_PREFETCH_WORKERS) {
+      return;  // A running worker will pick it up
+    }
+    ++m_prefetchWorkers;
+  }
+
+  // Clean up completed utility tasks first
+  {
+    std::lock_guard<std::mutex> lock(m_utilityTasksMutex);
+    m_utilityTasks.erase(
+        std::remove_if(m_utilityTasks.begin(), m_utilityTasks.end(),
+                       [](std::future<void> &f) {
+                         return !f.valid() ||
+                                f.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready;
+                       }),
+        m_utilityTasks.end());
+    m_utilityTasks.push_back(
+        std::async(std::launch::async, [this]() { PrefetchWorker(); }));
+  }
+}
+
+void YtDlpManager::PrefetchWorker() {
+  // Workers exit when the queue runs dry rather than idling
+  for (;;) {
+    std::string url;
+    {
+      std::lock_guard<std::mutex> lock(m_infoMutex);
+      if (m_prefetchQueue.empty() || m_shuttingDown.load()) {
+        --m_prefetchWorkers;
+        return;
+      }
+      url = std::move(m_prefetchQueue.front());
+      m_prefetchQueue.pop_front();
+    }
+    VideoInfo info;
+    try {
+      GetVideoInfo(url, info);
+    } catch (const std::exception &e) {
+      std::cerr << "[YtDlpManager] Prefetch failed for " << url << ": "
+                << e.what() << std::endl;
+    }
+  }
+}
+
+void YtDlpManager::LoadVideoInfoCache() {
+  std::ifstream file(m_infoCachePath, std::ios::binary);
+  if (!file.is_open()) {
+    return;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string text = buffer.str();
+
+  JsonValue root = JsonValue::Parse(text);
+  int64_t now = static_cast<int64_t>(std::time(nullptr));
+
+  std::lock_guard<std::mutex> lock(m_infoMutex);
+  // Stored most recent first, which is also the list order
+  root["entries"].ForEachElement([&](const JsonValue &entry) {
+    CachedVideoInfo cached;
+    cached.url = entry["url"].AsString();
+    cached.fetchedAt = entry["fetchedAt"].AsInt();
+    if (cached.url.empty() || now - cached.fetchedAt > VIDEO_INFO_TTL_SECONDS ||
+        m_infoIndex.count(cached.url)) {
+      return true;
+    }
+    cached.info.title = entry["title"].AsString();
+    entry["formats"].ForEachElement([&cached](const JsonValue &stored) {
+      VideoFormat fmt;
+      fmt.formatId = stored["id"].AsString();
+      fmt.ext = stored["ext"].AsString();
+      fmt.resolution = stored["resolution"].AsString();
+      fmt.note = stored["note"].AsString();
+      fmt.height = static_cast<int>(stored["height"].AsInt());
+      fmt.filesize = stored["filesize"].AsInt(-1);
+      fmt.hasVideo = stored["video"].AsBool(true);
+      fmt.hasAudio = stored["audio"].AsBool(true);
+      cached.info.formats.push_back(std::move(fmt));
+      return true;
+    });
+    m_infoCache.push_back(std::move(cached));
+    m_infoIndex[m_infoCache.back().url] = std::prev(m_infoCache.end());
+    return m_infoCache.size() < VIDEO_INFO_CACHE_SIZE;
+  });
+}
+
+void YtDlpManager::SaveVideoInfoCache() {
+  JsonWriter writer(16 * 1024);
+  {
+    std::lock_guard<std::mutex> lock(m_infoMutex);
+    writer.BeginObject().Key("entries").BeginArray();
+    for (const CachedVideoInfo &cached : m_infoCache) {
+      writer.BeginObject()
+          .Key("url").String(cached.url)
+          .Key("fetchedAt").Int(cached.fetchedAt)
+          .Key("title").String(cached.info.title)
+          .Key("formats").BeginArray();
+      for (const VideoFormat &fmt : cached.info.formats) {
+        writer.BeginObject()
+            .Key("id").String(fmt.formatId)
+            .Key("ext").String(fmt.ext)
+            .Key("resolution").String(fmt.resolution)
+            .Key("note").String(fmt.note)
+            .Key("height").Int(fmt.height)
+            .Key("filesize").Int(fmt.filesize)
+            .Key("video").Bool(fmt.hasVideo)
+            .Key("audio").Bool(fmt.hasAudio)
+            .EndObject();
+      }
+      writer.EndArray().EndObject();
+    }
+    writer.EndArray().EndObject();
+  }
+
+  // Write beside the cache and swap it in, so a crash never leaves half a file
+  std::lock_guard<std::mutex> lock(m_infoFileMutex);
+  std::string tempPath = m_infoCachePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      return;
+    }
+    file << writer.Str();
+    if (!file) {
+      return;
+    }
+  }
+  if (!MoveFileExA(tempPath.c_str(), m_infoCachePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+    std::cerr << "[YtDlpManager] Failed to save video info cache" << std::endl;
+    DeleteFileA(tempPath.c_str());
   }
-  return result;
 }
 
 std::string YtDlpManager::GetYtDlpVersion() const {
@@ -861,6 +1101,74 @@ void YtDlpManager::CleanupCompletedTasks() {
   }
 }
 
+std::string YtDlpManager::DenoOption(const std::string &url) const {
+  // Deno JS runtime only for YouTube (it's the main site that requires it)
+  bool isYouTube = (url.find("youtube.com") != std::string::npos ||
+                    url.find("youtu.be") != std::string::npos ||
+                    url.find("youtube-nocookie.com") != std::string::npos);
+  if (!isYouTube) {
+    return "";
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  DWORD attrs = GetFileAttributesA(m_denoPath.c_str());
+  if (attrs == INVALID_FILE_ATTRIBUTES || (attrs & FILE_ATTRIBUTE_DIRECTORY)) {
+    return "";
+  }
+  return "--js-runtimes deno:\"" + m_denoPath + "\" ";
+}
+
+std::string YtDlpManager::FormatOptions(const std::string &selectedFormat) const {
+  std::string ffmpegPath;
+  bool hasFfmpeg = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ffmpegPath = m_ffmpegPath;
+    DWORD attrs = GetFileAttributesA(ffmpegPath.c_str());
+    hasFfmpeg = (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY));
+  }
+
+  // Tell yt-dlp where to find ffmpeg and merge into mp4
+  std::string mergeOptions;
+  if (hasFfmpeg) {
+    std::string ffmpegDir = ffmpegPath.substr(0, ffmpegPath.find_last_of("\\/"));
+    mergeOptions = "--ffmpeg-location \"" + ffmpegDir + "\" --merge-output-format mp4 ";
+  }
+
+  // Use selected format if specified, otherwise use defaults
+  if (!selectedFormat.empty()) {
+    return "-f \"" + selectedFormat + "\" " + mergeOptions;
+  }
+  if (hasFfmpeg) {
+    // With ffmpeg: download best video + audio and merge
+    return "-f \"bestvideo[height<=1080][ext=mp4]+bestaudio[ext=m4a]/bestvideo[height<=1080]+bestaudio/best[height<=1080]/best\" " +
+           mergeOptions;
+  }
+  // Without ffmpeg: get best pre-merged format (mp4 preferred)
+  return "-f \"best[ext=mp4][height<=1080]/best[height<=1080]/best\" ";
+}
+
+std::string YtDlpManager::OutputDirectory(const Download &download) const {
+  std::string outputDir = download.GetSavePath();
+  if (outputDir.empty()) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    outputDir = m_outputDir;
+  }
+
+  // Ensure output directory exists and is valid
+  if (outputDir.empty()) {
+    // Fallback to user's Videos folder
+    char videosPath[MAX_PATH];
+    if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_MYVIDEO, NULL, 0, videosPath))) {
+      outputDir = std::string(videosPath) + "\\LDM";
+    } else {
+      outputDir = ".";
+    }
+  }
+
+  CreateDirectoryA(outputDir.c_str(), NULL);
+  return outputDir;
+}
+
 bool YtDlpManager::StartDownload(std::shared_ptr<Download> download) {
   // Default: use best quality with ffmpeg if available
   return StartDownloadWithFormat(download, "");
@@ -879,12 +1187,6 @@ bool YtDlpManager::StartDownloadWithFormat(std::shared_ptr<Download> download, c
 
   int downloadId = download->GetId();
 
-  // Store format selection
-  if (!formatId.empty()) {
-    std::lock_guard<std::mutex> lock(m_formatsMutex);
-    m_downloadFormats[downloadId] = formatId;
-  }
-
   // Mark the download object itself as yt-dlp download
   download->SetYtDlpDownload(true);
   download->SetStatus(DownloadStatus::Downloading);
@@ -892,76 +1194,47 @@ bool YtDlpManager::StartDownloadWithFormat(std::shared_ptr<Download> download, c
   // Clean up any completed tasks first
   CleanupCompletedTasks();
 
-  // Start download using std::async for proper lifecycle management
-  auto future = std::async(std::launch::async, [this, download]() {
-    PerformDownload(download);
-  });
-
+  // Resolve right away; the runner's I/O thread handles output and exit, so
+  // a running video no longer holds a thread of its own
+  auto done = std::make_shared<std::promise<void>>();
   {
     std::lock_guard<std::mutex> lock(m_tasksMutex);
-    m_downloadTasks[downloadId] = std::move(future);
+    m_downloadTasks[downloadId] = done->get_future();
   }
 
+  // A job paused in the stream engine continues from its chunks, unless
+  // another format is wanted now
+  if (std::shared_ptr<StreamJob> paused = m_streamJobs.TakeParked(downloadId)) {
+    if (formatId.empty() || formatId == paused->selectedFormat) {
+      paused->done = done;
+      ResumeStreamJob(paused, download);
+      return true;
+    }
+    StopStreamJob(paused, true, false);
+  }
+  ResolveAndFetch(download, formatId, done);
+
   return true;
 }
 
-void YtDlpManager::PerformDownload(std::shared_ptr<Download> download) {
-  if (!download || m_shuttingDown.load()) return;
+void YtDlpManager::PerformDownload(std::shared_ptr<Download> download,
+                                   const std::string &selectedFormat,
+                                   std::shared_ptr<std::promise<void>> done) {
+  if (!download || m_shuttingDown.load()) {
+    done->set_value();
+    return;
+  }
 
   int downloadId = download->GetId();
   std::string url = download->GetUrl();
-  std::string outputDir = download->GetSavePath();
-
-  // Get selected format for this download
-  std::string selectedFormat;
-  {
-    std::lock_guard<std::mutex> lock(m_formatsMutex);
-    auto it = m_downloadFormats.find(downloadId);
-    if (it != m_downloadFormats.end()) {
-      selectedFormat = it->second;
-      m_downloadFormats.erase(it);  // Clean up after reading
-    }
-  }
-
-  // Get yt-dlp path, ffmpeg path, deno path, and output dir safely
+  std::string outputDir = OutputDirectory(*download);
   std::string ytdlpPath;
-  std::string ffmpegPath;
-  std::string denoPath;
-  bool hasFfmpeg = false;
-  bool hasDeno = false;
   {
     std::lock_guard<std::mutex> lock(m_mutex);
     ytdlpPath = m_ytdlpPath;
-    ffmpegPath = m_ffmpegPath;
-    denoPath = m_denoPath;
-    if (outputDir.empty()) {
-      outputDir = m_outputDir;
-    }
-    // Check if ffmpeg exists
-    DWORD attrs = GetFileAttributesA(ffmpegPath.c_str());
-    hasFfmpeg = (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY));
-    // Check if deno exists
-    attrs = GetFileAttributesA(denoPath.c_str());
-    hasDeno = (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY));
-  }
-
-  // Ensure output directory exists and is valid
-  if (outputDir.empty()) {
-    // Fallback to user's Videos folder
-    char videosPath[MAX_PATH];
-    if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_MYVIDEO, NULL, 0, videosPath))) {
-      outputDir = std::string(videosPath) + "\\LDM";
-    } else {
-      outputDir = ".";
-    }
   }
 
-  // Create output directory
-  CreateDirectoryA(outputDir.c_str(), NULL);
-
   std::cout << "[YtDlpManager] Output directory: " << outputDir << std::endl;
-  std::cout << "[YtDlpManager] ffmpeg available: " << (hasFfmpeg ? "yes" : "no") << std::endl;
-  std::cout << "[YtDlpManager] Deno available: " << (hasDeno ? "yes" : "no") << std::endl;
   std::cout << "[YtDlpManager] Selected format: " << (selectedFormat.empty() ? "auto" : selectedFormat) << std::endl;
 
   // Build yt-dlp command
@@ -974,43 +1247,11 @@ void YtDlpManager::PerformDownload(std::shared_ptr<Download> download) {
   // --restrict-filenames: avoid special characters in filename
   std::string outputTemplate = outputDir + "\\%(title)s.%(ext)s";
 
-  std::string formatOption;
-  std::string mergeOption;
-  std::string ffmpegOption;
-  std::string denoOption;
-
-  // Configure Deno JS runtime only for YouTube (it's the main site that requires it)
-  bool isYouTube = (url.find("youtube.com") != std::string::npos ||
-                    url.find("youtu.be") != std::string::npos ||
-                    url.find("youtube-nocookie.com") != std::string::npos);
-  if (hasDeno && isYouTube) {
-    denoOption = "--js-runtimes deno:\"" + denoPath + "\" ";
-  }
-
-  // Use selected format if specified, otherwise use defaults
-  if (!selectedFormat.empty()) {
-    formatOption = "-f \"" + selectedFormat + "\" ";
-    if (hasFfmpeg) {
-      mergeOption = "--merge-output-format mp4 ";
-      std::string ffmpegDir = ffmpegPath.substr(0, ffmpegPath.find_last_of("\\/"));
-      ffmpegOption = "--ffmpeg-location \"" + ffmpegDir + "\" ";
-    }
-  } else if (hasFfmpeg) {
-    // With ffmpeg: download best video + audio and merge
-    formatOption = "-f \"bestvideo[height<=1080][ext=mp4]+bestaudio[ext=m4a]/bestvideo[height<=1080]+bestaudio/best[height<=1080]/best\" ";
-    mergeOption = "--merge-output-format mp4 ";
-    // Tell yt-dlp where to find ffmpeg
-    std::string ffmpegDir = ffmpegPath.substr(0, ffmpegPath.find_last_of("\\/"));
-    ffmpegOption = "--ffmpeg-location \"" + ffmpegDir + "\" ";
-  } else {
-    // Without ffmpeg: get best pre-merged format (mp4 preferred)
-    formatOption = "-f \"best[ext=mp4][height<=1080]/best[height<=1080]/best\" ";
-  }
-
   std::string cmd = "\"" + ytdlpPath + "\" "
                     "--newline "
                     "--no-mtime "
                     "--progress "
+                    "--progress-template \"" + std::string(YtDlpProgress::TEMPLATE) + "\" "
                     "-c "
                     "--no-playlist "
                     "--restrict-filenames "
@@ -1019,183 +1260,565 @@ void YtDlpManager::PerformDownload(std::shared_ptr<Download> download) {
                     "--no-warnings "
                     "--socket-timeout 30 "
                     "--retries 3 "
-                    + denoOption
-                    + ffmpegOption
-                    + formatOption
-                    + mergeOption
+                    + DenoOption(url)
+                    + FormatOptions(selectedFormat)
                     + "-o \"" + outputTemplate + "\" "
                     "\"" + url + "\"";
 
   std::cout << "[YtDlpManager] Running: " << cmd << std::endl;
 
-  // Create process with pipes to read output
-  SECURITY_ATTRIBUTES sa;
-  sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-  sa.bInheritHandle = TRUE;
-  sa.lpSecurityDescriptor = NULL;
+  // Both callbacks run on the runner's I/O thread. The runner id is filled
+  // in under m_processMutex, which the exit callback also takes, so it is
+  // set by the time that callback reads it.
+  auto processId = std::make_shared<int>(-1);
+  {
+    std::lock_guard<std::mutex> lock(m_processMutex);
+    *processId = m_runner->Start(
+        cmd,
+        [this, download](std::string_view line) { ParseProgressLine(line, download); },
+        [this, download, done, processId](int exitCode) {
+          {
+            std::lock_guard<std::mutex> lock(m_processMutex);
+            auto it = m_runningProcesses.find(download->GetId());
+            // A resumed download may already be tracking a newer process
+            if (it != m_runningProcesses.end() && it->second == *processId) {
+              m_runningProcesses.erase(it);
+            }
+          }
+          OnProcessExit(download, exitCode);
+          done->set_value();
+        },
+        READ_TIMEOUT_MS);
+
+    // Store process id for pause/cancel
+    if (*processId >= 0) {
+      m_runningProcesses[downloadId] = *processId;
+    }
+  }
 
-  HANDLE hReadPipe, hWritePipe;
-  if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
+  if (*processId < 0) {
     download->SetStatus(DownloadStatus::Error);
-    download->SetErrorMessage("Failed to create pipe");
+    download->SetErrorMessage("Failed to start yt-dlp");
+    done->set_value();
+  }
+}
+
+void YtDlpManager::OnProcessExit(const std::shared_ptr<Download> &download,
+                                 int exitCode) {
+  // Set final status (only if not shutting down)
+  if (!m_shuttingDown.load()) {
+    DownloadStatus currentStatus = download->GetStatus();
+    if (currentStatus != DownloadStatus::Cancelled &&
+        currentStatus != DownloadStatus::Paused) {
+      if (exitCode == 0) {
+        download->SetStatus(DownloadStatus::Completed);
+        download->SetProgress(100.0);
+        std::cout << "[YtDlpManager] Download completed: " << download->GetFilename() << std::endl;
+      } else {
+        download->SetStatus(DownloadStatus::Error);
+        // Keep existing error message if one was set during parsing, otherwise use generic
+        std::string existingError = download->GetErrorMessage();
+        if (existingError.empty() || existingError.find("yt-dlp exited") != std::string::npos) {
+          download->SetErrorMessage("yt-dlp exited with code " + std::to_string(exitCode) +
+                                    ". Try running yt-dlp manually to see the error.");
+        }
+        std::cerr << "[YtDlpManager] Download failed with exit code: " << exitCode << std::endl;
+        std::cerr << "[YtDlpManager] Error message: " << download->GetErrorMessage() << std::endl;
+        std::cerr << "[YtDlpManager] URL: " << download->GetUrl() << std::endl;
+      }
+    }
+  }
+}
+
+void YtDlpManager::ResolveAndFetch(std::shared_ptr<Download> download,
+                                   const std::string &selectedFormat,
+                                   std::shared_ptr<std::promise<void>> done) {
+  if (!download || m_shuttingDown.load()) {
+    done->set_value();
     return;
   }
 
-  SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
+  int downloadId = download->GetId();
+  std::string url = download->GetUrl();
+  std::string outputDir = OutputDirectory(*download);
+  std::string ytdlpPath;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ytdlpPath = m_ytdlpPath;
+  }
 
-  STARTUPINFOA si = {0};
-  si.cb = sizeof(STARTUPINFOA);
-  si.hStdOutput = hWritePipe;
-  si.hStdError = hWritePipe;
-  si.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-  si.wShowWindow = SW_HIDE;
+  // Same format and naming options as the download itself, so the streams
+  // and the file name are the ones yt-dlp would have picked. Direct URLs
+  // expire, so this is never answered from the video info cache.
+  std::string cmd = "\"" + ytdlpPath + "\" " + DenoOption(url) +
+                    FormatOptions(selectedFormat) +
+                    "-J --no-playlist --no-warnings --socket-timeout 15 "
+                    "--restrict-filenames --windows-filenames "
+                    "-o \"" + outputDir + "\\%(title)s.%(ext)s\" "
+                    "\"" + url + "\"";
+  auto output = std::make_shared<std::string>();
+  auto processId = std::make_shared<int>(-1);
+  {
+    std::lock_guard<std::mutex> lock(m_processMutex);
+    *processId = m_runner->Start(
+        cmd, [output](std::string_view chunk) { output->append(chunk); },
+        [this, download, selectedFormat, done, output, processId](int exitCode) {
+          bool current = false;
+          {
+            std::lock_guard<std::mutex> lock(m_processMutex);
+            auto it = m_runningProcesses.find(download->GetId());
+            if (it != m_runningProcesses.end() && it->second == *processId) {
+              m_runningProcesses.erase(it);
+              current = true;
+            }
+          }
+          // Paused or cancelled while resolving
+          if (!current || m_shuttingDown.load()) {
+            done->set_value();
+            return;
+          }
 
-  PROCESS_INFORMATION pi = {0};
+          JsonValue root;
+          if (exitCode == 0) {
+            root = JsonValue::Parse(LastJsonLine(*output));
+          }
+          if (!StartStreamJob(download, selectedFormat, done, root)) {
+            PerformDownload(download, selectedFormat, done);
+          }
+        },
+        VIDEO_INFO_TIMEOUT_MS, false);
 
-  // Create the process
-  std::vector<char> cmdLine(cmd.begin(), cmd.end());
-  cmdLine.push_back('\0');
+    if (*processId >= 0) {
+      m_runningProcesses[downloadId] = *processId;
+    }
+  }
 
-  if (!CreateProcessA(NULL, cmdLine.data(), NULL, NULL, TRUE,
-                       CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-    CloseHandle(hReadPipe);
-    CloseHandle(hWritePipe);
+  if (*processId < 0) {
     download->SetStatus(DownloadStatus::Error);
     download->SetErrorMessage("Failed to start yt-dlp");
-    return;
+    done->set_value();
   }
+}
 
-  CloseHandle(hWritePipe);  // Close write end in parent
+bool YtDlpManager::StartStreamJob(const std::shared_ptr<Download> &download,
+                                  const std::string &selectedFormat,
+                                  const std::shared_ptr<std::promise<void>> &done,
+                                  const JsonValue &root) {
+  if (!root.IsObject()) {
+    return false;
+  }
+  std::string outputPath = root["filename"].AsString(root["_filename"].AsString());
+  if (outputPath.empty()) {
+    return false;
+  }
 
-  // Store process handle for pause/cancel
-  {
-    std::lock_guard<std::mutex> lock(m_processMutex);
-    m_runningProcesses[downloadId] = pi.hProcess;
+  // Separate video and audio come as requested_formats; a single format
+  // is described by the document itself
+  std::vector<JsonValue> formats;
+  JsonValue requested = root["requested_formats"];
+  if (requested.IsArray()) {
+    requested.ForEachElement([&formats](const JsonValue &format) {
+      formats.push_back(format);
+      return true;
+    });
+  } else {
+    formats.push_back(root);
+  }
+  if (formats.empty() || (formats.size() > 1 && !IsFfmpegAvailable())) {
+    return false;
   }
 
-  // Read output and parse progress with timeout
-  char buffer[4096];
-  DWORD bytesRead;
-  DWORD bytesAvailable;
-  std::string lineBuffer;
-  DWORD lastActivityTime = GetTickCount();
-  const DWORD READ_TIMEOUT_MS = 120000; // 2 minute timeout for no output
-
-  while (!m_shuttingDown.load()) {
-    // Check for timeout (no output for too long)
-    if (GetTickCount() - lastActivityTime > READ_TIMEOUT_MS) {
-      std::cerr << "[YtDlpManager] Download timed out - no output for 2 minutes" << std::endl;
-      TerminateProcess(pi.hProcess, 1);
+  size_t slash = outputPath.find_last_of("\\/");
+  std::string outputDir = (slash == std::string::npos) ? "." : outputPath.substr(0, slash);
+  std::string filename = outputPath.substr(slash == std::string::npos ? 0 : slash + 1);
+  std::string stem = filename.substr(0, filename.find_last_of('.'));
+
+  struct StreamSource {
+    std::string url;
+    std::string filename;
+    std::string referer;
+  };
+  std::vector<StreamSource> sources;
+  for (const JsonValue &format : formats) {
+    // The engine range-requests plain files and sends nothing but a
+    // Referer, so manifests, fragments and cookie-bound streams stay with
+    // yt-dlp
+    std::string protocol = format["protocol"].AsString();
+    JsonValue headers = format["http_headers"];
+    StreamSource source;
+    source.url = format["url"].AsString();
+    if ((protocol != "http" && protocol != "https") || source.url.empty() ||
+        format["fragments"].IsValid() || headers["Cookie"].IsValid() ||
+        !format["cookies"].AsString().empty()) {
+      return false;
+    }
+    source.referer = headers["Referer"].AsString();
+    // Named as yt-dlp names the parts it merges, so a fallback resumes them
+    source.filename = (formats.size() == 1)
+                          ? filename
+                          : stem + ".f" + format["format_id"].AsString() +
+                                "." + format["ext"].AsString();
+    sources.push_back(std::move(source));
+  }
+
+  auto job = std::make_shared<StreamJob>();
+  job->download = download;
+  job->selectedFormat = selectedFormat;
+  job->done = done;
+  job->outputPath = outputPath;
+  for (const StreamSource &source : sources) {
+    MediaStream stream;
+    stream.download = std::make_shared<Download>(m_nextStreamId++, source.url, outputDir);
+    stream.download->SetFilename(source.filename);
+    if (!source.referer.empty()) {
+      stream.download->SetReferer(source.referer);
+    }
+    // Some engine failures only set the status
+    stream.download->SetIndexListener([this](const Download &streamDownload) {
+      if (streamDownload.GetStatus() == DownloadStatus::Error) {
+        OnStreamComplete(streamDownload.GetId(), false, "stream failed");
+      }
+    });
+    job->streams.push_back(std::move(stream));
+  }
+  m_streamJobs.Add(job);
+
+  download->SetFilename(filename);
+  std::cout << "[YtDlpManager] Fetching " << job->streams.size()
+            << " stream(s) with the download engine: " << filename << std::endl;
+
+  for (const MediaStream &stream : job->streams) {
+    if (!m_streamEngine->StartDownload(stream.download)) {
+      std::cerr << "[YtDlpManager] Stream engine refused " << filename
+                << ", falling back to yt-dlp" << std::endl;
+      if (auto detached = m_streamJobs.Detach(download->GetId())) {
+        StopStreamJob(detached, true, true);
+      }
       break;
     }
+  }
+  return true;
+}
 
-    // Check if data available (non-blocking)
-    if (!PeekNamedPipe(hReadPipe, NULL, 0, NULL, &bytesAvailable, NULL)) {
-      break; // Pipe closed or error
+void YtDlpManager::ResumeStreamJob(const std::shared_ptr<StreamJob> &job,
+                                   const std::shared_ptr<Download> &download) {
+  job->download = download;
+  std::cout << "[YtDlpManager] Resuming " << job->streams.size()
+            << " stream(s) with the download engine: "
+            << download->GetFilename() << std::endl;
+
+  // The pause only told the engine to stop, and it refuses to start a
+  // stream whose thread is still running. The job stays out of the table
+  // until then, so the old threads' last reports are ignored.
+  RunUtilityTask([this, job]() {
+    bool released = true;
+    for (const MediaStream &stream : job->streams) {
+      if (m_shuttingDown.load()) {
+        job->done->set_value();
+        return;
+      }
+      released = m_streamEngine->WaitForDownloadFinish(stream.download->GetId(), 5000) &&
+                 released;
     }
 
-    if (bytesAvailable > 0) {
-      if (ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
-        buffer[bytesRead] = '\0';
-        lineBuffer += buffer;
-        lastActivityTime = GetTickCount(); // Reset timeout on activity
-
-        // Process complete lines
-        size_t newlinePos;
-        while ((newlinePos = lineBuffer.find('\n')) != std::string::npos) {
-          std::string line = lineBuffer.substr(0, newlinePos);
-          lineBuffer = lineBuffer.substr(newlinePos + 1);
-
-          // Remove carriage return if present
-          if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-          }
+    DownloadStatus status = job->download->GetStatus();
+    if (status == DownloadStatus::Paused) {
+      // Paused again meanwhile
+      std::shared_ptr<std::promise<void>> done = std::move(job->done);
+      m_streamJobs.Park(job);
+      done->set_value();
+      return;
+    }
+    if (status != DownloadStatus::Downloading) {
+      StopStreamJob(job, true, false);
+      return;
+    }
+    if (!released) {
+      std::cerr << "[YtDlpManager] Streams of " << job->download->GetFilename()
+                << " did not stop, falling back to yt-dlp" << std::endl;
+      StopStreamJob(job, false, true);
+      return;
+    }
 
-          ParseProgressLine(line, download);
-        }
-      }
-    } else {
-      // No data available, check if process is still running
-      DWORD exitCode;
-      if (GetExitCodeProcess(pi.hProcess, &exitCode) && exitCode != STILL_ACTIVE) {
-        // Process exited, read any remaining data
-        while (PeekNamedPipe(hReadPipe, NULL, 0, NULL, &bytesAvailable, NULL) && bytesAvailable > 0) {
-          if (ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            lineBuffer += buffer;
-          } else {
-            break;
-          }
-        }
-        break;
+    int downloadId = job->download->GetId();
+    m_streamJobs.Add(job);
+    bool pending = false;
+    for (const MediaStream &stream : job->streams) {
+      if (!stream.completed) {
+        pending = true;
+        m_streamEngine->ResumeDownload(stream.download);
       }
-      Sleep(100); // Small delay before next check
     }
+    if (!pending) {
+      MergeStreams(downloadId);  // Paused while merging
+    }
+  });
+}
 
-    // Check if download was cancelled
-    DownloadStatus status = download->GetStatus();
-    if (status == DownloadStatus::Cancelled ||
-        status == DownloadStatus::Paused) {
-      break;
+void YtDlpManager::OnStreamProgress(int streamId, int64_t downloaded,
+                                    int64_t total, double speed) {
+  if (m_shuttingDown.load()) {
+    return;
+  }
+
+  // Report the streams as one download
+  StreamTotals totals;
+  std::shared_ptr<Download> download =
+      m_streamJobs.RecordProgress(streamId, downloaded, total, speed, totals);
+  if (!download) {
+    return;
+  }
+
+  download->SetDownloadedSize(totals.downloaded);
+  download->SetSpeed(totals.speed);
+  if (totals.totalKnown && totals.total > 0) {
+    download->SetTotalSize(totals.total);
+    download->SetProgress(std::min(100.0, totals.downloaded * 100.0 / totals.total));
+  }
+}
+
+void YtDlpManager::OnStreamComplete(int streamId, bool success,
+                                    const std::string &error) {
+  if (m_shuttingDown.load()) {
+    return;
+  }
+
+  bool allCompleted = false;
+  int downloadId = m_streamJobs.RecordCompletion(streamId, success, allCompleted);
+  if (downloadId < 0) {
+    return;  // Paused or cancelled
+  }
+
+  if (!success) {
+    // Expired links, refused ranges and the like: yt-dlp knows the site
+    std::cerr << "[YtDlpManager] Stream " << streamId << " failed (" << error
+              << "), falling back to yt-dlp" << std::endl;
+    if (auto job = m_streamJobs.Detach(downloadId)) {
+      StopStreamJob(job, true, true);
     }
+    return;
+  }
+  if (!allCompleted) {
+    return;
   }
 
-  CloseHandle(hReadPipe);
+  std::shared_ptr<StreamJob> job = m_streamJobs.Find(downloadId);
+  if (!job) {
+    return;
+  }
+  if (job->streams.size() > 1) {
+    MergeStreams(downloadId);
+    return;
+  }
 
-  // Wait for process to exit
-  DWORD exitCode = 0;
-  WaitForSingleObject(pi.hProcess, 5000);
-  GetExitCodeProcess(pi.hProcess, &exitCode);
+  if (m_streamJobs.Detach(downloadId)) {
+    job->download->SetStatus(DownloadStatus::Completed);
+    job->download->SetProgress(100.0);
+    std::cout << "[YtDlpManager] Download completed: " << job->download->GetFilename() << std::endl;
+    job->done->set_value();
+  }
+}
 
-  // Clean up process handle - check if it's still in the map (not killed by user)
-  bool wasKilled = false;
+void YtDlpManager::MergeStreams(int downloadId) {
+  std::shared_ptr<StreamJob> job = m_streamJobs.Find(downloadId);
+  if (!job) {
+    return;
+  }
+  std::vector<std::string> inputs;
+  for (const MediaStream &stream : job->streams) {
+    inputs.push_back(stream.download->GetSavePath() + "\\" +
+                     stream.download->GetFilename());
+  }
+  std::string tempPath;
+  std::string cmd = MergeCommand(inputs, job->outputPath, tempPath);
+  std::cout << "[YtDlpManager] Merging: " << cmd << std::endl;
+
+  // Tracked like a yt-dlp process, so pause and cancel stop the merge
+  auto processId = std::make_shared<int>(-1);
   {
     std::lock_guard<std::mutex> lock(m_processMutex);
-    auto it = m_runningProcesses.find(downloadId);
-    if (it != m_runningProcesses.end()) {
-      // Still in map, we can close it
-      CloseHandle(pi.hProcess);
-      m_runningProcesses.erase(it);
-    } else {
-      // Already removed by KillProcess, don't close again
-      wasKilled = true;
+    *processId = m_runner->Start(
+        cmd, [](std::string_view line) { std::cout << "[ffmpeg] " << line << std::endl; },
+        [this, downloadId, tempPath, processId](int exitCode) {
+          {
+            std::lock_guard<std::mutex> lock(m_processMutex);
+            auto it = m_runningProcesses.find(downloadId);
+            if (it != m_runningProcesses.end() && it->second == *processId) {
+              m_runningProcesses.erase(it);
+            }
+          }
+          std::shared_ptr<StreamJob> job = m_streamJobs.Detach(downloadId);
+          if (!job) {
+            return;  // Paused or cancelled
+          }
+
+          if (exitCode != 0 || m_shuttingDown.load() ||
+              !MoveFileExA(tempPath.c_str(), job->outputPath.c_str(),
+                           MOVEFILE_REPLACE_EXISTING)) {
+            // yt-dlp finds the parts complete and merges them itself
+            std::cerr << "[YtDlpManager] ffmpeg merge failed with exit code "
+                      << exitCode << ", falling back to yt-dlp" << std::endl;
+            DeleteFileA(tempPath.c_str());
+            StopStreamJob(job, false, true);
+            return;
+          }
+
+          for (const MediaStream &stream : job->streams) {
+            DeleteFileA((stream.download->GetSavePath() + "\\" +
+                         stream.download->GetFilename()).c_str());
+          }
+          job->download->SetStatus(DownloadStatus::Completed);
+          job->download->SetProgress(100.0);
+          std::cout << "[YtDlpManager] Download completed: " << job->download->GetFilename() << std::endl;
+          job->done->set_value();
+        });
+
+    if (*processId >= 0) {
+      m_runningProcesses[downloadId] = *processId;
     }
   }
 
-  CloseHandle(pi.hThread);
+  if (*processId < 0) {
+    if (auto detached = m_streamJobs.Detach(downloadId)) {
+      StopStreamJob(detached, false, true);
+    }
+  }
+}
 
-  // Set final status (only if not shutting down)
-  if (!m_shuttingDown.load()) {
-    DownloadStatus currentStatus = download->GetStatus();
-    if (currentStatus != DownloadStatus::Cancelled &&
-        currentStatus != DownloadStatus::Paused) {
-      if (exitCode == 0) {
-        download->SetStatus(DownloadStatus::Completed);
-        download->SetProgress(100.0);
-        std::cout << "[YtDlpManager] Download completed: " << download->GetFilename() << std::endl;
+std::string YtDlpManager::MergeCommand(const std::vector<std::string> &inputs,
+                                       const std::string &outputPath,
+                                       std::string &tempPath) const {
+  std::string ffmpegPath;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ffmpegPath = m_ffmpegPath;
+  }
+
+  // Copy the streams into one container, as yt-dlp's merger does; ffmpeg
+  // picks the muxer from the extension, so the temporary name keeps it
+  size_t dot = outputPath.find_last_of('.');
+  tempPath = outputPath.substr(0, dot) + ".temp" +
+             (dot == std::string::npos ? "" : outputPath.substr(dot));
+  std::string cmd = "\"" + ffmpegPath + "\" -y -nostdin -loglevel error";
+  std::string maps;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    cmd += " -i \"" + inputs[i] + "\"";
+    maps += " -map " + std::to_string(i);
+  }
+  return cmd + maps + " -c copy \"" + tempPath + "\"";
+}
+
+bool YtDlpManager::MergeMediaFiles(const std::vector<std::string> &inputs,
+                                   const std::string &outputPath) {
+  if (!IsFfmpegAvailable() || m_shuttingDown.load()) {
+    return false;
+  }
+  std::string tempPath;
+  std::string cmd = MergeCommand(inputs, outputPath, tempPath);
+  std::cout << "[YtDlpManager] Merging: " << cmd << std::endl;
+
+  // Shutdown() runs the exit callback too, so the wait always ends
+  auto exited = std::make_shared<std::promise<int>>();
+  std::future<int> exitCode = exited->get_future();
+  if (m_runner->Start(
+          cmd, [](std::string_view line) { std::cout << "[ffmpeg] " << line << std::endl; },
+          [exited](int code) { exited->set_value(code); }) < 0) {
+    return false;
+  }
+
+  int code = exitCode.get();
+  if (code != 0 || !MoveFileExA(tempPath.c_str(), outputPath.c_str(),
+                                MOVEFILE_REPLACE_EXISTING)) {
+    std::cerr << "[YtDlpManager] ffmpeg merge failed with exit code " << code
+              << std::endl;
+    DeleteFileA(tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+void YtDlpManager::StopStreamJob(std::shared_ptr<StreamJob> job, bool cancel,
+                                 bool fallBack) {
+  for (const MediaStream &stream : job->streams) {
+    if (!stream.completed) {
+      if (cancel) {
+        m_streamEngine->CancelDownload(stream.download);
       } else {
-        download->SetStatus(DownloadStatus::Error);
-        // Keep existing error message if one was set during parsing, otherwise use generic
-        std::string existingError = download->GetErrorMessage();
-        if (existingError.empty() || existingError.find("yt-dlp exited") != std::string::npos) {
-          download->SetErrorMessage("yt-dlp exited with code " + std::to_string(exitCode) +
-                                    ". Try running yt-dlp manually to see the error.");
+        m_streamEngine->PauseDownload(stream.download);
+      }
+    }
+  }
+
+  // The engine's threads notice shortly; wait for them to release the
+  // files off the caller's thread, then hand over or settle. A paused job
+  // is kept without its promise, which this settles.
+  std::shared_ptr<std::promise<void>> done = std::move(job->done);
+  RunUtilityTask([this, job, done, cancel, fallBack]() {
+    for (const MediaStream &stream : job->streams) {
+      if (m_shuttingDown.load()) {
+        break;
+      }
+      m_streamEngine->WaitForDownloadFinish(stream.download->GetId(), 5000);
+    }
+    if ((cancel || fallBack) && !m_shuttingDown.load()) {
+      for (const MediaStream &stream : job->streams) {
+        if (!stream.completed) {
+          DiscardStreamData(*stream.download, fallBack);
         }
-        std::cerr << "[YtDlpManager] Download failed with exit code: " << exitCode << std::endl;
-        std::cerr << "[YtDlpManager] Error message: " << download->GetErrorMessage() << std::endl;
-        std::cerr << "[YtDlpManager] URL: " << download->GetUrl() << std::endl;
       }
     }
+    if (fallBack && done && !m_shuttingDown.load() &&
+        job->download->GetStatus() == DownloadStatus::Downloading) {
+      PerformDownload(job->download, job->selectedFormat, done);
+    } else if (done) {
+      done->set_value();
+    }
+  });
+}
+
+void YtDlpManager::RunUtilityTask(std::function<void()> task) {
+  std::lock_guard<std::mutex> lock(m_utilityTasksMutex);
+  m_utilityTasks.erase(
+      std::remove_if(m_utilityTasks.begin(), m_utilityTasks.end(),
+                     [](std::future<void> &pending) {
+                       return pending.valid() &&
+                              pending.wait_for(std::chrono::seconds(0)) ==
+                                  std::future_status::ready;
+                     }),
+      m_utilityTasks.end());
+  m_utilityTasks.push_back(std::async(std::launch::async, std::move(task)));
+}
+
+void YtDlpManager::ApplySettings(const Settings &settings) {
+  // Same limits as the main engine. The speed limit is not set here: both
+  // engines draw from the one SpeedLimiter the download manager sets
+  m_streamEngine->SetMaxConnections(std::max(1, settings.GetMaxConnections()));
+
+  if (settings.GetUseProxy()) {
+    m_streamEngine->SetProxy(settings.GetProxyHost(), settings.GetProxyPort());
+  } else {
+    m_streamEngine->SetProxy("", 0);
   }
 }
 
-void YtDlpManager::ParseProgressLine(const std::string &line, std::shared_ptr<Download> download) {
+void YtDlpManager::ParseProgressLine(std::string_view line, const std::shared_ptr<Download> &download) {
   if (!download || line.empty()) return;
 
-  // Log ALL output from yt-dlp for debugging
+  // Progress from YtDlpProgress::TEMPLATE arrives several times a second, so it
+  // is scanned first and not logged
+  if (YtDlpProgress::IsTemplateLine(line)) {
+    ProgressFields fields;
+    if (YtDlpProgress::ParseTemplate(line, fields)) {
+      ApplyProgress(*download, fields);
+    }
+    return;
+  }
+
+  // Log ALL other output from yt-dlp for debugging
   std::cout << "[yt-dlp] " << line << std::endl;
 
-  // yt-dlp progress format examples:
+  // Human-readable yt-dlp format examples (progress here is the fallback
+  // for builds that ignore the template):
   // [download]   5.2% of   50.23MiB at    2.50MiB/s ETA 00:19
   // [download]  45.3% of  150.23MiB at   10.50MiB/s ETA 00:09
   // [download] Destination: C:\path\to\Video Title.mp4
@@ -1203,11 +1826,11 @@ void YtDlpManager::ParseProgressLine(const std::string &line, std::shared_ptr<Do
   // [Merger] Merging formats into "C:\path\to\Video Title.mp4"
 
   // Handle merger output (final filename after merging)
-  if (line.find("[Merger]") != std::string::npos && line.find("Merging formats into") != std::string::npos) {
+  if (line.find("[Merger]") != std::string_view::npos && line.find("Merging formats into") != std::string_view::npos) {
     size_t quoteStart = line.find('"');
     size_t quoteEnd = line.rfind('"');
-    if (quoteStart != std::string::npos && quoteEnd != std::string::npos && quoteEnd > quoteStart) {
-      std::string fullPath = line.substr(quoteStart + 1, quoteEnd - quoteStart - 1);
+    if (quoteStart != std::string_view::npos && quoteEnd != std::string_view::npos && quoteEnd > quoteStart) {
+      std::string fullPath(line.substr(quoteStart + 1, quoteEnd - quoteStart - 1));
 
       // Extract directory and filename
       size_t lastSlash = fullPath.find_last_of("\\/");
@@ -1223,12 +1846,12 @@ void YtDlpManager::ParseProgressLine(const std::string &line, std::shared_ptr<Do
     return;
   }
 
-  if (line.find("[download]") != std::string::npos) {
+  if (line.find("[download]") != std::string_view::npos) {
     // Extract filename from Destination line
-    if (line.find("Destination:") != std::string::npos) {
+    if (line.find("Destination:") != std::string_view::npos) {
       size_t pos = line.find("Destination:");
-      if (pos != std::string::npos) {
-        std::string fullPath = line.substr(pos + 12);
+      if (pos != std::string_view::npos) {
+        std::string fullPath(line.substr(pos + 12));
         // Trim whitespace
         size_t start = fullPath.find_first_not_of(" \t");
         size_t end = fullPath.find_last_not_of(" \t");
@@ -1250,46 +1873,17 @@ void YtDlpManager::ParseProgressLine(const std::string &line, std::shared_ptr<Do
       return;
     }
 
-    // Extract progress percentage
-    std::regex progressRegex(R"(\s*(\d+\.?\d*)%\s+of\s+~?(\d+\.?\d*)(Ki|Mi|Gi)?B)");
-    std::smatch match;
-    if (std::regex_search(line, match, progressRegex)) {
-      double progress = std::stod(match[1].str());
-      download->SetProgress(progress);
-
-      // Extract total size
-      double size = std::stod(match[2].str());
-      std::string unit = match[3].str();
-      if (unit == "Ki") size *= 1024;
-      else if (unit == "Mi") size *= 1024 * 1024;
-      else if (unit == "Gi") size *= 1024 * 1024 * 1024;
-
-      if (download->GetTotalSize() <= 0) {
-        download->SetTotalSize(static_cast<int64_t>(size));
-      }
-
-      // Calculate downloaded size from percentage
-      int64_t downloaded = static_cast<int64_t>(size * progress / 100.0);
-      download->SetDownloadedSize(downloaded);
-    }
-
-    // Extract speed
-    std::regex speedRegex(R"(at\s+(\d+\.?\d*)(Ki|Mi|Gi)?B/s)");
-    if (std::regex_search(line, match, speedRegex)) {
-      double speed = std::stod(match[1].str());
-      std::string unit = match[2].str();
-      if (unit == "Ki") speed *= 1024;
-      else if (unit == "Mi") speed *= 1024 * 1024;
-      else if (unit == "Gi") speed *= 1024 * 1024 * 1024;
-
-      download->SetSpeed(speed);
+    // Extract progress percentage, total size and speed
+    ProgressFields fields;
+    if (YtDlpProgress::ParseLegacy(line, fields)) {
+      ApplyProgress(*download, fields);
     }
   }
 
   // Handle errors
-  if (line.find("ERROR:") != std::string::npos) {
+  if (line.find("ERROR:") != std::string_view::npos) {
     size_t errorPos = line.find("ERROR:") + 6;
-    std::string error = line.substr(errorPos);
+    std::string error(line.substr(errorPos));
     // Trim leading whitespace
     size_t start = error.find_first_not_of(" \t");
     if (start != std::string::npos) {
@@ -1300,12 +1894,12 @@ void YtDlpManager::ParseProgressLine(const std::string &line, std::shared_ptr<Do
   }
 
   // Handle warnings
-  if (line.find("WARNING:") != std::string::npos) {
+  if (line.find("WARNING:") != std::string_view::npos) {
     std::cerr << "[YtDlpManager] " << line << std::endl;
   }
 
   // Handle video info
-  if (line.find("[info]") != std::string::npos) {
+  if (line.find("[info]") != std::string_view::npos) {
     std::cout << "[YtDlpManager] " << line << std::endl;
   }
 
@@ -1317,17 +1911,29 @@ void YtDlpManager::ParseProgressLine(const std::string &line, std::shared_ptr<Do
 
 void YtDlpManager::PauseDownload(int downloadId) {
   KillProcess(downloadId);
+  // The job is kept, its streams' chunks with it, for the resume
+  if (auto job = m_streamJobs.Detach(downloadId)) {
+    StopStreamJob(job, false, false);
+    m_streamJobs.Park(job);
+  }
 }
 
 void YtDlpManager::ResumeDownload(std::shared_ptr<Download> download) {
   if (!download) return;
 
-  // yt-dlp with -c flag will automatically resume
+  // Engine streams continue from their chunks; yt-dlp with -c resumes its
+  // own files
   StartDownload(download);
 }
 
 void YtDlpManager::CancelDownload(int downloadId) {
   KillProcess(downloadId);
+  if (auto job = m_streamJobs.Detach(downloadId)) {
+    StopStreamJob(job, true, false);
+  }
+  if (auto job = m_streamJobs.TakeParked(downloadId)) {
+    StopStreamJob(job, true, false);
+  }
 }
 
 bool YtDlpManager::WaitForDownloadFinish(int downloadId, int timeoutMs) {
@@ -1348,9 +1954,8 @@ bool YtDlpManager::WaitForDownloadFinish(int downloadId, int timeoutMs) {
 void YtDlpManager::KillProcess(int downloadId) {
   std::lock_guard<std::mutex> lock(m_processMutex);
   auto it = m_runningProcesses.find(downloadId);
-  if (it != m_runningProcesses.end() && it->second) {
-    TerminateProcess(it->second, 1);
-    CloseHandle(it->second);
+  if (it != m_runningProcesses.end()) {
+    m_runner->Kill(it->second);
     m_runningProcesses.erase(it);
   }
 }
@@ -1,16 +1,25 @@
 #pragma once
 
 #include "Download.h"
+#include "StreamJobTable.h"
+#include "../utils/ProcessRunner.h"
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <future>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+class DownloadEngine;
+class JsonValue;
+class Settings;
+
 // Video format info from yt-dlp
 struct VideoFormat {
   std::string formatId;      // e.g., "137", "best"
@@ -23,6 +32,12 @@ struct VideoFormat {
   bool hasAudio;
 };
 
+// Title and formats of one URL, from a single `yt-dlp -J`
+struct VideoInfo {
+  std::string title;
+  std::vector<VideoFormat> formats;  // As yt-dlp lists them, without presets
+};
+
 // Manages yt-dlp integration for video site downloads
 class YtDlpManager {
 public:
@@ -45,11 +60,18 @@ public:
   // Check if URL is a video site that needs yt-dlp
   bool IsVideoSiteUrl(const std::string &url) const;
 
+  // Title and formats of a URL (blocking call). Answered from a cache kept
+  // across restarts, or by joining a fetch already running for the URL.
+  bool GetVideoInfo(const std::string &url, VideoInfo &info);
+
+  // Fetch a URL's info into the cache in the background
+  void PrefetchVideoInfo(const std::string &url);
+
   // Get available formats for a URL (blocking call)
-  std::vector<VideoFormat> GetAvailableFormats(const std::string &url) const;
+  std::vector<VideoFormat> GetAvailableFormats(const std::string &url);
 
   // Get video title for a URL (blocking call)
-  std::string GetVideoTitle(const std::string &url) const;
+  std::string GetVideoTitle(const std::string &url);
 
   // Start a video download using yt-dlp
   bool StartDownload(std::shared_ptr<Download> download);
@@ -91,15 +113,56 @@ public:
   // Download Deno (async) - required for YouTube
   void DownloadDeno(std::function<void(bool success, const std::string &error)> callback);
 
+  // Connection, speed and proxy settings for the engine that fetches
+  // resolved media streams
+  void ApplySettings(const Settings &settings);
+
+  // Copy separately downloaded streams into one container with ffmpeg.
+  // Blocks until ffmpeg exits; false if it is missing or the merge fails.
+  bool MergeMediaFiles(const std::vector<std::string> &inputs,
+                       const std::string &outputPath);
+
 private:
   YtDlpManager();
   ~YtDlpManager();
 
-  // Internal download function (runs in thread)
-  void PerformDownload(std::shared_ptr<Download> download);
+  // Launch yt-dlp for a download. Its output and exit arrive on the process
+  // runner's I/O thread; 'done' is fulfilled once the download has settled.
+  void PerformDownload(std::shared_ptr<Download> download,
+                       const std::string &selectedFormat,
+                       std::shared_ptr<std::promise<void>> done);
+
+  // Ask yt-dlp (-J) where the selected format's streams live. Plain HTTP(S)
+  // streams are fetched by the stream engine with its segmentation, speed
+  // limit and resume, then merged by ffmpeg; anything else (HLS, DASH
+  // fragments, cookies, no ffmpeg for a merge) goes to PerformDownload.
+  void ResolveAndFetch(std::shared_ptr<Download> download,
+                       const std::string &selectedFormat,
+                       std::shared_ptr<std::promise<void>> done);
+  // Start the stream engine on a -J document; false if it cannot take it
+  bool StartStreamJob(const std::shared_ptr<Download> &download,
+                      const std::string &selectedFormat,
+                      const std::shared_ptr<std::promise<void>> &done,
+                      const JsonValue &root);
+  // Restart a paused job's unfinished streams, which continue from their
+  // chunks once the engine has let go of them
+  void ResumeStreamJob(const std::shared_ptr<StreamJob> &job,
+                       const std::shared_ptr<Download> &download);
+  void OnStreamProgress(int streamId, int64_t downloaded, int64_t total,
+                        double speed);
+  void OnStreamComplete(int streamId, bool success, const std::string &error);
+  void MergeStreams(int downloadId);
+  // ffmpeg command line that muxes 'inputs' into tempPath, a sibling of
+  // outputPath to be moved over it once ffmpeg succeeds
+  std::string MergeCommand(const std::vector<std::string> &inputs,
+                           const std::string &outputPath,
+                           std::string &tempPath) const;
+
+  // Set the final status once yt-dlp has exited
+  void OnProcessExit(const std::shared_ptr<Download> &download, int exitCode);
 
   // Parse yt-dlp progress output
-  void ParseProgressLine(const std::string &line, std::shared_ptr<Download> download);
+  void ParseProgressLine(std::string_view line, const std::shared_ptr<Download> &download);
 
   // Kill yt-dlp process for a download
   void KillProcess(int downloadId);
@@ -107,6 +170,20 @@ private:
   // Clean up completed download tasks
   void CleanupCompletedTasks();
 
+  // Command-line pieces shared by -J lookups and downloads
+  std::string DenoOption(const std::string &url) const;
+  std::string FormatOptions(const std::string &selectedFormat) const;
+  // Where a download's files go; created if missing
+  std::string OutputDirectory(const Download &download) const;
+
+  // Video info cache helpers
+  bool FetchVideoInfo(const std::string &url, VideoInfo &info);  // Runs yt-dlp -J
+  // Caller holds m_infoMutex; a fresh hit moves to the front. 'info' may be null.
+  bool LookupVideoInfo(const std::string &url, VideoInfo *info);
+  void LoadVideoInfoCache();
+  void SaveVideoInfoCache();
+  void PrefetchWorker();
+
   // Supported video sites (partial list - yt-dlp supports 1400+)
   static const std::unordered_set<std::string> VIDEO_SITE_PATTERNS;
 
@@ -116,19 +193,48 @@ private:
   std::string m_outputDir;
   mutable std::mutex m_mutex;
 
-  // Track running yt-dlp processes (downloadId -> process handle)
-  std::unordered_map<int, void*> m_runningProcesses;
+  // Every yt-dlp child shares the runner's single I/O thread
+  std::unique_ptr<ProcessRunner> m_runner;
+
+  // Track running yt-dlp processes (downloadId -> runner process id)
+  std::unordered_map<int, int> m_runningProcesses;
   std::mutex m_processMutex;
 
-  // Download tasks using std::future for proper lifecycle management
+  // Completion of each download, fulfilled by its exit callback
   std::unordered_map<int, std::future<void>> m_downloadTasks;
   std::mutex m_tasksMutex;
 
-  // Format selection per download (downloadId -> formatId)
-  std::unordered_map<int, std::string> m_downloadFormats;
-  std::mutex m_formatsMutex;
-
-  // Utility threads (download yt-dlp, ffmpeg, deno)
+  // Pause, cancel or hand over a detached job's streams: the engine's
+  // threads are stopped and waited for off the caller's thread. A fallback
+  // then runs yt-dlp; a cancel deletes the streams' partial data.
+  void StopStreamJob(std::shared_ptr<StreamJob> job, bool cancel,
+                     bool fallBack);
+  // Run 'task' on a utility thread, dropping finished ones
+  void RunUtilityTask(std::function<void()> task);
+
+  std::unique_ptr<DownloadEngine> m_streamEngine;
+  StreamJobTable m_streamJobs;  // Running and paused, by download id
+  std::atomic<int> m_nextStreamId{1};
+
+  // Video info by URL, most recently used first; entries expire after the TTL
+  struct CachedVideoInfo {
+    std::string url;
+    VideoInfo info;
+    int64_t fetchedAt;  // Unix time
+  };
+  static constexpr size_t VIDEO_INFO_CACHE_SIZE = 64;
+  static constexpr int64_t VIDEO_INFO_TTL_SECONDS = 6 * 60 * 60;
+  std::list<CachedVideoInfo> m_infoCache;
+  std::unordered_map<std::string, std::list<CachedVideoInfo>::iterator> m_infoIndex;
+  std::unordered_map<std::string, std::shared_future<bool>> m_infoInFlight;
+  std::deque<std::string> m_prefetchQueue;
+  int m_prefetchWorkers = 0;
+  static constexpr int MAX_PREFETCH_WORKERS = 2;
+  std::mutex m_infoMutex;
+  std::string m_infoCachePath;
+  std::mutex m_infoFileMutex;  // Serialises cache file writes
+
+  // Utility threads (download yt-dlp, ffmpeg, deno, info prefetch)
   std::vector<std::future<void>> m_utilityTasks;
   std::mutex m_utilityTasksMutex;
 
@@ -1,11 +1,83 @@
 #include "DatabaseManager.h"
 #include <ShlObj.h>
 #include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <wx/filename.h>
+#include <wx/log.h>
+#include <wx/mstream.h>
 #include <wx/stdpaths.h>
 
 
+namespace {
+// How long changes may sit in memory before the writer logs them
+constexpr int GROUP_COMMIT_INTERVAL_MS = 1000;
+// Compact once the journal holds more records than this, or more than
+// COMPACT_RECORDS_PER_DOWNLOAD per stored download, whichever is larger
+constexpr size_t COMPACT_MIN_RECORDS = 1000;
+constexpr size_t COMPACT_RECORDS_PER_DOWNLOAD = 4;
+
+// Safe parsing helpers to avoid crashes on corrupted XML
+int SafeStoi(const std::string &s, int defaultVal = 0) {
+  try {
+    return std::stoi(s);
+  } catch (...) {
+    return defaultVal;
+  }
+}
+
+int64_t SafeStoll(const std::string &s, int64_t defaultVal = 0) {
+  try {
+    return std::stoll(s);
+  } catch (...) {
+    return defaultVal;
+  }
+}
+
+void AppendEscaped(std::string &out, const std::string &value) {
+  for (char c : value) {
+    switch (c) {
+    case '&': out += "&amp;"; break;
+    case '<': out += "&lt;"; break;
+    case '>': out += "&gt;"; break;
+    case '"': out += "&quot;"; break;
+    case '\n': out += "&#10;"; break;
+    case '\r': out += "&#13;"; break;
+    case '\t': out += "&#9;"; break;
+    default: out += c; break;
+    }
+  }
+}
+
+// Serialise an element tree as XML on a single line (one journal record)
+void AppendNodeInline(std::string &out, const wxXmlNode *node) {
+  out += '<';
+  out += node->GetName().utf8_string();
+  for (const wxXmlAttribute *attr = node->GetAttributes(); attr;
+       attr = attr->GetNext()) {
+    out += ' ';
+    out += attr->GetName().utf8_string();
+    out += "=\"";
+    AppendEscaped(out, attr->GetValue().utf8_string());
+    out += '"';
+  }
+
+  const wxXmlNode *child = node->GetChildren();
+  if (!child) {
+    out += "/>";
+    return;
+  }
+  out += '>';
+  for (; child; child = child->GetNext()) {
+    AppendNodeInline(out, child);
+  }
+  out += "</";
+  out += node->GetName().utf8_string();
+  out += '>';
+}
+} // namespace
+
 DatabaseManager &DatabaseManager::GetInstance() {
   static DatabaseManager instance;
   return instance;
@@ -31,29 +103,245 @@ bool DatabaseManager::Initialize(const std::string &dbPath) {
   } else {
     m_dbPath = dbPath;
   }
+  m_journalPath = m_dbPath + ".journal";
 
   if (!LoadDatabase()) {
     CreateDefaultCategories();
-    SaveDatabase();
+    m_journalEpoch = 0;
+    SaveDatabase(*BuildSnapshot(m_journalEpoch));
+    ResetJournal();
+  } else if (!ReplayJournal()) {
+    ResetJournal();
+  }
+
+  if (!m_writerThread.joinable()) {
+    m_stopWriter = false;
+    m_writerThread = std::thread(&DatabaseManager::WriterLoop, this);
   }
 
   return true;
 }
 
-void DatabaseManager::Close() { 
-  std::lock_guard<std::mutex> lock(m_mutex);
-  if (m_dirty) {
-    SaveDatabase();
-    m_dirty = false;
+void DatabaseManager::Close() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopWriter = true;
   }
+  m_writerCv.notify_all();
+  if (m_writerThread.joinable()) {
+    m_writerThread.join();
+  }
+  Commit();
 }
 
-void DatabaseManager::Flush() {
-  std::lock_guard<std::mutex> lock(m_mutex);
-  if (m_dirty) {
-    SaveDatabase();
-    m_dirty = false;
+void DatabaseManager::Flush() { Commit(); }
+
+void DatabaseManager::WriterLoop() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopWriter) {
+    m_writerCv.wait_for(lock,
+                        std::chrono::milliseconds(GROUP_COMMIT_INTERVAL_MS),
+                        [this]() { return m_stopWriter; });
+    if (m_stopWriter) {
+      break;
+    }
+    lock.unlock();
+    Commit();
+    lock.lock();
+  }
+}
+
+bool DatabaseManager::Commit() {
+  std::lock_guard<std::mutex> ioLock(m_ioMutex);
+
+  std::unique_ptr<wxXmlDocument> snapshot;
+  std::string batch;
+  size_t records = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_dbPath.empty()) {
+      return false;
+    }
+
+    size_t compactAt = std::max(COMPACT_MIN_RECORDS,
+                                COMPACT_RECORDS_PER_DOWNLOAD *
+                                    GetRecordCount());
+    if (m_dirty || m_journalRecords + m_pendingIds.size() > compactAt) {
+      // Capture the whole state; anything changed after this point is
+      // logged to the new journal once the snapshot is on disk
+      snapshot = BuildSnapshot(m_journalEpoch + 1);
+      m_pendingIds.clear();
+      m_dirty = false;
+    } else {
+      if (m_pendingIds.empty()) {
+        return true;
+      }
+      DownloadRecord record;
+      for (int id : m_pendingIds) {
+        if (GetRecord(id, record)) {
+          std::unique_ptr<wxXmlNode> node(CreateDownloadNode(record));
+          AppendNodeInline(batch, node.get());
+        } else {
+          batch += "<Delete id=\"" + std::to_string(id) + "\"/>";
+        }
+        batch += '\n';
+        ++records;
+      }
+      m_pendingIds.clear();
+    }
+  }
+
+  if (snapshot) {
+    if (!SaveDatabase(*snapshot)) {
+      std::cerr << "[Database] Failed to write snapshot " << m_dbPath
+                << std::endl;
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_dirty = true;
+      return false;
+    }
+    m_journalEpoch++;
+    m_journalRecords = 0;
+    return ResetJournal();
+  }
+
+  if (!AppendToJournal(batch)) {
+    // The records are not durable; fall back to a full snapshot next time
+    std::cerr << "[Database] Failed to append to journal " << m_journalPath
+              << std::endl;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirty = true;
+    return false;
+  }
+  m_journalRecords += records;
+  return true;
+}
+
+bool DatabaseManager::AppendToJournal(const std::string &records) {
+  HANDLE file = CreateFileA(m_journalPath.c_str(), FILE_APPEND_DATA,
+                            FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
   }
+
+  // One write and one flush per batch, however many records it carries
+  DWORD written = 0;
+  bool ok = WriteFile(file, records.data(), static_cast<DWORD>(records.size()),
+                      &written, NULL) &&
+            written == records.size() && FlushFileBuffers(file);
+  CloseHandle(file);
+  return ok;
+}
+
+bool DatabaseManager::ResetJournal() {
+  HANDLE file = CreateFileA(m_journalPath.c_str(), GENERIC_WRITE,
+                            FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::cerr << "[Database] Failed to create journal " << m_journalPath
+              << std::endl;
+    return false;
+  }
+
+  std::string header =
+      "<Journal epoch=\"" + std::to_string(m_journalEpoch) + "\"/>\n";
+  DWORD written = 0;
+  bool ok = WriteFile(file, header.data(), static_cast<DWORD>(header.size()),
+                      &written, NULL) &&
+            FlushFileBuffers(file);
+  CloseHandle(file);
+  return ok;
+}
+
+bool DatabaseManager::ReplayJournal() {
+  std::ifstream journal(m_journalPath, std::ios::binary);
+  if (!journal) {
+    return false;
+  }
+
+  wxLogNull noLog;  // A torn final record is expected after a crash
+  std::string line;
+  bool headerSeen = false;
+  size_t replayed = 0;
+  int64_t tornAt = -1;         // Start of an unreadable final line
+  bool unterminated = false;  // Final line readable but missing its newline
+  while (true) {
+    int64_t lineStart = static_cast<int64_t>(journal.tellg());
+    if (!std::getline(journal, line)) {
+      break;
+    }
+    // getline only reaches EOF on a line the writer never finished
+    bool lastLine = journal.eof();
+    if (line.empty()) {
+      continue;
+    }
+
+    wxMemoryInputStream stream(line.data(), line.size());
+    wxXmlDocument doc;
+    if (!doc.Load(stream) || !doc.GetRoot()) {
+      if (!headerSeen) {
+        return false;
+      }
+      if (lastLine) {
+        tornAt = lineStart;  // Interrupted append: cut it off below
+        break;
+      }
+      // Damaged in the middle; the records after it are still good
+      std::cerr << "[Database] Skipping unreadable journal record at byte "
+                << lineStart << std::endl;
+      continue;
+    }
+    unterminated = lastLine;
+    const wxXmlNode *record = doc.GetRoot();
+
+    if (!headerSeen) {
+      if (record->GetName() != "Journal" ||
+          SafeStoll(record->GetAttribute("epoch", "-1").ToStdString(), -1) !=
+              static_cast<int64_t>(m_journalEpoch)) {
+        return false;  // Belongs to another snapshot
+      }
+      headerSeen = true;
+      continue;
+    }
+
+    if (record->GetName() == "Download") {
+      PutRecord(ParseDownloadNode(record));
+    } else if (record->GetName() == "Delete") {
+      EraseRecord(SafeStoi(record->GetAttribute("id", "0").ToStdString()));
+    }
+    ++replayed;
+  }
+  journal.close();
+
+  // Later appends must start on a line of their own
+  if (tornAt >= 0) {
+    std::cerr << "[Database] Dropping torn journal record at byte " << tornAt
+              << std::endl;
+    if (!TruncateJournal(tornAt)) {
+      MarkDirty();  // Could not repair; the next commit rewrites everything
+    }
+  } else if (unterminated && !AppendToJournal("\n")) {
+    MarkDirty();
+  }
+
+  m_journalRecords = replayed;
+  return headerSeen;
+}
+
+bool DatabaseManager::TruncateJournal(int64_t size) {
+  HANDLE file = CreateFileA(m_journalPath.c_str(), GENERIC_WRITE,
+                            FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER offset;
+  offset.QuadPart = size;
+  bool ok = SetFilePointerEx(file, offset, NULL, FILE_BEGIN) &&
+            SetEndOfFile(file) && FlushFileBuffers(file);
+  CloseHandle(file);
+  return ok;
 }
 
 bool DatabaseManager::LoadDatabase() {
@@ -62,6 +350,7 @@ bool DatabaseManager::LoadDatabase() {
     return false;
 
   m_data.downloads.clear();
+  m_data.history.Clear();
   m_data.categories.clear();
   m_data.settings.clear();
 
@@ -69,21 +358,8 @@ bool DatabaseManager::LoadDatabase() {
   if (!root || root->GetName() != "LDM")
     return false;
 
-  // Safe parsing helpers to avoid crashes on corrupted XML
-  auto safeStoi = [](const std::string &s, int defaultVal = 0) -> int {
-    try {
-      return std::stoi(s);
-    } catch (...) {
-      return defaultVal;
-    }
-  };
-  auto safeStoll = [](const std::string &s, int64_t defaultVal = 0) -> int64_t {
-    try {
-      return std::stoll(s);
-    } catch (...) {
-      return defaultVal;
-    }
-  };
+  m_journalEpoch = static_cast<uint64_t>(
+      SafeStoll(root->GetAttribute("journal_epoch", "0").ToStdString()));
 
   wxXmlNode *child = root->GetChildren();
   while (child) {
@@ -91,80 +367,7 @@ bool DatabaseManager::LoadDatabase() {
       wxXmlNode *downloadNode = child->GetChildren();
       while (downloadNode) {
         if (downloadNode->GetName() == "Download") {
-          int id =
-              safeStoi(downloadNode->GetAttribute("id", "0").ToStdString());
-          std::string url = downloadNode->GetAttribute("url", "").ToStdString();
-          std::string savePath =
-              downloadNode->GetAttribute("save_path", "").ToStdString();
-
-          auto download = std::make_shared<Download>(id, url, savePath);
-          download->SetFilename(
-              downloadNode->GetAttribute("filename", "").ToStdString());
-          download->SetTotalSize(safeStoll(
-              downloadNode->GetAttribute("total_size", "0").ToStdString()));
-          download->SetDownloadedSize(
-              safeStoll(downloadNode->GetAttribute("downloaded_size", "0")
-                             .ToStdString()));
-          download->SetCategory(
-              downloadNode->GetAttribute("category", "").ToStdString());
-          download->SetDescription(
-              downloadNode->GetAttribute("description", "").ToStdString());
-          download->SetReferer(
-              downloadNode->GetAttribute("referer", "").ToStdString());
-
-          std::string statusStr =
-              downloadNode->GetAttribute("status", "Queued").ToStdString();
-          if (statusStr == "Completed")
-            download->SetStatus(DownloadStatus::Completed);
-          else if (statusStr == "Paused")
-            download->SetStatus(DownloadStatus::Paused);
-          else if (statusStr == "Error")
-            download->SetStatus(DownloadStatus::Error);
-          else if (statusStr == "Cancelled")
-            download->SetStatus(DownloadStatus::Cancelled);
-          else if (statusStr == "Downloading")
-            // App likely crashed mid-download - set to Paused for explicit resume
-            download->SetStatus(DownloadStatus::Paused);
-          else
-            download->SetStatus(DownloadStatus::Queued);
-
-          download->SetErrorMessage(
-              downloadNode->GetAttribute("error_message", "").ToStdString());
-
-          // Load yt-dlp flag
-          std::string isYtDlp =
-              downloadNode->GetAttribute("is_ytdlp", "0").ToStdString();
-          download->SetYtDlpDownload(isYtDlp == "1");
-
-          // Load chunk metadata if present
-          std::vector<DownloadChunk> chunks;
-          wxXmlNode *downloadChild = downloadNode->GetChildren();
-          while (downloadChild) {
-            if (downloadChild->GetName() == "Chunks") {
-              wxXmlNode *chunkNode = downloadChild->GetChildren();
-              while (chunkNode) {
-                if (chunkNode->GetName() == "Chunk") {
-                  int64_t start = safeStoll(
-                      chunkNode->GetAttribute("start", "0").ToStdString());
-                  int64_t end = safeStoll(
-                      chunkNode->GetAttribute("end", "0").ToStdString());
-                  DownloadChunk chunk(start, end);
-                  chunk.currentByte = safeStoll(
-                      chunkNode->GetAttribute("current", "0").ToStdString());
-                  chunk.completed =
-                      chunkNode->GetAttribute("completed", "0") == "1";
-                  chunks.push_back(chunk);
-                }
-                chunkNode = chunkNode->GetNext();
-              }
-            }
-            downloadChild = downloadChild->GetNext();
-          }
-          if (!chunks.empty()) {
-            download->SetChunks(chunks);
-          }
-
-          m_data.downloads.push_back(download);
+          PutRecord(ParseDownloadNode(downloadNode));
         }
         downloadNode = downloadNode->GetNext();
       }
@@ -181,55 +384,161 @@ bool DatabaseManager::LoadDatabase() {
       wxXmlNode *setNode = child->GetChildren();
       while (setNode) {
         if (setNode->GetName() == "Setting") {
-          m_data.settings.push_back(
-              {setNode->GetAttribute("key", "").ToStdString(),
-               setNode->GetAttribute("value", "").ToStdString()});
+          m_data.settings[setNode->GetAttribute("key", "").ToStdString()] =
+              setNode->GetAttribute("value", "").ToStdString();
         }
         setNode = setNode->GetNext();
       }
     }
     child = child->GetNext();
   }
+  m_settingsVersion++;
   return true;
 }
 
-bool DatabaseManager::SaveDatabase() {
-  wxXmlDocument doc;
+void DatabaseManager::PutRecord(DownloadRecord record) {
+  int id = record.id;
+  if (record.status == DownloadStatus::Completed) {
+    m_data.downloads.erase(id);
+    m_data.history.Put(record);
+  } else {
+    m_data.history.Erase(id);
+    m_data.downloads[id] = std::move(record);
+  }
+}
+
+bool DatabaseManager::GetRecord(int downloadId, DownloadRecord &record) const {
+  auto it = m_data.downloads.find(downloadId);
+  if (it != m_data.downloads.end()) {
+    record = it->second;
+    return true;
+  }
+  return m_data.history.Get(downloadId, record);
+}
+
+bool DatabaseManager::EraseRecord(int downloadId) {
+  bool erased = m_data.downloads.erase(downloadId) > 0;
+  return m_data.history.Erase(downloadId) || erased;
+}
+
+DownloadRecord DatabaseManager::ParseDownloadNode(const wxXmlNode *downloadNode) {
+  DownloadRecord record;
+  record.id = SafeStoi(downloadNode->GetAttribute("id", "0").ToStdString());
+  record.url = downloadNode->GetAttribute("url", "").ToStdString();
+  record.savePath = downloadNode->GetAttribute("save_path", "").ToStdString();
+  record.filename = downloadNode->GetAttribute("filename", "").ToStdString();
+  record.totalSize =
+      SafeStoll(downloadNode->GetAttribute("total_size", "0").ToStdString());
+  record.downloadedSize = SafeStoll(
+      downloadNode->GetAttribute("downloaded_size", "0").ToStdString());
+  record.category = downloadNode->GetAttribute("category", "").ToStdString();
+  record.description =
+      downloadNode->GetAttribute("description", "").ToStdString();
+  record.referer = downloadNode->GetAttribute("referer", "").ToStdString();
+  record.etag = downloadNode->GetAttribute("etag", "").ToStdString();
+  record.lastModified =
+      downloadNode->GetAttribute("last_modified", "").ToStdString();
+  record.priority = static_cast<DownloadPriority>(std::clamp(
+      SafeStoi(downloadNode->GetAttribute("priority", "1").ToStdString(), 1),
+      0, 2));
+
+  std::string statusStr =
+      downloadNode->GetAttribute("status", "Queued").ToStdString();
+  if (statusStr == "Completed")
+    record.status = DownloadStatus::Completed;
+  else if (statusStr == "Paused")
+    record.status = DownloadStatus::Paused;
+  else if (statusStr == "Error")
+    record.status = DownloadStatus::Error;
+  else if (statusStr == "Cancelled")
+    record.status = DownloadStatus::Cancelled;
+  else if (statusStr == "Downloading")
+    // App likely crashed mid-download - set to Paused for explicit resume
+    record.status = DownloadStatus::Paused;
+  else
+    record.status = DownloadStatus::Queued;
+
+  record.errorMessage =
+      downloadNode->GetAttribute("error_message", "").ToStdString();
+
+  // Load yt-dlp flag
+  record.isYtDlp = downloadNode->GetAttribute("is_ytdlp", "0") == "1";
+
+  // Load chunk metadata if present
+  wxXmlNode *downloadChild = downloadNode->GetChildren();
+  while (downloadChild) {
+    if (downloadChild->GetName() == "Chunks") {
+      wxXmlNode *chunkNode = downloadChild->GetChildren();
+      while (chunkNode) {
+        if (chunkNode->GetName() == "Chunk") {
+          int64_t start =
+              SafeStoll(chunkNode->GetAttribute("start", "0").ToStdString());
+          int64_t end =
+              SafeStoll(chunkNode->GetAttribute("end", "0").ToStdString());
+          DownloadChunk chunk(start, end);
+          chunk.currentByte =
+              SafeStoll(chunkNode->GetAttribute("current", "0").ToStdString());
+          chunk.completed = chunkNode->GetAttribute("completed", "0") == "1";
+          record.chunks.push_back(chunk);
+        }
+        chunkNode = chunkNode->GetNext();
+      }
+    }
+    downloadChild = downloadChild->GetNext();
+  }
+
+  return record;
+}
+
+wxXmlNode *DatabaseManager::CreateDownloadNode(const DownloadRecord &record) {
+  wxXmlNode *node = new wxXmlNode(wxXML_ELEMENT_NODE, "Download");
+  node->AddAttribute("id", std::to_string(record.id));
+  node->AddAttribute("url", record.url);
+  node->AddAttribute("filename", record.filename);
+  node->AddAttribute("save_path", record.savePath);
+  node->AddAttribute("total_size", std::to_string(record.totalSize));
+  node->AddAttribute("downloaded_size", std::to_string(record.downloadedSize));
+  node->AddAttribute("status", Download::StatusToString(record.status));
+  node->AddAttribute("category", record.category);
+  node->AddAttribute("description", record.description);
+  node->AddAttribute("referer", record.referer);
+  node->AddAttribute("etag", record.etag);
+  node->AddAttribute("last_modified", record.lastModified);
+  node->AddAttribute("priority",
+                     std::to_string(static_cast<int>(record.priority)));
+  node->AddAttribute("error_message", record.errorMessage);
+  node->AddAttribute("is_ytdlp", record.isYtDlp ? "1" : "0");
+
+  if (!record.chunks.empty()) {
+    wxXmlNode *chunksNode = new wxXmlNode(node, wxXML_ELEMENT_NODE, "Chunks");
+    for (const auto &chunk : record.chunks) {
+      wxXmlNode *chunkNode =
+          new wxXmlNode(chunksNode, wxXML_ELEMENT_NODE, "Chunk");
+      chunkNode->AddAttribute("start", std::to_string(chunk.startByte));
+      chunkNode->AddAttribute("end", std::to_string(chunk.endByte));
+      chunkNode->AddAttribute("current", std::to_string(chunk.currentByte));
+      chunkNode->AddAttribute("completed", chunk.completed ? "1" : "0");
+    }
+  }
+  return node;
+}
+
+std::unique_ptr<wxXmlDocument>
+DatabaseManager::BuildSnapshot(uint64_t epoch) const {
+  auto doc = std::make_unique<wxXmlDocument>();
   wxXmlNode *root = new wxXmlNode(NULL, wxXML_ELEMENT_NODE, "LDM");
-  doc.SetRoot(root);
+  root->AddAttribute("journal_epoch", std::to_string(epoch));
+  doc->SetRoot(root);
 
   // Downloads
   wxXmlNode *downloadsNode =
       new wxXmlNode(root, wxXML_ELEMENT_NODE, "Downloads");
-  for (const auto &download : m_data.downloads) {
-    wxXmlNode *node =
-        new wxXmlNode(downloadsNode, wxXML_ELEMENT_NODE, "Download");
-    node->AddAttribute("id", std::to_string(download->GetId()));
-    node->AddAttribute("url", download->GetUrl());
-    node->AddAttribute("filename", download->GetFilename());
-    node->AddAttribute("save_path", download->GetSavePath());
-    node->AddAttribute("total_size", std::to_string(download->GetTotalSize()));
-    node->AddAttribute("downloaded_size",
-                       std::to_string(download->GetDownloadedSize()));
-    node->AddAttribute("status", download->GetStatusString());
-    node->AddAttribute("category", download->GetCategory());
-    node->AddAttribute("description", download->GetDescription());
-    node->AddAttribute("referer", download->GetReferer());
-    node->AddAttribute("error_message", download->GetErrorMessage());
-    node->AddAttribute("is_ytdlp", download->IsYtDlpDownload() ? "1" : "0");
-
-    auto chunks = download->GetChunksCopy();
-    if (!chunks.empty()) {
-      wxXmlNode *chunksNode = new wxXmlNode(node, wxXML_ELEMENT_NODE, "Chunks");
-      for (const auto &chunk : chunks) {
-        wxXmlNode *chunkNode =
-            new wxXmlNode(chunksNode, wxXML_ELEMENT_NODE, "Chunk");
-        chunkNode->AddAttribute("start", std::to_string(chunk.startByte));
-        chunkNode->AddAttribute("end", std::to_string(chunk.endByte));
-        chunkNode->AddAttribute("current", std::to_string(chunk.currentByte));
-        chunkNode->AddAttribute("completed", chunk.completed ? "1" : "0");
-      }
-    }
+  for (const auto &entry : m_data.downloads) {
+    downloadsNode->AddChild(CreateDownloadNode(entry.second));
+  }
+  for (const auto &entry : m_data.history.Records()) {
+    downloadsNode->AddChild(CreateDownloadNode(
+        entry.second.ToRecord(entry.first, m_data.history.Strings())));
   }
 
   // Categories
@@ -250,6 +559,10 @@ bool DatabaseManager::SaveDatabase() {
     node->AddAttribute("value", set.second);
   }
 
+  return doc;
+}
+
+bool DatabaseManager::SaveDatabase(const wxXmlDocument &doc) {
   // Atomic save: write to temp file, then use ReplaceFile for atomic replacement
   std::string tempPath = m_dbPath + ".tmp";
   if (!doc.Save(tempPath)) {
@@ -286,73 +599,35 @@ bool DatabaseManager::SaveDatabase() {
 
 bool DatabaseManager::SaveDownload(const Download &download) {
   std::lock_guard<std::mutex> lock(m_mutex);
-  auto it = std::find_if(m_data.downloads.begin(), m_data.downloads.end(),
-                         [&](const std::shared_ptr<Download> &d) {
-                           return d->GetId() == download.GetId();
-                         });
+  SaveDownloadLocked(download);
+  return true;
+}
 
-  if (it != m_data.downloads.end()) {
-    // Update existing (Clone/Update values)
-    // Since we are using shared_ptrs in pure in-memory replacement,
-    // we might not need to strictly copy if the UI is holding the same pointer.
-    // But to be safe and match behavior:
-    (*it)->SetStatus(download.GetStatus());
-    (*it)->SetDownloadedSize(download.GetDownloadedSize());
-    (*it)->SetErrorMessage(download.GetErrorMessage());
-    (*it)->SetChunks(download.GetChunksCopy());
-    (*it)->SetYtDlpDownload(download.IsYtDlpDownload());
-    // Copy other fields if needed, but usually only status/progress changes
-    // frequently.
-  } else {
-    // Add new (Deep copy to ensure persistence doesn't depend on UI object
-    // lifecycle if different)
-    auto newDownload = std::make_shared<Download>(
-        download.GetId(), download.GetUrl(), download.GetSavePath());
-    newDownload->SetFilename(download.GetFilename());
-    newDownload->SetCategory(download.GetCategory());
-    newDownload->SetDescription(download.GetDescription());
-    newDownload->SetReferer(download.GetReferer());
-    newDownload->SetTotalSize(download.GetTotalSize());
-    newDownload->SetDownloadedSize(download.GetDownloadedSize());
-    newDownload->SetStatus(download.GetStatus());
-    newDownload->SetChunks(download.GetChunksCopy());
-    newDownload->SetYtDlpDownload(download.IsYtDlpDownload());
-    m_data.downloads.push_back(newDownload);
+bool DatabaseManager::SaveDownloads(
+    const std::vector<std::shared_ptr<Download>> &downloads) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto &download : downloads) {
+    SaveDownloadLocked(*download);
   }
-  MarkDirty();
   return true;
 }
 
+void DatabaseManager::SaveDownloadLocked(const Download &download) {
+  PutRecord(DownloadRecord::FromDownload(download));
+  MarkPending(download.GetId());
+}
+
 bool DatabaseManager::SyncAllDownloads(
     const std::vector<std::shared_ptr<Download>> &downloads) {
   std::lock_guard<std::mutex> lock(m_mutex);
 
-  m_data.downloads.clear();
-  m_data.downloads.reserve(downloads.size());
-
+  // Upsert only: history the caller has not loaded stays as stored, and
+  // removals are already recorded through DeleteDownload
   for (const auto &download : downloads) {
-    if (!download) {
-      continue;
+    if (download) {
+      SaveDownloadLocked(*download);
     }
-
-    auto copy = std::make_shared<Download>(download->GetId(),
-                                           download->GetUrl(),
-                                           download->GetSavePath());
-    copy->SetFilename(download->GetFilename());
-    copy->SetCategory(download->GetCategory());
-    copy->SetDescription(download->GetDescription());
-    copy->SetReferer(download->GetReferer());
-    copy->SetTotalSize(download->GetTotalSize());
-    copy->SetDownloadedSize(download->GetDownloadedSize());
-    copy->SetStatus(download->GetStatus());
-    copy->SetErrorMessage(download->GetErrorMessage());
-    copy->SetChunks(download->GetChunksCopy());
-    copy->SetYtDlpDownload(download->IsYtDlpDownload());
-
-    m_data.downloads.push_back(copy);
   }
-
-  MarkDirty();
   return true;
 }
 
@@ -362,14 +637,8 @@ bool DatabaseManager::UpdateDownload(const Download &download) {
 
 bool DatabaseManager::DeleteDownload(int downloadId) {
   std::lock_guard<std::mutex> lock(m_mutex);
-  auto it = std::remove_if(m_data.downloads.begin(), m_data.downloads.end(),
-                           [&](const std::shared_ptr<Download> &d) {
-                             return d->GetId() == downloadId;
-                           });
-
-  if (it != m_data.downloads.end()) {
-    m_data.downloads.erase(it, m_data.downloads.end());
-    MarkDirty();
+  if (EraseRecord(downloadId)) {
+    MarkPending(downloadId);
     return true;
   }
   return false;
@@ -377,26 +646,9 @@ bool DatabaseManager::DeleteDownload(int downloadId) {
 
 std::unique_ptr<Download> DatabaseManager::LoadDownload(int downloadId) {
   std::lock_guard<std::mutex> lock(m_mutex);
-  auto it = std::find_if(m_data.downloads.begin(), m_data.downloads.end(),
-                         [&](const std::shared_ptr<Download> &d) {
-                           return d->GetId() == downloadId;
-                         });
-
-  if (it != m_data.downloads.end()) {
-    // Return a copy as expected by the interface
-    auto d = *it;
-    auto copy =
-        std::make_unique<Download>(d->GetId(), d->GetUrl(), d->GetSavePath());
-    copy->SetFilename(d->GetFilename());
-    copy->SetCategory(d->GetCategory());
-    copy->SetDescription(d->GetDescription());
-    copy->SetTotalSize(d->GetTotalSize());
-    copy->SetDownloadedSize(d->GetDownloadedSize());
-    copy->SetStatus(d->GetStatus());
-    copy->SetErrorMessage(d->GetErrorMessage());
-    copy->SetChunks(d->GetChunksCopy());
-    copy->SetYtDlpDownload(d->IsYtDlpDownload());
-    return copy;
+  DownloadRecord record;
+  if (GetRecord(downloadId, record)) {
+    return record.ToDownload();
   }
   return nullptr;
 }
@@ -404,23 +656,71 @@ std::unique_ptr<Download> DatabaseManager::LoadDownload(int downloadId) {
 std::vector<std::unique_ptr<Download>> DatabaseManager::LoadAllDownloads() {
   std::lock_guard<std::mutex> lock(m_mutex);
   std::vector<std::unique_ptr<Download>> result;
-  for (const auto &d : m_data.downloads) {
-    auto copy =
-        std::make_unique<Download>(d->GetId(), d->GetUrl(), d->GetSavePath());
-    copy->SetFilename(d->GetFilename());
-    copy->SetCategory(d->GetCategory());
-    copy->SetDescription(d->GetDescription());
-    copy->SetTotalSize(d->GetTotalSize());
-    copy->SetDownloadedSize(d->GetDownloadedSize());
-    copy->SetStatus(d->GetStatus());
-    copy->SetErrorMessage(d->GetErrorMessage());
-    copy->SetChunks(d->GetChunksCopy());
-    copy->SetYtDlpDownload(d->IsYtDlpDownload());
-    result.push_back(std::move(copy));
+  result.reserve(GetRecordCount());
+  for (const auto &entry : m_data.downloads) {
+    result.push_back(entry.second.ToDownload());
+  }
+  for (const auto &entry : m_data.history.Records()) {
+    result.push_back(
+        entry.second.ToRecord(entry.first, m_data.history.Strings()).ToDownload());
+  }
+  return result;
+}
+
+std::vector<std::unique_ptr<Download>>
+DatabaseManager::LoadUnfinishedDownloads() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<std::unique_ptr<Download>> result;
+  result.reserve(m_data.downloads.size());
+  for (const auto &entry : m_data.downloads) {
+    result.push_back(entry.second.ToDownload());
   }
   return result;
 }
 
+bool DatabaseManager::LoadRecord(int downloadId, DownloadRecord &record) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return GetRecord(downloadId, record);
+}
+
+std::vector<int>
+DatabaseManager::GetCompletedDownloadIds(const std::string &category) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_data.history.Ids(category);
+}
+
+std::vector<DownloadRecord>
+DatabaseManager::FindCompleted(const HistoryStore::Filter &filter,
+                               int beforeId, int floorId, size_t limit,
+                               size_t budget, int &resumeId) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_data.history.Find(filter, beforeId, floorId, limit, budget,
+                             resumeId);
+}
+
+int DatabaseManager::GetMaxDownloadId() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  int maxId = m_data.downloads.empty() ? 0 : m_data.downloads.rbegin()->first;
+  maxId = std::max(maxId, m_data.history.MaxId());
+  return maxId;
+}
+
+bool DatabaseManager::UpdateCategory(const std::string &fromCategory,
+                                     const std::string &toCategory) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto &entry : m_data.downloads) {
+    if (entry.second.category == fromCategory) {
+      entry.second.category = toCategory;
+      MarkPending(entry.first);
+    }
+  }
+
+  for (int id : m_data.history.Recategorize(fromCategory, toCategory)) {
+    MarkPending(id);
+  }
+  return true;
+}
+
 std::vector<std::string> DatabaseManager::GetCategories() {
   std::lock_guard<std::mutex> lock(m_mutex);
   return m_data.categories;
@@ -451,11 +751,7 @@ bool DatabaseManager::DeleteCategory(const std::string &name) {
 std::string DatabaseManager::GetSetting(const std::string &key,
                                         const std::string &defaultValue) {
   std::lock_guard<std::mutex> lock(m_mutex);
-  auto it = std::find_if(m_data.settings.begin(), m_data.settings.end(),
-                         [&](const std::pair<std::string, std::string> &s) {
-                           return s.first == key;
-                         });
-
+  auto it = m_data.settings.find(key);
   if (it != m_data.settings.end()) {
     return it->second;
   }
@@ -465,16 +761,14 @@ std::string DatabaseManager::GetSetting(const std::string &key,
 bool DatabaseManager::SetSetting(const std::string &key,
                                  const std::string &value) {
   std::lock_guard<std::mutex> lock(m_mutex);
-  auto it = std::find_if(m_data.settings.begin(), m_data.settings.end(),
-                         [&](const std::pair<std::string, std::string> &s) {
-                           return s.first == key;
-                         });
-
-  if (it != m_data.settings.end()) {
-    it->second = value;
-  } else {
-    m_data.settings.push_back({key, value});
+  auto result = m_data.settings.try_emplace(key, value);
+  if (!result.second) {
+    if (result.first->second == value) {
+      return true;  // Unchanged; nothing to save or invalidate
+    }
+    result.first->second = value;
   }
+  m_settingsVersion++;
   MarkDirty();
   return true;
 }
@@ -482,18 +776,14 @@ bool DatabaseManager::SetSetting(const std::string &key,
 bool DatabaseManager::ClearHistory() {
   std::lock_guard<std::mutex> lock(m_mutex);
   m_data.downloads.clear();
+  m_data.history.Clear();
   MarkDirty();
   return true;
 }
 
 bool DatabaseManager::ClearCompleted() {
   std::lock_guard<std::mutex> lock(m_mutex);
-  m_data.downloads.erase(
-      std::remove_if(m_data.downloads.begin(), m_data.downloads.end(),
-                     [](const std::shared_ptr<Download> &d) {
-                       return d->GetStatus() == DownloadStatus::Completed;
-                     }),
-      m_data.downloads.end());
+  m_data.history.Clear();
   MarkDirty();
   return true;
 }
@@ -1,13 +1,20 @@
 #pragma once
 
 #include "../core/Download.h"
+#include "DownloadRecord.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <wx/xml/xml.h>
 
-
 class DatabaseManager {
 public:
   static DatabaseManager &GetInstance();
@@ -19,14 +26,29 @@ public:
   // Database operations
   bool Initialize(const std::string &dbPath = "");
   void Close();
-  void Flush();  // Explicitly save if dirty
+  void Flush();  // Commit pending changes now instead of at the next tick
 
   // Download CRUD operations
   bool SaveDownload(const Download &download);
+  bool SaveDownloads(const std::vector<std::shared_ptr<Download>> &downloads);
   bool UpdateDownload(const Download &download);
   bool DeleteDownload(int downloadId);
   std::unique_ptr<Download> LoadDownload(int downloadId);
   std::vector<std::unique_ptr<Download>> LoadAllDownloads();
+  // A download's stored fields as plain data, for showing it without
+  // building a Download
+  bool LoadRecord(int downloadId, DownloadRecord &record);
+  // Startup split: unfinished downloads are loaded up front, completed
+  // history stays here as records and is read a row at a time
+  std::vector<std::unique_ptr<Download>> LoadUnfinishedDownloads();
+  // Ascending; all of them, or those filed under one category
+  std::vector<int> GetCompletedDownloadIds(const std::string &category = "");
+  // Completed records a query matches, newest first (see HistoryStore::Find)
+  std::vector<DownloadRecord> FindCompleted(const HistoryStore::Filter &filter,
+                                            int beforeId, int floorId,
+                                            size_t limit, size_t budget,
+                                            int &resumeId);
+  int GetMaxDownloadId();
   bool SyncAllDownloads(
       const std::vector<std::shared_ptr<Download>> &downloads);
 
@@ -34,48 +56,84 @@ public:
   std::vector<std::string> GetCategories();
   bool AddCategory(const std::string &name);
   bool DeleteCategory(const std::string &name);
+  bool UpdateCategory(const std::string &fromCategory,
+                      const std::string &toCategory);  // Re-file stored downloads
 
   // Settings operations
   std::string GetSetting(const std::string &key,
                          const std::string &defaultValue = "");
   bool SetSetting(const std::string &key, const std::string &value);
+  // Bumped whenever a setting value changes, so callers can cache
+  // anything derived from settings and rebuild only when this moves
+  uint64_t GetSettingsVersion() const { return m_settingsVersion.load(); }
 
   // Cleanup
   bool ClearHistory();
   bool ClearCompleted();
 
-  // Transaction support (No-op in XML version, kept for API compatibility)
+  // Transaction support. Changes are already batched into group commits,
+  // so committing just forces the pending batch out.
   bool BeginTransaction() { return true; }
-  bool CommitTransaction() { 
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (m_dirty) {
-      bool result = SaveDatabase();
-      m_dirty = false;
-      return result;
-    }
-    return true;
-  }
+  bool CommitTransaction() { return Commit(); }
   bool RollbackTransaction() { return true; }
 
 private:
   DatabaseManager();
   ~DatabaseManager();
 
+  // downloads.xml is a full snapshot (and the import/export format).
+  // Download changes made between snapshots are appended to a journal next
+  // to it, one record per line, and replayed over the snapshot on load.
+  // Compaction rewrites the snapshot and starts a new journal epoch, so a
+  // journal left over from an older snapshot is never replayed.
   std::string m_dbPath;
+  std::string m_journalPath;
   std::mutex m_mutex;
-  bool m_dirty = false;  // Tracks unsaved changes
+  std::mutex m_ioMutex;  // Serialises file writes; taken before m_mutex
+  bool m_dirty = false;  // Snapshot-level change (categories, settings, bulk)
+  std::unordered_set<int> m_pendingIds;  // Downloads to log at next commit
+  uint64_t m_journalEpoch = 0;
+  size_t m_journalRecords = 0;  // Logged since last compaction (m_ioMutex)
+  std::atomic<uint64_t> m_settingsVersion{1};
+
+  // Group commit writer
+  std::thread m_writerThread;
+  std::condition_variable m_writerCv;
+  bool m_stopWriter = false;
 
   // In-memory data
   struct AppData {
-    std::vector<std::shared_ptr<Download>> downloads;
+    std::map<int, DownloadRecord> downloads;  // Unfinished, keyed by id
+    HistoryStore history;                     // Completed
     std::vector<std::string> categories;
-    std::vector<std::pair<std::string, std::string>> settings;
+    std::unordered_map<std::string, std::string> settings;
   } m_data;
 
   bool LoadDatabase();
-  bool SaveDatabase();
+  std::unique_ptr<wxXmlDocument> BuildSnapshot(uint64_t epoch) const;
+  bool SaveDatabase(const wxXmlDocument &doc);
   void MarkDirty() { m_dirty = true; }
+  void MarkPending(int downloadId) { m_pendingIds.insert(downloadId); }
+  void SaveDownloadLocked(const Download &download);
+
+  // Records are filed as unfinished or compacted history by their status
+  void PutRecord(DownloadRecord record);
+  bool GetRecord(int downloadId, DownloadRecord &record) const;
+  bool EraseRecord(int downloadId);
+  size_t GetRecordCount() const {
+    return m_data.downloads.size() + m_data.history.Size();
+  }
+
+  // Journal
+  bool Commit();
+  void WriterLoop();
+  bool ReplayJournal();
+  bool ResetJournal();
+  bool AppendToJournal(const std::string &records);
+  bool TruncateJournal(int64_t size);  // Drop a torn final record
 
   // Helpers
   void CreateDefaultCategories();
+  static wxXmlNode *CreateDownloadNode(const DownloadRecord &record);
+  static DownloadRecord ParseDownloadNode(const wxXmlNode *node);
 };
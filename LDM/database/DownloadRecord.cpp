@@ -0,0 +1,292 @@
+#include "DownloadRecord.h"
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+// Lowercase host of a URL or of an origin, as DownloadManager reads it
+static std::string HostOf(const std::string &url) {
+  size_t start = url.find("://");
+  start = (start == std::string::npos) ? 0 : start + 3;
+  size_t end = url.find_first_of(":/?#", start);
+  std::string host = url.substr(start, end == std::string::npos
+                                           ? std::string::npos
+                                           : end - start);
+  std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+  return host;
+}
+
+static bool ContainsLower(const std::string &haystack,
+                          const std::string &needle, std::string &buffer) {
+  buffer.assign(haystack);
+  std::transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
+  return buffer.find(needle) != std::string::npos;
+}
+
+DownloadRecord DownloadRecord::FromDownload(const Download &download) {
+  DownloadRecord record;
+  record.id = download.GetId();
+  record.url = download.GetUrl();
+  record.filename = download.GetFilename();
+  record.savePath = download.GetSavePath();
+  record.category = download.GetCategory();
+  record.description = download.GetDescription();
+  record.referer = download.GetReferer();
+  record.etag = download.GetETag();
+  record.lastModified = download.GetLastModified();
+  record.errorMessage = download.GetErrorMessage();
+  record.totalSize = download.GetTotalSize();
+  record.downloadedSize = download.GetDownloadedSize();
+  record.status = download.GetStatus();
+  record.priority = download.GetPriority();
+  record.isYtDlp = download.IsYtDlpDownload();
+  record.chunks = download.GetChunksCopy();
+  return record;
+}
+
+std::unique_ptr<Download> DownloadRecord::ToDownload() const {
+  auto download = std::make_unique<Download>(id, url, savePath);
+  download->SetFilename(filename);
+  download->SetCategory(category);
+  download->SetDescription(description);
+  download->SetReferer(referer);
+  download->SetValidators(etag, lastModified);
+  download->SetErrorMessage(errorMessage);
+  download->SetTotalSize(totalSize);
+  download->SetDownloadedSize(downloadedSize);
+  download->SetStatus(status);
+  download->SetPriority(priority);
+  download->SetYtDlpDownload(isYtDlp);
+  if (!chunks.empty()) {
+    download->SetChunks(chunks);
+  }
+  return download;
+}
+
+uint32_t StringPool::Intern(const std::string &value) {
+  auto it = m_indexes.find(value);
+  if (it != m_indexes.end()) {
+    ++m_refs[it->second];
+    return it->second;
+  }
+  uint32_t index;
+  if (!m_free.empty()) {
+    index = m_free.back();
+    m_free.pop_back();
+    m_strings[index] = value;
+    m_refs[index] = 1;
+  } else {
+    index = static_cast<uint32_t>(m_strings.size());
+    m_strings.push_back(value);
+    m_refs.push_back(1);
+  }
+  m_indexes.emplace(m_strings[index], index);
+  return index;
+}
+
+void StringPool::Release(uint32_t index) {
+  if (index >= m_refs.size() || m_refs[index] == 0 || --m_refs[index] > 0) {
+    return;
+  }
+  m_indexes.erase(m_strings[index]);
+  std::string().swap(m_strings[index]);
+  m_free.push_back(index);
+}
+
+bool StringPool::Find(const std::string &value, uint32_t &index) const {
+  auto it = m_indexes.find(value);
+  if (it == m_indexes.end()) {
+    return false;
+  }
+  index = it->second;
+  return true;
+}
+
+CompletedRecord CompletedRecord::FromRecord(const DownloadRecord &record,
+                                            StringPool &strings) {
+  // Split "https://host/path" after the host so the origin can be shared
+  size_t originEnd = 0;
+  size_t scheme = record.url.find("://");
+  if (scheme != std::string::npos) {
+    originEnd = std::min(record.url.find('/', scheme + 3), record.url.size());
+  }
+
+  CompletedRecord compact;
+  compact.origin = strings.Intern(record.url.substr(0, originEnd));
+  compact.urlPath = record.url.substr(originEnd);
+  compact.savePath = strings.Intern(record.savePath);
+  compact.category = strings.Intern(record.category);
+  compact.filename = record.filename;
+  compact.totalSize = record.totalSize;
+  compact.downloadedSize = record.downloadedSize;
+  compact.isYtDlp = record.isYtDlp;
+  if (!record.description.empty() || !record.referer.empty() ||
+      !record.etag.empty() || !record.lastModified.empty()) {
+    compact.extras = std::make_unique<CompletedRecord::Extras>(
+        CompletedRecord::Extras{record.description, record.referer,
+                                record.etag, record.lastModified});
+  }
+  compact.urlPath.shrink_to_fit();
+  compact.filename.shrink_to_fit();
+  return compact;
+}
+
+DownloadRecord CompletedRecord::ToRecord(int id,
+                                         const StringPool &strings) const {
+  DownloadRecord record;
+  record.id = id;
+  record.url = strings.Get(origin) + urlPath;
+  record.savePath = strings.Get(savePath);
+  record.category = strings.Get(category);
+  record.filename = filename;
+  record.totalSize = totalSize;
+  record.downloadedSize = downloadedSize;
+  record.status = DownloadStatus::Completed;
+  record.isYtDlp = isYtDlp;
+  if (extras) {
+    record.description = extras->description;
+    record.referer = extras->referer;
+    record.etag = extras->etag;
+    record.lastModified = extras->lastModified;
+  }
+  return record;
+}
+
+void CompletedRecord::Release(StringPool &strings) const {
+  strings.Release(origin);
+  strings.Release(savePath);
+  strings.Release(category);
+}
+
+void HistoryStore::Put(const DownloadRecord &record) {
+  // Intern the new strings before releasing the old, so shared ones stay
+  CompletedRecord compact = CompletedRecord::FromRecord(record, m_strings);
+  auto it = m_records.find(record.id);
+  if (it != m_records.end()) {
+    it->second.Release(m_strings);
+    it->second = std::move(compact);
+  } else {
+    m_records.emplace(record.id, std::move(compact));
+  }
+}
+
+bool HistoryStore::Get(int id, DownloadRecord &record) const {
+  auto it = m_records.find(id);
+  if (it == m_records.end()) {
+    return false;
+  }
+  record = it->second.ToRecord(id, m_strings);
+  return true;
+}
+
+bool HistoryStore::Erase(int id) {
+  auto it = m_records.find(id);
+  if (it == m_records.end()) {
+    return false;
+  }
+  it->second.Release(m_strings);
+  m_records.erase(it);
+  return true;
+}
+
+void HistoryStore::Clear() {
+  m_records.clear();
+  m_strings = StringPool();
+}
+
+std::vector<int> HistoryStore::Recategorize(const std::string &from,
+                                            const std::string &to) {
+  std::vector<int> changed;
+  uint32_t fromIndex;
+  if (from == to || !m_strings.Find(from, fromIndex)) {
+    return changed;
+  }
+  for (auto &entry : m_records) {
+    if (entry.second.category == fromIndex) {
+      changed.push_back(entry.first);
+    }
+  }
+  for (int id : changed) {
+    CompletedRecord &compact = m_records[id];
+    compact.category = m_strings.Intern(to);
+    m_strings.Release(fromIndex);
+  }
+  return changed;
+}
+
+std::vector<int> HistoryStore::Ids(const std::string &category) const {
+  std::vector<int> ids;
+  if (category.empty()) {
+    ids.reserve(m_records.size());
+    for (const auto &entry : m_records) {
+      ids.push_back(entry.first);
+    }
+    return ids;
+  }
+  uint32_t index;
+  if (!m_strings.Find(category, index)) {
+    return ids;
+  }
+  for (const auto &entry : m_records) {
+    if (entry.second.category == index) {
+      ids.push_back(entry.first);
+    }
+  }
+  return ids;
+}
+
+std::vector<DownloadRecord> HistoryStore::Find(const Filter &filter,
+                                               int beforeId, int floorId,
+                                               size_t limit, size_t budget,
+                                               int &resumeId) const {
+  std::vector<DownloadRecord> matches;
+  resumeId = -1;
+  uint32_t category = 0;
+  if (!filter.category.empty() && !m_strings.Find(filter.category, category)) {
+    return matches;  // No record is filed there
+  }
+
+  // Host answers are shared by every record from the same origin
+  std::unordered_map<uint32_t, bool> hostMatches;
+  auto matchesHost = [&](const CompletedRecord &compact) {
+    const std::string &origin = m_strings.Get(compact.origin);
+    if (origin.empty()) {
+      return HostOf(compact.urlPath) == filter.host;  // No scheme to split at
+    }
+    auto it = hostMatches.find(compact.origin);
+    if (it == hostMatches.end()) {
+      it = hostMatches.emplace(compact.origin, HostOf(origin) == filter.host)
+               .first;
+    }
+    return it->second;
+  };
+
+  std::string buffer;
+  auto it = m_records.lower_bound(beforeId);
+  while (it != m_records.begin() && matches.size() < limit) {
+    --it;
+    if (it->first <= floorId) {
+      break;
+    }
+    if (budget == 0) {
+      resumeId = it->first + 1;  // This one has not been looked at yet
+      break;
+    }
+    --budget;
+
+    const CompletedRecord &compact = it->second;
+    if (!filter.category.empty() && compact.category != category) {
+      continue;
+    }
+    if (!filter.host.empty() && !matchesHost(compact)) {
+      continue;
+    }
+    if (!filter.text.empty() &&
+        !ContainsLower(compact.filename, filter.text, buffer) &&
+        !ContainsLower(m_strings.Get(compact.origin) + compact.urlPath,
+                       filter.text, buffer)) {
+      continue;
+    }
+    matches.push_back(compact.ToRecord(it->first, m_strings));
+  }
+  return matches;
+}
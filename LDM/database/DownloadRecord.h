@@ -0,0 +1,121 @@
+#pragma once
+
+#include "../core/Download.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Persistent fields of one download as plain data. The database stores
+// these rather than Download objects, so a history entry costs its strings
+// and nothing else: no mutexes, no atomics, no filename/category detection.
+struct DownloadRecord {
+  int id = 0;
+  std::string url;
+  std::string filename;
+  std::string savePath;
+  std::string category;
+  std::string description;
+  std::string referer;
+  std::string etag;
+  std::string lastModified;
+  std::string errorMessage;
+  int64_t totalSize = -1;
+  int64_t downloadedSize = 0;
+  DownloadStatus status = DownloadStatus::Queued;
+  DownloadPriority priority = DownloadPriority::Normal;
+  bool isYtDlp = false;
+  std::vector<DownloadChunk> chunks;
+
+  static DownloadRecord FromDownload(const Download &download);
+  std::unique_ptr<Download> ToDownload() const;
+};
+
+// Deduplicating string table; an interned string is referred to by index.
+// Each Intern is a reference, dropped again with Release; a string goes
+// with its last reference and its index is reused.
+class StringPool {
+public:
+  uint32_t Intern(const std::string &value);
+  void Release(uint32_t index);
+  const std::string &Get(uint32_t index) const { return m_strings[index]; }
+  // Index of a string already interned, without taking a reference
+  bool Find(const std::string &value, uint32_t &index) const;
+  size_t Size() const { return m_indexes.size(); }  // Strings referenced
+
+private:
+  std::deque<std::string> m_strings;  // Stable storage for the view keys
+  std::vector<uint32_t> m_refs;       // Per index
+  std::vector<uint32_t> m_free;       // Released indexes
+  std::unordered_map<std::string_view, uint32_t> m_indexes;
+};
+
+// A finished download, kept read-only and small: the URL origin, save
+// folder and category are interned, and state that only matters while
+// downloading (chunks, error, priority) is dropped. Rarely-set text lives
+// out of line so the common entry carries just a null pointer for it.
+struct CompletedRecord {
+  uint32_t origin = 0;    // "scheme://host[:port]"
+  uint32_t savePath = 0;
+  uint32_t category = 0;
+  bool isYtDlp = false;
+  int64_t totalSize = -1;
+  int64_t downloadedSize = 0;
+  std::string urlPath;  // URL after the origin
+  std::string filename;
+  struct Extras {
+    std::string description;
+    std::string referer;
+    std::string etag;
+    std::string lastModified;
+  };
+  std::unique_ptr<Extras> extras;
+
+  static CompletedRecord FromRecord(const DownloadRecord &record,
+                                    StringPool &strings);
+  DownloadRecord ToRecord(int id, const StringPool &strings) const;
+  void Release(StringPool &strings) const;  // Drop its pooled strings
+};
+
+// Completed history by id, with the string pool its records share. Going
+// through here keeps the pool's references right, so strings that only
+// removed or re-filed records used are freed.
+class HistoryStore {
+public:
+  void Put(const DownloadRecord &record);  // Replaces one with the same id
+  bool Get(int id, DownloadRecord &record) const;
+  bool Erase(int id);
+  void Clear();
+  // Re-file every record in one category; returns the ids changed
+  std::vector<int> Recategorize(const std::string &from, const std::string &to);
+
+  // Ascending ids, all of them or those in one category, told apart on
+  // the compact records without expanding any
+  std::vector<int> Ids(const std::string &category = "") const;
+
+  // What a history query asks for; empty fields match every record
+  struct Filter {
+    std::string category;
+    std::string host;  // Lowercase, compared with the URL's host
+    std::string text;  // Lowercase, found in the filename or URL
+  };
+  // Newest-first matches with ids above floorId and below beforeId, at
+  // most 'limit'. Only matches are expanded. Looks at no more than
+  // 'budget' records: if that runs out first, resumeId is the id to carry
+  // on below, otherwise -1.
+  std::vector<DownloadRecord> Find(const Filter &filter, int beforeId,
+                                   int floorId, size_t limit, size_t budget,
+                                   int &resumeId) const;
+  size_t Size() const { return m_records.size(); }
+  int MaxId() const { return m_records.empty() ? 0 : m_records.rbegin()->first; }
+  const std::map<int, CompletedRecord> &Records() const { return m_records; }
+  const StringPool &Strings() const { return m_strings; }
+
+private:
+  std::map<int, CompletedRecord> m_records;
+  StringPool m_strings;
+};
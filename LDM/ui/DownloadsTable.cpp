@@ -1,6 +1,7 @@
 #include "DownloadsTable.h"
 #include "../core/DownloadManager.h"
 #include "../utils/ThemeManager.h"
+#include <algorithm>
 #include <shellapi.h>
 #include <wx/artprov.h>
 
@@ -21,6 +22,9 @@ wxBEGIN_EVENT_TABLE(DownloadsTable, wxPanel) EVT_LIST_ITEM_SELECTED(
                                     EVT_MENU(
                                         ID_CTX_DELETE_WITH_FILE,
                                         DownloadsTable::OnContextDeleteWithFile)
+                                        EVT_MENU_RANGE(ID_CTX_PRIORITY_HIGH,
+                                                       ID_CTX_PRIORITY_LOW,
+                                                       DownloadsTable::OnContextPriority)
                                         wxEND_EVENT_TABLE()
 
                                             DownloadsTable::DownloadsTable(
@@ -29,11 +33,12 @@ wxBEGIN_EVENT_TABLE(DownloadsTable, wxPanel) EVT_LIST_ITEM_SELECTED(
   wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
 
   // Create list control
-  m_listCtrl =
-      new wxListCtrl(this, wxID_ANY, wxDefaultPosition, wxDefaultSize,
-                     wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_VRULES | wxLC_HRULES);
+  m_listCtrl = new DownloadsListCtrl(
+      this, this,
+      wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL | wxLC_VRULES | wxLC_HRULES);
 
   CreateColumns();
+  LoadHistoryIds();
 
   sizer->Add(m_listCtrl, 1, wxEXPAND);
   SetSizer(sizer);
@@ -42,6 +47,19 @@ wxBEGIN_EVENT_TABLE(DownloadsTable, wxPanel) EVT_LIST_ITEM_SELECTED(
   ThemeManager::GetInstance().ApplyTheme(this);
 }
 
+DownloadsListCtrl::DownloadsListCtrl(DownloadsTable *owner, wxWindow *parent,
+                                     long style)
+    : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, style),
+      m_owner(owner) {}
+
+wxString DownloadsListCtrl::OnGetItemText(long item, long column) const {
+  return m_owner->GetCellText(item, column);
+}
+
+wxItemAttr *DownloadsListCtrl::OnGetItemAttr(long item) const {
+  return m_owner->GetRowAttr(item);
+}
+
 void DownloadsTable::CreateColumns() {
   // Create columns matching IDM layout
   m_listCtrl->InsertColumn(0, "File Name", wxLIST_FORMAT_LEFT, 250);
@@ -66,22 +84,48 @@ void DownloadsTable::AddDownload(std::shared_ptr<Download> download) {
   ApplyFilter();
 }
 
+void DownloadsTable::AddDownloads(
+    const std::vector<std::shared_ptr<Download>> &downloads) {
+  m_downloads.reserve(m_downloads.size() + downloads.size());
+  for (const auto &download : downloads) {
+    if (m_downloadIndex.find(download->GetId()) == m_downloadIndex.end()) {
+      m_downloadIndex[download->GetId()] = m_downloads.size();
+      m_downloads.push_back(download);
+    }
+  }
+
+  // Filter once for the whole batch
+  ApplyFilter();
+}
+
 void DownloadsTable::RemoveDownload(int downloadId) {
-  auto indexIt = m_downloadIndex.find(downloadId);
-  if (indexIt != m_downloadIndex.end()) {
+  RemoveDownloads({downloadId});
+}
+
+void DownloadsTable::RemoveDownloads(const std::vector<int> &downloadIds) {
+  for (int downloadId : downloadIds) {
+    auto indexIt = m_downloadIndex.find(downloadId);
+    if (indexIt == m_downloadIndex.end()) {
+      auto historyIt = std::lower_bound(m_historyIds.begin(),
+                                        m_historyIds.end(), downloadId);
+      if (historyIt != m_historyIds.end() && *historyIt == downloadId) {
+        m_historyIds.erase(historyIt);
+      }
+      continue;
+    }
     size_t idx = indexIt->second;
-    
+
     // If not the last element, swap with last and update its index
     if (idx < m_downloads.size() - 1) {
       auto& lastDownload = m_downloads.back();
       m_downloadIndex[lastDownload->GetId()] = idx;
       m_downloads[idx] = std::move(m_downloads.back());
     }
-    
+
     m_downloads.pop_back();
     m_downloadIndex.erase(indexIt);
   }
-  // Re-apply filter to update display
+  // Re-apply filter once to update display
   ApplyFilter();
 }
 
@@ -89,27 +133,83 @@ void DownloadsTable::UpdateDownload(int downloadId) {
   // Use filtered index for O(1) lookup instead of linear search
   auto it = m_filteredIndex.find(downloadId);
   if (it != m_filteredIndex.end() && it->second < m_filteredDownloads.size()) {
-    UpdateRow(static_cast<long>(it->second), m_filteredDownloads[it->second]);
+    RefreshRowIfChanged(it->second);
+    return;
+  }
+
+  // A history entry restarted or resumed is a download now; its history
+  // row becomes a download row
+  if (m_downloadIndex.find(downloadId) == m_downloadIndex.end()) {
+    auto download = DownloadManager::GetInstance().GetDownload(downloadId);
+    if (download) {
+      auto historyIt = std::lower_bound(m_historyIds.begin(),
+                                        m_historyIds.end(), downloadId);
+      if (historyIt != m_historyIds.end() && *historyIt == downloadId) {
+        m_historyIds.erase(historyIt);
+      }
+      AddDownload(download);
+    }
   }
 }
 
-void DownloadsTable::RefreshAll() { ApplyFilter(); }
+void DownloadsTable::RefreshRowIfChanged(size_t row) {
+  uint64_t generation = m_filteredDownloads[row]->GetGeneration();
+  if (m_rowGenerations[row] != generation) {
+    m_rowGenerations[row] = generation;
+    m_listCtrl->RefreshItem(static_cast<long>(row));
+  }
+}
+
+void DownloadsTable::RefreshAll() {
+  LoadHistoryIds();
+  ApplyFilter();
+}
 
 void DownloadsTable::FilterByCategory(const wxString &category) {
   m_currentFilter = category;
+  LoadHistoryIds();
   ApplyFilter();
 }
 
 void DownloadsTable::ClearFilter() {
   m_currentFilter = "";
+  LoadHistoryIds();
   ApplyFilter();
 }
 
+// Category name of the current filter, without a count suffix like " (5)"
+static std::string FilterCategory(const wxString &filter) {
+  wxString categoryName = filter;
+  int parenPos = categoryName.Find('(');
+  if (parenPos != wxNOT_FOUND) {
+    categoryName = categoryName.Left(parenPos).Trim();
+  }
+  return categoryName.ToStdString();
+}
+
+void DownloadsTable::LoadHistoryIds() {
+  // History is all completed, so it matches every filter but Unfinished
+  DownloadManager &manager = DownloadManager::GetInstance();
+  if (m_currentFilter.IsEmpty() || m_currentFilter == "All Downloads" ||
+      m_currentFilter == "Finished") {
+    m_historyIds = manager.GetHistoryIds();
+  } else if (m_currentFilter == "Unfinished") {
+    m_historyIds.clear();
+  } else {
+    m_historyIds = manager.GetHistoryIds(FilterCategory(m_currentFilter));
+  }
+  m_historyRecordId = -1;
+}
+
 void DownloadsTable::ApplyFilter() {
-  m_listCtrl->DeleteAllItems();
+  // Keep the selection on the same download across the rebuild
+  int selectedId = GetSelectedDownloadId();
+
   m_filteredDownloads.clear();
   m_filteredIndex.clear();
 
+  std::string category = FilterCategory(m_currentFilter);
+
   for (const auto &download : m_downloads) {
     bool matches = false;
 
@@ -124,80 +224,168 @@ void DownloadsTable::ApplyFilter() {
       matches = (download->GetStatus() != DownloadStatus::Completed);
     } else {
       // Filter by category name (Compressed, Documents, Music, Programs, Video)
-      // Remove any count suffix like " (5)" from the filter
-      wxString categoryName = m_currentFilter;
-      int parenPos = categoryName.Find('(');
-      if (parenPos != wxNOT_FOUND) {
-        categoryName = categoryName.Left(parenPos).Trim();
-      }
-      matches = (download->GetCategory() == categoryName.ToStdString());
+      matches = (download->GetCategory() == category);
     }
 
     if (matches) {
-      size_t filteredIdx = m_filteredDownloads.size();
-      m_filteredIndex[download->GetId()] = filteredIdx;
+      m_filteredIndex[download->GetId()] = m_filteredDownloads.size();
       m_filteredDownloads.push_back(download);
-      long index = m_listCtrl->InsertItem(m_listCtrl->GetItemCount(),
-                                          download->GetFilename());
-      UpdateRow(index, download);
     }
   }
+
+  m_rowGenerations.resize(m_filteredDownloads.size());
+  for (size_t i = 0; i < m_filteredDownloads.size(); ++i) {
+    m_rowGenerations[i] = m_filteredDownloads[i]->GetGeneration();
+  }
+
+  // Virtual mode: only the count changes, rows are pulled on paint
+  long oldSelection =
+      m_listCtrl->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
+  if (oldSelection >= 0) {
+    m_listCtrl->SetItemState(oldSelection, 0, wxLIST_STATE_SELECTED);
+  }
+  m_listCtrl->SetItemCount(
+      static_cast<long>(m_filteredDownloads.size() + m_historyIds.size()));
+  long selectedRow = -1;
+  auto selectedIt = m_filteredIndex.find(selectedId);
+  if (selectedIt != m_filteredIndex.end()) {
+    selectedRow = static_cast<long>(selectedIt->second);
+  } else {
+    auto historyIt = std::lower_bound(m_historyIds.begin(), m_historyIds.end(),
+                                      selectedId);
+    if (historyIt != m_historyIds.end() && *historyIt == selectedId) {
+      selectedRow = static_cast<long>(m_filteredDownloads.size() +
+                                      (m_historyIds.end() - historyIt) - 1);
+    }
+  }
+  if (selectedRow >= 0) {
+    m_listCtrl->SetItemState(selectedRow, wxLIST_STATE_SELECTED,
+                             wxLIST_STATE_SELECTED);
+  }
+  m_listCtrl->Refresh();
 }
 
-void DownloadsTable::UpdateRow(long row, std::shared_ptr<Download> download) {
-  m_listCtrl->SetItem(row, 0, download->GetFilename());
-  m_listCtrl->SetItem(row, 1, FormatFileSize(download->GetTotalSize()));
+int DownloadsTable::GetRowId(long row) const {
+  if (row < 0) {
+    return -1;
+  }
+  size_t index = static_cast<size_t>(row);
+  if (index < m_filteredDownloads.size()) {
+    return m_filteredDownloads[index]->GetId();
+  }
+  index -= m_filteredDownloads.size();
+  if (index < m_historyIds.size()) {
+    return m_historyIds[m_historyIds.size() - 1 - index];
+  }
+  return -1;
+}
 
-  DownloadStatus status = download->GetStatus();
+const DownloadRecord *DownloadsTable::GetHistoryRecord(long row) const {
+  if (row < static_cast<long>(m_filteredDownloads.size())) {
+    return nullptr;
+  }
+  int downloadId = GetRowId(row);
+  if (downloadId < 0) {
+    return nullptr;
+  }
 
-  // Calculate and display progress percentage
-  int progress = download->GetProgress();
-  wxString progressStr;
-  if (status == DownloadStatus::Completed) {
-    progressStr = "100%";
-  } else if (progress >= 0) {
-    progressStr = wxString::Format("%d%%", progress);
-  } else {
-    progressStr = "-";
+  // Every column of a row is asked for in turn; read the record once
+  if (downloadId != m_historyRecordId) {
+    m_historyRecordId = -1;
+    if (!DownloadManager::GetInstance().GetHistoryRecord(downloadId,
+                                                         m_historyRecord)) {
+      return nullptr;
+    }
+    m_historyRecordId = downloadId;
   }
-  m_listCtrl->SetItem(row, 2, progressStr);
+  return &m_historyRecord;
+}
 
-  m_listCtrl->SetItem(row, 3, download->GetStatusString());
+bool DownloadsTable::FindRecordById(int downloadId,
+                                    DownloadRecord &record) const {
+  auto download = FindDownloadById(downloadId);
+  if (download) {
+    record = DownloadRecord::FromDownload(*download);
+    return true;
+  }
+  return DownloadManager::GetInstance().GetHistoryRecord(downloadId, record);
+}
 
-  wxString timeLeft;
-  if (status == DownloadStatus::Completed) {
-    timeLeft = "-";
-  } else {
-    timeLeft = FormatTime(download->GetTimeRemaining());
+wxString DownloadsTable::GetCellText(long row, long column) const {
+  if (row >= static_cast<long>(m_filteredDownloads.size())) {
+    const DownloadRecord *record = GetHistoryRecord(row);
+    if (!record) {
+      return wxEmptyString;
+    }
+    switch (column) {
+      case 0:
+        return record->filename;
+      case 1:
+        return FormatFileSize(record->totalSize);
+      case 2:
+        return "100%";
+      case 3:
+        return Download::StatusToString(record->status);
+      case 4:
+      case 5:
+        return "-";
+      default:
+        return wxEmptyString;
+    }
+  }
+  if (row < 0) {
+    return wxEmptyString;
   }
-  m_listCtrl->SetItem(row, 4, timeLeft);
+  const auto &download = m_filteredDownloads[row];
+  DownloadStatus status = download->GetStatus();
 
-  wxString speedStr;
-  if (status == DownloadStatus::Completed) {
-    speedStr = "-";
-  } else {
-    speedStr = FormatSpeed(download->GetSpeed());
-  }
-  m_listCtrl->SetItem(row, 5, speedStr);
-  m_listCtrl->SetItem(row, 6, download->GetLastTryTime());
-
-  // Set row color based on status
-  // Set row color based on status
-  wxColour bgColor;
-  if (ThemeManager::GetInstance().IsDarkMode()) {
-    // In dark mode, row background is control background, but we might want
-    // slight tint Actually, simple list control usually handles selection, but
-    // for specific rows we use:
-    bgColor = ThemeManager::GetInstance().GetStatusColor(status);
-  } else {
-    bgColor = ThemeManager::GetInstance().GetStatusColor(status);
+  switch (column) {
+    case 0:
+      return download->GetFilename();
+    case 1:
+      return FormatFileSize(download->GetTotalSize());
+    case 2: {
+      // Progress percentage
+      int progress = download->GetProgress();
+      if (status == DownloadStatus::Completed) {
+        return "100%";
+      } else if (progress >= 0) {
+        return wxString::Format("%d%%", progress);
+      }
+      return "-";
+    }
+    case 3:
+      return download->GetStatusString();
+    case 4:
+      if (status == DownloadStatus::Completed) {
+        return "-";
+      }
+      return FormatTime(download->GetTimeRemaining());
+    case 5:
+      if (status == DownloadStatus::Completed) {
+        return "-";
+      }
+      return FormatSpeed(download->GetSpeed());
+    case 6:
+      return download->GetLastTryTime();
+    default:
+      return wxEmptyString;
   }
+}
 
-  m_listCtrl->SetItemBackgroundColour(row, bgColor);
+wxItemAttr *DownloadsTable::GetRowAttr(long row) const {
+  if (GetRowId(row) < 0) {
+    return nullptr;
+  }
 
-  // Set text color if needed (e.g. for dark mode readability)
-  m_listCtrl->SetItemTextColour(
-      row, ThemeManager::GetInstance().GetForegroundColor());
+  // Row color based on status; text color for dark mode readability
+  ThemeManager &theme = ThemeManager::GetInstance();
+  DownloadStatus status = row < static_cast<long>(m_filteredDownloads.size())
+                              ? m_filteredDownloads[row]->GetStatus()
+                              : DownloadStatus::Completed;
+  m_rowAttr.SetBackgroundColour(theme.GetStatusColor(status));
+  m_rowAttr.SetTextColour(theme.GetForegroundColor());
+  return &m_rowAttr;
 }
 
 wxString DownloadsTable::FormatFileSize(int64_t bytes) const {
@@ -251,11 +439,7 @@ wxString DownloadsTable::FormatTime(int seconds) const {
 int DownloadsTable::GetSelectedDownloadId() const {
   long selectedIndex =
       m_listCtrl->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
-  if (selectedIndex >= 0 &&
-      selectedIndex < static_cast<long>(m_filteredDownloads.size())) {
-    return m_filteredDownloads[selectedIndex]->GetId();
-  }
-  return -1;
+  return GetRowId(selectedIndex);
 }
 
 std::shared_ptr<Download> DownloadsTable::GetSelectedDownload() const {
@@ -274,8 +458,9 @@ std::vector<int> DownloadsTable::GetSelectedDownloadIds() const {
 
   while ((selectedIndex = m_listCtrl->GetNextItem(
               selectedIndex, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED)) != -1) {
-    if (selectedIndex < static_cast<long>(m_filteredDownloads.size())) {
-      ids.push_back(m_filteredDownloads[selectedIndex]->GetId());
+    int downloadId = GetRowId(selectedIndex);
+    if (downloadId >= 0) {
+      ids.push_back(downloadId);
     }
   }
 
@@ -287,7 +472,12 @@ void DownloadsTable::OnItemSelected(wxListEvent &event) { event.Skip(); }
 void DownloadsTable::OnItemActivated(wxListEvent &event) {
   // Double-click behavior based on status
   long index = event.GetIndex();
-  if (index >= 0 && index < static_cast<long>(m_filteredDownloads.size())) {
+  if (const DownloadRecord *record = GetHistoryRecord(index)) {
+    // History is always completed: open the file
+    std::string filePath = record->savePath + "\\" + record->filename;
+    ShellExecuteA(NULL, "open", filePath.c_str(), NULL, NULL, SW_SHOWNORMAL);
+  } else if (index >= 0 &&
+             index < static_cast<long>(m_filteredDownloads.size())) {
     auto download = m_filteredDownloads[index];
 
     if (download->GetStatus() == DownloadStatus::Completed) {
@@ -313,12 +503,7 @@ void DownloadsTable::OnItemActivated(wxListEvent &event) {
 }
 
 void DownloadsTable::OnItemRightClick(wxListEvent &event) {
-  long index = event.GetIndex();
-  if (index >= 0 && index < static_cast<long>(m_filteredDownloads.size())) {
-    m_contextMenuDownloadId = m_filteredDownloads[index]->GetId();
-  } else {
-    m_contextMenuDownloadId = -1;
-  }
+  m_contextMenuDownloadId = GetRowId(event.GetIndex());
 
   // Create context menu
   wxMenu contextMenu;
@@ -327,6 +512,26 @@ void DownloadsTable::OnItemRightClick(wxListEvent &event) {
   contextMenu.AppendSeparator();
   contextMenu.Append(ID_CTX_RESUME, "Resume");
   contextMenu.Append(ID_CTX_PAUSE, "Pause");
+
+  wxMenu *priorityMenu = new wxMenu();
+  priorityMenu->AppendRadioItem(ID_CTX_PRIORITY_HIGH, "High");
+  priorityMenu->AppendRadioItem(ID_CTX_PRIORITY_NORMAL, "Normal");
+  priorityMenu->AppendRadioItem(ID_CTX_PRIORITY_LOW, "Low");
+  auto selected = FindDownloadById(m_contextMenuDownloadId);
+  if (selected) {
+    switch (selected->GetPriority()) {
+      case DownloadPriority::High:
+        priorityMenu->Check(ID_CTX_PRIORITY_HIGH, true);
+        break;
+      case DownloadPriority::Low:
+        priorityMenu->Check(ID_CTX_PRIORITY_LOW, true);
+        break;
+      default:
+        priorityMenu->Check(ID_CTX_PRIORITY_NORMAL, true);
+        break;
+    }
+  }
+  contextMenu.AppendSubMenu(priorityMenu, "Priority");
   contextMenu.AppendSeparator();
   contextMenu.Append(ID_CTX_DELETE, "Delete");
   contextMenu.Append(ID_CTX_DELETE_WITH_FILE, "Delete with File");
@@ -345,19 +550,17 @@ std::shared_ptr<Download> DownloadsTable::FindDownloadById(int downloadId) const
 }
 
 void DownloadsTable::OnContextOpen(wxCommandEvent &event) {
-  auto download = FindDownloadById(m_contextMenuDownloadId);
-  if (download) {
-    std::string filePath =
-        download->GetSavePath() + "\\" + download->GetFilename();
+  DownloadRecord record;
+  if (FindRecordById(m_contextMenuDownloadId, record)) {
+    std::string filePath = record.savePath + "\\" + record.filename;
     ShellExecuteA(NULL, "open", filePath.c_str(), NULL, NULL, SW_SHOWNORMAL);
   }
 }
 
 void DownloadsTable::OnContextOpenFolder(wxCommandEvent &event) {
-  auto download = FindDownloadById(m_contextMenuDownloadId);
-  if (download) {
-    std::string filePath =
-        download->GetSavePath() + "\\" + download->GetFilename();
+  DownloadRecord record;
+  if (FindRecordById(m_contextMenuDownloadId, record)) {
+    std::string filePath = record.savePath + "\\" + record.filename;
 
     // Use /select to highlight the file in Explorer
     std::string explorerCmd = "/select,\"" + filePath + "\"";
@@ -379,8 +582,8 @@ void DownloadsTable::OnContextPause(wxCommandEvent &event) {
 }
 
 void DownloadsTable::OnContextDelete(wxCommandEvent &event) {
-  auto download = FindDownloadById(m_contextMenuDownloadId);
-  if (download) {
+  DownloadRecord record;
+  if (FindRecordById(m_contextMenuDownloadId, record)) {
     // Create a custom dialog with checkbox
     wxDialog dlg(this, wxID_ANY, "Delete Download", wxDefaultPosition,
                  wxDefaultSize, wxDEFAULT_DIALOG_STYLE);
@@ -389,7 +592,7 @@ void DownloadsTable::OnContextDelete(wxCommandEvent &event) {
     // Message
     wxStaticText *msg = new wxStaticText(
         &dlg, wxID_ANY,
-        wxString::Format("Remove '%s' from list?", download->GetFilename()));
+        wxString::Format("Remove '%s' from list?", record.filename));
     mainSizer->Add(msg, 0, wxALL, 15);
 
     // Checkbox for delete file
@@ -412,7 +615,7 @@ void DownloadsTable::OnContextDelete(wxCommandEvent &event) {
 
     if (dlg.ShowModal() == wxID_OK) {
       bool deleteFile = deleteFileCheck->GetValue();
-      int downloadId = download->GetId();
+      int downloadId = record.id;
       DownloadManager::GetInstance().RemoveDownload(downloadId, deleteFile);
       RemoveDownload(downloadId);
     }
@@ -430,3 +633,18 @@ void DownloadsTable::OnContextDeleteWithFile(wxCommandEvent &event) {
     }
   }
 }
+
+void DownloadsTable::OnContextPriority(wxCommandEvent &event) {
+  if (m_contextMenuDownloadId < 0) {
+    return;
+  }
+
+  DownloadPriority priority = DownloadPriority::Normal;
+  if (event.GetId() == ID_CTX_PRIORITY_HIGH) {
+    priority = DownloadPriority::High;
+  } else if (event.GetId() == ID_CTX_PRIORITY_LOW) {
+    priority = DownloadPriority::Low;
+  }
+  DownloadManager::GetInstance().SetDownloadPriority(m_contextMenuDownloadId,
+                                                     priority);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/Download.h"
+#include "../database/DownloadRecord.h"
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -16,17 +17,40 @@ enum {
   ID_CTX_STOP,
   ID_CTX_DELETE,
   ID_CTX_DELETE_WITH_FILE,
-  ID_CTX_PROPERTIES
+  ID_CTX_PROPERTIES,
+  ID_CTX_PRIORITY_HIGH,
+  ID_CTX_PRIORITY_NORMAL,
+  ID_CTX_PRIORITY_LOW
+};
+
+class DownloadsTable;
+
+// Virtual-mode list: rows are produced on demand from the owning table's
+// filtered list, so only the visible rows are ever formatted
+class DownloadsListCtrl : public wxListCtrl {
+public:
+  DownloadsListCtrl(DownloadsTable *owner, wxWindow *parent, long style);
+
+protected:
+  wxString OnGetItemText(long item, long column) const override;
+  wxItemAttr *OnGetItemAttr(long item) const override;
+
+private:
+  DownloadsTable *m_owner;
 };
 
 class DownloadsTable : public wxPanel {
+  friend class DownloadsListCtrl;
+
 public:
   DownloadsTable(wxWindow *parent);
   ~DownloadsTable() = default;
 
   // Download management
   void AddDownload(std::shared_ptr<Download> download);
+  void AddDownloads(const std::vector<std::shared_ptr<Download>> &downloads);
   void RemoveDownload(int downloadId);
+  void RemoveDownloads(const std::vector<int> &downloadIds);
   void UpdateDownload(int downloadId);
   void RefreshAll();
 
@@ -38,21 +62,35 @@ public:
   int GetSelectedDownloadId() const;
   std::vector<int> GetSelectedDownloadIds() const;
 
-  // Get selected download
+  // Get selected download; nullptr for a completed history row
   std::shared_ptr<Download> GetSelectedDownload() const;
 
 private:
-  wxListCtrl *m_listCtrl;
+  DownloadsListCtrl *m_listCtrl;
   std::vector<std::shared_ptr<Download>> m_downloads;
   std::vector<std::shared_ptr<Download>>
       m_filteredDownloads;  // Visible downloads after filtering
   std::unordered_map<int, size_t> m_downloadIndex;  // Map download ID to index for O(1) lookup
   std::unordered_map<int, size_t> m_filteredIndex;  // Map download ID to filtered index for O(1) lookup
+  std::vector<uint64_t> m_rowGenerations;  // Download generation last drawn per filtered row
+  mutable wxItemAttr m_rowAttr;  // Returned by OnGetItemAttr, refilled per row
   wxString m_currentFilter; // Current category filter
   int m_contextMenuDownloadId;  // ID of right-clicked download (stable across refreshes)
 
+  // Completed history the filter shows, ascending; drawn newest first after
+  // the filtered downloads, each row read from the manager as a record
+  std::vector<int> m_historyIds;
+  mutable DownloadRecord m_historyRecord;  // Last history row read
+  mutable int m_historyRecordId = -1;
+  void LoadHistoryIds();
+  int GetRowId(long row) const;
+  const DownloadRecord *GetHistoryRecord(long row) const;
+  bool FindRecordById(int downloadId, DownloadRecord &record) const;
+
   void CreateColumns();
-  void UpdateRow(long row, std::shared_ptr<Download> download);
+  wxString GetCellText(long row, long column) const;
+  wxItemAttr *GetRowAttr(long row) const;
+  void RefreshRowIfChanged(size_t row);
   void ApplyFilter(); // Apply current filter to downloads
   std::shared_ptr<Download> FindDownloadById(int downloadId) const;
   wxString FormatFileSize(int64_t bytes) const;
@@ -72,6 +110,7 @@ private:
   void OnContextPause(wxCommandEvent &event);
   void OnContextDelete(wxCommandEvent &event);
   void OnContextDeleteWithFile(wxCommandEvent &event);
+  void OnContextPriority(wxCommandEvent &event);
 
   wxDECLARE_EVENT_TABLE();
 };
@@ -3,21 +3,26 @@
 #include "../core/YtDlpManager.h"
 #include "../database/DatabaseManager.h"
 #include "../utils/HttpServer.h"
+#include "../utils/Json.h"
+#include "../utils/Settings.h"
 #include "../utils/ThemeManager.h"
 #include "OptionsDialog.h"
 #include "SchedulerDialog.h"
 #include "VideoQualityDialog.h"
 #include <wx/dnd.h>
 #include <wx/file.h>
+#include <wx/filedlg.h>
 #include <wx/dir.h>
 #include <wx/utils.h>
 #include <wx/filename.h>
 #include <wx/msgdlg.h>
 #include <wx/stdpaths.h>
 #include <wx/progdlg.h>
+#include <algorithm>
 #include <vector>
 #include <thread>
 #include <iostream>
+#include <unordered_map>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -72,6 +77,8 @@ wxBEGIN_EVENT_TABLE(MainWindow, wxFrame) EVT_MENU(
                                                                                         EVT_MENU(ID_INSTALL_EXTENSION, MainWindow::OnInstallExtension)
                                                                                         EVT_MENU(ID_GRABBER, MainWindow::OnGrabber)
                                                                                         EVT_TOOL(ID_GRABBER, MainWindow::OnGrabber)
+                                                                                        EVT_MENU(ID_CHECK_LINKS, MainWindow::OnCheckLinks)
+                                                                                        EVT_MENU(ID_IMPORT_URL_LIST, MainWindow::OnImportUrlList)
                                                                                         wxEND_EVENT_TABLE()
 
                                                             MainWindow::MainWindow()
@@ -126,10 +133,7 @@ wxBEGIN_EVENT_TABLE(MainWindow, wxFrame) EVT_MENU(
 
   // Load existing downloads from database into the table
   DownloadManager &manager = DownloadManager::GetInstance();
-  auto downloads = manager.GetAllDownloads();
-  for (const auto &download : downloads) {
-    m_downloadsTable->AddDownload(download);
-  }
+  m_downloadsTable->AddDownloads(manager.GetSnapshot()->downloads);
 
   // Start update timer (500ms interval for UI refresh)
   m_updateTimer = new wxTimer(this, ID_UPDATE_TIMER);
@@ -146,6 +150,12 @@ wxBEGIN_EVENT_TABLE(MainWindow, wxFrame) EVT_MENU(
       std::cout << "[MainWindow] With referer: " << refererCopy << std::endl;
     }
     std::cout.flush();
+    // Start resolving video formats now, so the quality dialog ProcessUrl
+    // opens finds them cached instead of waiting on yt-dlp
+    YtDlpManager &ytdlp = YtDlpManager::GetInstance();
+    if (ytdlp.IsVideoSiteUrl(urlCopy)) {
+      ytdlp.PrefetchVideoInfo(urlCopy);
+    }
     // Post to main thread via wxWidgets event mechanism
     wxTheApp->CallAfter([this, urlCopy, refererCopy]() {
       std::cout << "[MainWindow] CallAfter executing with URL (len=" << urlCopy.length() << ")" << std::endl;
@@ -154,68 +164,306 @@ wxBEGIN_EVENT_TABLE(MainWindow, wxFrame) EVT_MENU(
     });
   });
 
-  // Set status callback for extension to get download speeds
-  httpServer.SetStatusCallback([]() -> std::string {
+  // Set status callback for extension to get download speeds. The JSON is
+  // only rebuilt when some download changed or was removed since the
+  // previous poll.
+  struct StatusCache {
+    std::mutex mutex;
+    std::string json;
+  };
+  auto statusCache = std::make_shared<StatusCache>();
+  httpServer.SetStatusCallback([statusCache]() -> std::string {
     DownloadManager &mgr = DownloadManager::GetInstance();
-    auto downloads = mgr.GetAllDownloads();
+    std::lock_guard<std::mutex> cacheLock(statusCache->mutex);
+    std::vector<int> removed;
+    if (mgr.DrainChanged(ChangeConsumer::Status, &removed).empty() &&
+        removed.empty() && !statusCache->json.empty()) {
+      return statusCache->json;
+    }
+
+    // Only active downloads are reported; the status index avoids walking
+    // the whole history on every poll
+    auto downloads = mgr.GetDownloadsByStatus(DownloadStatus::Downloading);
 
     int activeCount = 0;
     double totalSpeed = 0;
-    std::string downloadsJson = "[";
-    bool first = true;
-
+    JsonWriter json(128 + downloads.size() * 160);
+    json.BeginObject().Key("status").String("ok").Key("downloads").BeginArray();
     for (const auto &dl : downloads) {
-      DownloadStatus status = dl->GetStatus();
-      if (status == DownloadStatus::Downloading) {
-        activeCount++;
-        double speed = dl->GetSpeed();
-        totalSpeed += speed;
-
-        if (!first) downloadsJson += ",";
-        first = false;
-
-        // Escape filename for JSON
-        std::string filename = dl->GetFilename();
-        std::string escapedFilename;
-        escapedFilename.reserve(filename.size() + 16);
-        for (char c : filename) {
-          if (c == '"') escapedFilename += "\\\"";
-          else if (c == '\\') escapedFilename += "\\\\";
-          else if (c == '\n') escapedFilename += "\\n";
-          else if (c == '\r') escapedFilename += "\\r";
-          else if (c == '\t') escapedFilename += "\\t";
-          else escapedFilename += c;
+      if (dl->GetStatus() != DownloadStatus::Downloading) {
+        continue;
+      }
+      activeCount++;
+      double speed = dl->GetSpeed();
+      totalSpeed += speed;
+
+      json.BeginObject()
+          .Key("id").Int(dl->GetId())
+          .Key("filename").String(dl->GetFilename())
+          .Key("progress").Double(dl->GetProgress(), 1)
+          .Key("speed").Int(static_cast<int64_t>(speed))
+          .Key("size").Int(dl->GetTotalSize())
+          .Key("downloaded").Int(dl->GetDownloadedSize())
+          .EndObject();
+    }
+    json.EndArray()
+        .Key("activeDownloads").Int(activeCount)
+        .Key("totalSpeed").Int(static_cast<int64_t>(totalSpeed))
+        .EndObject();
+
+    statusCache->json = json.Take();
+    return statusCache->json;
+  });
+
+  // History queries for external dashboards (GET /downloads). The ETag is
+  // derived from the ids and change generations on the page, so an
+  // unchanged page is answered with 304 before anything is serialized.
+  httpServer.SetQueryCallback([](const HttpServer::QueryParams &params,
+                                 const std::string &ifNoneMatch,
+                                 std::string &etag, std::string &body) {
+    auto param = [&params](const char *name) {
+      auto it = params.find(name);
+      return it == params.end() ? std::string() : it->second;
+    };
+
+    DownloadManager::DownloadQuery query;
+    query.category = param("category");
+    query.host = param("host");
+    query.text = param("q");
+    try {
+      if (!param("cursor").empty()) {
+        query.beforeId = std::stoi(param("cursor"));
+      }
+      if (!param("limit").empty()) {
+        query.limit = static_cast<size_t>(std::clamp(std::stoi(param("limit")), 1, 1000));
+      }
+    } catch (...) {
+      // Keep the defaults
+    }
+
+    // Comma-separated status names; if none is recognised nothing matches
+    bool impossible = false;
+    std::string statusList = param("status");
+    if (!statusList.empty()) {
+      std::transform(statusList.begin(), statusList.end(), statusList.begin(), ::tolower);
+      for (int i = 0; i <= static_cast<int>(DownloadStatus::Cancelled); ++i) {
+        auto status = static_cast<DownloadStatus>(i);
+        std::string name = Download::StatusToString(status);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (("," + statusList + ",").find("," + name + ",") != std::string::npos) {
+          query.statuses.push_back(status);
         }
+      }
+      impossible = query.statuses.empty();
+    }
 
-        // Build JSON using string concatenation (no buffer overflow risk)
-        downloadsJson += "{\"id\":";
-        downloadsJson += std::to_string(dl->GetId());
-        downloadsJson += ",\"filename\":\"";
-        downloadsJson += escapedFilename;
-        downloadsJson += "\",\"progress\":";
-        downloadsJson += std::to_string(static_cast<int>(dl->GetProgress() * 10) / 10.0).substr(0, 5);
-        downloadsJson += ",\"speed\":";
-        downloadsJson += std::to_string(static_cast<long long>(speed));
-        downloadsJson += ",\"size\":";
-        downloadsJson += std::to_string(dl->GetTotalSize());
-        downloadsJson += ",\"downloaded\":";
-        downloadsJson += std::to_string(dl->GetDownloadedSize());
-        downloadsJson += "}";
+    DownloadManager::DownloadPage page;
+    if (!impossible) {
+      page = DownloadManager::GetInstance().QueryDownloads(query);
+    }
+
+    // FNV-1a over what the page shows
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value) {
+      for (int i = 0; i < 8; ++i) {
+        hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ull;
       }
+    };
+    for (const auto &row : page.downloads) {
+      mix(static_cast<uint64_t>(row.record.id));
+      mix(row.generation);
+    }
+    mix(static_cast<uint64_t>(static_cast<int64_t>(page.nextCursor)));
+    static const char HEX[] = "0123456789abcdef";
+    etag = "\"";
+    for (int shift = 60; shift >= 0; shift -= 4) {
+      etag += HEX[(hash >> shift) & 0xF];
+    }
+    etag += "\"";
+    if (etag == ifNoneMatch) {
+      return;
+    }
+
+    JsonWriter json(128 + page.downloads.size() * 320);
+    json.BeginObject().Key("status").String("ok").Key("downloads").BeginArray();
+    for (const auto &row : page.downloads) {
+      const DownloadRecord &dl = row.record;
+      json.BeginObject()
+          .Key("id").Int(dl.id)
+          .Key("url").String(dl.url)
+          .Key("filename").String(dl.filename)
+          .Key("status").String(Download::StatusToString(dl.status))
+          .Key("category").String(dl.category)
+          .Key("savePath").String(dl.savePath)
+          .Key("size").Int(dl.totalSize)
+          .Key("downloaded").Int(dl.downloadedSize)
+          .Key("progress").Double(row.progress, 1)
+          .Key("speed").Int(static_cast<int64_t>(row.speed))
+          .Key("error").String(dl.errorMessage)
+          .EndObject();
     }
-    downloadsJson += "]";
-
-    // Build final result using string concatenation
-    std::string result = "{\"status\":\"ok\",\"activeDownloads\":";
-    result += std::to_string(activeCount);
-    result += ",\"totalSpeed\":";
-    result += std::to_string(static_cast<long long>(totalSpeed));
-    result += ",\"downloads\":";
-    result += downloadsJson;
-    result += "}";
-    return result;
+    json.EndArray().Key("nextCursor");
+    if (page.nextCursor >= 0) {
+      json.Int(page.nextCursor);
+    } else {
+      json.Null();
+    }
+    json.EndObject();
+    body = json.Take();
   });
 
+  // Batches are added with one bulk call on the server's query thread;
+  // only the table update is posted to the UI thread, once per batch
+  httpServer.SetBatchCallback(
+      [this](const std::vector<HttpServer::DownloadSubmission> &batch) {
+        DownloadManager &manager = DownloadManager::GetInstance();
+        std::vector<std::string> urls;
+        urls.reserve(batch.size());
+        for (const auto &submission : batch) {
+          urls.push_back(submission.url);
+        }
+        std::vector<int> ids = manager.AddDownloads(urls);
+
+        std::vector<std::shared_ptr<Download>> added;
+        added.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+          const auto &submission = batch[i];
+          // A mirror stands in when the primary URL is rejected
+          for (size_t m = 0; ids[i] < 0 && m < submission.mirrors.size(); ++m) {
+            ids[i] = manager.AddDownload(submission.mirrors[m]);
+          }
+          auto download = ids[i] >= 0 ? manager.GetDownload(ids[i]) : nullptr;
+          if (!download) {
+            continue;
+          }
+
+          if (!submission.referer.empty()) {
+            download->SetReferer(submission.referer);
+          }
+          if (!submission.checksum.empty()) {
+            // Type from an "md5:" / "sha256:" prefix, else from the length
+            std::string hash = submission.checksum;
+            int type = hash.size() == 32 ? 1 : hash.size() == 64 ? 2 : 0;
+            size_t colon = hash.find(':');
+            if (colon != std::string::npos) {
+              std::string algorithm = hash.substr(0, colon);
+              type = algorithm == "md5" ? 1 : algorithm == "sha256" ? 2 : 0;
+              hash = hash.substr(colon + 1);
+            }
+            if (type != 0) {
+              download->SetExpectedChecksum(hash, type);
+            }
+          }
+          // Through the manager, so the record is saved with everything above
+          manager.SetDownloadPriority(
+              ids[i], static_cast<DownloadPriority>(submission.priority));
+          added.push_back(std::move(download));
+        }
+
+        if (!added.empty()) {
+          wxTheApp->CallAfter([this, added]() {
+            m_downloadsTable->AddDownloads(added);
+            // Started through the queue so a large batch honours the
+            // simultaneous download limit
+            DownloadManager &manager = DownloadManager::GetInstance();
+            manager.StartQueue();
+            m_statusBar->SetStatusText(
+                wxString::Format("Added %zu downloads from browser", added.size()), 0);
+            m_statusBar->SetStatusText(
+                wxString::Format("Downloads: %d", manager.GetTotalDownloads()), 1);
+          });
+        }
+        return ids;
+      });
+
+  // Batch control from /rpc. Pause and resume are applied directly; removal
+  // waits for transfer threads, so it runs on the UI thread like a manual one.
+  httpServer.SetControlCallback([this](const std::string &method,
+                                       const std::vector<int> &ids,
+                                       bool deleteFiles) -> int {
+    DownloadManager &manager = DownloadManager::GetInstance();
+    if (method != "pause" && method != "resume" && method != "remove") {
+      return -1;
+    }
+
+    int applied = 0;
+    for (int id : ids) {
+      if (!manager.GetDownload(id)) {
+        continue;
+      }
+      applied++;
+      if (method == "pause") {
+        manager.PauseDownload(id);
+      } else if (method == "resume") {
+        manager.ResumeDownload(id);
+      }
+    }
+
+    if (method == "remove" && applied > 0) {
+      wxTheApp->CallAfter([this, ids, deleteFiles]() {
+        DownloadManager::GetInstance().RemoveDownloads(ids, deleteFiles);
+        m_downloadsTable->RemoveDownloads(ids);
+      });
+    }
+    return applied;
+  });
+
+  // Event stream for the extension: deltas for whatever the engine changed
+  // since the previous batch. The server calls this once per batch however
+  // many subscribers there are; lastStatus tells the event kinds apart.
+  auto lastStatus = std::make_shared<std::unordered_map<int, DownloadStatus>>();
+  httpServer.SetEventsCallback([lastStatus]() -> std::string {
+    std::string events;
+    JsonWriter data(192);
+    std::vector<int> removed;
+    for (const auto &dl : DownloadManager::GetInstance().DrainChanged(
+             ChangeConsumer::Events, &removed)) {
+      int id = dl->GetId();
+      DownloadStatus status = dl->GetStatus();
+      auto it = lastStatus->find(id);
+      const char *type = nullptr;  // Progress only, unless set below
+      if (it == lastStatus->end()) {
+        type = "added";
+        lastStatus->emplace(id, status);
+      } else if (it->second != status) {
+        type = status == DownloadStatus::Completed ? "completed" : "status";
+        it->second = status;
+      }
+
+      data.Clear();
+      data.BeginObject().Key("id").Int(id);
+      if (type) {
+        data.Key("filename").String(dl->GetFilename())
+            .Key("status").String(Download::StatusToString(status));
+      }
+      data.Key("progress").Double(dl->GetProgress(), 1)
+          .Key("speed").Int(static_cast<int64_t>(dl->GetSpeed()))
+          .Key("size").Int(dl->GetTotalSize())
+          .Key("downloaded").Int(dl->GetDownloadedSize())
+          .EndObject();
+
+      events += "event: ";
+      events += type ? type : "progress";
+      events += "\ndata: ";
+      events += data.Str();
+      events += "\n\n";
+    }
+    if (!removed.empty()) {
+      data.Clear();
+      data.BeginObject().Key("ids").BeginArray();
+      for (int id : removed) {
+        lastStatus->erase(id);
+        data.Int(id);
+      }
+      data.EndArray().EndObject();
+      events += "event: removed\ndata: ";
+      events += data.Str();
+      events += "\n\n";
+    }
+    return events;
+  });
+  httpServer.SetEventInterval(Settings::GetInstance().GetEventIntervalMs());
+
   if (!httpServer.Start(45678)) {
     // Non-fatal: log but don't show error (port might be in use)
     wxLogDebug("Failed to start HTTP server on port 45678");
@@ -232,6 +480,10 @@ MainWindow::~MainWindow() {
   // Clear callbacks first to prevent calls with dangling 'this'
   HttpServer::GetInstance().SetUrlCallback(nullptr);
   HttpServer::GetInstance().SetStatusCallback(nullptr);
+  HttpServer::GetInstance().SetEventsCallback(nullptr);
+  HttpServer::GetInstance().SetQueryCallback(nullptr);
+  HttpServer::GetInstance().SetBatchCallback(nullptr);
+  HttpServer::GetInstance().SetControlCallback(nullptr);
 
   // Stop HTTP server and wait for threads
   HttpServer::GetInstance().Stop();
@@ -270,6 +522,9 @@ void MainWindow::CreateMenuBar() {
 
   // File menu
   m_fileMenu = new wxMenu();
+  m_fileMenu->Append(ID_IMPORT_URL_LIST, "&Import URL List...",
+                     "Queue every URL listed in a text file");
+  m_fileMenu->AppendSeparator();
   m_fileMenu->Append(ID_DELETE, "&Delete\tDel", "Delete selected download");
   m_fileMenu->Append(ID_DELETE_COMPLETED, "Delete &Completed",
                      "Delete completed downloads");
@@ -281,6 +536,8 @@ void MainWindow::CreateMenuBar() {
   m_downloadsMenu->Append(ID_START_QUEUE, "Start &Queue",
                           "Start download queue");
   m_downloadsMenu->Append(ID_STOP_QUEUE, "Stop Q&ueue", "Stop download queue");
+  m_downloadsMenu->Append(ID_CHECK_LINKS, "Check &Links",
+                          "Check unfinished download links");
   m_downloadsMenu->AppendSeparator();
   m_downloadsMenu->Append(ID_GRABBER, "&Grabber...", "Open URL grabber");
   m_menuBar->Append(m_downloadsMenu, "&Downloads");
@@ -652,7 +909,7 @@ void MainWindow::ProcessUrl(const wxString &url, const wxString &referer) {
 
       // Check for validation error
       if (downloadId < 0) {
-        wxMessageBox("Invalid or unsupported URL.\n\nSupported: HTTP, HTTPS, FTP\nNot supported: blob:, data:, streaming (m3u8, mpd)",
+        wxMessageBox("Invalid or unsupported URL.\n\nSupported: HTTP, HTTPS, FTP\nNot supported: blob:, data:",
                      "Invalid URL", wxOK | wxICON_ERROR, this);
         m_statusBar->SetStatusText("Invalid URL entered", 0);
         return;
@@ -814,6 +1071,44 @@ void MainWindow::OnStopQueue(wxCommandEvent &event) {
   m_statusBar->SetStatusText("Download queue stopped", 0);
 }
 
+void MainWindow::OnCheckLinks(wxCommandEvent &event) {
+  int count = DownloadManager::GetInstance().CheckLinks();
+  if (count > 0) {
+    m_statusBar->SetStatusText(
+        wxString::Format("Checking %d link(s)...", count), 0);
+  } else {
+    m_statusBar->SetStatusText("No links to check", 0);
+  }
+}
+
+void MainWindow::OnImportUrlList(wxCommandEvent &event) {
+  wxFileDialog dialog(this, "Import URL List", "", "",
+                      "Text files (*.txt)|*.txt|All files (*.*)|*.*",
+                      wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+  if (dialog.ShowModal() != wxID_OK) {
+    return;
+  }
+
+  DownloadManager &manager = DownloadManager::GetInstance();
+  int added;
+  {
+    wxBusyCursor wait;
+    added = manager.ImportUrlList(dialog.GetPath().ToStdString());
+    if (added > 0) {
+      // The table skips downloads it already shows
+      m_downloadsTable->AddDownloads(manager.GetSnapshot()->downloads);
+    }
+  }
+
+  if (added < 0) {
+    wxMessageBox("Could not open the selected file.", "Import URL List",
+                 wxOK | wxICON_ERROR, this);
+    return;
+  }
+  m_statusBar->SetStatusText(
+      wxString::Format("Imported %d download(s)", added), 0);
+}
+
 void MainWindow::OnViewDarkMode(wxCommandEvent &event) {
   bool isDarkMode = event.IsChecked();
   ThemeManager::GetInstance().SetDarkMode(isDarkMode);
@@ -845,16 +1140,20 @@ void MainWindow::OnUpdateTimer(wxTimerEvent &event) {
     return;
   }
   
-  // Refresh downloads table with latest data from DownloadManager
+  // Redraw only the rows whose downloads changed since the last tick, and
+  // drop those removed without the table hearing of it
   DownloadManager &manager = DownloadManager::GetInstance();
-  auto downloads = manager.GetAllDownloads();
-
-  // Update each download in the table
-  for (const auto &download : downloads) {
+  std::vector<int> removed;
+  for (const auto &download :
+       manager.DrainChanged(ChangeConsumer::Table, &removed)) {
     m_downloadsTable->UpdateDownload(download->GetId());
   }
+  if (!removed.empty()) {
+    m_downloadsTable->RemoveDownloads(removed);
+  }
 
   // Periodic database save (every 60 ticks = 30 seconds at 500ms interval)
+  // of the downloads that changed since the last one.
   // This ensures progress is saved in case of crash
   // Run in background thread to avoid UI blocking
   m_dbSaveCounter++;
@@ -870,7 +1169,7 @@ void MainWindow::OnUpdateTimer(wxTimerEvent &event) {
 
       m_dbSaveInProgress.store(true);
       m_dbSaveThread = std::thread([this]() {
-        DownloadManager::GetInstance().SaveAllDownloadsToDatabase();
+        DownloadManager::GetInstance().SaveChangedDownloadsToDatabase();
         DatabaseManager::GetInstance().Flush();
         m_dbSaveInProgress.store(false);
       });
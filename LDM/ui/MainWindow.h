@@ -76,6 +76,8 @@ private:
   void OnScheduler(wxCommandEvent &event);
   void OnStartQueue(wxCommandEvent &event);
   void OnStopQueue(wxCommandEvent &event);
+  void OnCheckLinks(wxCommandEvent &event);
+  void OnImportUrlList(wxCommandEvent &event);
   void OnViewDarkMode(wxCommandEvent &event);
   void OnCategorySelected(wxTreeEvent &event);
   void OnUpdateTimer(wxTimerEvent &event);
@@ -120,7 +122,9 @@ enum {
   ID_UPDATE_TIMER,
   ID_INSTALL_EXTENSION,
   ID_TRAY_SHOW,
-  ID_TRAY_EXIT
+  ID_TRAY_EXIT,
+  ID_CHECK_LINKS,
+  ID_IMPORT_URL_LIST
 };
 
 // System tray icon class
@@ -85,7 +85,7 @@ void OptionsDialog::CreateConnectionTab(wxNotebook *notebook) {
   wxStaticBoxSizer *limitsBox =
       new wxStaticBoxSizer(wxVERTICAL, panel, "Connection Limits");
 
-  wxFlexGridSizer *gridSizer = new wxFlexGridSizer(2, 2, 5, 10);
+  wxFlexGridSizer *gridSizer = new wxFlexGridSizer(3, 2, 5, 10);
 
   gridSizer->Add(new wxStaticText(panel, wxID_ANY,
                                   "Max connections per download (WinINet: 1):"),
@@ -104,6 +104,18 @@ void OptionsDialog::CreateConnectionTab(wxNotebook *notebook) {
                      wxSP_ARROW_KEYS, 1, 10, 3);
   gridSizer->Add(m_maxDownloadsSpin, 0);
 
+  gridSizer->Add(new wxStaticText(panel, wxID_ANY, "Queue order:"), 0,
+                 wxALIGN_CENTER_VERTICAL);
+  // Order matches QueuePolicy
+  wxArrayString policies;
+  policies.Add("First in, first out");
+  policies.Add("Smallest remaining first");
+  policies.Add("Fair share per server");
+  policies.Add("By priority");
+  m_queuePolicyChoice =
+      new wxChoice(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, policies);
+  gridSizer->Add(m_queuePolicyChoice, 0);
+
   limitsBox->Add(gridSizer, 0, wxALL, 5);
   sizer->Add(limitsBox, 0, wxEXPAND | wxALL, 10);
 
@@ -248,6 +260,7 @@ void OptionsDialog::LoadSettings() {
   m_showNotificationsCheck->SetValue(settings.GetShowNotifications());
   m_maxConnectionsSpin->SetValue(settings.GetMaxConnections());
   m_maxDownloadsSpin->SetValue(settings.GetMaxSimultaneousDownloads());
+  m_queuePolicyChoice->SetSelection(settings.GetQueuePolicy());
   m_speedLimitSpin->SetValue(settings.GetSpeedLimit());
   m_useProxyCheck->SetValue(settings.GetUseProxy());
   m_proxyHostText->SetValue(settings.GetProxyHost());
@@ -272,6 +285,7 @@ void OptionsDialog::SaveSettings() {
   settings.SetShowNotifications(m_showNotificationsCheck->GetValue());
   settings.SetMaxConnections(m_maxConnectionsSpin->GetValue());
   settings.SetMaxSimultaneousDownloads(m_maxDownloadsSpin->GetValue());
+  settings.SetQueuePolicy(m_queuePolicyChoice->GetSelection());
   settings.SetSpeedLimit(m_speedLimitSpin->GetValue());
   settings.SetUseProxy(m_useProxyCheck->GetValue());
   settings.SetProxyHost(m_proxyHostText->GetValue().ToStdString());
@@ -23,6 +23,7 @@ private:
   // Connection tab controls
   wxSpinCtrl *m_maxConnectionsSpin;
   wxSpinCtrl *m_maxDownloadsSpin;
+  wxChoice *m_queuePolicyChoice;
   wxSpinCtrl *m_speedLimitSpin;
   wxCheckBox *m_useProxyCheck;
   wxTextCtrl *m_proxyHostText;
@@ -1,9 +1,11 @@
 #include "HttpServer.h"
+#include "Json.h"
 
 #include <sstream>
 #include <random>
 #include <iomanip>
 #include <algorithm>  // for std::transform
+#include <cstring>
 #include <iostream>
 
 #ifdef _WIN32
@@ -13,13 +15,22 @@
 #pragma comment(lib, "Ws2_32.lib")
 #endif
 
+// WSAPOLLFD::fd is a SOCKET in Winsock but an int in the tests' shim
+static WSAPOLLFD PollEntry(uintptr_t socket, SHORT events) {
+  WSAPOLLFD entry = {};
+  entry.fd = (SOCKET)socket;
+  entry.events = events;
+  return entry;
+}
+
 HttpServer &HttpServer::GetInstance() {
   static HttpServer instance;
   return instance;
 }
 
 HttpServer::HttpServer()
-    : m_running(false), m_listenSocket(INVALID_SOCKET), m_port(45678) {
+    : m_running(false), m_listenSocket(INVALID_SOCKET),
+      m_wakeSocket(INVALID_SOCKET), m_port(45678) {
 #ifdef _WIN32
   WSADATA wsaData;
   WSAStartup(MAKEWORD(2, 2), &wsaData);
@@ -175,8 +186,20 @@ bool HttpServer::Start(int port) {
     return false;
   }
 
+  // The loop polls the listening socket, so accept() must never block
+  u_long nonBlocking = 1;
+  ioctlsocket((SOCKET)m_listenSocket, FIONBIO, &nonBlocking);
+
+  if (!OpenWakeSocket()) {
+    std::cerr << "[HttpServer] Could not open the wake socket" << std::endl;
+    closesocket((SOCKET)m_listenSocket);
+    m_listenSocket = INVALID_SOCKET;
+    return false;
+  }
+
   m_running.store(true);
   m_serverThread = std::thread(&HttpServer::ServerLoop, this);
+  m_queryThread = std::thread(&HttpServer::QueryLoop, this);
 
   std::cout << "[HttpServer] Started on port " << port << std::endl;
   return true;
@@ -186,31 +209,52 @@ void HttpServer::Stop() {
   if (!m_running.load())
     return;
 
+  // The loop notices within one poll interval and closes its connections
   m_running.store(false);
+  {
+    std::lock_guard<std::mutex> lock(m_queryMutex);
+  }
+  m_queryCv.notify_all();
+  if (m_serverThread.joinable()) {
+    m_serverThread.join();
+  }
+  if (m_queryThread.joinable()) {
+    m_queryThread.join();  // A query already running is finished first
+  }
+  m_queryJobs.clear();
+  m_queryResults.clear();
 
-  // Close listen socket to unblock accept()
   if (m_listenSocket != INVALID_SOCKET) {
     closesocket((SOCKET)m_listenSocket);
     m_listenSocket = INVALID_SOCKET;
   }
-
-  if (m_serverThread.joinable()) {
-    m_serverThread.join();
+  if (m_wakeSocket != INVALID_SOCKET) {
+    closesocket((SOCKET)m_wakeSocket);
+    m_wakeSocket = INVALID_SOCKET;
   }
+}
 
-  // Wait for all client handler threads to finish
-  // Use a longer timeout (30s) and poll to ensure clean shutdown
-  {
-    std::unique_lock<std::mutex> lock(m_clientThreadsMutex);
-    int waitAttempts = 0;
-    const int maxWaitAttempts = 60;  // 60 * 500ms = 30 seconds max
-    while (m_activeClientCount.load() > 0 && waitAttempts < maxWaitAttempts) {
-      m_clientsDoneCondition.wait_for(lock, std::chrono::milliseconds(500));
-      waitAttempts++;
-    }
-    // If threads are still active after timeout, they will be orphaned
-    // but m_running is false so they will exit on next check
+bool HttpServer::OpenWakeSocket() {
+  // A datagram socket connected to itself: the query thread sends a byte,
+  // and the loop, which polls it with the connections, wakes up to it
+  SOCKET wakeSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (wakeSocket == INVALID_SOCKET) {
+    return false;
   }
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t addrLen = sizeof(addr);
+  if (bind(wakeSocket, (sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR ||
+      getsockname(wakeSocket, (sockaddr *)&addr, &addrLen) == SOCKET_ERROR ||
+      connect(wakeSocket, (sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR) {
+    closesocket(wakeSocket);
+    return false;
+  }
+  u_long nonBlocking = 1;
+  ioctlsocket(wakeSocket, FIONBIO, &nonBlocking);
+  m_wakeSocket = (uintptr_t)wakeSocket;
+  return true;
 }
 
 void HttpServer::SetUrlCallback(UrlCallback callback) {
@@ -224,163 +268,657 @@ void HttpServer::SetStatusCallback(StatusCallback callback) {
   m_statusCallback = callback;
 }
 
+void HttpServer::SetQueryCallback(QueryCallback callback) {
+  std::lock_guard<std::mutex> lock(m_callbackMutex);
+  m_queryCallback = callback;
+}
+
+void HttpServer::SetBatchCallback(BatchCallback callback) {
+  std::lock_guard<std::mutex> lock(m_callbackMutex);
+  m_batchCallback = callback;
+}
+
+void HttpServer::SetControlCallback(ControlCallback callback) {
+  std::lock_guard<std::mutex> lock(m_callbackMutex);
+  m_controlCallback = callback;
+}
+
+void HttpServer::SetEventsCallback(EventsCallback callback) {
+  std::lock_guard<std::mutex> lock(m_callbackMutex);
+  m_eventsCallback = callback;
+}
+
 void HttpServer::ServerLoop() {
+  std::vector<Connection> connections;
+  std::vector<WSAPOLLFD> pollFds;
+
   while (m_running.load()) {
-    sockaddr_in clientAddr = {};
-    int addrLen = sizeof(clientAddr);
+    // Slot 0 is the listening socket, slot 1 the wake socket and slot
+    // i + 2 is connections[i]
+    pollFds.resize(connections.size() + 2);
+    pollFds[0] = PollEntry(m_listenSocket, POLLRDNORM);
+    pollFds[1] = PollEntry(m_wakeSocket, POLLRDNORM);
+    int timeout = POLL_INTERVAL_MS;
+    for (size_t i = 0; i < connections.size(); ++i) {
+      const Connection &connection = connections[i];
+      if (connection.eventStream) {
+        timeout = std::min(timeout, m_eventIntervalMs.load());
+      }
+      SHORT events = POLLRDNORM;
+      if (connection.outOffset < connection.out.size()) {
+        events |= POLLWRNORM;
+      }
+      pollFds[i + 2] = PollEntry(connection.socket, events);
+    }
+
+    int ready = WSAPoll(pollFds.data(), static_cast<ULONG>(pollFds.size()),
+                        timeout);
+    if (ready == SOCKET_ERROR) {
+      std::cerr << "[HttpServer] WSAPoll failed: " << WSAGetLastError()
+                << std::endl;
+      break;
+    }
+
+    // Queued here so the write pass below sends it in this same iteration
+    if (pollFds[1].revents & POLLRDNORM) {
+      DeliverQueryResults(connections);
+    }
+    BroadcastEvents(connections);
+
+    auto now = std::chrono::steady_clock::now();
+    std::vector<Connection> alive;
+    alive.reserve(connections.size());
+    for (size_t i = 0; i < connections.size(); ++i) {
+      Connection &connection = connections[i];
+      SHORT revents = pollFds[i + 2].revents;
+      bool open = true;
+
+      if (revents & (POLLERR | POLLNVAL)) {
+        open = false;
+      } else {
+        if (revents & (POLLRDNORM | POLLHUP)) {
+          open = ReadFromConnection(connection);
+          if (open) {
+            ProcessRequests(connection);
+          }
+        }
+        if (open && connection.outOffset < connection.out.size()) {
+          open = WriteToConnection(connection);
+        }
+        if (open && connection.closeAfterWrite && !connection.awaitingQuery &&
+            connection.outOffset >= connection.out.size()) {
+          open = false;
+        }
+        if (open && connection.eventStream &&
+            connection.out.size() - connection.outOffset >
+                MAX_EVENT_BACKLOG_BYTES) {
+          open = false;  // Subscriber stopped reading
+        }
+        if (open && revents == 0 && !connection.eventStream &&
+            !connection.awaitingQuery &&
+            now - connection.lastActivity >
+                std::chrono::seconds(IDLE_TIMEOUT_SECONDS)) {
+          open = false;
+        }
+      }
+
+      if (open) {
+        alive.push_back(std::move(connection));
+      } else {
+        closesocket((SOCKET)connection.socket);
+      }
+    }
+    connections.swap(alive);
+
+    if (pollFds[0].revents & POLLRDNORM) {
+      AcceptConnections(connections);
+    }
+  }
 
+  for (const auto &connection : connections) {
+    closesocket((SOCKET)connection.socket);
+  }
+}
+
+void HttpServer::AcceptConnections(std::vector<Connection> &connections) {
+  while (true) {
+    sockaddr_in clientAddr = {};
+    socklen_t addrLen = sizeof(clientAddr);
     SOCKET clientSocket =
         accept((SOCKET)m_listenSocket, (sockaddr *)&clientAddr, &addrLen);
-
     if (clientSocket == INVALID_SOCKET) {
-      continue;
+      return;  // WSAEWOULDBLOCK: backlog drained
     }
 
-    // Enforce connection limit to prevent thread exhaustion
-    if (m_activeClientCount.load() >= MAX_CONCURRENT_CLIENTS) {
+    if (connections.size() >= MAX_CONNECTIONS) {
       // Too many connections - send 503 and close immediately
-      const char* response = "HTTP/1.1 503 Service Unavailable\r\n"
+      const char *response = "HTTP/1.1 503 Service Unavailable\r\n"
+                             "Connection: close\r\n"
                              "Content-Length: 0\r\n\r\n";
       send(clientSocket, response, (int)strlen(response), 0);
       closesocket(clientSocket);
       continue;
     }
 
-    // Handle in a detached thread (simple approach for low traffic)
-    std::thread(&HttpServer::HandleClient, this, (uintptr_t)clientSocket)
-        .detach();
+    u_long nonBlocking = 1;
+    ioctlsocket(clientSocket, FIONBIO, &nonBlocking);
+
+    Connection connection;
+    connection.id = ++m_nextConnectionId;
+    connection.socket = (uintptr_t)clientSocket;
+    connection.lastActivity = std::chrono::steady_clock::now();
+    connections.push_back(std::move(connection));
   }
 }
 
-void HttpServer::HandleClient(uintptr_t clientSocket) {
-  // RAII guard to track active client count
-  m_activeClientCount.fetch_add(1);
-  struct ClientGuard {
-    HttpServer* server;
-    ~ClientGuard() {
-      if (server->m_activeClientCount.fetch_sub(1) == 1) {
-        std::lock_guard<std::mutex> lock(server->m_clientThreadsMutex);
-        server->m_clientsDoneCondition.notify_all();
+bool HttpServer::ReadFromConnection(Connection &connection) {
+  char buffer[8192];
+  while (true) {
+    int bytesRead =
+        recv((SOCKET)connection.socket, buffer, sizeof(buffer), 0);
+    if (bytesRead > 0) {
+      connection.in.append(buffer, bytesRead);
+      connection.lastActivity = std::chrono::steady_clock::now();
+      if (connection.in.size() > MAX_HEADER_BYTES + MAX_BODY_BYTES) {
+        return false;
       }
+      continue;
+    }
+    if (bytesRead == 0) {
+      // Peer closed its side; still answer what it already sent
+      connection.closeAfterWrite = true;
+      return !connection.in.empty() || connection.awaitingQuery ||
+             connection.outOffset < connection.out.size();
+    }
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+  }
+}
+
+bool HttpServer::WriteToConnection(Connection &connection) {
+  while (connection.outOffset < connection.out.size()) {
+    int sent = send((SOCKET)connection.socket,
+                    connection.out.data() + connection.outOffset,
+                    (int)(connection.out.size() - connection.outOffset), 0);
+    if (sent == SOCKET_ERROR) {
+      return WSAGetLastError() == WSAEWOULDBLOCK;
     }
-  } guard{this};
+    connection.outOffset += static_cast<size_t>(sent);
+    connection.lastActivity = std::chrono::steady_clock::now();
+  }
+  connection.out.clear();
+  connection.outOffset = 0;
+  return true;
+}
 
-  SOCKET sock = (SOCKET)clientSocket;
+void HttpServer::ProcessRequests(Connection &connection) {
+  if (connection.eventStream) {
+    connection.in.clear();  // Nothing more is expected from a subscriber
+    return;
+  }
+  if (connection.awaitingQuery) {
+    return;  // Picked up again when the query's response is delivered
+  }
 
-  // Set receive timeout (5 seconds) to prevent blocking forever
-  DWORD timeout = 5000;
-  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+  // Pipelined requests are answered in arrival order
+  while (!connection.closeAfterWrite || !connection.in.empty()) {
+    HttpRequest request;
+    std::string error;
+    ParseStatus status = ParseRequest(connection, request, error);
+    if (status == ParseStatus::Incomplete) {
+      return;
+    }
+    if (status == ParseStatus::Error) {
+      JsonWriter body(64 + error.size());
+      body.BeginObject().Key("status").String("error").Key("message").String(error).EndObject();
+      connection.out += BuildResponse("400 Bad Request", "", body.Str(), false);
+      connection.in.clear();
+      connection.closeAfterWrite = true;
+      return;
+    }
 
-  // Read request (headers + body)
-  std::string request;
-  request.reserve(8192);
-  char buffer[8192] = {};
-  int bytesRead = recv(sock, buffer, sizeof(buffer) - 1, 0);
+    if (request.method == "GET" && request.path == "/events" &&
+        ValidateOrigin(request.head)) {
+      OpenEventStream(connection, request);
+      return;
+    }
 
-  if (bytesRead <= 0) {
-    closesocket(sock);
+    bool deferred = false;
+    std::string response = HandleRequest(request, deferred);
+    if (deferred) {
+      connection.awaitingQuery = true;
+      {
+        std::lock_guard<std::mutex> lock(m_queryMutex);
+        m_queryJobs.push_back({connection.id, std::move(request)});
+      }
+      m_queryCv.notify_one();
+      return;
+    }
+    connection.out += response;
+    if (!request.keepAlive) {
+      connection.in.clear();
+      connection.closeAfterWrite = true;
+      return;
+    }
+  }
+}
+
+void HttpServer::QueryLoop() {
+  while (true) {
+    QueryJob job;
+    {
+      std::unique_lock<std::mutex> lock(m_queryMutex);
+      m_queryCv.wait(lock, [this] {
+        return !m_running.load() || !m_queryJobs.empty();
+      });
+      if (!m_running.load()) {
+        return;
+      }
+      job = std::move(m_queryJobs.front());
+      m_queryJobs.pop_front();
+    }
+
+    std::string response = job.request.method == "POST"
+                               ? AnswerBatch(job.request)
+                               : AnswerQuery(job.request);
+    QueryResult result{job.connectionId, std::move(response),
+                       job.request.keepAlive};
+    {
+      std::lock_guard<std::mutex> lock(m_queryMutex);
+      m_queryResults.push_back(std::move(result));
+    }
+    send((SOCKET)m_wakeSocket, "q", 1, 0);
+  }
+}
+
+void HttpServer::DeliverQueryResults(std::vector<Connection> &connections) {
+  char drain[64];
+  while (recv((SOCKET)m_wakeSocket, drain, sizeof(drain), 0) > 0) {
+  }
+
+  std::vector<QueryResult> results;
+  {
+    std::lock_guard<std::mutex> lock(m_queryMutex);
+    results.swap(m_queryResults);
+  }
+  for (auto &result : results) {
+    auto it = std::find_if(connections.begin(), connections.end(),
+                           [&result](const Connection &connection) {
+                             return connection.id == result.connectionId;
+                           });
+    if (it == connections.end()) {
+      continue;  // Closed while its query ran
+    }
+    it->out += result.response;
+    it->awaitingQuery = false;
+    if (!result.keepAlive) {
+      it->in.clear();
+      it->closeAfterWrite = true;
+    } else {
+      ProcessRequests(*it);  // Pipelined behind the query
+    }
+  }
+}
+
+void HttpServer::OpenEventStream(Connection &connection,
+                                 const HttpRequest &request) {
+  std::string snapshot;
+  {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    // First subscriber: changes made while nobody listened are already
+    // covered by the snapshot, so drop them instead of replaying them
+    if (m_eventsIdle && m_eventsCallback) {
+      m_eventsCallback();
+    }
+    if (m_statusCallback) {
+      snapshot = m_statusCallback();
+    } else {
+      snapshot = "{\"status\":\"ok\",\"activeDownloads\":0,\"totalSpeed\":0,\"downloads\":[]}";
+    }
+  }
+  m_eventsIdle = false;
+
+  connection.out += "HTTP/1.1 200 OK\r\n" + BuildCorsHeaders(request.head) +
+                    "Content-Type: text/event-stream\r\n"
+                    "Cache-Control: no-cache\r\n"
+                    "Connection: keep-alive\r\n\r\n";
+  connection.out += "retry: 3000\nevent: snapshot\ndata: " + snapshot + "\n\n";
+  connection.in.clear();
+  connection.eventStream = true;
+}
+
+void HttpServer::BroadcastEvents(std::vector<Connection> &connections) {
+  bool hasStreams =
+      std::any_of(connections.begin(), connections.end(),
+                  [](const Connection &connection) { return connection.eventStream; });
+  if (!hasStreams) {
+    m_eventsIdle = true;
     return;
   }
 
-  request.append(buffer, bytesRead);
+  auto now = std::chrono::steady_clock::now();
+  if (now < m_nextEventTime) {
+    return;
+  }
+  m_nextEventTime = now + std::chrono::milliseconds(m_eventIntervalMs.load());
 
-  // Ensure headers are fully read before parsing
-  const size_t maxHeaderBytes = 64 * 1024;
-  while (request.find("\r\n\r\n") == std::string::npos &&
-         request.size() < maxHeaderBytes) {
-    int more = recv(sock, buffer, sizeof(buffer) - 1, 0);
-    if (more <= 0) {
-      break;
+  // Serialized once, whatever the number of subscribers
+  std::string events;
+  {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    if (m_eventsCallback) {
+      events = m_eventsCallback();
+    }
+  }
+  if (events.empty()) {
+    if (now - m_lastEventWrite < std::chrono::seconds(EVENT_HEARTBEAT_SECONDS)) {
+      return;
     }
-    request.append(buffer, more);
+    events = ": keep-alive\n\n";
   }
+  m_lastEventWrite = now;
 
-  // If there is a body, keep reading until Content-Length is satisfied
-  size_t headerEnd = request.find("\r\n\r\n");
-  if (headerEnd != std::string::npos) {
-    std::string contentLengthHeader = ExtractHeader(request, "Content-Length");
-    int contentLength = 0;
-    if (!contentLengthHeader.empty()) {
-      try {
-        int parsed = std::stoi(contentLengthHeader);
-        contentLength = parsed < 0 ? 0 : parsed;
-      } catch (...) {
-        contentLength = 0;
-      }
+  for (auto &connection : connections) {
+    if (connection.eventStream) {
+      connection.out += events;
+    }
+  }
+}
+
+HttpServer::ParseStatus HttpServer::ParseRequest(Connection &connection,
+                                                 HttpRequest &request,
+                                                 std::string &error) {
+  std::string &in = connection.in;
+
+  // Resume the header search where the last partial read left off
+  size_t searchFrom = connection.headerScan > 3 ? connection.headerScan - 3 : 0;
+  size_t headerEnd = in.find("\r\n\r\n", searchFrom);
+  if (headerEnd == std::string::npos) {
+    connection.headerScan = in.size();
+    if (in.size() > MAX_HEADER_BYTES) {
+      error = "Request headers too large";
+      return ParseStatus::Error;
     }
+    return ParseStatus::Incomplete;
+  }
 
-    if (contentLength > 0) {
-      size_t bodyStart = headerEnd + 4;
-      size_t currentBodySize = request.size() > bodyStart ? request.size() - bodyStart : 0;
-      while (currentBodySize < static_cast<size_t>(contentLength)) {
-        int more = recv(sock, buffer, sizeof(buffer) - 1, 0);
-        if (more <= 0) {
-          break;
-        }
-        request.append(buffer, more);
-        currentBodySize += static_cast<size_t>(more);
+  // Request line: METHOD SP target SP HTTP/x.y
+  size_t lineEnd = in.find("\r\n");
+  size_t methodEnd = in.find(' ');
+  size_t targetEnd =
+      methodEnd == std::string::npos ? std::string::npos : in.find(' ', methodEnd + 1);
+  if (methodEnd == std::string::npos || targetEnd == std::string::npos ||
+      targetEnd > lineEnd) {
+    error = "Malformed request line";
+    return ParseStatus::Error;
+  }
+  request.method = in.substr(0, methodEnd);
+  std::string target = in.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+  std::string version = in.substr(targetEnd + 1, lineEnd - targetEnd - 1);
+  size_t queryPos = target.find('?');
+  request.path = target.substr(0, queryPos);
+  if (queryPos != std::string::npos) {
+    request.query = target.substr(queryPos + 1);
+  }
+  request.head = in.substr(0, headerEnd + 2);
+
+  size_t contentLength = 0;
+  std::string contentLengthHeader = ExtractHeader(request.head, "Content-Length");
+  if (!contentLengthHeader.empty()) {
+    try {
+      long long parsed = std::stoll(contentLengthHeader);
+      contentLength = parsed < 0 ? 0 : static_cast<size_t>(parsed);
+    } catch (...) {
+      error = "Invalid Content-Length";
+      return ParseStatus::Error;
+    }
+  }
+  if (contentLength > MAX_BODY_BYTES) {
+    error = "Request body too large";
+    return ParseStatus::Error;
+  }
+
+  size_t bodyStart = headerEnd + 4;
+  if (in.size() < bodyStart + contentLength) {
+    return ParseStatus::Incomplete;
+  }
+  request.body = in.substr(bodyStart, contentLength);
+
+  // HTTP/1.1 defaults to keep-alive, HTTP/1.0 to close
+  std::string connectionHeader = ExtractHeader(request.head, "Connection");
+  std::transform(connectionHeader.begin(), connectionHeader.end(),
+                 connectionHeader.begin(), ::tolower);
+  if (version == "HTTP/1.0") {
+    request.keepAlive = connectionHeader.find("keep-alive") != std::string::npos;
+  } else {
+    request.keepAlive = connectionHeader.find("close") == std::string::npos;
+  }
+
+  in.erase(0, bodyStart + contentLength);
+  connection.headerScan = 0;
+  return ParseStatus::Complete;
+}
+
+std::string HttpServer::BuildResponse(const std::string &status,
+                                      const std::string &corsHeaders,
+                                      const std::string &body, bool keepAlive) {
+  std::string response = "HTTP/1.1 " + status + "\r\n" + corsHeaders;
+  if (!body.empty()) {
+    response += "Content-Type: application/json\r\n";
+  }
+  response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+  response += keepAlive ? "Connection: keep-alive\r\n\r\n"
+                        : "Connection: close\r\n\r\n";
+  response += body;
+  return response;
+}
+
+std::string HttpServer::BuildCorsHeaders(const std::string &head) {
+  // CORS headers - dynamically set based on request Origin
+  std::string origin = ExtractHeader(head, "Origin");
+  std::string corsOrigin = origin.empty() ? "http://127.0.0.1" : origin;
+  return "Access-Control-Allow-Origin: " + corsOrigin + "\r\n"
+         "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+         "Access-Control-Allow-Headers: Content-Type, X-Auth-Token, If-None-Match\r\n"
+         "Access-Control-Expose-Headers: ETag\r\n"
+         "Vary: Origin\r\n";
+}
+
+bool HttpServer::IsAuthenticated(const HttpRequest &request,
+                                 const JsonValue &body) {
+  // Token from header or body
+  std::string headerToken = ExtractHeader(request.head, "X-Auth-Token");
+  std::string bodyToken = body["token"].AsString();
+  return (!headerToken.empty() && headerToken == m_authToken) ||
+         (!bodyToken.empty() && bodyToken == m_authToken);
+}
+
+std::string HttpServer::AnswerBatch(const HttpRequest &request) {
+  std::string corsHeaders = BuildCorsHeaders(request.head);
+  // Parsed again here rather than carried over: values point into the body
+  JsonValue body = JsonValue::Parse(request.body);
+  // Either a bare array or {"token": ..., "downloads": [...]}
+  JsonValue entries = body.IsArray() ? body : body["downloads"];
+
+  std::vector<DownloadSubmission> batch;
+  entries.ForEachElement([&batch](const JsonValue &entry) {
+    DownloadSubmission submission;
+    submission.url = entry["url"].AsString();
+    submission.referer = entry["referer"].AsString();
+    submission.checksum = entry["checksum"].AsString();
+    entry["mirrors"].ForEachElement([&submission](const JsonValue &mirror) {
+      if (mirror.IsString()) {
+        submission.mirrors.push_back(mirror.AsString());
       }
+      return true;
+    });
+    submission.priority =
+        static_cast<int>(std::clamp<int64_t>(entry["priority"].AsInt(1), 0, 2));
+    batch.push_back(std::move(submission));
+    return true;
+  });
+  if (batch.empty()) {
+    std::string error = "{\"status\":\"error\",\"message\":\"Expected a non-empty array of downloads\"}";
+    return BuildResponse("400 Bad Request", corsHeaders, error, request.keepAlive);
+  }
+
+  // Copied out so adding a large batch does not hold the lock the poll
+  // loop needs; Stop() joins this thread before the callback goes away
+  BatchCallback batchCallback;
+  {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    if (m_running.load()) {
+      batchCallback = m_batchCallback;
     }
   }
+  std::vector<int> ids;
+  if (batchCallback) {
+    ids = batchCallback(batch);
+  }
+  if (ids.size() != batch.size()) {
+    std::string error = "{\"status\":\"error\",\"message\":\"Batch submission unavailable\"}";
+    return BuildResponse("503 Service Unavailable", corsHeaders, error,
+                         request.keepAlive);
+  }
+
+  int64_t added = std::count_if(ids.begin(), ids.end(), [](int id) { return id >= 0; });
+  JsonWriter result(64 + ids.size() * 8);
+  result.BeginObject()
+      .Key("status").String("ok")
+      .Key("added").Int(added)
+      .Key("rejected").Int(static_cast<int64_t>(ids.size()) - added)
+      .Key("ids").BeginArray();
+  for (int id : ids) {
+    result.Int(id);
+  }
+  result.EndArray().EndObject();
+  return BuildResponse("200 OK", corsHeaders, result.Str(), request.keepAlive);
+}
+
+std::string HttpServer::HandleRpc(const HttpRequest &request,
+                                  const JsonValue &body,
+                                  const std::string &corsHeaders) {
+  // JSON-RPC 2.0: one call object, or a batch array answered in one array
+  JsonWriter out(256);
+  if (!body.IsValid()) {
+    out.BeginObject().Key("jsonrpc").String("2.0").Key("id").Null();
+    out.Key("error").BeginObject()
+        .Key("code").Int(-32700).Key("message").String("Parse error")
+        .EndObject().EndObject();
+    return BuildResponse("200 OK", corsHeaders, out.Str(), request.keepAlive);
+  }
+
+  bool replied = false;
+  if (body.IsArray()) {
+    out.BeginArray();
+    body.ForEachElement([&](const JsonValue &call) {
+      replied |= HandleRpcCall(call, out);
+      return true;
+    });
+    out.EndArray();
+  } else {
+    replied = HandleRpcCall(body, out);
+  }
+
+  // Only notifications: nothing to answer
+  if (!replied) {
+    return BuildResponse("204 No Content", corsHeaders, "", request.keepAlive);
+  }
+  return BuildResponse("200 OK", corsHeaders, out.Str(), request.keepAlive);
+}
+
+bool HttpServer::HandleRpcCall(const JsonValue &call, JsonWriter &out) {
+  JsonValue id = call["id"];
+  JsonValue params = call["params"];
+  std::string method = call["method"].AsString();
+
+  auto beginReply = [&]() {
+    out.BeginObject().Key("jsonrpc").String("2.0").Key("id");
+    if (id.IsValid()) {
+      out.Raw(id.Raw());
+    } else {
+      out.Null();
+    }
+  };
+  auto replyError = [&](int code, const char *message) {
+    beginReply();
+    out.Key("error").BeginObject()
+        .Key("code").Int(code).Key("message").String(message)
+        .EndObject().EndObject();
+    return true;
+  };
+
+  if (!call.IsObject() || method.empty()) {
+    return replyError(-32600, "Invalid Request");
+  }
+
+  std::vector<int> ids;
+  bool validIds = params["ids"].IsArray();
+  params["ids"].ForEachElement([&](const JsonValue &value) {
+    validIds = value.IsNumber();
+    ids.push_back(static_cast<int>(value.AsInt()));
+    return validIds;
+  });
+  if (!validIds) {
+    return id.IsValid() && replyError(-32602, "Invalid params");
+  }
+  bool deleteFiles = params["deleteFiles"].AsBool();
+
+  int applied = -1;
+  {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    if (m_running.load() && m_controlCallback) {
+      applied = m_controlCallback(method, ids, deleteFiles);
+    }
+  }
+
+  if (!id.IsValid()) {
+    return false;  // Notification
+  }
+  if (applied < 0) {
+    return replyError(-32601, "Method not found");
+  }
+  beginReply();
+  out.Key("result").BeginObject().Key("applied").Int(applied).EndObject();
+  out.EndObject();
+  return true;
+}
+
+std::string HttpServer::HandleRequest(const HttpRequest &request,
+                                      bool &deferred) {
+  const std::string &head = request.head;
+  bool keepAlive = request.keepAlive;
 
   // Validate Origin header to prevent CSRF attacks
-  if (!ValidateOrigin(request)) {
+  if (!ValidateOrigin(head)) {
     std::string body = "{\"status\":\"error\",\"message\":\"Invalid origin\"}";
-    std::string response = "HTTP/1.1 403 Forbidden\r\n"
-                           "Content-Type: application/json\r\n"
-                           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
-    send(sock, response.c_str(), (int)response.size(), 0);
-    closesocket(sock);
-    return;
+    return BuildResponse("403 Forbidden", "", body, keepAlive);
   }
 
-  // CORS headers - dynamically set based on request Origin
-  std::string origin = ExtractHeader(request, "Origin");
-  std::string corsOrigin = origin.empty() ? "http://127.0.0.1" : origin;
-  std::string corsHeaders =
-      "Access-Control-Allow-Origin: " + corsOrigin + "\r\n"
-      "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
-      "Access-Control-Allow-Headers: Content-Type, X-Auth-Token\r\n"
-      "Vary: Origin\r\n";
+  std::string corsHeaders = BuildCorsHeaders(head);
 
   // Handle OPTIONS (CORS preflight)
-  if (request.find("OPTIONS ") == 0) {
-    std::string response = "HTTP/1.1 204 No Content\r\n" + corsHeaders +
-                           "Content-Length: 0\r\n\r\n";
-    send(sock, response.c_str(), (int)response.size(), 0);
-    closesocket(sock);
-    return;
+  if (request.method == "OPTIONS") {
+    return BuildResponse("204 No Content", corsHeaders, "", keepAlive);
   }
 
   // Handle GET /ping - public endpoint for extension to check if LDM is running
-  if (request.find("GET /ping") != std::string::npos) {
+  if (request.method == "GET" && request.path == "/ping") {
     std::string body = "{\"status\":\"ok\",\"app\":\"LDM\",\"version\":\"2.0.0\"}";
-    std::string response = "HTTP/1.1 200 OK\r\n" + corsHeaders +
-                           "Content-Type: application/json\r\n"
-                           "Content-Length: " +
-                           std::to_string(body.size()) + "\r\n\r\n" + body;
-    send(sock, response.c_str(), (int)response.size(), 0);
-    closesocket(sock);
-    return;
+    return BuildResponse("200 OK", corsHeaders, body, keepAlive);
   }
 
   // Handle GET /token - returns the auth token (only accessible from localhost)
   // Note: We don't require Origin header here because browser extensions may not send it
   // Security is provided by binding to 127.0.0.1 only
-  if (request.find("GET /token") != std::string::npos) {
+  if (request.method == "GET" && request.path == "/token") {
     std::cout << "[HttpServer] GET /token request - returning token" << std::endl;
-    std::string body = "{\"token\":\"" + m_authToken + "\"}";
-    std::string response = "HTTP/1.1 200 OK\r\n" + corsHeaders +
-                           "Content-Type: application/json\r\n"
-                           "Content-Length: " +
-                           std::to_string(body.size()) + "\r\n\r\n" + body;
-    send(sock, response.c_str(), (int)response.size(), 0);
-    closesocket(sock);
-    return;
+    JsonWriter body(96);
+    body.BeginObject().Key("token").String(m_authToken).EndObject();
+    return BuildResponse("200 OK", corsHeaders, body.Str(), keepAlive);
   }
 
   // Handle GET /status - returns active downloads and speeds (public endpoint)
-  if (request.find("GET /status") != std::string::npos) {
+  if (request.method == "GET" && request.path == "/status") {
     std::string body;
     {
       std::lock_guard<std::mutex> lock(m_callbackMutex);
@@ -390,52 +928,34 @@ void HttpServer::HandleClient(uintptr_t clientSocket) {
         body = "{\"status\":\"ok\",\"activeDownloads\":0,\"totalSpeed\":0,\"downloads\":[]}";
       }
     }
-    std::string response = "HTTP/1.1 200 OK\r\n" + corsHeaders +
-                           "Content-Type: application/json\r\n"
-                           "Content-Length: " +
-                           std::to_string(body.size()) + "\r\n\r\n" + body;
-    send(sock, response.c_str(), (int)response.size(), 0);
-    closesocket(sock);
-    return;
+    return BuildResponse("200 OK", corsHeaders, body, keepAlive);
   }
 
-  // Handle POST /download - REQUIRES authentication token
-  if (request.find("POST /download") != std::string::npos) {
-    std::cout << "[HttpServer] Received POST /download request" << std::endl;
+  // Everything below needs the auth token; a JSON body is parsed once here
+  JsonValue requestJson = JsonValue::Parse(request.body);
+  const char *authError = "{\"status\":\"error\",\"message\":\"Authentication required. Get token from GET /token\"}";
 
-    // Extract body first
-    std::string requestBody;
-    size_t bodyStart = request.find("\r\n\r\n");
-    if (bodyStart != std::string::npos) {
-      requestBody = request.substr(bodyStart + 4);
+  // Handle GET /downloads - filtered, paginated listing including history.
+  // REQUIRES authentication: unlike /status it exposes every URL.
+  if (request.method == "GET" && request.path == "/downloads") {
+    if (!IsAuthenticated(request, requestJson)) {
+      return BuildResponse("401 Unauthorized", corsHeaders, authError, keepAlive);
     }
-    std::cout << "[HttpServer] Request body: " << requestBody << std::endl;
-
-    // Verify auth token from header or body
-    std::string headerToken = ExtractHeader(request, "X-Auth-Token");
-    std::string bodyToken = ExtractJsonValue(requestBody, "token");
-
-    std::cout << "[HttpServer] Auth check - headerToken: '" << headerToken
-              << "', bodyToken: '" << bodyToken
-              << "', expected: '" << m_authToken << "'" << std::endl;
+    deferred = true;  // Answered by AnswerQuery on the query thread
+    return "";
+  }
 
-    bool authenticated = (!headerToken.empty() && headerToken == m_authToken) ||
-                         (!bodyToken.empty() && bodyToken == m_authToken);
+  // Handle POST /download - REQUIRES authentication token
+  if (request.method == "POST" && request.path == "/download") {
+    std::cout << "[HttpServer] Received POST /download request" << std::endl;
 
-    if (!authenticated) {
+    if (!IsAuthenticated(request, requestJson)) {
       std::cout << "[HttpServer] Authentication FAILED - returning 401" << std::endl;
-      std::string body = "{\"status\":\"error\",\"message\":\"Authentication required. Get token from GET /token\"}";
-      std::string response = "HTTP/1.1 401 Unauthorized\r\n" + corsHeaders +
-                             "Content-Type: application/json\r\n"
-                             "Content-Length: " +
-                             std::to_string(body.size()) + "\r\n\r\n" + body;
-      send(sock, response.c_str(), (int)response.size(), 0);
-      closesocket(sock);
-      return;
+      return BuildResponse("401 Unauthorized", corsHeaders, authError, keepAlive);
     }
 
-    std::string url = ExtractJsonValue(requestBody, "url");
-    std::string referer = ExtractJsonValue(requestBody, "referer");
+    std::string url = requestJson["url"].AsString();
+    std::string referer = requestJson["referer"].AsString();
     std::cout << "[HttpServer] Extracted URL: " << url << std::endl;
     if (!referer.empty()) {
       std::cout << "[HttpServer] Referer from extension: " << referer << std::endl;
@@ -443,86 +963,114 @@ void HttpServer::HandleClient(uintptr_t clientSocket) {
 
     std::string body;
     if (!url.empty()) {
-      // Invoke callback on main thread via posted message
+      // The callback only posts to the main thread, so the loop is not held up
       // Check m_running to avoid calling callback during shutdown
       {
         std::lock_guard<std::mutex> lock(m_callbackMutex);
-        std::cout << "[HttpServer] m_running=" << m_running.load()
-                  << ", m_urlCallback=" << (m_urlCallback ? "set" : "null") << std::endl;
         if (m_running.load() && m_urlCallback) {
-          std::cout << "[HttpServer] Calling URL callback..." << std::endl;
           m_urlCallback(url, referer);
-          std::cout << "[HttpServer] Callback returned" << std::endl;
         }
       }
       body = "{\"status\":\"ok\",\"message\":\"Download added\"}";
     } else {
       body = "{\"status\":\"error\",\"message\":\"Missing url parameter\"}";
     }
-
-    std::string response = "HTTP/1.1 200 OK\r\n" + corsHeaders +
-                           "Content-Type: application/json\r\n"
-                           "Content-Length: " +
-                           std::to_string(body.size()) + "\r\n\r\n" + body;
-    send(sock, response.c_str(), (int)response.size(), 0);
-    closesocket(sock);
-    return;
+    return BuildResponse("200 OK", corsHeaders, body, keepAlive);
   }
 
-  // 404 for unknown endpoints
-  std::string body = "{\"status\":\"error\",\"message\":\"Not found\"}";
-  std::string response = "HTTP/1.1 404 Not Found\r\n" + corsHeaders +
-                         "Content-Type: application/json\r\n"
-                         "Content-Length: " +
-                         std::to_string(body.size()) + "\r\n\r\n" + body;
-  send(sock, response.c_str(), (int)response.size(), 0);
-  closesocket(sock);
-}
-
-std::string HttpServer::ParseUrlFromRequest(const std::string &request) {
-  // Find the body (after \r\n\r\n)
-  size_t bodyStart = request.find("\r\n\r\n");
-  if (bodyStart == std::string::npos) {
+  // Handle POST /downloads - a batch in one request, REQUIRES authentication
+  if (request.method == "POST" && request.path == "/downloads") {
+    if (!IsAuthenticated(request, requestJson)) {
+      return BuildResponse("401 Unauthorized", corsHeaders, authError, keepAlive);
+    }
+    deferred = true;  // Answered by AnswerBatch on the query thread
     return "";
   }
-  bodyStart += 4;
 
-  std::string body = request.substr(bodyStart);
-  return ExtractJsonValue(body, "url");
+  // Handle POST /rpc - pause/resume/remove by id, REQUIRES authentication
+  if (request.method == "POST" && request.path == "/rpc") {
+    if (!IsAuthenticated(request, requestJson)) {
+      return BuildResponse("401 Unauthorized", corsHeaders, authError, keepAlive);
+    }
+    return HandleRpc(request, requestJson, corsHeaders);
+  }
+
+  // 404 for unknown endpoints
+  std::string body = "{\"status\":\"error\",\"message\":\"Not found\"}";
+  return BuildResponse("404 Not Found", corsHeaders, body, keepAlive);
 }
 
-std::string HttpServer::ExtractJsonValue(const std::string &json,
-                                         const std::string &key) {
-  // Simple JSON parser for {"key": "value"} format
-  std::string searchKey = "\"" + key + "\"";
-  size_t keyPos = json.find(searchKey);
-  if (keyPos == std::string::npos) {
-    return "";
+HttpServer::QueryParams HttpServer::ParseQueryString(const std::string &query) {
+  QueryParams params;
+  size_t start = 0;
+  while (start < query.length()) {
+    size_t end = query.find('&', start);
+    if (end == std::string::npos) {
+      end = query.length();
+    }
+    size_t equals = query.find('=', start);
+    if (equals == std::string::npos || equals > end) {
+      equals = end;
+    }
+    if (equals > start) {
+      std::string value =
+          equals < end ? query.substr(equals + 1, end - equals - 1) : "";
+      params[UrlDecode(query.substr(start, equals - start))] = UrlDecode(value);
+    }
+    start = end + 1;
   }
+  return params;
+}
 
-  size_t colonPos = json.find(':', keyPos + searchKey.length());
-  if (colonPos == std::string::npos) {
-    return "";
+std::string HttpServer::AnswerQuery(const HttpRequest &request) {
+  std::string corsHeaders = BuildCorsHeaders(request.head);
+  // Copied out so a slow query does not hold the lock the poll loop needs
+  QueryCallback queryCallback;
+  {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    queryCallback = m_queryCallback;
   }
-
-  // Find opening quote
-  size_t startQuote = json.find('"', colonPos + 1);
-  if (startQuote == std::string::npos) {
-    return "";
+  if (!queryCallback) {
+    std::string body = "{\"status\":\"error\",\"message\":\"Query unavailable\"}";
+    return BuildResponse("503 Service Unavailable", corsHeaders, body,
+                         request.keepAlive);
   }
 
-  // Find closing quote (handle escaped quotes)
-  size_t endQuote = startQuote + 1;
-  while (endQuote < json.length()) {
-    if (json[endQuote] == '"' && (endQuote == 0 || json[endQuote - 1] != '\\')) {
-      break;
+  std::string ifNoneMatch = ExtractHeader(request.head, "If-None-Match");
+  std::string etag;
+  std::string body;
+  queryCallback(ParseQueryString(request.query), ifNoneMatch, etag, body);
+
+  std::string headers = corsHeaders + "Cache-Control: no-cache\r\n";
+  if (!etag.empty()) {
+    headers += "ETag: " + etag + "\r\n";
+    if (etag == ifNoneMatch) {
+      return BuildResponse("304 Not Modified", headers, "", request.keepAlive);
     }
-    endQuote++;
   }
+  return BuildResponse("200 OK", headers, body, request.keepAlive);
+}
 
-  if (endQuote >= json.length()) {
-    return "";
+std::string HttpServer::UrlDecode(const std::string &value) {
+  auto hexValue = [](char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  };
+
+  std::string decoded;
+  decoded.reserve(value.length());
+  for (size_t i = 0; i < value.length(); ++i) {
+    if (value[i] == '+') {
+      decoded += ' ';
+    } else if (value[i] == '%' && i + 2 < value.length() &&
+               hexValue(value[i + 1]) >= 0 && hexValue(value[i + 2]) >= 0) {
+      decoded += static_cast<char>(hexValue(value[i + 1]) * 16 + hexValue(value[i + 2]));
+      i += 2;
+    } else {
+      decoded += value[i];
+    }
   }
-
-  return json.substr(startQuote + 1, endQuote - startQuote - 1);
+  return decoded;
 }
@@ -1,21 +1,61 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <map>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
-#include <condition_variable>
+
+class JsonValue;
+class JsonWriter;
 
 // Lightweight HTTP server for browser extension integration.
 // Listens on localhost only (127.0.0.1) for security.
 // Uses token-based authentication to prevent unauthorized download injection.
+// A single thread serves every connection from a non-blocking poll loop,
+// with HTTP/1.1 keep-alive and pipelined requests answered in order.
+// GET /events holds its connection open as a Server-Sent Events stream.
+// GET /downloads queries, which may read history from the database, and
+// POST /downloads batches, which add to the download manager, run on a
+// second thread so they never hold up the poll loop.
 class HttpServer {
 public:
   // Callback receives URL and optional referer (page URL for protected downloads)
   using UrlCallback = std::function<void(const std::string &url, const std::string &referer)>;
   using StatusCallback = std::function<std::string()>;  // Returns JSON status
+  // GET /downloads: sets the ETag of the page the query parameters select
+  // and, unless it equals ifNoneMatch, the JSON body as well. Called on the
+  // query thread, one query at a time.
+  using QueryParams = std::map<std::string, std::string>;
+  using QueryCallback =
+      std::function<void(const QueryParams &params, const std::string &ifNoneMatch,
+                         std::string &etag, std::string &body)>;
+  // Returns SSE text for whatever changed since the previous call, or an
+  // empty string; called at most once per event interval for all streams
+  using EventsCallback = std::function<std::string()>;
+
+  // One entry of a POST /downloads batch
+  struct DownloadSubmission {
+    std::string url;
+    std::string referer;
+    std::vector<std::string> mirrors;  // Alternative URLs for the same file
+    int priority = 1;                  // DownloadPriority value
+    std::string checksum;              // "md5:<hex>", "sha256:<hex>" or bare hex
+  };
+  // Adds a whole batch at once; returns one id per entry (-1 = rejected).
+  // Called on the query thread, one batch at a time.
+  using BatchCallback =
+      std::function<std::vector<int>(const std::vector<DownloadSubmission> &)>;
+  // Applies "pause", "resume" or "remove" to a list of ids. Returns how many
+  // downloads it applied to, or -1 for an unknown method.
+  using ControlCallback = std::function<int(
+      const std::string &method, const std::vector<int> &ids, bool deleteFiles)>;
 
   static HttpServer &GetInstance();
 
@@ -44,33 +84,128 @@ public:
   // Set callback for status requests (returns active downloads info)
   void SetStatusCallback(StatusCallback callback);
 
+  // Set callback for GET /downloads queries
+  void SetQueryCallback(QueryCallback callback);
+
+  // Set callback for POST /downloads batches
+  void SetBatchCallback(BatchCallback callback);
+
+  // Set callback for POST /rpc control calls
+  void SetControlCallback(ControlCallback callback);
+
+  // Set callback producing /events deltas
+  void SetEventsCallback(EventsCallback callback);
+
+  // Minimum time between event batches; changes in between are coalesced
+  void SetEventInterval(int milliseconds) { m_eventIntervalMs.store(milliseconds); }
+
 private:
   HttpServer();
   ~HttpServer() noexcept;
 
+  // One parsed request; 'head' is the request line plus headers
+  struct HttpRequest {
+    std::string method;
+    std::string path;   // Target without the query string
+    std::string query;  // After '?', if any
+    std::string head;
+    std::string body;
+    bool keepAlive = true;
+  };
+
+  // Per-connection state owned by the server loop
+  struct Connection {
+    uint64_t id = 0;           // Matches query results to their connection
+    uintptr_t socket;
+    std::string in;            // Received, not yet parsed
+    size_t headerScan = 0;     // Bytes of 'in' already searched for the header end
+    std::string out;           // Responses waiting to be sent
+    size_t outOffset = 0;
+    bool closeAfterWrite = false;
+    bool eventStream = false;  // Answered GET /events; only receives events now
+    bool awaitingQuery = false;  // Later requests wait behind a running query
+    std::chrono::steady_clock::time_point lastActivity;
+  };
+
+  enum class ParseStatus { Incomplete, Complete, Error };
+
+  // A GET /downloads or POST /downloads handed to the query thread, and its
+  // finished response
+  struct QueryJob {
+    uint64_t connectionId;
+    HttpRequest request;
+  };
+  struct QueryResult {
+    uint64_t connectionId;
+    std::string response;
+    bool keepAlive;
+  };
+
   void ServerLoop();
-  void HandleClient(uintptr_t clientSocket);
-  std::string ParseUrlFromRequest(const std::string &request);
-  std::string ExtractJsonValue(const std::string &json, const std::string &key);
+  void AcceptConnections(std::vector<Connection> &connections);
+  bool ReadFromConnection(Connection &connection);
+  bool WriteToConnection(Connection &connection);
+  void ProcessRequests(Connection &connection);
+  void OpenEventStream(Connection &connection, const HttpRequest &request);
+  void BroadcastEvents(std::vector<Connection> &connections);
+  bool OpenWakeSocket();
+  void QueryLoop();
+  void DeliverQueryResults(std::vector<Connection> &connections);
+  std::string AnswerQuery(const HttpRequest &request);
+  static ParseStatus ParseRequest(Connection &connection, HttpRequest &request,
+                                  std::string &error);
+  // Sets 'deferred' instead of answering when the query thread must
+  std::string HandleRequest(const HttpRequest &request, bool &deferred);
+  static std::string BuildCorsHeaders(const std::string &head);
+  bool IsAuthenticated(const HttpRequest &request, const JsonValue &body);
+  std::string AnswerBatch(const HttpRequest &request);
+  std::string HandleRpc(const HttpRequest &request, const JsonValue &body,
+                        const std::string &corsHeaders);
+  bool HandleRpcCall(const JsonValue &call, JsonWriter &out);  // false: no reply
+  static QueryParams ParseQueryString(const std::string &query);
+  static std::string UrlDecode(const std::string &value);
+  static std::string BuildResponse(const std::string &status,
+                                   const std::string &corsHeaders,
+                                   const std::string &body, bool keepAlive);
   std::string GenerateAuthToken();
   bool ValidateOrigin(const std::string &request);
-  std::string ExtractHeader(const std::string &request, const std::string &headerName);
+  static std::string ExtractHeader(const std::string &request, const std::string &headerName);
 
   std::atomic<bool> m_running;
   std::thread m_serverThread;
   uintptr_t m_listenSocket;
+  uintptr_t m_wakeSocket;  // Loopback UDP the query thread pokes the loop with
+  uint64_t m_nextConnectionId = 0;  // Server loop only
   int m_port;
   std::string m_authToken;  // Authentication token for API security
 
   std::mutex m_callbackMutex;
   UrlCallback m_urlCallback;
   StatusCallback m_statusCallback;
-
-  // Track active client handler threads to ensure clean shutdown
-  std::mutex m_clientThreadsMutex;
-  std::atomic<int> m_activeClientCount{0};
-  std::condition_variable m_clientsDoneCondition;
-
-  // Maximum concurrent connections to prevent thread exhaustion
-  static constexpr int MAX_CONCURRENT_CLIENTS = 16;
+  EventsCallback m_eventsCallback;
+  QueryCallback m_queryCallback;
+  BatchCallback m_batchCallback;
+  ControlCallback m_controlCallback;
+
+  // Query thread; jobs and results are swapped under m_queryMutex
+  std::thread m_queryThread;
+  std::mutex m_queryMutex;
+  std::condition_variable m_queryCv;
+  std::deque<QueryJob> m_queryJobs;
+  std::vector<QueryResult> m_queryResults;
+
+  // Event stream pacing; only touched by the server loop apart from the interval
+  std::atomic<int> m_eventIntervalMs{500};
+  std::chrono::steady_clock::time_point m_nextEventTime;
+  std::chrono::steady_clock::time_point m_lastEventWrite;
+  bool m_eventsIdle = true;  // No stream was open at the last broadcast
+
+  // Connection limits
+  static constexpr size_t MAX_CONNECTIONS = 256;
+  static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+  static constexpr size_t MAX_BODY_BYTES = 8 * 1024 * 1024;
+  static constexpr int POLL_INTERVAL_MS = 250;  // Also bounds Stop() latency
+  static constexpr int IDLE_TIMEOUT_SECONDS = 30;
+  static constexpr int EVENT_HEARTBEAT_SECONDS = 15;  // Keeps proxies from timing out
+  static constexpr size_t MAX_EVENT_BACKLOG_BYTES = 1024 * 1024;  // Slow reader cut-off
 };
@@ -0,0 +1,496 @@
+#include "Json.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+constexpr size_t NPOS = std::string_view::npos;
+constexpr int MAX_NESTING = 128;  // Bounds recursion on hostile input
+
+bool IsWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+size_t SkipWhitespace(std::string_view text, size_t pos) {
+  while (pos < text.size() && IsWhitespace(text[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Each Scan* takes the position of a token's first byte and returns the
+// position just past it, or NPOS if it is malformed
+
+size_t ScanString(std::string_view text, size_t pos) {
+  for (++pos; pos < text.size(); ++pos) {
+    unsigned char c = static_cast<unsigned char>(text[pos]);
+    if (c == '"') {
+      return pos + 1;
+    }
+    if (c < 0x20) {
+      return NPOS;
+    }
+    if (c == '\\') {
+      if (++pos >= text.size()) {
+        return NPOS;
+      }
+      switch (text[pos]) {
+      case '"': case '\\': case '/': case 'b':
+      case 'f': case 'n': case 'r': case 't':
+        break;
+      case 'u':
+        for (int i = 0; i < 4; ++i) {
+          if (++pos >= text.size() || HexValue(text[pos]) < 0) {
+            return NPOS;
+          }
+        }
+        break;
+      default:
+        return NPOS;
+      }
+    }
+  }
+  return NPOS;
+}
+
+size_t ScanDigits(std::string_view text, size_t pos) {
+  size_t start = pos;
+  while (pos < text.size() && IsDigit(text[pos])) {
+    ++pos;
+  }
+  return pos == start ? NPOS : pos;
+}
+
+size_t ScanNumber(std::string_view text, size_t pos) {
+  if (text[pos] == '-') {
+    ++pos;
+  }
+  if (pos < text.size() && text[pos] == '0') {
+    ++pos;
+  } else if ((pos = ScanDigits(text, pos)) == NPOS) {
+    return NPOS;
+  }
+  if (pos < text.size() && text[pos] == '.') {
+    if ((pos = ScanDigits(text, pos + 1)) == NPOS) {
+      return NPOS;
+    }
+  }
+  if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+    ++pos;
+    if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+      ++pos;
+    }
+    return ScanDigits(text, pos);
+  }
+  return pos;
+}
+
+size_t ScanLiteral(std::string_view text, size_t pos, std::string_view literal) {
+  return text.substr(pos, literal.size()) == literal ? pos + literal.size()
+                                                       : NPOS;
+}
+
+size_t ScanValue(std::string_view text, size_t pos, int depth,
+                 JsonValue::Type &type) {
+  if (pos >= text.size()) {
+    return NPOS;
+  }
+
+  switch (text[pos]) {
+  case '{':
+  case '[': {
+    bool isObject = text[pos] == '{';
+    char close = isObject ? '}' : ']';
+    type = isObject ? JsonValue::Type::Object : JsonValue::Type::Array;
+    if (depth >= MAX_NESTING) {
+      return NPOS;
+    }
+    pos = SkipWhitespace(text, pos + 1);
+    if (pos < text.size() && text[pos] == close) {
+      return pos + 1;
+    }
+    while (true) {
+      if (isObject) {
+        if (pos >= text.size() || text[pos] != '"' ||
+            (pos = ScanString(text, pos)) == NPOS) {
+          return NPOS;
+        }
+        pos = SkipWhitespace(text, pos);
+        if (pos >= text.size() || text[pos] != ':') {
+          return NPOS;
+        }
+        pos = SkipWhitespace(text, pos + 1);
+      }
+      JsonValue::Type childType;
+      if ((pos = ScanValue(text, pos, depth + 1, childType)) == NPOS) {
+        return NPOS;
+      }
+      pos = SkipWhitespace(text, pos);
+      if (pos >= text.size()) {
+        return NPOS;
+      }
+      if (text[pos] == close) {
+        return pos + 1;
+      }
+      if (text[pos] != ',') {
+        return NPOS;
+      }
+      pos = SkipWhitespace(text, pos + 1);
+    }
+  }
+  case '"':
+    type = JsonValue::Type::String;
+    return ScanString(text, pos);
+  case 't':
+    type = JsonValue::Type::Bool;
+    return ScanLiteral(text, pos, "true");
+  case 'f':
+    type = JsonValue::Type::Bool;
+    return ScanLiteral(text, pos, "false");
+  case 'n':
+    type = JsonValue::Type::Null;
+    return ScanLiteral(text, pos, "null");
+  default:
+    type = JsonValue::Type::Number;
+    return text[pos] == '-' || IsDigit(text[pos]) ? ScanNumber(text, pos) : NPOS;
+  }
+}
+
+void AppendUtf8(std::string &out, uint32_t codepoint) {
+  if (codepoint < 0x80) {
+    out += static_cast<char>(codepoint);
+  } else if (codepoint < 0x800) {
+    out += static_cast<char>(0xC0 | (codepoint >> 6));
+    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+  } else if (codepoint < 0x10000) {
+    out += static_cast<char>(0xE0 | (codepoint >> 12));
+    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (codepoint >> 18));
+    out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+  }
+}
+
+uint32_t ReadHex4(std::string_view text, size_t pos) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    value = (value << 4) | static_cast<uint32_t>(HexValue(text[pos + i]));
+  }
+  return value;
+}
+
+} // namespace
+
+// ============================================================================
+// JsonValue
+// ============================================================================
+
+JsonValue JsonValue::Parse(std::string_view text) {
+  size_t start = SkipWhitespace(text, 0);
+  Type type = Type::Invalid;
+  size_t end = ScanValue(text, start, 0, type);
+  if (end == NPOS || SkipWhitespace(text, end) != text.size()) {
+    return JsonValue();
+  }
+  return JsonValue(text.substr(start, end - start), type);
+}
+
+bool JsonValue::NextElement(size_t &pos, JsonValue &element) const {
+  pos = SkipWhitespace(m_text, pos);
+  if (pos < m_text.size() && m_text[pos] == ',') {
+    pos = SkipWhitespace(m_text, pos + 1);
+  }
+  if (pos >= m_text.size() || m_text[pos] == ']') {
+    return false;
+  }
+  Type type = Type::Invalid;
+  size_t end = ScanValue(m_text, pos, 0, type);
+  if (end == NPOS) {
+    return false;
+  }
+  element = JsonValue(m_text.substr(pos, end - pos), type);
+  pos = end;
+  return true;
+}
+
+bool JsonValue::NextMember(size_t &pos, std::string_view &key,
+                           JsonValue &value) const {
+  pos = SkipWhitespace(m_text, pos);
+  if (pos < m_text.size() && m_text[pos] == ',') {
+    pos = SkipWhitespace(m_text, pos + 1);
+  }
+  if (pos >= m_text.size() || m_text[pos] != '"') {
+    return false;
+  }
+  size_t keyEnd = ScanString(m_text, pos);
+  if (keyEnd == NPOS) {
+    return false;
+  }
+  // Keys are compared as written; none of ours need escapes
+  key = m_text.substr(pos + 1, keyEnd - pos - 2);
+
+  pos = SkipWhitespace(m_text, SkipWhitespace(m_text, keyEnd) + 1);  // ':'
+  Type type = Type::Invalid;
+  size_t end = ScanValue(m_text, pos, 0, type);
+  if (end == NPOS) {
+    return false;
+  }
+  value = JsonValue(m_text.substr(pos, end - pos), type);
+  pos = end;
+  return true;
+}
+
+JsonValue JsonValue::operator[](std::string_view key) const {
+  JsonValue found;
+  ForEachMember([&](std::string_view memberKey, const JsonValue &value) {
+    if (memberKey == key) {
+      found = value;
+      return false;
+    }
+    return true;
+  });
+  return found;
+}
+
+size_t JsonValue::Size() const {
+  size_t count = 0;
+  if (m_type == Type::Array) {
+    ForEachElement([&count](const JsonValue &) {
+      ++count;
+      return true;
+    });
+  } else if (m_type == Type::Object) {
+    ForEachMember([&count](std::string_view, const JsonValue &) {
+      ++count;
+      return true;
+    });
+  }
+  return count;
+}
+
+std::string JsonValue::AsString(const std::string &fallback) const {
+  if (m_type != Type::String) {
+    return fallback;
+  }
+  std::string_view inner = m_text.substr(1, m_text.size() - 2);
+  if (inner.find('\\') == NPOS) {
+    return std::string(inner);
+  }
+
+  std::string out;
+  out.reserve(inner.size());
+  for (size_t i = 0; i < inner.size(); ++i) {
+    char c = inner[i];
+    if (c != '\\') {
+      out += c;
+      continue;
+    }
+    switch (inner[++i]) {
+    case 'b': out += '\b'; break;
+    case 'f': out += '\f'; break;
+    case 'n': out += '\n'; break;
+    case 'r': out += '\r'; break;
+    case 't': out += '\t'; break;
+    case 'u': {
+      uint32_t codepoint = ReadHex4(inner, i + 1);
+      i += 4;
+      // A high surrogate followed by a low one encodes one code point
+      if (codepoint >= 0xD800 && codepoint <= 0xDBFF && i + 6 < inner.size() &&
+          inner[i + 1] == '\\' && inner[i + 2] == 'u') {
+        uint32_t low = ReadHex4(inner, i + 3);
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+          codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+          i += 6;
+        }
+      }
+      AppendUtf8(out, codepoint);
+      break;
+    }
+    default: out += inner[i]; break;  // \" \\ \/
+    }
+  }
+  return out;
+}
+
+int64_t JsonValue::AsInt(int64_t fallback) const {
+  if (m_type != Type::Number) {
+    return fallback;
+  }
+  int64_t value = 0;
+  auto result = std::from_chars(m_text.data(), m_text.data() + m_text.size(), value);
+  if (result.ec == std::errc() && result.ptr == m_text.data() + m_text.size()) {
+    return value;
+  }
+  return static_cast<int64_t>(AsDouble(static_cast<double>(fallback)));
+}
+
+double JsonValue::AsDouble(double fallback) const {
+  if (m_type != Type::Number) {
+    return fallback;
+  }
+  double value = 0.0;
+  auto result = std::from_chars(m_text.data(), m_text.data() + m_text.size(), value);
+  return result.ec == std::errc() ? value : fallback;
+}
+
+bool JsonValue::AsBool(bool fallback) const {
+  if (m_type != Type::Bool) {
+    return fallback;
+  }
+  return m_text[0] == 't';
+}
+
+// ============================================================================
+// JsonWriter
+// ============================================================================
+
+void JsonWriter::BeforeValue() {
+  if (m_afterKey) {
+    m_afterKey = false;
+    return;
+  }
+  if (m_depth > 0 && m_depth <= MAX_DEPTH) {
+    uint64_t bit = 1ull << (m_depth - 1);
+    if (m_needComma & bit) {
+      m_out += ',';
+    } else {
+      m_needComma |= bit;
+    }
+  }
+}
+
+JsonWriter &JsonWriter::BeginObject() {
+  BeforeValue();
+  m_out += '{';
+  if (++m_depth <= MAX_DEPTH) {
+    m_needComma &= ~(1ull << (m_depth - 1));
+  }
+  return *this;
+}
+
+JsonWriter &JsonWriter::EndObject() {
+  m_out += '}';
+  --m_depth;
+  return *this;
+}
+
+JsonWriter &JsonWriter::BeginArray() {
+  BeforeValue();
+  m_out += '[';
+  if (++m_depth <= MAX_DEPTH) {
+    m_needComma &= ~(1ull << (m_depth - 1));
+  }
+  return *this;
+}
+
+JsonWriter &JsonWriter::EndArray() {
+  m_out += ']';
+  --m_depth;
+  return *this;
+}
+
+JsonWriter &JsonWriter::Key(std::string_view key) {
+  BeforeValue();
+  AppendEscaped(key);
+  m_out += ':';
+  m_afterKey = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::String(std::string_view value) {
+  BeforeValue();
+  AppendEscaped(value);
+  return *this;
+}
+
+JsonWriter &JsonWriter::Int(int64_t value) {
+  BeforeValue();
+  char buffer[24];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  m_out.append(buffer, result.ptr);
+  return *this;
+}
+
+JsonWriter &JsonWriter::Double(double value, int decimals) {
+  BeforeValue();
+  if (!std::isfinite(value)) {
+    m_out += '0';  // JSON has no NaN or infinity
+    return *this;
+  }
+  char buffer[64];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value,
+                              std::chars_format::fixed, decimals);
+  if (result.ec == std::errc()) {
+    m_out.append(buffer, result.ptr);
+  } else {
+    m_out += '0';
+  }
+  return *this;
+}
+
+JsonWriter &JsonWriter::Bool(bool value) {
+  BeforeValue();
+  m_out += value ? "true" : "false";
+  return *this;
+}
+
+JsonWriter &JsonWriter::Null() {
+  BeforeValue();
+  m_out += "null";
+  return *this;
+}
+
+JsonWriter &JsonWriter::Raw(std::string_view json) {
+  BeforeValue();
+  m_out += json;
+  return *this;
+}
+
+void JsonWriter::Clear() {
+  m_out.clear();
+  m_needComma = 0;
+  m_depth = 0;
+  m_afterKey = false;
+}
+
+void JsonWriter::AppendEscaped(std::string_view value) {
+  static const char HEX[] = "0123456789abcdef";
+  m_out += '"';
+  // Copy runs of plain bytes in one append
+  size_t runStart = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(value[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    m_out.append(value.data() + runStart, i - runStart);
+    runStart = i + 1;
+    switch (c) {
+    case '"': m_out += "\\\""; break;
+    case '\\': m_out += "\\\\"; break;
+    case '\n': m_out += "\\n"; break;
+    case '\r': m_out += "\\r"; break;
+    case '\t': m_out += "\\t"; break;
+    default:
+      m_out += "\\u00";
+      m_out += HEX[c >> 4];
+      m_out += HEX[c & 0xF];
+      break;
+    }
+  }
+  m_out.append(value.data() + runStart, value.size() - runStart);
+  m_out += '"';
+}
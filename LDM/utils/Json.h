@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+// Read-only view of one JSON value inside text the caller keeps alive.
+// Parse() validates the whole document in one pass without building a
+// tree; members and elements are then found by scanning the original
+// bytes, so reading a request never allocates except to unescape strings.
+class JsonValue {
+public:
+  enum class Type { Invalid, Null, Bool, Number, String, Array, Object };
+
+  JsonValue() = default;
+
+  // Invalid unless 'text' holds exactly one well-formed value
+  static JsonValue Parse(std::string_view text);
+
+  Type GetType() const { return m_type; }
+  bool IsValid() const { return m_type != Type::Invalid; }
+  bool IsObject() const { return m_type == Type::Object; }
+  bool IsArray() const { return m_type == Type::Array; }
+  bool IsString() const { return m_type == Type::String; }
+  bool IsNumber() const { return m_type == Type::Number; }
+
+  // Member of an object; Invalid if absent or not an object
+  JsonValue operator[](std::string_view key) const;
+
+  // Scalars, falling back when the value has another type
+  std::string AsString(const std::string &fallback = "") const;
+  int64_t AsInt(int64_t fallback = 0) const;
+  double AsDouble(double fallback = 0.0) const;
+  bool AsBool(bool fallback = false) const;
+
+  // Exact source text of the value, e.g. to echo a JSON-RPC id back
+  std::string_view Raw() const { return m_text; }
+
+  // Visit array elements / object members in order; return false from the
+  // visitor to stop early
+  template <typename Visitor> void ForEachElement(Visitor visitor) const {
+    if (m_type != Type::Array) {
+      return;
+    }
+    size_t pos = 1;
+    JsonValue element;
+    while (NextElement(pos, element)) {
+      if (!visitor(element)) {
+        return;
+      }
+    }
+  }
+  template <typename Visitor> void ForEachMember(Visitor visitor) const {
+    if (m_type != Type::Object) {
+      return;
+    }
+    size_t pos = 1;
+    std::string_view key;
+    JsonValue value;
+    while (NextMember(pos, key, value)) {
+      if (!visitor(key, value)) {
+        return;
+      }
+    }
+  }
+  size_t Size() const;  // Elements or members; 0 for scalars
+
+private:
+  JsonValue(std::string_view text, Type type) : m_text(text), m_type(type) {}
+
+  // Step through a value already known to be well formed
+  bool NextElement(size_t &pos, JsonValue &element) const;
+  bool NextMember(size_t &pos, std::string_view &key, JsonValue &value) const;
+
+  std::string_view m_text;
+  Type m_type = Type::Invalid;
+};
+
+// Appends JSON to one growing buffer, inserting separators itself. Reuse a
+// writer (Clear() keeps the capacity) to serialize without reallocating.
+class JsonWriter {
+public:
+  explicit JsonWriter(size_t reserve = 256) { m_out.reserve(reserve); }
+
+  JsonWriter &BeginObject();
+  JsonWriter &EndObject();
+  JsonWriter &BeginArray();
+  JsonWriter &EndArray();
+  JsonWriter &Key(std::string_view key);
+
+  JsonWriter &String(std::string_view value);
+  JsonWriter &Int(int64_t value);
+  JsonWriter &Double(double value, int decimals);
+  JsonWriter &Bool(bool value);
+  JsonWriter &Null();
+  JsonWriter &Raw(std::string_view json);  // Pre-serialized value
+
+  const std::string &Str() const { return m_out; }
+  std::string Take() { return std::move(m_out); }
+  void Clear();
+
+private:
+  void BeforeValue();
+  void AppendEscaped(std::string_view value);
+
+  static constexpr int MAX_DEPTH = 64;  // One "needs a comma" bit per level
+
+  std::string m_out;
+  uint64_t m_needComma = 0;
+  int m_depth = 0;
+  bool m_afterKey = false;
+};
@@ -0,0 +1,948 @@
+#include "Manifest.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+constexpr size_t NPOS = std::string_view::npos;
+constexpr size_t MAX_SEGMENTS = 200000;  // Bounds hostile or broken manifests
+
+bool StartsWith(std::string_view text, std::string_view prefix) {
+  return text.substr(0, prefix.size()) == prefix;
+}
+
+std::string_view Trim(std::string_view text) {
+  size_t start = text.find_first_not_of(" \t\r\n");
+  if (start == NPOS) {
+    return std::string_view();
+  }
+  size_t end = text.find_last_not_of(" \t\r\n");
+  return text.substr(start, end - start + 1);
+}
+
+int64_t ToInt(std::string_view text, int64_t fallback) {
+  std::string value(Trim(text));
+  if (value.empty()) {
+    return fallback;
+  }
+  char *end = nullptr;
+  long long parsed = std::strtoll(value.c_str(), &end, 10);
+  return (end == value.c_str()) ? fallback : static_cast<int64_t>(parsed);
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Remove "." and ".." segments from the path of a URL (query untouched)
+std::string NormalizePath(const std::string &path) {
+  size_t queryStart = path.find_first_of("?#");
+  std::string query = (queryStart == std::string::npos) ? "" : path.substr(queryStart);
+  std::string_view rest(path.data(), std::min(path.size(), queryStart));
+
+  std::vector<std::string_view> parts;
+  size_t pos = 0;
+  while (pos <= rest.size()) {
+    size_t slash = rest.find('/', pos);
+    std::string_view part = rest.substr(pos, slash == NPOS ? NPOS : slash - pos);
+    if (part == "..") {
+      if (parts.size() > 1) {
+        parts.pop_back();
+      }
+    } else if (part != "." || slash == NPOS) {
+      parts.push_back(part == "." ? std::string_view() : part);
+    }
+    if (slash == NPOS) {
+      break;
+    }
+    pos = slash + 1;
+  }
+
+  std::string result;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    if (i > 0) {
+      result += '/';
+    }
+    result.append(parts[i].data(), parts[i].size());
+  }
+  return result + query;
+}
+
+// ---------------------------------------------------------------------------
+// HLS
+
+// Value of one attribute in an HLS attribute list; quoted values keep
+// their commas and lose their quotes
+std::string HlsAttribute(std::string_view list, std::string_view name) {
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t eq = list.find('=', pos);
+    if (eq == NPOS) {
+      break;
+    }
+    std::string_view key = Trim(list.substr(pos, eq - pos));
+    size_t valueStart = eq + 1;
+    size_t valueEnd;
+    std::string_view value;
+    if (valueStart < list.size() && list[valueStart] == '"') {
+      size_t close = list.find('"', valueStart + 1);
+      valueEnd = (close == NPOS) ? list.size() : close + 1;
+      value = list.substr(valueStart + 1, valueEnd - valueStart - 2);
+      valueEnd = list.find(',', valueEnd);
+    } else {
+      valueEnd = list.find(',', valueStart);
+      value = list.substr(valueStart, valueEnd == NPOS ? NPOS : valueEnd - valueStart);
+    }
+    if (key == name) {
+      return std::string(value);
+    }
+    if (valueEnd == NPOS) {
+      break;
+    }
+    pos = valueEnd + 1;
+  }
+  return "";
+}
+
+// Visit each line of a playlist without its line ending
+template <typename Visitor> void ForEachLine(std::string_view text, Visitor visitor) {
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    std::string_view line = Trim(text.substr(pos, end == NPOS ? NPOS : end - pos));
+    if (!visitor(line)) {
+      return;
+    }
+    if (end == NPOS) {
+      break;
+    }
+    pos = end + 1;
+  }
+}
+
+// "<length>[@<offset>]"; offset is -1 when absent
+bool ParseByteRange(std::string_view text, int64_t &length, int64_t &offset) {
+  size_t at = text.find('@');
+  length = ToInt(text.substr(0, at), -1);
+  offset = (at == NPOS) ? -1 : ToInt(text.substr(at + 1), -1);
+  return length >= 0;
+}
+
+// ---------------------------------------------------------------------------
+// DASH
+
+// Just enough XML for an MPD: elements, attributes and text, with
+// namespace prefixes dropped and the predefined entities decoded
+struct XmlNode {
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> attributes;
+  std::string text;
+  int parent = -1;
+  std::vector<int> children;
+};
+
+std::string DecodeEntities(std::string_view text) {
+  std::string result;
+  result.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] != '&') {
+      result += text[i];
+      continue;
+    }
+    size_t semicolon = text.find(';', i);
+    if (semicolon == NPOS || semicolon - i > 10) {
+      result += text[i];
+      continue;
+    }
+    std::string_view entity = text.substr(i + 1, semicolon - i - 1);
+    if (entity == "amp") result += '&';
+    else if (entity == "lt") result += '<';
+    else if (entity == "gt") result += '>';
+    else if (entity == "quot") result += '"';
+    else if (entity == "apos") result += '\'';
+    else if (StartsWith(entity, "#")) {
+      bool hex = entity.size() > 1 && (entity[1] == 'x' || entity[1] == 'X');
+      long code = std::strtol(std::string(entity.substr(hex ? 2 : 1)).c_str(), nullptr,
+                              hex ? 16 : 10);
+      if (code > 0 && code < 128) {
+        result += static_cast<char>(code);
+      }
+    } else {
+      result.append(text.data() + i, semicolon - i + 1);
+    }
+    i = semicolon;
+  }
+  return result;
+}
+
+std::string_view LocalName(std::string_view name) {
+  size_t colon = name.find(':');
+  return (colon == NPOS) ? name : name.substr(colon + 1);
+}
+
+bool ParseXml(std::string_view text, std::vector<XmlNode> &nodes) {
+  nodes.clear();
+  int current = -1;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t lt = text.find('<', pos);
+    if (current >= 0) {
+      nodes[current].text += DecodeEntities(text.substr(pos, lt == NPOS ? NPOS : lt - pos));
+    }
+    if (lt == NPOS) {
+      break;
+    }
+
+    std::string_view rest = text.substr(lt);
+    if (StartsWith(rest, "<!--") || StartsWith(rest, "<?") ||
+        StartsWith(rest, "<![CDATA[") || StartsWith(rest, "<!")) {
+      std::string_view terminator = StartsWith(rest, "<!--")        ? "-->"
+                                    : StartsWith(rest, "<?")        ? "?>"
+                                    : StartsWith(rest, "<![CDATA[") ? "]]>"
+                                                                    : ">";
+      size_t end = text.find(terminator, lt);
+      if (end == NPOS) {
+        return false;
+      }
+      if (current >= 0 && StartsWith(rest, "<![CDATA[")) {
+        nodes[current].text += text.substr(lt + 9, end - lt - 9);
+      }
+      pos = end + terminator.size();
+      continue;
+    }
+
+    if (StartsWith(rest, "</")) {
+      size_t gt = text.find('>', lt);
+      if (gt == NPOS) {
+        return false;
+      }
+      if (current >= 0) {
+        current = nodes[current].parent;
+      }
+      pos = gt + 1;
+      continue;
+    }
+
+    // Start tag: name, then attributes up to '>' or '/>'
+    size_t i = lt + 1;
+    size_t nameEnd = text.find_first_of(" \t\r\n/>", i);
+    if (nameEnd == NPOS) {
+      return false;
+    }
+    XmlNode node;
+    node.name = std::string(LocalName(text.substr(i, nameEnd - i)));
+    node.parent = current;
+    i = nameEnd;
+    bool selfClosing = false;
+    for (;;) {
+      i = text.find_first_not_of(" \t\r\n", i);
+      if (i == NPOS) {
+        return false;
+      }
+      if (text[i] == '>') {
+        break;
+      }
+      if (text[i] == '/') {
+        selfClosing = true;
+        i = text.find('>', i);
+        if (i == NPOS) {
+          return false;
+        }
+        break;
+      }
+      size_t eq = text.find('=', i);
+      if (eq == NPOS) {
+        return false;
+      }
+      std::string_view name = Trim(text.substr(i, eq - i));
+      size_t quote = text.find_first_of("\"'", eq);
+      if (quote == NPOS) {
+        return false;
+      }
+      size_t close = text.find(text[quote], quote + 1);
+      if (close == NPOS) {
+        return false;
+      }
+      node.attributes.emplace_back(std::string(LocalName(name)),
+                                   DecodeEntities(text.substr(quote + 1, close - quote - 1)));
+      i = close + 1;
+    }
+
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(std::move(node));
+    if (current >= 0) {
+      nodes[current].children.push_back(index);
+    }
+    if (!selfClosing) {
+      current = index;
+    }
+    pos = i + 1;
+  }
+  return !nodes.empty();
+}
+
+std::string Attr(const XmlNode &node, std::string_view name) {
+  for (const auto &attribute : node.attributes) {
+    if (attribute.first == name) {
+      return attribute.second;
+    }
+  }
+  return "";
+}
+
+const XmlNode *Child(const std::vector<XmlNode> &nodes, const XmlNode *node,
+                     std::string_view name) {
+  if (!node) {
+    return nullptr;
+  }
+  for (int index : node->children) {
+    if (nodes[index].name == name) {
+      return &nodes[index];
+    }
+  }
+  return nullptr;
+}
+
+// A node's BaseURL applied on top of the one it inherits
+std::string BaseFor(const std::vector<XmlNode> &nodes, const XmlNode *node,
+                    const std::string &inherited) {
+  const XmlNode *base = Child(nodes, node, "BaseURL");
+  if (!base) {
+    return inherited;
+  }
+  std::string reference(Trim(base->text));
+  return reference.empty() ? inherited : Manifest::ResolveUrl(inherited, reference);
+}
+
+// ISO 8601 duration as used by MPDs, e.g. "PT1H2M3.5S"; -1 if unreadable
+double ParseDuration(const std::string &text) {
+  if (text.empty() || text[0] != 'P') {
+    return -1.0;
+  }
+  double seconds = 0.0;
+  bool inTime = false;
+  const char *p = text.c_str() + 1;
+  while (*p) {
+    if (*p == 'T') {
+      inTime = true;
+      ++p;
+      continue;
+    }
+    char *end = nullptr;
+    double value = std::strtod(p, &end);
+    if (end == p || !*end) {
+      return -1.0;
+    }
+    switch (*end) {
+    case 'D': seconds += value * 86400.0; break;
+    case 'H': seconds += value * 3600.0; break;
+    case 'M': seconds += value * (inTime ? 60.0 : 30.0 * 86400.0); break;
+    case 'S': seconds += value; break;
+    case 'Y': seconds += value * 365.0 * 86400.0; break;
+    default: return -1.0;
+    }
+    p = end + 1;
+  }
+  return seconds;
+}
+
+// Expand $RepresentationID$, $Bandwidth$, $Number$, $Time$ (with an
+// optional %0<width>d format) and $$ in a SegmentTemplate URL
+std::string ExpandTemplate(const std::string &pattern, const std::string &representationId,
+                           int64_t bandwidth, int64_t number, int64_t time) {
+  std::string result;
+  size_t pos = 0;
+  while (pos < pattern.size()) {
+    size_t open = pattern.find('$', pos);
+    if (open == std::string::npos) {
+      result += pattern.substr(pos);
+      break;
+    }
+    result += pattern.substr(pos, open - pos);
+    size_t close = pattern.find('$', open + 1);
+    if (close == std::string::npos) {
+      result += pattern.substr(open);
+      break;
+    }
+    std::string identifier = pattern.substr(open + 1, close - open - 1);
+    pos = close + 1;
+    if (identifier.empty()) {
+      result += '$';
+      continue;
+    }
+
+    size_t percent = identifier.find('%');
+    std::string name = identifier.substr(0, percent);
+    int width = 0;
+    if (percent != std::string::npos) {
+      width = static_cast<int>(ToInt(identifier.substr(percent + 1).substr(1), 0));
+    }
+    std::string value;
+    if (name == "RepresentationID") value = representationId;
+    else if (name == "Bandwidth") value = std::to_string(bandwidth);
+    else if (name == "Number") value = std::to_string(number);
+    else if (name == "Time") value = std::to_string(time);
+    else {
+      result += '$' + identifier + '$';
+      continue;
+    }
+    if (static_cast<int>(value.size()) < width) {
+      value.insert(0, width - value.size(), '0');
+    }
+    result += value;
+  }
+  return result;
+}
+
+// Attributes of the SegmentTemplate elements that apply to a
+// representation, the most specific level winning
+struct SegmentTemplateInfo {
+  std::string media;
+  std::string initialization;
+  int64_t startNumber = 1;
+  int64_t timescale = 1;
+  int64_t duration = 0;
+  int64_t presentationTimeOffset = 0;
+  const XmlNode *timeline = nullptr;
+  bool present = false;
+};
+
+void MergeTemplate(const std::vector<XmlNode> &nodes, const XmlNode *level,
+                   SegmentTemplateInfo &info) {
+  const XmlNode *element = Child(nodes, level, "SegmentTemplate");
+  if (!element) {
+    return;
+  }
+  info.present = true;
+  std::string value;
+  if (!(value = Attr(*element, "media")).empty()) info.media = value;
+  if (!(value = Attr(*element, "initialization")).empty()) info.initialization = value;
+  if (!(value = Attr(*element, "startNumber")).empty()) info.startNumber = ToInt(value, 1);
+  if (!(value = Attr(*element, "timescale")).empty()) info.timescale = std::max<int64_t>(1, ToInt(value, 1));
+  if (!(value = Attr(*element, "duration")).empty()) info.duration = ToInt(value, 0);
+  if (!(value = Attr(*element, "presentationTimeOffset")).empty()) {
+    info.presentationTimeOffset = ToInt(value, 0);
+  }
+  if (const XmlNode *timeline = Child(nodes, element, "SegmentTimeline")) {
+    info.timeline = timeline;
+  }
+}
+
+// "first-last" byte range as used by SegmentList/SegmentBase
+void ApplyRange(const std::string &range, MediaSegment &segment) {
+  size_t dash = range.find('-');
+  if (range.empty() || dash == std::string::npos) {
+    return;
+  }
+  int64_t first = ToInt(std::string_view(range).substr(0, dash), -1);
+  int64_t last = ToInt(std::string_view(range).substr(dash + 1), -1);
+  if (first >= 0 && last >= first) {
+    segment.rangeStart = first;
+    segment.rangeLength = last - first + 1;
+  }
+}
+
+std::string ExtensionForMimeType(const std::string &mimeType) {
+  if (mimeType == "audio/mp4") return "m4a";
+  if (mimeType == "video/webm" || mimeType == "audio/webm") return "webm";
+  if (mimeType == "video/mp2t") return "ts";
+  return "mp4";
+}
+
+bool BuildDashTrack(const std::vector<XmlNode> &nodes, const XmlNode &period,
+                    const XmlNode &set, const XmlNode &representation,
+                    const std::string &periodBase, double periodSeconds,
+                    MediaTrack &track, std::string &error) {
+  std::string base = BaseFor(nodes, &representation, BaseFor(nodes, &set, periodBase));
+  std::string id = Attr(representation, "id");
+  int64_t bandwidth = ToInt(Attr(representation, "bandwidth"), 0);
+  std::string mimeType = Attr(representation, "mimeType");
+  if (mimeType.empty()) {
+    mimeType = Attr(set, "mimeType");
+  }
+  track = MediaTrack();
+  track.extension = ExtensionForMimeType(mimeType);
+
+  SegmentTemplateInfo info;
+  MergeTemplate(nodes, &period, info);
+  MergeTemplate(nodes, &set, info);
+  MergeTemplate(nodes, &representation, info);
+
+  if (info.present && !info.media.empty()) {
+    if (!info.initialization.empty()) {
+      MediaSegment init;
+      init.url = Manifest::ResolveUrl(
+          base, ExpandTemplate(info.initialization, id, bandwidth, 0, 0));
+      track.segments.push_back(std::move(init));
+    }
+
+    int64_t periodEnd = (periodSeconds > 0)
+                            ? info.presentationTimeOffset +
+                                  static_cast<int64_t>(std::llround(periodSeconds * info.timescale))
+                            : -1;
+    int64_t number = info.startNumber;
+    auto addSegment = [&](int64_t time) {
+      MediaSegment segment;
+      segment.url = Manifest::ResolveUrl(
+          base, ExpandTemplate(info.media, id, bandwidth, number++, time));
+      track.segments.push_back(std::move(segment));
+      return track.segments.size() < MAX_SEGMENTS;
+    };
+
+    if (info.timeline) {
+      int64_t time = 0;
+      const auto &entries = info.timeline->children;
+      for (size_t e = 0; e < entries.size(); ++e) {
+        const XmlNode &entry = nodes[entries[e]];
+        if (entry.name != "S") {
+          continue;
+        }
+        std::string start = Attr(entry, "t");
+        if (!start.empty()) {
+          time = ToInt(start, time);
+        }
+        int64_t duration = ToInt(Attr(entry, "d"), 0);
+        int64_t repeat = ToInt(Attr(entry, "r"), 0);
+        if (duration <= 0) {
+          error = "Invalid SegmentTimeline entry";
+          return false;
+        }
+        if (repeat < 0) {
+          // Repeat until the next entry's start or the end of the period
+          int64_t until = periodEnd;
+          for (size_t n = e + 1; n < entries.size(); ++n) {
+            if (nodes[entries[n]].name == "S") {
+              until = ToInt(Attr(nodes[entries[n]], "t"), periodEnd);
+              break;
+            }
+          }
+          if (until < 0) {
+            error = "MPD has no duration";
+            return false;
+          }
+          repeat = (until - time + duration - 1) / duration - 1;
+        }
+        for (int64_t r = 0; r <= repeat; ++r) {
+          if (!addSegment(time)) {
+            error = "Too many segments";
+            return false;
+          }
+          time += duration;
+        }
+      }
+    } else if (info.duration > 0) {
+      if (periodEnd < 0) {
+        error = "MPD has no duration";
+        return false;
+      }
+      int64_t count = (periodEnd - info.presentationTimeOffset + info.duration - 1) / info.duration;
+      for (int64_t i = 0; i < count; ++i) {
+        if (!addSegment(info.presentationTimeOffset + i * info.duration)) {
+          error = "Too many segments";
+          return false;
+        }
+      }
+    } else {
+      error = "SegmentTemplate has neither a timeline nor a duration";
+      return false;
+    }
+    return true;
+  }
+
+  const XmlNode *list = Child(nodes, &representation, "SegmentList");
+  if (!list) {
+    list = Child(nodes, &set, "SegmentList");
+  }
+  if (list) {
+    if (const XmlNode *init = Child(nodes, list, "Initialization")) {
+      MediaSegment segment;
+      std::string source = Attr(*init, "sourceURL");
+      segment.url = source.empty() ? base : Manifest::ResolveUrl(base, source);
+      ApplyRange(Attr(*init, "range"), segment);
+      track.segments.push_back(std::move(segment));
+    }
+    for (int index : list->children) {
+      const XmlNode &entry = nodes[index];
+      if (entry.name != "SegmentURL") {
+        continue;
+      }
+      MediaSegment segment;
+      std::string media = Attr(entry, "media");
+      segment.url = media.empty() ? base : Manifest::ResolveUrl(base, media);
+      ApplyRange(Attr(entry, "mediaRange"), segment);
+      track.segments.push_back(std::move(segment));
+    }
+    if (track.segments.empty()) {
+      error = "SegmentList is empty";
+      return false;
+    }
+    return true;
+  }
+
+  // SegmentBase or nothing: the representation is one file
+  MediaSegment whole;
+  whole.url = base;
+  track.segments.push_back(std::move(whole));
+  return true;
+}
+
+} // namespace
+
+bool Manifest::IsManifestUrl(const std::string &url) {
+  size_t end = url.find_first_of("?#");
+  std::string path = url.substr(0, end);
+  std::transform(path.begin(), path.end(), path.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  auto endsWith = [&path](const char *suffix) {
+    size_t length = std::char_traits<char>::length(suffix);
+    return path.size() >= length && path.compare(path.size() - length, length, suffix) == 0;
+  };
+  return endsWith(".m3u8") || endsWith(".mpd");
+}
+
+bool Manifest::IsHls(std::string_view text) {
+  size_t start = text.find_first_not_of(" \t\r\n\xEF\xBB\xBF");
+  return start != NPOS && StartsWith(text.substr(start), "#EXTM3U");
+}
+
+bool Manifest::IsDash(std::string_view text) {
+  return text.find("<MPD") != NPOS || text.find(":MPD") != NPOS;
+}
+
+std::string Manifest::ResolveUrl(const std::string &baseUrl,
+                                 const std::string &reference) {
+  if (reference.empty()) {
+    return baseUrl;
+  }
+  size_t colon = reference.find(':');
+  size_t firstSlash = reference.find('/');
+  if (colon != std::string::npos && reference.compare(colon, 3, "://") == 0 &&
+      colon < firstSlash) {
+    return reference;  // Absolute
+  }
+
+  size_t schemeEnd = baseUrl.find("://");
+  if (schemeEnd == std::string::npos) {
+    return reference;
+  }
+  if (StartsWith(reference, "//")) {
+    return baseUrl.substr(0, schemeEnd + 1) + reference;
+  }
+
+  size_t hostEnd = baseUrl.find_first_of("/?#", schemeEnd + 3);
+  std::string origin = baseUrl.substr(0, hostEnd);
+  if (reference[0] == '/') {
+    return origin + NormalizePath(reference);
+  }
+
+  std::string path;
+  if (hostEnd != std::string::npos && baseUrl[hostEnd] == '/') {
+    size_t pathEnd = baseUrl.find_first_of("?#", hostEnd);
+    path = baseUrl.substr(hostEnd, pathEnd == std::string::npos ? std::string::npos
+                                                                 : pathEnd - hostEnd);
+  } else {
+    path = "/";
+  }
+  if (reference[0] == '?') {
+    return origin + path + reference;
+  }
+  path.erase(path.find_last_of('/') + 1);
+  return origin + NormalizePath(path + reference);
+}
+
+bool Manifest::ParseHlsMaster(std::string_view text, const std::string &baseUrl,
+                              std::string &variantUrl, std::string &audioUrl) {
+  struct Variant {
+    int64_t bandwidth = 0;
+    std::string url;
+    std::string audioGroup;
+  };
+  struct Rendition {
+    std::string group;
+    std::string url;
+    bool isDefault = false;
+  };
+  std::vector<Variant> variants;
+  std::vector<Rendition> audio;
+  Variant pending;
+  bool expectUri = false;
+
+  ForEachLine(text, [&](std::string_view line) {
+    if (StartsWith(line, "#EXT-X-STREAM-INF:")) {
+      std::string_view list = line.substr(18);
+      pending = Variant();
+      pending.bandwidth = ToInt(HlsAttribute(list, "BANDWIDTH"), 0);
+      pending.audioGroup = HlsAttribute(list, "AUDIO");
+      expectUri = true;
+    } else if (StartsWith(line, "#EXT-X-MEDIA:")) {
+      std::string_view list = line.substr(13);
+      std::string uri = HlsAttribute(list, "URI");
+      if (HlsAttribute(list, "TYPE") == "AUDIO" && !uri.empty()) {
+        audio.push_back({HlsAttribute(list, "GROUP-ID"), ResolveUrl(baseUrl, uri),
+                         HlsAttribute(list, "DEFAULT") == "YES"});
+      }
+    } else if (!line.empty() && line[0] != '#' && expectUri) {
+      pending.url = ResolveUrl(baseUrl, std::string(line));
+      variants.push_back(pending);
+      expectUri = false;
+    }
+    return true;
+  });
+
+  if (variants.empty()) {
+    return false;
+  }
+  const Variant &best = *std::max_element(
+      variants.begin(), variants.end(),
+      [](const Variant &a, const Variant &b) { return a.bandwidth < b.bandwidth; });
+  variantUrl = best.url;
+  audioUrl.clear();
+
+  // Renditions in the variant's group carry its audio; without a URI the
+  // audio is muxed into the variant itself
+  for (const Rendition &rendition : audio) {
+    if (rendition.group == best.audioGroup &&
+        (audioUrl.empty() || rendition.isDefault)) {
+      audioUrl = rendition.url;
+      if (rendition.isDefault) {
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+bool Manifest::ParseHlsMedia(std::string_view text, const std::string &baseUrl,
+                             MediaTrack &track, std::string &error) {
+  track = MediaTrack();
+  int64_t sequence = 0;
+  bool endList = false;
+  bool fragmented = false;
+  int keyIndex = -1;
+  bool explicitIv = false;
+  uint8_t keyIv[16] = {};
+  int64_t rangeLength = -1;
+  int64_t rangeOffset = -1;
+  std::string lastRangeUrl;
+  int64_t nextRangeStart = 0;
+
+  auto applyKey = [&](MediaSegment &segment, int64_t segmentSequence) {
+    if (keyIndex < 0) {
+      return;
+    }
+    segment.keyIndex = keyIndex;
+    if (explicitIv) {
+      std::copy(keyIv, keyIv + 16, segment.iv);
+    } else {
+      // Without an IV attribute the media sequence number is the IV
+      for (int i = 0; i < 8; ++i) {
+        segment.iv[15 - i] = static_cast<uint8_t>(segmentSequence >> (8 * i));
+      }
+    }
+  };
+
+  bool ok = true;
+  ForEachLine(text, [&](std::string_view line) {
+    if (line.empty()) {
+      return true;
+    }
+    if (StartsWith(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+      sequence = ToInt(line.substr(22), 0);
+    } else if (StartsWith(line, "#EXT-X-ENDLIST")) {
+      endList = true;
+    } else if (StartsWith(line, "#EXT-X-STREAM-INF:")) {
+      error = "Expected a media playlist, got a master playlist";
+      ok = false;
+    } else if (StartsWith(line, "#EXT-X-KEY:")) {
+      std::string_view list = line.substr(11);
+      std::string method = HlsAttribute(list, "METHOD");
+      if (method == "NONE") {
+        keyIndex = -1;
+      } else if (method == "AES-128") {
+        std::string uri = HlsAttribute(list, "URI");
+        if (uri.empty()) {
+          error = "AES-128 key without a URI";
+          ok = false;
+          return false;
+        }
+        std::string keyUrl = ResolveUrl(baseUrl, uri);
+        auto it = std::find(track.keyUrls.begin(), track.keyUrls.end(), keyUrl);
+        keyIndex = static_cast<int>(it - track.keyUrls.begin());
+        if (it == track.keyUrls.end()) {
+          track.keyUrls.push_back(keyUrl);
+        }
+
+        std::string iv = HlsAttribute(list, "IV");
+        explicitIv = !iv.empty();
+        std::fill(keyIv, keyIv + 16, 0);
+        if (explicitIv) {
+          // Hex, right-aligned into 16 bytes
+          size_t digits = (iv.size() > 2 && (iv[1] == 'x' || iv[1] == 'X')) ? 2 : 0;
+          int nibble = 31;
+          for (size_t i = iv.size(); i > digits && nibble >= 0; --i, --nibble) {
+            int value = HexValue(iv[i - 1]);
+            if (value < 0) {
+              error = "Invalid AES-128 IV";
+              ok = false;
+              return false;
+            }
+            keyIv[nibble / 2] |= static_cast<uint8_t>(nibble % 2 ? value : value << 4);
+          }
+        }
+      } else {
+        error = "Unsupported encryption: " + method;
+        ok = false;
+      }
+    } else if (StartsWith(line, "#EXT-X-MAP:")) {
+      std::string_view list = line.substr(11);
+      MediaSegment init;
+      init.url = ResolveUrl(baseUrl, HlsAttribute(list, "URI"));
+      int64_t length;
+      int64_t offset;
+      if (ParseByteRange(HlsAttribute(list, "BYTERANGE"), length, offset)) {
+        init.rangeStart = std::max<int64_t>(0, offset);
+        init.rangeLength = length;
+      }
+      if (explicitIv) {
+        applyKey(init, sequence);
+      }
+      track.segments.push_back(std::move(init));
+      fragmented = true;
+    } else if (StartsWith(line, "#EXT-X-BYTERANGE:")) {
+      ParseByteRange(line.substr(17), rangeLength, rangeOffset);
+    } else if (line[0] != '#') {
+      MediaSegment segment;
+      segment.url = ResolveUrl(baseUrl, std::string(line));
+      if (rangeLength >= 0) {
+        // Without an offset a range continues where the last one ended
+        segment.rangeStart = (rangeOffset >= 0)
+                                 ? rangeOffset
+                                 : (segment.url == lastRangeUrl ? nextRangeStart : 0);
+        segment.rangeLength = rangeLength;
+        nextRangeStart = segment.rangeStart + rangeLength;
+        lastRangeUrl = segment.url;
+        rangeLength = -1;
+        rangeOffset = -1;
+      }
+      applyKey(segment, sequence++);
+      track.segments.push_back(std::move(segment));
+      if (track.segments.size() >= MAX_SEGMENTS) {
+        error = "Too many segments";
+        ok = false;
+      }
+    }
+    return ok;
+  });
+
+  if (!ok) {
+    return false;
+  }
+  if (!endList) {
+    error = "Live streams are not supported";
+    return false;
+  }
+  if (track.segments.empty()) {
+    error = "Playlist lists no segments";
+    return false;
+  }
+
+  std::string mediaPath = track.segments.back().url.substr(
+      0, track.segments.back().url.find_first_of("?#"));
+  bool packedAudio = mediaPath.size() > 4 &&
+                     mediaPath.compare(mediaPath.size() - 4, 4, ".aac") == 0;
+  track.extension = fragmented ? "mp4" : (packedAudio ? "aac" : "ts");
+  return true;
+}
+
+bool Manifest::ParseDash(std::string_view text, const std::string &baseUrl,
+                         std::vector<MediaTrack> &tracks, std::string &error) {
+  tracks.clear();
+  std::vector<XmlNode> nodes;
+  if (!ParseXml(text, nodes)) {
+    error = "Unreadable MPD";
+    return false;
+  }
+  const XmlNode *mpd = nullptr;
+  for (const XmlNode &node : nodes) {
+    if (node.name == "MPD") {
+      mpd = &node;
+      break;
+    }
+  }
+  if (!mpd) {
+    error = "Unreadable MPD";
+    return false;
+  }
+  if (Attr(*mpd, "type") == "dynamic") {
+    error = "Live streams are not supported";
+    return false;
+  }
+  const XmlNode *period = Child(nodes, mpd, "Period");
+  if (!period) {
+    error = "MPD has no period";
+    return false;
+  }
+
+  std::string periodBase = BaseFor(nodes, period, BaseFor(nodes, mpd, baseUrl));
+  double periodSeconds = ParseDuration(Attr(*period, "duration"));
+  if (periodSeconds <= 0) {
+    periodSeconds = ParseDuration(Attr(*mpd, "mediaPresentationDuration"));
+  }
+
+  // Best representation of each kind, with the adaptation set it is in
+  struct Choice {
+    const XmlNode *set = nullptr;
+    const XmlNode *representation = nullptr;
+    int64_t bandwidth = -1;
+  };
+  Choice video;
+  Choice audio;
+  for (int setIndex : period->children) {
+    const XmlNode &set = nodes[setIndex];
+    if (set.name != "AdaptationSet") {
+      continue;
+    }
+    for (int repIndex : set.children) {
+      const XmlNode &representation = nodes[repIndex];
+      if (representation.name != "Representation") {
+        continue;
+      }
+      std::string kind = Attr(set, "contentType");
+      if (kind.empty()) {
+        std::string mimeType = Attr(representation, "mimeType");
+        if (mimeType.empty()) {
+          mimeType = Attr(set, "mimeType");
+        }
+        kind = mimeType.substr(0, mimeType.find('/'));
+      }
+      Choice *choice = (kind == "video") ? &video : (kind == "audio") ? &audio : nullptr;
+      int64_t bandwidth = ToInt(Attr(representation, "bandwidth"), 0);
+      if (choice && bandwidth > choice->bandwidth) {
+        *choice = {&set, &representation, bandwidth};
+      }
+    }
+  }
+
+  for (const Choice *choice : {&video, &audio}) {
+    if (!choice->representation) {
+      continue;
+    }
+    MediaTrack track;
+    if (!BuildDashTrack(nodes, *period, *choice->set, *choice->representation,
+                        periodBase, periodSeconds, track, error)) {
+      return false;
+    }
+    tracks.push_back(std::move(track));
+  }
+  if (tracks.empty()) {
+    error = "MPD has no audio or video representation";
+    return false;
+  }
+  return true;
+}
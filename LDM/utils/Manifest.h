@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One request of a streaming track: a whole resource or a byte range of it
+struct MediaSegment {
+  std::string url;
+  int64_t rangeStart = -1;   // -1 = whole resource
+  int64_t rangeLength = -1;
+  int keyIndex = -1;         // Into MediaTrack::keyUrls; -1 = not encrypted
+  uint8_t iv[16] = {};       // AES-128-CBC IV when keyIndex >= 0
+};
+
+// A variant flattened into the requests that rebuild it when their bodies
+// are written out in order; an initialization section comes first
+struct MediaTrack {
+  std::vector<MediaSegment> segments;
+  std::vector<std::string> keyUrls;  // Each holds a 16-byte AES-128 key
+  std::string extension;             // Container of the written file
+};
+
+// Parses HLS playlists and DASH MPDs into MediaTracks. Only on-demand
+// presentations are accepted; a live manifest is a moving window.
+class Manifest {
+public:
+  // URL path ends in .m3u8 or .mpd
+  static bool IsManifestUrl(const std::string &url);
+
+  static bool IsHls(std::string_view text);
+  static bool IsDash(std::string_view text);
+
+  // HLS master playlist: the highest-bandwidth variant and, if it takes its
+  // audio from a separate rendition, that rendition's playlist (else empty).
+  // False when the text is a media playlist rather than a master.
+  static bool ParseHlsMaster(std::string_view text, const std::string &baseUrl,
+                             std::string &variantUrl, std::string &audioUrl);
+
+  // HLS media playlist; AES-128 keys and EXT-X-MAP sections are resolved
+  static bool ParseHlsMedia(std::string_view text, const std::string &baseUrl,
+                            MediaTrack &track, std::string &error);
+
+  // DASH MPD: the highest-bandwidth video representation, then the
+  // highest-bandwidth audio one if audio is separate. First period only.
+  static bool ParseDash(std::string_view text, const std::string &baseUrl,
+                        std::vector<MediaTrack> &tracks, std::string &error);
+
+  // Resolve a reference (absolute, scheme-relative, rooted or relative)
+  // against the URL of the document it appeared in
+  static std::string ResolveUrl(const std::string &baseUrl,
+                                const std::string &reference);
+};
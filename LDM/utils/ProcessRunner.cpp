@@ -0,0 +1,510 @@
+#include "ProcessRunner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+struct ProcessRunner::Process {
+  int id = 0;
+  LineCallback onLine;
+  ExitCallback onExit;
+
+  // Output since the last complete line; lines are handed out as views
+  // into it and only the unfinished tail is moved, once per read
+  std::unique_ptr<char[]> buffer{new char[LINE_BUFFER_SIZE]};
+  size_t length = 0;
+  bool splitLines = true;
+
+  int idleTimeoutMs = 0;
+  std::chrono::steady_clock::time_point lastOutput;
+  std::chrono::steady_clock::time_point exitTime;
+  bool outputEnded = false;
+  bool exited = false;
+  bool killed = false;
+  int exitCode = -1;
+
+#ifdef _WIN32
+  HANDLE process = NULL;
+  HANDLE pipe = INVALID_HANDLE_VALUE;
+  OVERLAPPED overlapped = {};
+  bool readPending = false;
+#else
+  pid_t pid = -1;
+  int fd = -1;
+#endif
+};
+
+ProcessRunner::ProcessRunner() {
+#ifdef _WIN32
+  m_completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+#else
+  if (pipe2(m_wakePipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+    m_wakePipe[0] = m_wakePipe[1] = -1;
+  }
+#endif
+}
+
+ProcessRunner::~ProcessRunner() {
+  Shutdown();
+
+#ifdef _WIN32
+  if (m_completionPort) {
+    CloseHandle(m_completionPort);
+  }
+#else
+  for (int fd : m_wakePipe) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+void ProcessRunner::Shutdown() {
+  m_stopping.store(true);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &pair : m_processes) {
+      Process &process = *pair.second;
+      if (process.exited) {
+        continue;
+      }
+#ifdef _WIN32
+      TerminateProcess(process.process, 1);
+#else
+      kill(-process.pid, SIGKILL);
+#endif
+    }
+  }
+
+  // The I/O thread leaves once every child has been reaped
+  Wake();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+int ProcessRunner::Start(const std::string &commandLine, LineCallback onLine,
+                         ExitCallback onExit, int idleTimeoutMs,
+                         bool splitLines) {
+  if (m_stopping.load()) {
+    return -1;
+  }
+
+  auto process = std::make_unique<Process>();
+  process->onLine = std::move(onLine);
+  process->onExit = std::move(onExit);
+  process->idleTimeoutMs = idleTimeoutMs;
+  process->splitLines = splitLines;
+  process->lastOutput = std::chrono::steady_clock::now();
+
+#ifdef _WIN32
+  if (!m_completionPort) {
+    return -1;
+  }
+
+  // Anonymous pipes cannot be read overlapped, so give each child a
+  // uniquely named pipe whose server end we read through the port
+  static std::atomic<unsigned> pipeSerial{0};
+  std::string pipeName = "\\\\.\\pipe\\LDM-" +
+                         std::to_string(GetCurrentProcessId()) + "-" +
+                         std::to_string(pipeSerial.fetch_add(1));
+
+  HANDLE readPipe = CreateNamedPipeA(
+      pipeName.c_str(),
+      PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+      PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 0,
+      static_cast<DWORD>(LINE_BUFFER_SIZE), 0, NULL);
+  if (readPipe == INVALID_HANDLE_VALUE) {
+    std::cerr << "[ProcessRunner] Failed to create pipe: " << GetLastError()
+              << std::endl;
+    return -1;
+  }
+
+  SECURITY_ATTRIBUTES sa;
+  sa.nLength = sizeof(SECURITY_ATTRIBUTES);
+  sa.bInheritHandle = TRUE;
+  sa.lpSecurityDescriptor = NULL;
+
+  HANDLE writePipe = CreateFileA(pipeName.c_str(), GENERIC_WRITE, 0, &sa,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (writePipe == INVALID_HANDLE_VALUE) {
+    CloseHandle(readPipe);
+    return -1;
+  }
+
+  STARTUPINFOA si = {0};
+  si.cb = sizeof(STARTUPINFOA);
+  si.hStdOutput = writePipe;
+  si.hStdError = writePipe;
+  si.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+  si.wShowWindow = SW_HIDE;
+
+  PROCESS_INFORMATION pi = {0};
+
+  std::vector<char> cmdLine(commandLine.begin(), commandLine.end());
+  cmdLine.push_back('\0');
+
+  BOOL created = CreateProcessA(NULL, cmdLine.data(), NULL, NULL, TRUE,
+                                CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+  CloseHandle(writePipe);  // Only the child writes
+  if (!created) {
+    CloseHandle(readPipe);
+    return -1;
+  }
+  CloseHandle(pi.hThread);
+
+  process->process = pi.hProcess;
+  process->pipe = readPipe;
+#else
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) {
+    return -1;
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return -1;
+  }
+  if (pid == 0) {
+    // Own process group, so Kill() takes any grandchildren down too
+    setpgid(0, 0);
+    int devNull = open("/dev/null", O_RDONLY);
+    if (devNull >= 0) {
+      dup2(devNull, STDIN_FILENO);
+    }
+    dup2(fds[1], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+    execl("/bin/sh", "sh", "-c", commandLine.c_str(), static_cast<char *>(nullptr));
+    _exit(127);
+  }
+
+  setpgid(pid, pid);  // Also here, so an immediate Kill() cannot race the child
+  close(fds[1]);
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  process->pid = pid;
+  process->fd = fds[0];
+#endif
+
+  int id;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopping.load()) {
+      // Shutdown() began while the child was being created
+#ifdef _WIN32
+      TerminateProcess(process->process, 1);
+      CloseHandle(process->process);
+      CloseHandle(process->pipe);
+#else
+      kill(-process->pid, SIGKILL);
+      waitpid(process->pid, nullptr, 0);
+      close(process->fd);
+#endif
+      return -1;
+    }
+    id = m_nextId++;
+    process->id = id;
+#ifdef _WIN32
+    CreateIoCompletionPort(process->pipe, m_completionPort,
+                           static_cast<ULONG_PTR>(id), 0);
+#endif
+    m_processes[id] = std::move(process);
+    if (!m_thread.joinable()) {
+      m_thread = std::thread(&ProcessRunner::Run, this);
+    }
+  }
+
+#ifdef _WIN32
+  // The first read is queued from the I/O thread, like every later one
+  PostQueuedCompletionStatus(m_completionPort, 0, static_cast<ULONG_PTR>(id),
+                             NULL);
+#else
+  Wake();
+#endif
+  return id;
+}
+
+void ProcessRunner::Kill(int processId) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || it->second->exited) {
+    return;  // Gone, or reaped (the pid may already be reused)
+  }
+  Process &process = *it->second;
+#ifdef _WIN32
+  TerminateProcess(process.process, 1);
+#else
+  kill(-process.pid, SIGKILL);
+#endif
+  process.killed = true;
+}
+
+size_t ProcessRunner::GetRunningCount() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_processes.size();
+}
+
+void ProcessRunner::Wake() {
+#ifdef _WIN32
+  if (m_completionPort) {
+    PostQueuedCompletionStatus(m_completionPort, 0, 0, NULL);
+  }
+#else
+  if (m_wakePipe[1] >= 0) {
+    char byte = 1;
+    ssize_t written = write(m_wakePipe[1], &byte, 1);
+    (void)written;  // Full pipe: a wake-up is already pending
+  }
+#endif
+}
+
+void ProcessRunner::DeliverLines(Process &process, bool flushAll) {
+  const char *data = process.buffer.get();
+  const char *end = data + process.length;
+  const char *lineStart = data;
+
+  if (!process.splitLines) {
+    if (process.length > 0 && process.onLine) {
+      process.onLine(std::string_view(data, process.length));
+    }
+    process.length = 0;
+    return;
+  }
+
+  // '\r' ends a line too: without --newline, progress redraws with it
+  auto isBreak = [](char c) { return c == '\n' || c == '\r'; };
+  for (const char *pos = std::find_if(lineStart, end, isBreak); pos != end;
+       pos = std::find_if(lineStart, end, isBreak)) {
+    if (pos > lineStart && process.onLine) {
+      process.onLine(std::string_view(lineStart, pos - lineStart));
+    }
+    lineStart = pos + 1;
+  }
+
+  size_t remaining = static_cast<size_t>(end - lineStart);
+  if (remaining > 0 && (flushAll || remaining == LINE_BUFFER_SIZE)) {
+    if (process.onLine) {
+      process.onLine(std::string_view(lineStart, remaining));
+    }
+    remaining = 0;
+  }
+  if (remaining > 0 && lineStart != data) {
+    std::memmove(process.buffer.get(), lineStart, remaining);
+  }
+  process.length = remaining;
+}
+
+void ProcessRunner::ReadOutput(Process &process) {
+#ifdef _WIN32
+  process.overlapped = OVERLAPPED{};
+  DWORD room = static_cast<DWORD>(LINE_BUFFER_SIZE - process.length);
+  if (!ReadFile(process.pipe, process.buffer.get() + process.length, room,
+                NULL, &process.overlapped) &&
+      GetLastError() != ERROR_IO_PENDING) {
+    process.outputEnded = true;  // Broken pipe: the child closed its end
+    return;
+  }
+  // Completes through the port, whether or not it finished right away
+  process.readPending = true;
+#else
+  for (;;) {
+    ssize_t bytesRead = read(process.fd, process.buffer.get() + process.length,
+                             LINE_BUFFER_SIZE - process.length);
+    if (bytesRead > 0) {
+      process.length += static_cast<size_t>(bytesRead);
+      process.lastOutput = std::chrono::steady_clock::now();
+      DeliverLines(process, false);
+    } else if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    } else {
+      if (bytesRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        process.outputEnded = true;
+      }
+      return;
+    }
+  }
+#endif
+}
+
+int ProcessRunner::Housekeeping(std::vector<std::unique_ptr<Process>> &finished) {
+  auto now = std::chrono::steady_clock::now();
+  int waitMs = -1;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto it = m_processes.begin(); it != m_processes.end();) {
+    Process &process = *it->second;
+
+    if (!process.exited) {
+#ifdef _WIN32
+      DWORD code = 0;
+      if (WaitForSingleObject(process.process, 0) == WAIT_OBJECT_0 &&
+          GetExitCodeProcess(process.process, &code)) {
+        process.exited = true;
+        process.exitCode = static_cast<int>(code);
+      }
+#else
+      int status = 0;
+      if (waitpid(process.pid, &status, WNOHANG) == process.pid) {
+        process.exited = true;
+        process.exitCode = WIFEXITED(status) ? WEXITSTATUS(status)
+                                             : 128 + WTERMSIG(status);
+      }
+#endif
+      if (process.exited) {
+        process.exitTime = now;
+      }
+    }
+
+#ifdef _WIN32
+    bool drained = process.outputEnded && !process.readPending;
+#else
+    bool drained = process.outputEnded;
+#endif
+    if (process.exited && drained) {
+      finished.push_back(std::move(it->second));
+      it = m_processes.erase(it);
+      continue;
+    }
+
+    int nextCheckMs = HOUSEKEEPING_MS;
+    if (process.exited) {
+      if (now - process.exitTime >= std::chrono::milliseconds(EXIT_GRACE_MS)) {
+        // Stop waiting for EOF from whoever inherited the pipe
+#ifdef _WIN32
+        CancelIoEx(process.pipe, &process.overlapped);
+#else
+        process.outputEnded = true;
+#endif
+      }
+      nextCheckMs = EXIT_POLL_MS;
+    } else if (process.outputEnded) {
+      nextCheckMs = EXIT_POLL_MS;
+    } else if (process.idleTimeoutMs > 0 && !process.killed &&
+               now - process.lastOutput >
+                   std::chrono::milliseconds(process.idleTimeoutMs)) {
+      std::cerr << "[ProcessRunner] Process " << process.id
+                << " produced no output for " << process.idleTimeoutMs
+                << " ms; terminating" << std::endl;
+#ifdef _WIN32
+      TerminateProcess(process.process, 1);
+#else
+      kill(-process.pid, SIGKILL);
+#endif
+      process.killed = true;
+      nextCheckMs = EXIT_POLL_MS;
+    }
+    waitMs = (waitMs < 0) ? nextCheckMs : std::min(waitMs, nextCheckMs);
+    ++it;
+  }
+  return waitMs;
+}
+
+void ProcessRunner::FinishProcess(Process &process) {
+  DeliverLines(process, true);
+#ifdef _WIN32
+  CloseHandle(process.pipe);
+  CloseHandle(process.process);
+#else
+  close(process.fd);
+#endif
+  if (process.onExit) {
+    process.onExit(process.exitCode);
+  }
+}
+
+void ProcessRunner::Run() {
+  int waitMs = -1;
+  std::vector<std::unique_ptr<Process>> finished;
+
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_stopping.load() && m_processes.empty()) {
+        return;
+      }
+    }
+
+#ifdef _WIN32
+    DWORD bytes = 0;
+    ULONG_PTR key = 0;
+    OVERLAPPED *overlapped = NULL;
+    BOOL ok = GetQueuedCompletionStatus(
+        m_completionPort, &bytes, &key, &overlapped,
+        waitMs < 0 ? INFINITE : static_cast<DWORD>(waitMs));
+
+    // Only this thread removes processes, so the pointer stays valid
+    Process *process = nullptr;
+    if (key != 0) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_processes.find(static_cast<int>(key));
+      if (it != m_processes.end()) {
+        process = it->second.get();
+      }
+    }
+
+    if (process && overlapped) {
+      // A read finished: failure means the pipe broke or was cancelled
+      process->readPending = false;
+      if (!ok) {
+        process->outputEnded = true;
+      } else {
+        if (bytes > 0) {
+          process->length += bytes;
+          process->lastOutput = std::chrono::steady_clock::now();
+          DeliverLines(*process, false);
+        }
+        ReadOutput(*process);
+      }
+    } else if (process) {
+      ReadOutput(*process);  // Posted by Start()
+    }
+#else
+    std::vector<pollfd> fds;
+    std::vector<Process *> owners;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      fds.push_back({m_wakePipe[0], POLLIN, 0});
+      for (auto &pair : m_processes) {
+        if (!pair.second->outputEnded) {
+          fds.push_back({pair.second->fd, POLLIN, 0});
+          owners.push_back(pair.second.get());
+        }
+      }
+    }
+
+    if (poll(fds.data(), fds.size(), waitMs) > 0) {
+      if (fds[0].revents & POLLIN) {
+        char drain[64];
+        while (read(m_wakePipe[0], drain, sizeof(drain)) > 0) {
+        }
+      }
+      for (size_t i = 0; i < owners.size(); ++i) {
+        if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+          ReadOutput(*owners[i]);
+        }
+      }
+    }
+#endif
+
+    waitMs = Housekeeping(finished);
+    for (auto &done : finished) {
+      FinishProcess(*done);
+    }
+    finished.clear();
+  }
+}
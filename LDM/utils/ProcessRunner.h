@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Runs child processes and hands their combined stdout/stderr back line by
+// line. One I/O thread serves every child - overlapped named pipes on an I/O
+// completion port on Windows, poll() elsewhere - so a running child costs a
+// buffer rather than a thread. Callbacks run on that thread and must not
+// block; a line is a view into the read buffer, valid only during the call.
+class ProcessRunner {
+public:
+  using LineCallback = std::function<void(std::string_view line)>;
+  using ExitCallback = std::function<void(int exitCode)>;
+
+  ProcessRunner();
+  ~ProcessRunner();
+
+  // Disable copy
+  ProcessRunner(const ProcessRunner &) = delete;
+  ProcessRunner &operator=(const ProcessRunner &) = delete;
+
+  // Launch a command line. onExit runs once, after the last line. A child
+  // that prints nothing for idleTimeoutMs (0 = no limit) is killed. With
+  // splitLines off, onLine gets output as read, e.g. to collect a document.
+  // Returns an id for Kill(), or -1 if the process could not be started.
+  int Start(const std::string &commandLine, LineCallback onLine,
+            ExitCallback onExit, int idleTimeoutMs = 0, bool splitLines = true);
+
+  // Terminate a child; its onExit still runs once the pipe drains
+  void Kill(int processId);
+
+  // Kill every child, run their exit callbacks and stop the I/O thread.
+  // Start() fails from then on.
+  void Shutdown();
+
+  size_t GetRunningCount() const;
+
+private:
+  struct Process;
+
+  void Run();  // I/O thread
+  void Wake();
+  // Windows: queue the next overlapped read. Elsewhere: read what is ready.
+  static void ReadOutput(Process &process);
+  // Split complete lines out of the read buffer and shift the remainder
+  static void DeliverLines(Process &process, bool flushAll);
+  // Move children that have exited and drained into 'finished', enforce
+  // idle timeouts, and return how long the I/O thread may wait (-1 = forever)
+  int Housekeeping(std::vector<std::unique_ptr<Process>> &finished);
+  static void FinishProcess(Process &process);
+
+  static constexpr size_t LINE_BUFFER_SIZE = 64 * 1024;  // Longest line kept whole
+  static constexpr int HOUSEKEEPING_MS = 1000;  // Only while children exist
+  static constexpr int EXIT_POLL_MS = 50;       // Output ended, exit pending
+  // A grandchild (e.g. ffmpeg) can hold the pipe open after the child exits
+  static constexpr int EXIT_GRACE_MS = 2000;
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<int, std::unique_ptr<Process>> m_processes;
+  int m_nextId = 1;
+  std::atomic<bool> m_stopping{false};
+  std::thread m_thread;
+
+#ifdef _WIN32
+  void *m_completionPort = nullptr;
+#else
+  int m_wakePipe[2] = {-1, -1};
+#endif
+};
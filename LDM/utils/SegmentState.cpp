@@ -0,0 +1,51 @@
+#include "SegmentState.h"
+
+#include <fstream>
+
+uint64_t SegmentState::Hash(const MediaTrack &track) {
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+      hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ull;
+    }
+  };
+  for (const MediaSegment &segment : track.segments) {
+    for (char c : segment.url) {
+      hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    mix(static_cast<uint64_t>(segment.rangeStart));
+    mix(static_cast<uint64_t>(segment.rangeLength));
+  }
+  return hash;
+}
+
+bool SegmentState::Read(const std::string &path, SegmentState &state) {
+  state = SegmentState();
+  std::ifstream file(path);
+  if (!(file >> state.segments >> state.bytes >> state.listHash)) {
+    state = SegmentState();
+    return false;
+  }
+  return true;
+}
+
+void SegmentState::Write(const std::string &path) const {
+  std::ofstream file(path, std::ios::trunc);
+  file << segments << " " << bytes << " " << listHash;
+}
+
+SegmentState SegmentState::ResumePoint(const std::string &path,
+                                       const MediaTrack &track,
+                                       int64_t fileSize, bool &listChanged) {
+  listChanged = false;
+  SegmentState state;
+  if (!Read(path, state)) {
+    return SegmentState();
+  }
+  listChanged = state.listHash != Hash(track);
+  if (listChanged || state.segments > track.segments.size() ||
+      fileSize < state.bytes) {
+    return SegmentState();
+  }
+  return state;
+}
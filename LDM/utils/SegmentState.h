@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Manifest.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Resume record kept next to a track file being assembled from segments:
+// "<segments written> <bytes written> <segment list hash>"
+struct SegmentState {
+  size_t segments = 0;
+  int64_t bytes = 0;
+  uint64_t listHash = 0;
+
+  // FNV-1a over a track's segment URLs and byte ranges. A re-fetched
+  // playlist may list other segments (a new rendition, rotated URLs), and
+  // the bytes written so far only fit the list they came from.
+  static uint64_t Hash(const MediaTrack &track);
+
+  // False, leaving a zero state, if the record is missing or unreadable
+  static bool Read(const std::string &path, SegmentState &state);
+  void Write(const std::string &path) const;
+
+  // Where a track picks up: its record, if that was written for these
+  // segments and the file holds the bytes it counts; otherwise the start.
+  // listChanged tells a different segment list from a missing record.
+  static SegmentState ResumePoint(const std::string &path,
+                                  const MediaTrack &track, int64_t fileSize,
+                                  bool &listChanged);
+};
@@ -10,7 +10,9 @@ Settings &Settings::GetInstance() {
 
 Settings::Settings()
     : m_autoStart(true), m_minimizeToTray(true), m_showNotifications(true),
-      m_maxConnections(8), m_maxSimultaneousDownloads(3), m_speedLimit(0),
+      m_maxConnections(8), m_maxSimultaneousDownloads(3), m_queuePolicy(0),
+      m_eventIntervalMs(500),
+      m_speedLimit(0),
       m_useProxy(false), m_proxyPort(8080) {
   // Set default download folder to Windows Downloads folder
   m_downloadFolder = wxStandardPaths::Get().GetUserDir(wxStandardPaths::Dir_Downloads);
@@ -41,6 +43,10 @@ void Settings::Load() {
     m_maxSimultaneousDownloads =
         std::max(1, std::stoi(db.GetSetting("max_simultaneous_downloads", "3")));
     m_speedLimit = std::max(0, std::stoi(db.GetSetting("speed_limit", "0")));
+    m_queuePolicy =
+        std::clamp(std::stoi(db.GetSetting("queue_policy", "0")), 0, 3);
+    m_eventIntervalMs = std::clamp(
+        std::stoi(db.GetSetting("events_interval_ms", "500")), 100, 10000);
   } catch (...) {
     // Use defaults on parse error
   }
@@ -71,6 +77,8 @@ void Settings::Save() {
   db.SetSetting("max_simultaneous_downloads",
                 std::to_string(m_maxSimultaneousDownloads));
   db.SetSetting("speed_limit", std::to_string(m_speedLimit));
+  db.SetSetting("queue_policy", std::to_string(m_queuePolicy));
+  db.SetSetting("events_interval_ms", std::to_string(m_eventIntervalMs));
 
   // Save proxy settings
   db.SetSetting("use_proxy", m_useProxy ? "1" : "0");
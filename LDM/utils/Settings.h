@@ -73,6 +73,26 @@ public:
     m_maxSimultaneousDownloads = std::max(1, value);
   }
 
+  // Queue order, stored as the QueuePolicy value
+  int GetQueuePolicy() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queuePolicy;
+  }
+  void SetQueuePolicy(int value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queuePolicy = std::clamp(value, 0, 3);
+  }
+
+  // Minimum gap between batches on the extension's /events stream
+  int GetEventIntervalMs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_eventIntervalMs;
+  }
+  void SetEventIntervalMs(int value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_eventIntervalMs = std::clamp(value, 100, 10000);
+  }
+
   int GetSpeedLimit() const { 
     std::lock_guard<std::mutex> lock(m_mutex);
     return m_speedLimit; 
@@ -125,6 +145,8 @@ private:
   // Connection
   int m_maxConnections;
   int m_maxSimultaneousDownloads;
+  int m_queuePolicy;
+  int m_eventIntervalMs;
   int m_speedLimit;
 
   // Proxy
@@ -0,0 +1,56 @@
+#include "SpeedLimiter.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+// Unused budget kept for a quarter of a second, so a reader that pauses
+// briefly cannot burst far past the limit afterwards
+constexpr double BURST_SECONDS = 0.25;
+}  // namespace
+
+SpeedLimiter &SpeedLimiter::GetInstance() {
+  static SpeedLimiter instance;
+  return instance;
+}
+
+void SpeedLimiter::SetLimit(int64_t bytesPerSecond) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  bytesPerSecond = std::max<int64_t>(0, bytesPerSecond);
+  if (bytesPerSecond == m_limit) {
+    return;
+  }
+  m_limit = bytesPerSecond;
+  m_available = 0.0;
+  m_lastRefill = Clock::now();
+}
+
+int64_t SpeedLimiter::GetLimit() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_limit;
+}
+
+void SpeedLimiter::Consume(int64_t bytes) {
+  if (bytes <= 0) {
+    return;
+  }
+  double waitSeconds = 0.0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_limit <= 0) {
+      return;
+    }
+    Clock::time_point now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - m_lastRefill).count();
+    m_lastRefill = now;
+    m_available = std::min(m_available + elapsed * m_limit,
+                           m_limit * BURST_SECONDS);
+    m_available -= static_cast<double>(bytes);
+    if (m_available < 0.0) {
+      waitSeconds = -m_available / m_limit;
+    }
+  }
+  if (waitSeconds > 0.0) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(waitSeconds));
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// The user's speed limit, shared by every transfer in the process: the
+// download engine and the yt-dlp stream engine both read through it, so
+// together they stay under the one cap. A token bucket with a short
+// burst; readers that overdraw it sleep off their share of the debt.
+class SpeedLimiter {
+public:
+  static SpeedLimiter &GetInstance();
+
+  SpeedLimiter() = default;  // Separate limiters are for tests
+
+  // Bytes per second; 0 lifts the limit
+  void SetLimit(int64_t bytesPerSecond);
+  int64_t GetLimit() const;
+
+  // Account for 'bytes' just read, sleeping until the budget covers them
+  void Consume(int64_t bytes);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  mutable std::mutex m_mutex;
+  int64_t m_limit = 0;
+  double m_available = 0.0;  // Bytes; negative while readers are waiting
+  Clock::time_point m_lastRefill = Clock::now();
+};
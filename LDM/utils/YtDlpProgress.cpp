@@ -0,0 +1,115 @@
+#include "YtDlpProgress.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace {
+// Parse the number at 'pos' and move past it
+bool ScanNumber(std::string_view text, size_t &pos, double &value) {
+  auto result = std::from_chars(text.data() + pos, text.data() + text.size(), value);
+  if (result.ec != std::errc()) {
+    return false;
+  }
+  pos = static_cast<size_t>(result.ptr - text.data());
+  return true;
+}
+
+void SkipChars(std::string_view text, size_t &pos, std::string_view chars) {
+  while (pos < text.size() && chars.find(text[pos]) != std::string_view::npos) {
+    ++pos;
+  }
+}
+
+// Parse "B", "KiB", "MiB", "GiB" or "TiB" at 'pos' into a multiplier
+bool ScanByteUnit(std::string_view text, size_t &pos, double &multiplier) {
+  multiplier = 1.0;
+  if (pos < text.size()) {
+    switch (text[pos]) {
+    case 'K': multiplier = 1024.0; break;
+    case 'M': multiplier = 1024.0 * 1024; break;
+    case 'G': multiplier = 1024.0 * 1024 * 1024; break;
+    case 'T': multiplier = 1024.0 * 1024 * 1024 * 1024; break;
+    default: break;
+    }
+  }
+  if (multiplier != 1.0) {
+    if (pos + 1 >= text.size() || text[pos + 1] != 'i') {
+      return false;
+    }
+    pos += 2;
+  }
+  if (pos >= text.size() || text[pos] != 'B') {
+    return false;
+  }
+  ++pos;
+  return true;
+}
+}  // namespace
+
+bool YtDlpProgress::ParseTemplate(std::string_view line,
+                                  ProgressFields &fields) {
+  size_t pos = std::string_view(TAG).size();
+  double values[4];
+  for (double &value : values) {
+    SkipChars(line, pos, " ");
+    if (!ScanNumber(line, pos, value)) {
+      value = -1.0;  // "NA"
+      while (pos < line.size() && line[pos] != ' ') {
+        ++pos;
+      }
+    }
+  }
+
+  fields.downloadedBytes = values[0];
+  fields.totalBytes = values[1] > 0 ? values[1] : values[2];
+  fields.speed = values[3];
+  if (fields.downloadedBytes >= 0 && fields.totalBytes > 0) {
+    fields.percent = std::min(100.0, fields.downloadedBytes * 100.0 / fields.totalBytes);
+  }
+  return fields.downloadedBytes >= 0;
+}
+
+bool YtDlpProgress::ParseLegacy(std::string_view line, ProgressFields &fields) {
+  size_t percentPos = line.find('%');
+  if (percentPos == std::string_view::npos) {
+    return false;
+  }
+  size_t start = percentPos;
+  while (start > 0 && (std::isdigit(static_cast<unsigned char>(line[start - 1])) ||
+                       line[start - 1] == '.')) {
+    --start;
+  }
+  double percent = 0.0;
+  auto result = std::from_chars(line.data() + start, line.data() + percentPos, percent);
+  if (start == percentPos || result.ec != std::errc()) {
+    return false;
+  }
+
+  size_t pos = line.find(" of ", percentPos);
+  double size = 0.0;
+  double multiplier = 1.0;
+  if (pos == std::string_view::npos) {
+    return false;
+  }
+  pos += 4;
+  SkipChars(line, pos, " ~");
+  if (!ScanNumber(line, pos, size) || !ScanByteUnit(line, pos, multiplier)) {
+    return false;
+  }
+  fields.percent = percent;
+  fields.totalBytes = size * multiplier;
+  fields.downloadedBytes = fields.totalBytes * percent / 100.0;
+
+  // Speed is "Unknown B/s" until yt-dlp has a sample
+  pos = line.find(" at ", pos);
+  double speed = 0.0;
+  if (pos != std::string_view::npos) {
+    pos += 4;
+    SkipChars(line, pos, " ");
+    if (ScanNumber(line, pos, speed) && ScanByteUnit(line, pos, multiplier) &&
+        line.substr(pos, 2) == "/s") {
+      fields.speed = speed * multiplier;
+    }
+  }
+  return true;
+}
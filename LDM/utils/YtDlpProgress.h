@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string_view>
+
+// Progress fields from one line of either format; negative = not present
+struct ProgressFields {
+  double percent = -1.0;
+  double totalBytes = -1.0;
+  double downloadedBytes = -1.0;
+  double speed = -1.0;
+};
+
+// Reads yt-dlp progress lines in place, without allocating: they arrive
+// several times a second for every running video.
+class YtDlpProgress {
+public:
+  // Machine-readable progress: a fixed tag, then downloaded bytes, total,
+  // estimated total and speed in bytes/s, space separated ("NA" if unknown)
+  static constexpr const char *TAG = "[LDM-progress]";
+  static constexpr const char *TEMPLATE =
+      "download:[LDM-progress] %(progress.downloaded_bytes)s "
+      "%(progress.total_bytes)s %(progress.total_bytes_estimate)s "
+      "%(progress.speed)s";
+
+  static bool IsTemplateLine(std::string_view line) {
+    return line.compare(0, std::string_view(TAG).size(), TAG) == 0;
+  }
+
+  // "[LDM-progress] 1048576 52428800 NA 2621440.5" from TEMPLATE
+  static bool ParseTemplate(std::string_view line, ProgressFields &fields);
+
+  // Legacy "[download]  45.3% of ~ 150.23MiB at   10.50MiB/s ETA 00:09"
+  static bool ParseLegacy(std::string_view line, ProgressFields &fields);
+};
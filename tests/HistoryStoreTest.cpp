@@ -0,0 +1,155 @@
+// HistoryStore keeping its string pool in step with the records: strings
+// go with the last record that used them, indexes are reused, a replaced
+// or re-filed record lets go of its old strings, and category lookups
+// and filtered finds are answered from the compact records.
+
+#include "database/DownloadRecord.h"
+#include "support/Check.h"
+#include <cstdio>
+#include <string>
+
+namespace {
+DownloadRecord MakeRecord(int id, const std::string &host,
+                          const std::string &category) {
+  DownloadRecord record;
+  record.id = id;
+  record.url = "https://" + host + "/files/" + std::to_string(id) + ".zip";
+  record.filename = std::to_string(id) + ".zip";
+  record.savePath = "C:\\Downloads\\" + category;
+  record.category = category;
+  record.totalSize = 1000 + id;
+  record.downloadedSize = record.totalSize;
+  record.status = DownloadStatus::Completed;
+  return record;
+}
+
+void TestPoolFollowsRecords() {
+  std::printf("pooled strings go with the last record using them\n");
+  HistoryStore history;
+  history.Put(MakeRecord(1, "a.com", "Music"));
+  history.Put(MakeRecord(2, "a.com", "Music"));
+  history.Put(MakeRecord(3, "b.com", "Video"));
+  // Origins a.com and b.com, two folders, two categories
+  CHECK(history.Strings().Size() == 6);
+
+  CHECK(history.Erase(3));
+  CHECK(!history.Erase(3));
+  CHECK(history.Strings().Size() == 3);
+  CHECK(history.Erase(1));
+  CHECK(history.Strings().Size() == 3);  // Record 2 still uses them
+
+  DownloadRecord record;
+  CHECK(history.Get(2, record));
+  CHECK(record.url == "https://a.com/files/2.zip");
+  CHECK(record.category == "Music");
+  CHECK(record.status == DownloadStatus::Completed);
+
+  // Freed indexes are taken again before the pool grows
+  history.Put(MakeRecord(4, "c.com", "Programs"));
+  CHECK(history.Strings().Size() == 6);
+  CHECK(history.Get(4, record));
+  CHECK(record.url == "https://c.com/files/4.zip");
+  CHECK(record.savePath == "C:\\Downloads\\Programs");
+
+  history.Clear();
+  CHECK(history.Size() == 0);
+  CHECK(history.Strings().Size() == 0);
+}
+
+void TestReplaceAndRecategorize() {
+  std::printf("a replaced or re-filed record releases its old strings\n");
+  HistoryStore history;
+  history.Put(MakeRecord(1, "a.com", "Music"));
+  history.Put(MakeRecord(1, "b.com", "Music"));
+  CHECK(history.Size() == 1);
+  CHECK(history.Strings().Size() == 3);  // a.com is gone
+
+  history.Put(MakeRecord(2, "b.com", "Music"));
+  history.Put(MakeRecord(3, "b.com", "Video"));
+  std::vector<int> changed = history.Recategorize("Music", "Audio");
+  CHECK(changed.size() == 2);
+  CHECK(history.Ids("Music").empty());
+  CHECK(history.Ids("Audio") == std::vector<int>({1, 2}));
+  CHECK(history.Ids("Video") == std::vector<int>({3}));
+  CHECK(history.Ids() == std::vector<int>({1, 2, 3}));
+  CHECK(history.Ids("Nowhere").empty());
+  CHECK(history.Recategorize("Nowhere", "Audio").empty());
+
+  // b.com, the Music and Video folders, Audio and Video
+  CHECK(history.Strings().Size() == 5);
+  DownloadRecord record;
+  CHECK(history.Get(2, record));
+  CHECK(record.category == "Audio");
+  CHECK(history.MaxId() == 3);
+}
+
+std::vector<int> IdsOf(const std::vector<DownloadRecord> &records) {
+  std::vector<int> ids;
+  for (const auto &record : records) {
+    ids.push_back(record.id);
+  }
+  return ids;
+}
+
+void TestFind() {
+  std::printf("finds filter the compact records, newest first\n");
+  HistoryStore history;
+  for (int id = 1; id <= 10; ++id) {
+    history.Put(MakeRecord(id, id % 2 ? "Odd.example.com" : "even.example.com",
+                           id <= 5 ? "Music" : "Video"));
+  }
+  int resume = 0;
+  HistoryStore::Filter all;
+  CHECK(IdsOf(history.Find(all, 100, 0, 3, 100, resume)) ==
+        std::vector<int>({10, 9, 8}));
+  CHECK(resume == -1);
+  CHECK(IdsOf(history.Find(all, 8, 5, 10, 100, resume)) ==
+        std::vector<int>({7, 6}));
+
+  HistoryStore::Filter video{"Video", "", ""};
+  CHECK(IdsOf(history.Find(video, 100, 0, 10, 100, resume)) ==
+        std::vector<int>({10, 9, 8, 7, 6}));
+  HistoryStore::Filter nowhere{"Nowhere", "", ""};
+  CHECK(history.Find(nowhere, 100, 0, 10, 100, resume).empty());
+
+  // Hosts compare lowercase, without the port
+  history.Put(MakeRecord(11, "odd.example.com:8080", "Music"));
+  HistoryStore::Filter odd{"", "odd.example.com", ""};
+  CHECK(IdsOf(history.Find(odd, 100, 0, 3, 100, resume)) ==
+        std::vector<int>({11, 9, 7}));
+  HistoryStore::Filter oddMusic{"Music", "odd.example.com", ""};
+  CHECK(IdsOf(history.Find(oddMusic, 100, 0, 10, 100, resume)) ==
+        std::vector<int>({11, 5, 3, 1}));
+
+  // Text in the filename, or anywhere in the URL across the origin
+  HistoryStore::Filter name{"", "", "3.zip"};
+  CHECK(IdsOf(history.Find(name, 100, 0, 10, 100, resume)) ==
+        std::vector<int>({3}));
+  HistoryStore::Filter url{"", "", "even.example.com/files"};
+  CHECK(IdsOf(history.Find(url, 100, 0, 10, 100, resume)) ==
+        std::vector<int>({10, 8, 6, 4, 2}));
+
+  DownloadRecord record = history.Find(name, 100, 0, 1, 100, resume).front();
+  CHECK(record.url == "https://Odd.example.com/files/3.zip");
+  CHECK(record.category == "Music");
+
+  // A spent budget stops the scan and says where to carry on
+  std::vector<int> found = IdsOf(history.Find(video, 100, 0, 10, 4, resume));
+  CHECK(found == std::vector<int>({10, 9, 8}));
+  CHECK(resume == 8);
+  found = IdsOf(history.Find(video, resume, 0, 10, 4, resume));
+  CHECK(found == std::vector<int>({7, 6}));
+  CHECK(resume == 4);
+  found = IdsOf(history.Find(video, resume, 0, 10, 4, resume));
+  CHECK(found.empty());
+  CHECK(resume == -1);
+}
+}  // namespace
+
+int main() {
+  TestPoolFollowsRecords();
+  TestReplaceAndRecategorize();
+  TestFind();
+
+  return CheckSummary();
+}
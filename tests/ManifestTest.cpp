@@ -0,0 +1,249 @@
+// Manifest parsing: an HLS master with a separate audio rendition, AES-128
+// IVs taken from the media sequence and given explicitly, EXT-X-BYTERANGE,
+// live playlists turned away, and DASH SegmentTemplates addressed by
+// $Number$ and by a SegmentTimeline. Then the .segments resume record
+// against re-fetched playlists. Fetching segments is WinINet code and is
+// not exercised here.
+
+#include "utils/Manifest.h"
+#include "utils/SegmentState.h"
+#include "support/Check.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+void TestHlsMaster() {
+  std::printf("HLS master: best variant and its audio rendition\n");
+  const char *master =
+      "#EXTM3U\n"
+      "#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"aud\",NAME=\"en,x\",DEFAULT=YES,"
+      "URI=\"audio/en.m3u8\"\n"
+      "#EXT-X-STREAM-INF:BANDWIDTH=800000,CODECS=\"avc1,mp4a\",AUDIO=\"aud\"\n"
+      "low/index.m3u8\n"
+      "#EXT-X-STREAM-INF:BANDWIDTH=2000000,AUDIO=\"aud\"\n"
+      "/hi/index.m3u8?t=1\n";
+  std::string variant;
+  std::string audio;
+  CHECK(Manifest::IsHls(master));
+  CHECK(Manifest::ParseHlsMaster(master, "https://h.com/a/b/master.m3u8?x=1",
+                                 variant, audio));
+  CHECK(variant == "https://h.com/hi/index.m3u8?t=1");
+  CHECK(audio == "https://h.com/a/b/audio/en.m3u8");
+
+  // A media playlist is not a master
+  CHECK(!Manifest::ParseHlsMaster("#EXTM3U\n#EXTINF:4,\na.ts\n"
+                                  "#EXT-X-ENDLIST\n",
+                                  "https://h.com/i.m3u8", variant, audio));
+}
+
+void TestHlsMedia() {
+  std::printf("HLS media: AES-128 IVs and byte ranges\n");
+  const char *media =
+      "#EXTM3U\r\n"
+      "#EXT-X-MEDIA-SEQUENCE:7\r\n"
+      "#EXT-X-KEY:METHOD=AES-128,URI=\"../key.bin\"\r\n"
+      "#EXTINF:4,\r\n"
+      "seg0.ts\r\n"
+      "#EXTINF:4,\r\n"
+      "seg1.ts\r\n"
+      "#EXT-X-KEY:METHOD=AES-128,URI=\"../key.bin\","
+      "IV=0x000102030405060708090A0B0C0D0E0F\r\n"
+      "#EXT-X-BYTERANGE:100@0\r\n"
+      "#EXTINF:4,\r\n"
+      "all.ts\r\n"
+      "#EXT-X-BYTERANGE:50\r\n"
+      "#EXTINF:4,\r\n"
+      "all.ts\r\n"
+      "#EXT-X-ENDLIST\r\n";
+  MediaTrack track;
+  std::string error;
+  CHECK(Manifest::ParseHlsMedia(media, "https://h.com/a/b/x/i.m3u8", track,
+                                error));
+  CHECK(error.empty());
+  CHECK(track.extension == "ts");
+  CHECK(track.keyUrls.size() == 1);
+  if (track.keyUrls.size() == 1) {
+    CHECK(track.keyUrls[0] == "https://h.com/a/b/key.bin");
+  }
+  CHECK(track.segments.size() == 4);
+  if (track.segments.size() != 4) {
+    return;
+  }
+
+  // No IV attribute: the media sequence number, big-endian
+  const MediaSegment &first = track.segments[0];
+  CHECK(first.url == "https://h.com/a/b/x/seg0.ts");
+  CHECK(first.rangeStart == -1);
+  CHECK(first.keyIndex == 0);
+  for (int i = 0; i < 15; ++i) {
+    CHECK(first.iv[i] == 0);
+  }
+  CHECK(first.iv[15] == 7);
+  CHECK(track.segments[1].iv[15] == 8);
+
+  // Explicit IV, the same for every segment under that key tag
+  for (size_t s = 2; s < 4; ++s) {
+    CHECK(track.segments[s].keyIndex == 0);
+    for (int i = 0; i < 16; ++i) {
+      CHECK(track.segments[s].iv[i] == i);
+    }
+  }
+
+  // A byte range without an offset follows the previous one
+  CHECK(track.segments[2].url == "https://h.com/a/b/x/all.ts");
+  CHECK(track.segments[2].rangeStart == 0);
+  CHECK(track.segments[2].rangeLength == 100);
+  CHECK(track.segments[3].url == "https://h.com/a/b/x/all.ts");
+  CHECK(track.segments[3].rangeStart == 100);
+  CHECK(track.segments[3].rangeLength == 50);
+}
+
+void TestLiveRejected() {
+  std::printf("live playlists and MPDs are turned away\n");
+  MediaTrack track;
+  std::string error;
+  CHECK(!Manifest::ParseHlsMedia("#EXTM3U\n#EXTINF:4,\na.ts\n",
+                                 "https://h.com/i.m3u8", track, error));
+  CHECK(error == "Live streams are not supported");
+
+  std::vector<MediaTrack> tracks;
+  error.clear();
+  const char *dynamic =
+      "<MPD type=\"dynamic\" minimumUpdatePeriod=\"PT2S\"><Period>"
+      "<AdaptationSet mimeType=\"video/mp4\"><SegmentTemplate "
+      "duration=\"2\" media=\"$Number$.m4s\"/><Representation id=\"v\" "
+      "bandwidth=\"1\"/></AdaptationSet></Period></MPD>";
+  CHECK(Manifest::IsDash(dynamic));
+  CHECK(!Manifest::ParseDash(dynamic, "https://x.com/m.mpd", tracks, error));
+  CHECK(!error.empty());
+}
+
+void TestDashTemplates() {
+  std::printf("DASH SegmentTemplate by $Number$ and by SegmentTimeline\n");
+  const char *mpd =
+      R"(<?xml version="1.0"?><!-- c -->)"
+      R"(<MPD xmlns="urn:mpeg:dash:schema:mpd:2011" type="static" )"
+      R"(mediaPresentationDuration="PT1M0.5S">)"
+      R"(<BaseURL>https://cdn.com/v/</BaseURL><Period>)"
+      R"(<AdaptationSet mimeType="video/mp4">)"
+      R"(<SegmentTemplate timescale="1000" duration="4000" startNumber="1" )"
+      R"(media="$RepresentationID$/seg-$Number%05d$.m4s" )"
+      R"(initialization="$RepresentationID$/init.mp4"/>)"
+      R"(<Representation id="v1" bandwidth="100"/>)"
+      R"(<Representation id="v2" bandwidth="500"/></AdaptationSet>)"
+      R"(<AdaptationSet contentType="audio" mimeType="audio/mp4">)"
+      R"(<Representation id="a1" bandwidth="64">)"
+      R"(<SegmentTemplate timescale="48000" media="a/$Time$.m4s?a=1&amp;b=2" )"
+      R"(initialization="a/init.mp4"><SegmentTimeline>)"
+      R"(<S t="0" d="96000" r="2"/><S d="48000" r="-1"/>)"
+      R"(</SegmentTimeline></SegmentTemplate></Representation>)"
+      R"(</AdaptationSet></Period></MPD>)";
+  std::vector<MediaTrack> tracks;
+  std::string error;
+  CHECK(Manifest::IsDash(mpd));
+  CHECK(Manifest::ParseDash(mpd, "https://x.com/m.mpd", tracks, error));
+  CHECK(tracks.size() == 2);
+  if (tracks.size() != 2) {
+    return;
+  }
+
+  // Video: the higher-bandwidth representation, 60.5 s in 4 s segments
+  const MediaTrack &video = tracks[0];
+  CHECK(video.extension == "mp4");
+  CHECK(video.segments.size() == 1 + 16);
+  if (video.segments.size() == 17) {
+    CHECK(video.segments[0].url == "https://cdn.com/v/v2/init.mp4");
+    CHECK(video.segments[1].url == "https://cdn.com/v/v2/seg-00001.m4s");
+    CHECK(video.segments[16].url == "https://cdn.com/v/v2/seg-00016.m4s");
+  }
+
+  // Audio: three 2 s segments, then 1 s segments repeated to the end
+  const MediaTrack &audio = tracks[1];
+  CHECK(audio.extension == "m4a");
+  CHECK(audio.segments.size() == 1 + 3 + 55);
+  if (audio.segments.size() == 59) {
+    CHECK(audio.segments[0].url == "https://cdn.com/v/a/init.mp4");
+    CHECK(audio.segments[1].url == "https://cdn.com/v/a/0.m4s?a=1&b=2");
+    CHECK(audio.segments[3].url == "https://cdn.com/v/a/192000.m4s?a=1&b=2");
+    CHECK(audio.segments[4].url == "https://cdn.com/v/a/288000.m4s?a=1&b=2");
+    CHECK(audio.segments[58].url ==
+          "https://cdn.com/v/a/2880000.m4s?a=1&b=2");
+  }
+}
+std::string MediaPlaylist(const std::string &firstSegment) {
+  return "#EXTM3U\n#EXTINF:4,\n" + firstSegment +
+         "\n#EXTINF:4,\nb.ts\n#EXTINF:4,\nc.ts\n#EXT-X-ENDLIST\n";
+}
+
+void TestResumeRecord() {
+  std::printf("resume record: continue, or restart on a changed list\n");
+  const std::string base = "https://h.com/v/i.m3u8";
+  const std::string path = "build/ManifestTest.segments";
+  MediaTrack track;
+  std::string error;
+  CHECK(Manifest::ParseHlsMedia(MediaPlaylist("a.ts"), base, track, error));
+
+  // Two of three segments written, 300 bytes in the file
+  SegmentState written;
+  written.segments = 2;
+  written.bytes = 300;
+  written.listHash = SegmentState::Hash(track);
+  written.Write(path);
+
+  // The same playlist fetched again continues after segment 2
+  MediaTrack again;
+  CHECK(Manifest::ParseHlsMedia(MediaPlaylist("a.ts"), base, again, error));
+  bool listChanged = true;
+  SegmentState resume = SegmentState::ResumePoint(path, again, 300, listChanged);
+  CHECK(!listChanged);
+  CHECK(resume.segments == 2);
+  CHECK(resume.bytes == 300);
+
+  // Bytes missing from the file restart the track
+  resume = SegmentState::ResumePoint(path, again, 299, listChanged);
+  CHECK(!listChanged);
+  CHECK(resume.segments == 0);
+  CHECK(resume.bytes == 0);
+
+  // A playlist listing another first segment restarts it as well
+  MediaTrack changed;
+  CHECK(Manifest::ParseHlsMedia(MediaPlaylist("a2.ts"), base, changed, error));
+  CHECK(SegmentState::Hash(changed) != SegmentState::Hash(track));
+  resume = SegmentState::ResumePoint(path, changed, 300, listChanged);
+  CHECK(listChanged);
+  CHECK(resume.segments == 0);
+  CHECK(resume.bytes == 0);
+
+  // So do other byte ranges of the same resource
+  MediaTrack ranged = track;
+  ranged.segments[1].rangeStart = 0;
+  ranged.segments[1].rangeLength = 100;
+  CHECK(SegmentState::Hash(ranged) != SegmentState::Hash(track));
+
+  // A record from before the hash was kept cannot be trusted
+  {
+    std::ofstream old(path, std::ios::trunc);
+    old << "2 300";
+  }
+  resume = SegmentState::ResumePoint(path, again, 300, listChanged);
+  CHECK(resume.segments == 0);
+  std::remove(path.c_str());
+
+  // No record: from the start
+  resume = SegmentState::ResumePoint(path, again, 0, listChanged);
+  CHECK(!listChanged);
+  CHECK(resume.segments == 0);
+}
+}  // namespace
+
+int main() {
+  TestHlsMaster();
+  TestHlsMedia();
+  TestLiveRejected();
+  TestDashTemplates();
+  TestResumeRecord();
+
+  return CheckSummary();
+}
@@ -0,0 +1,128 @@
+// ProcessRunner on its poll() path, driven by fake-yt-dlp.sh: line
+// splitting on '\r', exit codes, the idle-timeout kill and many children
+// on the one I/O thread. Run from the tests directory.
+
+#include "utils/ProcessRunner.h"
+#include "support/Check.h"
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+const char *FAKE_YT_DLP = "sh ./fake-yt-dlp.sh";
+
+struct RunResult {
+  std::vector<std::string> lines;
+  int exitCode = -1;
+  bool exited = false;
+  double seconds = 0;
+};
+
+// Runs one fake child to completion; lines are only touched by the I/O
+// thread until onExit fulfils the promise
+RunResult Run(ProcessRunner &runner, const std::string &args,
+              int idleTimeoutMs = 0) {
+  auto result = std::make_shared<RunResult>();
+  auto done = std::make_shared<std::promise<void>>();
+  std::future<void> finished = done->get_future();
+  auto start = std::chrono::steady_clock::now();
+  int id = runner.Start(
+      std::string(FAKE_YT_DLP) + " " + args,
+      [result](std::string_view line) { result->lines.emplace_back(line); },
+      [result, done](int exitCode) {
+        result->exitCode = exitCode;
+        done->set_value();
+      },
+      idleTimeoutMs);
+  if (id < 0) {
+    return *result;
+  }
+  result->exited = finished.wait_for(std::chrono::seconds(10)) ==
+                   std::future_status::ready;
+  result->seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  return *result;
+}
+
+void TestProgressLines(ProcessRunner &runner) {
+  std::printf("progress lines separated by \\r\n");
+  RunResult result = Run(runner, "progress 50");
+  CHECK(result.exited);
+  CHECK(result.exitCode == 0);
+  // Webpage line, 50 progress redraws, final line
+  CHECK(result.lines.size() == 52);
+  if (result.lines.size() == 52) {
+    CHECK(result.lines[0] == "[youtube] abc123: Downloading webpage");
+    CHECK(result.lines[1] == "[LDM-progress] 1000 50000 NA 1048576.0");
+    CHECK(result.lines[50] == "[LDM-progress] 50000 50000 NA 1048576.0");
+    CHECK(result.lines[51] == "[download] 100% of 10.00KiB");
+  }
+}
+
+void TestExitCode(ProcessRunner &runner) {
+  std::printf("non-zero exit code, stderr merged\n");
+  RunResult result = Run(runner, "fail 3");
+  CHECK(result.exited);
+  CHECK(result.exitCode == 3);
+  bool sawError = false;
+  for (const auto &line : result.lines) {
+    sawError |= line.rfind("ERROR: ", 0) == 0;
+  }
+  CHECK(sawError);
+}
+
+void TestIdleTimeout(ProcessRunner &runner) {
+  std::printf("idle child killed after the timeout\n");
+  RunResult result = Run(runner, "hang", 300);
+  CHECK(result.exited);
+  CHECK(result.exitCode != 0);
+  CHECK(result.seconds < 5.0);  // Not the script's 60 s sleep
+  CHECK(result.lines.size() == 1);
+}
+
+void TestKill(ProcessRunner &runner) {
+  std::printf("Kill() ends a silent child\n");
+  auto exited = std::make_shared<std::promise<int>>();
+  std::future<int> exitCode = exited->get_future();
+  int id = runner.Start(
+      std::string(FAKE_YT_DLP) + " hang", [](std::string_view) {},
+      [exited](int code) { exited->set_value(code); });
+  CHECK(id >= 0);
+  runner.Kill(id);
+  CHECK(exitCode.wait_for(std::chrono::seconds(5)) ==
+        std::future_status::ready);
+  CHECK(runner.GetRunningCount() == 0);
+}
+
+void TestManyChildren(ProcessRunner &runner) {
+  std::printf("32 children on the one I/O thread\n");
+  std::vector<std::future<RunResult>> runs;
+  for (int i = 0; i < 32; ++i) {
+    runs.push_back(std::async(std::launch::async, [&runner] {
+      return Run(runner, "progress 200");
+    }));
+  }
+  for (auto &run : runs) {
+    RunResult result = run.get();
+    CHECK(result.exited);
+    CHECK(result.exitCode == 0);
+    CHECK(result.lines.size() == 202);
+  }
+}
+}  // namespace
+
+int main() {
+  ProcessRunner runner;
+  TestProgressLines(runner);
+  TestExitCode(runner);
+  TestIdleTimeout(runner);
+  TestKill(runner);
+  TestManyChildren(runner);
+  runner.Shutdown();
+
+  return CheckSummary();
+}
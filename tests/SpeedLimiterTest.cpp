@@ -0,0 +1,64 @@
+// SpeedLimiter shared by two readers, as the download engine and the stream
+// engine share it: together they stay near the one limit rather than each
+// getting it. Then a lifted limit lets reads through without waiting.
+
+#include "utils/SpeedLimiter.h"
+#include "support/Bench.h"
+#include "support/Check.h"
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+namespace {
+constexpr int64_t LIMIT = 400 * 1024;  // Bytes per second
+constexpr int64_t READ_SIZE = 8 * 1024;
+constexpr int64_t PER_READER = 200 * 1024;
+
+void Read(SpeedLimiter &limiter, int64_t total) {
+  for (int64_t done = 0; done < total; done += READ_SIZE) {
+    limiter.Consume(READ_SIZE);
+  }
+}
+
+void TestSharedLimit() {
+  std::printf("two readers share one limit\n");
+  SpeedLimiter limiter;
+  limiter.SetLimit(LIMIT);
+  CHECK(limiter.GetLimit() == LIMIT);
+
+  auto start = BenchClock::now();
+  std::thread first(Read, std::ref(limiter), PER_READER);
+  std::thread second(Read, std::ref(limiter), PER_READER);
+  first.join();
+  second.join();
+  double seconds = SecondsSince(start);
+
+  // 400 KB at 400 KB/s is one second; each reader alone at the limit would
+  // take half that. Leave room for a slow machine above, not below.
+  double rate = 2 * PER_READER / seconds;
+  std::printf("  %.2f s, %.0f KB/s\n", seconds, rate / 1024);
+  CHECK(seconds > 0.8);
+  CHECK(rate < LIMIT * 1.25);
+}
+
+void TestNoLimit() {
+  std::printf("no limit, no waiting\n");
+  SpeedLimiter limiter;
+  limiter.SetLimit(LIMIT);
+  limiter.SetLimit(0);
+  CHECK(limiter.GetLimit() == 0);
+  limiter.SetLimit(-5);
+  CHECK(limiter.GetLimit() == 0);
+
+  auto start = BenchClock::now();
+  Read(limiter, 100 * 1024 * 1024);
+  CHECK(SecondsSince(start) < 0.5);
+}
+}  // namespace
+
+int main() {
+  TestSharedLimit();
+  TestNoLimit();
+
+  return CheckSummary();
+}
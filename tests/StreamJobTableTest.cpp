@@ -0,0 +1,126 @@
+// StreamJobTable through a pause and a resume: the paused job keeps the
+// same stream Downloads and their chunk offsets, its streams' reports are
+// ignored while it is parked, and once resumed the job's progress carries
+// on from the bytes already fetched instead of starting over.
+
+#include "core/StreamJobTable.h"
+#include "support/Check.h"
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+constexpr int DOWNLOAD_ID = 100;
+constexpr int VIDEO_ID = 1;
+constexpr int AUDIO_ID = 2;
+constexpr int64_t VIDEO_SIZE = 40000;
+constexpr int64_t AUDIO_SIZE = 8000;
+
+std::shared_ptr<StreamJob> MakeJob() {
+  auto job = std::make_shared<StreamJob>();
+  job->download = std::make_shared<Download>(
+      DOWNLOAD_ID, "https://www.youtube.com/watch?v=abc123", "downloads");
+  job->done = std::make_shared<std::promise<void>>();
+  job->outputPath = "downloads\\Clip.mp4";
+  int ids[] = {VIDEO_ID, AUDIO_ID};
+  int64_t sizes[] = {VIDEO_SIZE, AUDIO_SIZE};
+  for (int i = 0; i < 2; ++i) {
+    MediaStream stream;
+    stream.download = std::make_shared<Download>(
+        ids[i], "https://media.example.com/stream" + std::to_string(ids[i]),
+        "downloads");
+    stream.download->SetTotalSize(sizes[i]);
+    stream.download->InitializeChunks(4);
+    job->streams.push_back(std::move(stream));
+  }
+  return job;
+}
+
+void TestPauseAndResume() {
+  std::printf("pause then resume keeps streams, chunks and progress\n");
+  StreamJobTable table;
+  std::shared_ptr<StreamJob> job = MakeJob();
+  std::shared_ptr<Download> video = job->streams[0].download;
+  table.Add(job);
+
+  // The engine has fetched part of each of the video's segments
+  std::vector<DownloadChunk> chunks = video->GetChunksCopy();
+  CHECK(chunks.size() == 4);
+  int64_t fetched = 0;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    video->UpdateChunkProgress(static_cast<int>(i),
+                               chunks[i].startByte + 2500);
+    fetched += 2500;
+  }
+  StreamTotals totals;
+  CHECK(table.RecordProgress(VIDEO_ID, fetched, VIDEO_SIZE, 1e6, totals) ==
+        job->download);
+  CHECK(totals.downloaded == fetched);
+  CHECK(!totals.totalKnown);  // Audio has not reported yet
+  std::vector<DownloadChunk> paused = video->GetChunksCopy();
+
+  // Pause: detached and kept
+  CHECK(table.Detach(DOWNLOAD_ID) == job);
+  table.Park(job);
+  CHECK(table.Find(DOWNLOAD_ID) == nullptr);
+  CHECK(table.RecordProgress(VIDEO_ID, fetched + 100, VIDEO_SIZE, 1e6,
+                             totals) == nullptr);
+  bool allCompleted = true;
+  CHECK(table.RecordCompletion(AUDIO_ID, false, allCompleted) == -1);
+
+  // Resume: the same job, the same stream Downloads, the same offsets
+  std::shared_ptr<StreamJob> resumed = table.TakeParked(DOWNLOAD_ID);
+  CHECK(resumed == job);
+  CHECK(table.TakeParked(DOWNLOAD_ID) == nullptr);
+  if (!resumed) {
+    return;
+  }
+  CHECK(resumed->streams.size() == 2);
+  CHECK(resumed->streams[0].download == video);
+  CHECK(resumed->streams[0].download->GetId() == VIDEO_ID);
+  std::vector<DownloadChunk> after = video->GetChunksCopy();
+  CHECK(after.size() == paused.size());
+  for (size_t i = 0; i < after.size() && i < paused.size(); ++i) {
+    CHECK(after[i].startByte == paused[i].startByte);
+    CHECK(after[i].currentByte == paused[i].currentByte);
+    CHECK(after[i].currentByte == after[i].startByte + 2500);
+  }
+  CHECK(resumed->streams[0].downloaded == fetched);
+
+  // Progress continues from what the video already has
+  table.Add(resumed);
+  CHECK(table.RecordProgress(AUDIO_ID, 500, AUDIO_SIZE, 2e5, totals) ==
+        job->download);
+  CHECK(totals.downloaded == fetched + 500);
+  CHECK(totals.totalKnown);
+  CHECK(totals.total == VIDEO_SIZE + AUDIO_SIZE);
+  CHECK(table.RecordProgress(VIDEO_ID, fetched + 1000, VIDEO_SIZE, 1e6,
+                             totals) == job->download);
+  CHECK(totals.downloaded == fetched + 1000 + 500);
+
+  // Both streams finish the job
+  CHECK(table.RecordCompletion(VIDEO_ID, true, allCompleted) == DOWNLOAD_ID);
+  CHECK(!allCompleted);
+  CHECK(table.RecordCompletion(AUDIO_ID, true, allCompleted) == DOWNLOAD_ID);
+  CHECK(allCompleted);
+}
+
+void TestCancelWhilePaused() {
+  std::printf("a paused job taken for a cancel is gone\n");
+  StreamJobTable table;
+  std::shared_ptr<StreamJob> job = MakeJob();
+  table.Add(job);
+  table.Park(table.Detach(DOWNLOAD_ID));
+  CHECK(table.Detach(DOWNLOAD_ID) == nullptr);
+  CHECK(table.TakeParked(DOWNLOAD_ID) == job);
+  CHECK(table.TakeParked(DOWNLOAD_ID) == nullptr);
+  CHECK(table.DetachAll().empty());
+}
+}  // namespace
+
+int main() {
+  TestPauseAndResume();
+  TestCancelWhilePaused();
+
+  return CheckSummary();
+}
@@ -0,0 +1,70 @@
+// Memory and build time of completed history held three ways: as full
+// Download objects, as DownloadRecords, and as the CompletedRecords plus
+// StringPool the database keeps. Heap use is counted by replacing the
+// global operator new/delete (support/HeapCount.h); per-entry figures
+// include the map nodes.
+
+#include "core/Download.h"
+#include "database/DownloadRecord.h"
+#include "support/Bench.h"
+#include "support/HeapCount.h"
+#include "support/History.h"
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+template <typename Build>
+void Measure(const char *label, size_t count, Build build) {
+  size_t before = LiveHeapBytes();
+  auto start = BenchClock::now();
+  auto held = build();
+  double ms = SecondsSince(start) * 1e3;
+  size_t bytes = LiveHeapBytes() - before;
+  std::printf("  %-18s %8.1f MB  %5zu B/entry  %8.1f ms\n", label,
+              bytes / 1048576.0, bytes / count, ms);
+}
+
+void Run(int count) {
+  std::printf("%d entries\n", count);
+  std::vector<DownloadRecord> source;
+  source.reserve(count);
+  for (int id = 1; id <= count; ++id) {
+    source.push_back(MakeHistoryRecord(id));
+  }
+
+  Measure("Download", count, [&] {
+    std::map<int, std::unique_ptr<Download>> held;
+    for (const auto &record : source) {
+      held.emplace(record.id, record.ToDownload());
+    }
+    return held;
+  });
+  Measure("DownloadRecord", count, [&] {
+    std::map<int, DownloadRecord> held;
+    for (const auto &record : source) {
+      held.emplace(record.id, record);
+    }
+    return held;
+  });
+  Measure("CompletedRecord", count, [&] {
+    struct Held {
+      StringPool strings;
+      std::map<int, CompletedRecord> history;
+    } held;
+    for (const auto &record : source) {
+      held.history.emplace(record.id,
+                           CompletedRecord::FromRecord(record, held.strings));
+    }
+    return held;
+  });
+}
+}  // namespace
+
+int main() {
+  Run(100000);
+  Run(1000000);
+  return 0;
+}
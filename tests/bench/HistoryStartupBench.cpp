@@ -0,0 +1,137 @@
+// Startup to the first page of the downloads list with 100k completed
+// entries, history loaded eagerly as Downloads against kept as records
+// that the list reads by id. The database is taken as already parsed into
+// CompletedRecords; each variant then builds what DownloadManager holds
+// (the list, the id index and the status and category buckets) until the
+// newest page of the list exists. Time and live heap are measured up to
+// that point.
+
+#include "core/Download.h"
+#include "database/DownloadRecord.h"
+#include "support/Bench.h"
+#include "support/HeapCount.h"
+#include "support/History.h"
+#include <algorithm>
+#include <cstdio>
+#include <malloc.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+constexpr int HISTORY = 100000;
+constexpr int UNFINISHED = 50;
+constexpr size_t PAGE = 200;  // Rows the list draws first, generously
+
+// What the database holds once it has read its file
+struct Database {
+  std::map<int, DownloadRecord> downloads;
+  std::map<int, CompletedRecord> history;
+  StringPool strings;
+};
+
+// What the download manager indexes its Downloads by
+struct Manager {
+  using Bucket = std::map<int, std::shared_ptr<Download>>;
+  std::vector<std::shared_ptr<Download>> list;
+  std::unordered_map<int, std::shared_ptr<Download>> index;
+  std::map<DownloadStatus, Bucket> byStatus;
+  std::unordered_map<std::string, Bucket> byCategory;
+
+  void Add(std::unique_ptr<Download> download) {
+    std::shared_ptr<Download> shared(download.release());
+    int id = shared->GetId();
+    list.push_back(shared);
+    index[id] = shared;
+    byStatus[shared->GetStatus()][id] = shared;
+    byCategory[shared->GetCategory()][id] = shared;
+  }
+};
+
+// The newest rows, as the list first shows them
+std::vector<std::shared_ptr<Download>> FirstPage(const Manager &manager) {
+  std::vector<std::shared_ptr<Download>> page;
+  size_t count = std::min(PAGE, manager.list.size());
+  page.assign(manager.list.end() - count, manager.list.end());
+  return page;
+}
+
+struct Held {
+  Manager manager;
+  std::vector<int> unloadedHistory;
+  std::vector<std::shared_ptr<Download>> page;
+  std::vector<DownloadRecord> historyRows;  // Drawn from records
+};
+
+// Every record becomes a Download at startup
+Held Eager(const Database &db) {
+  Held held;
+  for (const auto &entry : db.downloads) {
+    held.manager.Add(entry.second.ToDownload());
+  }
+  for (const auto &entry : db.history) {
+    held.manager.Add(entry.second.ToRecord(entry.first, db.strings)
+                         .ToDownload());
+  }
+  held.page = FirstPage(held.manager);
+  return held;
+}
+
+// Unfinished downloads and the completed ids; the rows of history the list
+// draws are read as records and never become Downloads
+Held Lazy(const Database &db) {
+  Held held;
+  for (const auto &entry : db.downloads) {
+    held.manager.Add(entry.second.ToDownload());
+  }
+  held.unloadedHistory.reserve(db.history.size());
+  for (const auto &entry : db.history) {
+    held.unloadedHistory.push_back(entry.first);
+  }
+  held.page = FirstPage(held.manager);
+  size_t count = std::min(PAGE - held.page.size(), held.unloadedHistory.size());
+  for (size_t i = 0; i < count; ++i) {
+    int id = held.unloadedHistory[held.unloadedHistory.size() - 1 - i];
+    held.historyRows.push_back(db.history.at(id).ToRecord(id, db.strings));
+  }
+  return held;
+}
+
+template <typename Startup>
+void Measure(const char *label, const Database &db, Startup startup) {
+  // Start from a settled heap, as a starting process would; otherwise
+  // glibc consolidates the previous run's freed blocks on our clock
+  malloc_trim(0);
+  size_t before = LiveHeapBytes();
+  auto start = BenchClock::now();
+  Held held = startup(db);
+  double ms = SecondsSince(start) * 1e3;
+  size_t bytes = LiveHeapBytes() - before;
+  std::printf("  %-6s %8.2f ms  %7.1f MB  %6zu Downloads  %3zu rows\n", label,
+              ms, bytes / 1048576.0, held.manager.list.size(),
+              held.page.size() + held.historyRows.size());
+}
+}  // namespace
+
+int main() {
+  Database db;
+  for (int id = 1; id <= HISTORY; ++id) {
+    db.history.emplace(id,
+                       CompletedRecord::FromRecord(MakeHistoryRecord(id),
+                                                   db.strings));
+  }
+  for (int id = HISTORY + 1; id <= HISTORY + UNFINISHED; ++id) {
+    DownloadRecord record = MakeHistoryRecord(id);
+    record.status = DownloadStatus::Paused;
+    record.downloadedSize = record.totalSize / 2;
+    db.downloads.emplace(id, record);
+  }
+
+  std::printf("%d completed, %d unfinished: startup to the first page\n",
+              HISTORY, UNFINISHED);
+  Measure("eager", db, Eager);
+  Measure("lazy", db, Lazy);
+  return 0;
+}
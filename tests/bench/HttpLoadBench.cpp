@@ -0,0 +1,161 @@
+// Load test for HttpServer: starts the server on a loopback port and has
+// a number of keep-alive clients hammer GET /status, optionally several
+// requests deep in a pipeline. Reports requests/second and latency
+// percentiles; a pipelined request's latency runs from sending its batch.
+//
+//   HttpLoadBench [connections] [requests per connection] [pipeline depth]
+
+#include "utils/HttpServer.h"
+#include "support/Bench.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr int PORT = 45699;
+
+int Connect() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(PORT);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+// Reads one response off the connection; false on error or early close
+bool ReadResponse(int fd, std::string &buffer) {
+  while (true) {
+    size_t headEnd = buffer.find("\r\n\r\n");
+    if (headEnd != std::string::npos) {
+      size_t length = 0;
+      size_t field = buffer.find("Content-Length: ");
+      if (field != std::string::npos && field < headEnd) {
+        length = std::strtoul(buffer.c_str() + field + 16, nullptr, 10);
+      }
+      size_t total = headEnd + 4 + length;
+      if (buffer.size() >= total) {
+        if (buffer.compare(0, 12, "HTTP/1.1 200") != 0) return false;
+        buffer.erase(0, total);
+        return true;
+      }
+    }
+    char chunk[16384];
+    ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+    if (received <= 0) return false;
+    buffer.append(chunk, static_cast<size_t>(received));
+  }
+}
+
+struct ClientResult {
+  std::vector<double> latenciesUs;
+  int failures = 0;
+};
+
+void RunClient(int requests, int depth, ClientResult &result) {
+  int fd = Connect();
+  if (fd < 0) {
+    result.failures = requests;
+    return;
+  }
+  const std::string request =
+      "GET /status HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+  std::string batch;
+  for (int i = 0; i < depth; ++i) batch += request;
+
+  std::string buffer;
+  result.latenciesUs.reserve(requests);
+  for (int done = 0; done < requests; done += depth) {
+    auto sent = BenchClock::now();
+    if (send(fd, batch.data(), batch.size(), 0) !=
+        static_cast<ssize_t>(batch.size())) {
+      result.failures += requests - done;
+      break;
+    }
+    for (int i = 0; i < depth; ++i) {
+      if (!ReadResponse(fd, buffer)) {
+        result.failures += requests - done - i;
+        close(fd);
+        return;
+      }
+      result.latenciesUs.push_back(
+          SecondsSince(sent) * 1e6);
+    }
+  }
+  close(fd);
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  int connections = argc > 1 ? std::atoi(argv[1]) : 64;
+  int requests = argc > 2 ? std::atoi(argv[2]) : 2000;
+  int depth = argc > 3 ? std::atoi(argv[3]) : 1;
+  requests -= requests % depth;
+  std::signal(SIGPIPE, SIG_IGN);
+
+  HttpServer &server = HttpServer::GetInstance();
+  // A typical /status body: a few active downloads
+  std::string status =
+      "{\"status\":\"ok\",\"activeDownloads\":3,\"totalSpeed\":5242880,"
+      "\"downloads\":[";
+  for (int i = 1; i <= 3; ++i) {
+    if (i > 1) status += ",";
+    status += "{\"id\":" + std::to_string(i) +
+              ",\"filename\":\"file.zip\",\"progress\":42.5,"
+              "\"speed\":1747626}";
+  }
+  status += "]}";
+  server.SetStatusCallback([&status] { return status; });
+  if (!server.Start(PORT)) {
+    std::fprintf(stderr, "could not start the server on port %d\n", PORT);
+    return 1;
+  }
+
+  std::vector<ClientResult> results(connections);
+  std::vector<std::thread> clients;
+  auto start = BenchClock::now();
+  for (int i = 0; i < connections; ++i) {
+    clients.emplace_back(RunClient, requests, depth, std::ref(results[i]));
+  }
+  for (auto &client : clients) client.join();
+  double seconds = SecondsSince(start);
+  server.Stop();
+
+  std::vector<double> latencies;
+  int failures = 0;
+  for (const auto &result : results) {
+    latencies.insert(latencies.end(), result.latenciesUs.begin(),
+                     result.latenciesUs.end());
+    failures += result.failures;
+  }
+  if (latencies.empty()) {
+    std::fprintf(stderr, "no request succeeded\n");
+    return 1;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+  };
+  std::printf("%d connections x %d requests, pipeline depth %d\n",
+              connections, requests, depth);
+  std::printf("  %.0f requests/s, %d failed\n", latencies.size() / seconds,
+              failures);
+  std::printf("  latency p50 %.0f us, p99 %.0f us, max %.0f us\n",
+              percentile(0.50), percentile(0.99), latencies.back());
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+// Throughput of the HTTP API's JSON: JsonWriter producing a GET /downloads
+// page and JsonValue parsing a POST /downloads batch and reading every
+// field, each with thousands of downloads.
+//
+//   JsonBench [downloads]
+
+#include "utils/Json.h"
+#include "support/Bench.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+template <typename Body>
+void Measure(const char *label, size_t bytesPerRun, Body body) {
+  double perRunUs = MicrosPerRun(body);
+  std::printf("  %-22s %9.1f us/run  %7.1f MB/s\n", label, perRunUs,
+              bytesPerRun / perRunUs);
+}
+
+void SerializeDownloads(int count, JsonWriter &json) {
+  json.Clear();
+  json.BeginObject().Key("status").String("ok").Key("downloads").BeginArray();
+  for (int id = 1; id <= count; ++id) {
+    json.BeginObject()
+        .Key("id").Int(id)
+        .Key("url").String("https://cdn.example.com/files/release-" +
+                           std::to_string(id) + ".zip?sig=a1b2c3")
+        .Key("filename").String("release-" + std::to_string(id) + ".zip")
+        .Key("status").String(id % 10 == 0 ? "Downloading" : "Completed")
+        .Key("category").String("Compressed")
+        .Key("savePath").String("C:\\Users\\user\\Downloads\\Compressed")
+        .Key("size").Int(104857600 + id)
+        .Key("downloaded").Int(52428800 + id)
+        .Key("progress").Double(50.0 + (id % 500) / 10.0, 1)
+        .Key("speed").Int(id % 10 == 0 ? 1747626 : 0)
+        .Key("error").String(id % 97 == 0 ? "HTTP 503 \"Service Unavailable\""
+                                          : "")
+        .EndObject();
+  }
+  json.EndArray().Key("nextCursor").Null().EndObject();
+}
+
+std::string BuildBatch(int count) {
+  JsonWriter json(count * 200);
+  json.BeginObject().Key("token").String("0123456789abcdef").Key("downloads")
+      .BeginArray();
+  for (int id = 1; id <= count; ++id) {
+    json.BeginObject()
+        .Key("url").String("https://cdn.example.com/files/release-" +
+                           std::to_string(id) + ".zip")
+        .Key("referer").String("https://example.com/downloads/page?id=" +
+                               std::to_string(id))
+        .Key("mirrors").BeginArray()
+        .String("https://mirror1.example.org/release-" + std::to_string(id) +
+                ".zip")
+        .String("https://mirror2.example.org/release-" + std::to_string(id) +
+                ".zip")
+        .EndArray()
+        .Key("priority").Int(id % 3)
+        .Key("checksum").String("sha256:9f86d081884c7d659a2feaa0c55ad015a3bf4f"
+                                "1b2b0b822cd15d6c15b0f00a08")
+        .EndObject();
+  }
+  json.EndArray().EndObject();
+  return json.Take();
+}
+
+// What the batch handler reads out of each entry
+size_t ReadBatch(const std::string &text) {
+  JsonValue root = JsonValue::Parse(text);
+  size_t total = 0;
+  root["downloads"].ForEachElement([&total](const JsonValue &entry) {
+    total += entry["url"].AsString().size();
+    total += entry["referer"].AsString().size();
+    entry["mirrors"].ForEachElement([&total](const JsonValue &mirror) {
+      total += mirror.AsString().size();
+      return true;
+    });
+    total += static_cast<size_t>(entry["priority"].AsInt());
+    total += entry["checksum"].AsString().size();
+    return true;
+  });
+  return total;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  int count = argc > 1 ? std::atoi(argv[1]) : 5000;
+  std::printf("%d downloads\n", count);
+
+  JsonWriter writer(128 + count * 320);
+  SerializeDownloads(count, writer);
+  std::string page(writer.Str());
+  Measure("serialize /downloads", page.size(),
+          [&] { SerializeDownloads(count, writer); });
+
+  std::string batch = BuildBatch(count);
+  if (!JsonValue::Parse(batch).IsValid() || ReadBatch(batch) == 0) {
+    std::fprintf(stderr, "batch did not parse\n");
+    return 1;
+  }
+  Measure("validate batch", batch.size(),
+          [&] { return JsonValue::Parse(batch).IsValid(); });
+  volatile size_t sink = 0;
+  Measure("parse + read batch", batch.size(),
+          [&] { sink = sink + ReadBatch(batch); });
+  std::printf("  page %zu bytes, batch %zu bytes\n", page.size(),
+              batch.size());
+  return 0;
+}
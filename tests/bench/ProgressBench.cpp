@@ -0,0 +1,100 @@
+// Cost per line of the yt-dlp progress scanner, for the template and the
+// legacy format, next to the two std::regex objects ParseProgressLine
+// used to build for every line.
+//
+//   ProgressBench [lines]
+
+#include "utils/YtDlpProgress.h"
+#include "support/Bench.h"
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+// The old parser, constructing its regexes per line as it did
+bool ParseWithRegex(const std::string &line, ProgressFields &fields) {
+  std::smatch match;
+  std::regex progressRegex(R"(\s*(\d+\.?\d*)%\s+of\s+~?(\d+\.?\d*)(Ki|Mi|Gi)?B)");
+  if (!std::regex_search(line, match, progressRegex)) {
+    return false;
+  }
+  fields.percent = std::stod(match[1].str());
+  fields.totalBytes = std::stod(match[2].str());
+  std::regex speedRegex(R"(at\s+(\d+\.?\d*)(Ki|Mi|Gi)?B/s)");
+  if (std::regex_search(line, match, speedRegex)) {
+    fields.speed = std::stod(match[1].str());
+  }
+  return true;
+}
+
+template <typename Parse>
+void Measure(const char *label, const std::vector<std::string> &lines,
+             int repeat, Parse parse) {
+  size_t parsed = 0;
+  auto start = BenchClock::now();
+  for (int r = 0; r < repeat; ++r) {
+    for (const auto &line : lines) {
+      ProgressFields fields;
+      parsed += parse(line, fields) ? 1 : 0;
+    }
+  }
+  double ns = SecondsSince(start) * 1e9;
+  size_t total = lines.size() * static_cast<size_t>(repeat);
+  std::printf("  %-10s %8.1f ns/line  (%zu of %zu parsed)\n", label,
+              ns / total, parsed, total);
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  int count = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+  std::vector<std::string> templateLines;
+  std::vector<std::string> legacyLines;
+  for (int i = 0; i < count; ++i) {
+    long long done = 1048576LL * (i % 500);
+    templateLines.push_back(
+        "[LDM-progress] " + std::to_string(done) + " " +
+        (i % 4 == 0 ? std::string("NA") : std::to_string(524288000)) +
+        " 524288000 " + std::to_string(2621440 + i % 1000) + ".5");
+    char legacy[96];
+    std::snprintf(legacy, sizeof(legacy),
+                  "[download] %5.1f%% of ~ %.2fMiB at %6.2fMiB/s ETA 00:%02d",
+                  (i % 1000) / 10.0, 150.23 + i % 7, 10.5 + i % 3, i % 60);
+    legacyLines.push_back(legacy);
+  }
+
+  // The scanners agree with what the lines say
+  ProgressFields check;
+  if (!YtDlpProgress::ParseTemplate(
+          "[LDM-progress] 1048576 NA 52428800 2621440.5", check) ||
+      check.totalBytes != 52428800 || check.percent != 2.0 ||
+      !YtDlpProgress::ParseLegacy(
+          "[download]  45.3% of ~ 150.23MiB at   10.50MiB/s ETA 00:09",
+          check) ||
+      check.percent != 45.3 || check.speed != 10.5 * 1024 * 1024) {
+    std::fprintf(stderr, "scanner returned unexpected fields\n");
+    return 1;
+  }
+
+  std::printf("%d lines of each format\n", count);
+  Measure("template", templateLines, 20,
+          [](const std::string &line, ProgressFields &fields) {
+            return YtDlpProgress::IsTemplateLine(line) &&
+                   YtDlpProgress::ParseTemplate(line, fields);
+          });
+  Measure("legacy", legacyLines, 20,
+          [](const std::string &line, ProgressFields &fields) {
+            return YtDlpProgress::ParseLegacy(line, fields);
+          });
+  // Without the "~ ", which the old pattern did not accept
+  std::vector<std::string> regexLines;
+  for (int i = 0; i < count / 20; ++i) {
+    std::string line = legacyLines[i];
+    line.erase(line.find("~ "), 2);
+    regexLines.push_back(line);
+  }
+  Measure("std::regex", regexLines, 1, ParseWithRegex);
+  return 0;
+}
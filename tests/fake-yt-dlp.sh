@@ -0,0 +1,32 @@
+#!/bin/sh
+# Stands in for yt-dlp in ProcessRunnerTest. The first argument picks
+# the behaviour:
+#   progress N   N progress lines in PROGRESS_TEMPLATE form, separated by
+#                '\r' as yt-dlp redraws them, then a final line; exit 0
+#   fail CODE    an error on stderr, then exit CODE
+#   hang         one line, then silence until killed
+
+case "$1" in
+progress)
+  echo "[youtube] abc123: Downloading webpage"
+  i=1
+  while [ "$i" -le "$2" ]; do
+    printf '[LDM-progress] %d %d NA 1048576.0\r' "$((i * 1000))" "$(($2 * 1000))"
+    i=$((i + 1))
+  done
+  echo "[download] 100% of 10.00KiB"
+  ;;
+fail)
+  echo "[youtube] abc123: Downloading webpage"
+  echo "ERROR: [youtube] abc123: Video unavailable" >&2
+  exit "$2"
+  ;;
+hang)
+  echo "[youtube] abc123: Downloading webpage"
+  exec sleep 60
+  ;;
+*)
+  echo "usage: $0 progress N | fail CODE | hang" >&2
+  exit 2
+  ;;
+esac
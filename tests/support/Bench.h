@@ -0,0 +1,27 @@
+#pragma once
+
+// Timing for the benchmarks
+
+#include <chrono>
+
+using BenchClock = std::chrono::steady_clock;
+
+inline double SecondsSince(BenchClock::time_point start) {
+  return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// Runs 'body' once to warm up, then again for at least 'minSeconds';
+// returns microseconds per run
+template <typename Body>
+double MicrosPerRun(Body body, double minSeconds = 0.5) {
+  body();
+  int runs = 0;
+  auto start = BenchClock::now();
+  double seconds = 0;
+  do {
+    body();
+    ++runs;
+    seconds = SecondsSince(start);
+  } while (seconds < minSeconds);
+  return seconds * 1e6 / runs;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Minimal checks for the test programs: CHECK records a failure and
+// carries on, CheckSummary prints the outcome and gives main's exit code.
+
+#include <cstdio>
+
+inline int g_failures = 0;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+      ++g_failures;                                                        \
+    }                                                                      \
+  } while (0)
+
+inline int CheckSummary() {
+  if (g_failures) {
+    std::printf("%d check(s) failed\n", g_failures);
+    return 1;
+  }
+  std::printf("all passed\n");
+  return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Force-included when building LDM sources on Linux for the tests and
+// benchmarks: the few MSVC CRT and Winsock names the portable sources use.
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef int errno_t;
+
+inline errno_t localtime_s(std::tm *result, const std::time_t *time) {
+  return localtime_r(time, result) ? 0 : errno;
+}
+
+// Winsock on BSD sockets. SOCKET is unsigned there, as in HttpServer's
+// members, and INVALID_SOCKET is what -1 from socket() converts to.
+using SOCKET = uintptr_t;
+using WSAPOLLFD = pollfd;
+using ULONG = unsigned long;
+using SHORT = short;
+constexpr SOCKET INVALID_SOCKET = ~static_cast<SOCKET>(0);
+constexpr int SOCKET_ERROR = -1;
+constexpr int WSAEWOULDBLOCK = EWOULDBLOCK;
+
+inline int closesocket(SOCKET s) { return close(static_cast<int>(s)); }
+inline int ioctlsocket(SOCKET s, long cmd, u_long *arg) {
+  return ioctl(static_cast<int>(s), cmd, arg);
+}
+inline int WSAPoll(WSAPOLLFD *fds, ULONG count, int timeout) {
+  return poll(fds, count, timeout);
+}
+inline int WSAGetLastError() { return errno; }
+#endif
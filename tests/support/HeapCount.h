@@ -0,0 +1,40 @@
+#pragma once
+
+// Live heap bytes for the memory benchmarks, counted by replacing the
+// global operator new/delete. Include from one file of a program only.
+
+#include <cstddef>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace heapcount {
+inline size_t g_liveBytes = 0;  // As the allocator sizes blocks, not as requested
+
+// Kept out of line: once inlined into a delete expression, g++ sees a
+// pointer from operator new reach free() and warns
+[[gnu::noinline]] inline void *Allocate(size_t size) {
+  void *ptr = std::malloc(size ? size : 1);
+  if (ptr) g_liveBytes += malloc_usable_size(ptr);
+  return ptr;
+}
+
+[[gnu::noinline]] inline void Release(void *ptr) {
+  g_liveBytes -= malloc_usable_size(ptr);
+  std::free(ptr);
+}
+}  // namespace heapcount
+
+inline size_t LiveHeapBytes() { return heapcount::g_liveBytes; }
+
+void *operator new(size_t size) {
+  void *ptr = heapcount::Allocate(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr) heapcount::Release(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
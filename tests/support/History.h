@@ -0,0 +1,33 @@
+#pragma once
+
+// Synthetic download history for the history benchmarks
+
+#include "database/DownloadRecord.h"
+#include <string>
+
+// A plausible completed entry: a few hundred hosts, a handful of folders
+// and the built-in categories, with one in four carrying an ETag
+inline DownloadRecord MakeHistoryRecord(int id) {
+  static const char *categories[] = {"Compressed", "Documents", "Music",
+                                     "Programs", "Video", "General"};
+  static const char *extensions[] = {".zip", ".pdf", ".mp3",
+                                     ".exe", ".mp4", ".bin"};
+  int kind = id % 6;
+  DownloadRecord record;
+  record.id = id;
+  record.url = "https://cdn" + std::to_string(id % 300) +
+               ".example.com/files/" + std::to_string(id * 7919 % 100000) +
+               "/file-" + std::to_string(id) + extensions[kind];
+  record.filename = "file-" + std::to_string(id) + extensions[kind];
+  record.savePath =
+      "C:\\Users\\user\\Downloads\\" + std::string(categories[kind]);
+  record.category = categories[kind];
+  if (id % 4 == 0) {
+    record.etag = "\"" + std::to_string(id * 2654435761u) + "\"";
+    record.lastModified = "Tue, 15 Nov 1994 08:12:31 GMT";
+  }
+  record.totalSize = 1000000 + id;
+  record.downloadedSize = record.totalSize;
+  record.status = DownloadStatus::Completed;
+  return record;
+}